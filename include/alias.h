@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef ALIAS_H
+#define ALIAS_H
+
+#include <stdint.h>
+#include "store.h"
+#include "symbol.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// Names for concepts beyond their unique ID (README §5.2, "John" vs
+// "John Smith" vs "Jon"): an alias table mapping any number of names to
+// any number of concepts, plus a fuzzy index answering "which concepts
+// have a name within edit distance k of this string".
+//
+// Memory Model:
+// ==============
+//
+//    names (SymbolTable, ASCII-folded)      entries (one per name → concept)
+//    ┌───────────────────┐                  ┌──────────────────────────┐
+//    │ "john"   → 0 ─────┼── first_entry ─→ │ john_smith → john_doe    │
+//    │ "jon"    → 1      │                  │ jon_snow                 │
+//    └───────────────────┘                  └──────────────────────────┘
+//
+//    grams[65536]: bigram → names containing it
+//        "^j" → {0, 1}   "jo" → {0, 1}   "oh" → {0}   "n$" → {0, 1} ...
+//
+// Fuzzy lookup (q-gram count filter, then verify):
+// ==============
+//
+// Names are padded as ^name$ and cut into bigrams, so a name of length n
+// has n + 1 of them; a bigram is 16 bits, so the inverted lists are a
+// direct table, no hashing. One edit changes at most 2 bigrams, so a
+// name within distance k of the query shares at least
+//
+//     distinct_bigrams(query) - 2k
+//
+// of the query's distinct bigrams. Counting hits along the query's
+// lists (with the length filter |n - m| <= k) leaves few candidates.
+// Each candidate is then verified with Myers' bit-parallel edit
+// distance: the whole DP column lives in one 64-bit word, so a name
+// costs a handful of word operations per character, with an early exit
+// once the distance bound can no longer be met. Queries too short for
+// the count filter to prune anything (bound <= 0) fall back to verifying
+// every name of a fitting length.
+//
+// Names are at most ALIAS_MAX_LENGTH bytes; ASCII case is folded.
+
+// ----------------------------------------------------------------------------------------
+
+#define ALIAS_MAX_LENGTH 255
+#define ALIAS_GRAMS 65536
+#define ALIAS_NONE UINT32_MAX
+
+typedef struct PostingList {
+    uint32_t* names;
+    uint32_t count;
+    uint32_t capacity;
+} PostingList;
+
+typedef struct AliasIndex {
+    SymbolTable names;
+    uint8_t* name_lengths;
+    uint32_t* first_entry;      // per name, ALIAS_NONE if none
+    uint32_t name_capacity;
+
+    uint32_t* entry_concepts;
+    uint32_t* entry_next;       // next entry of the same name
+    uint32_t entry_count;
+    uint32_t entry_capacity;
+
+    PostingList* grams;         // ALIAS_GRAMS lists
+    uint32_t store_synced;      // concepts of the store already added
+} AliasIndex;
+
+typedef struct AliasMatch {
+    uint32_t concept;
+    uint32_t distance;
+    Symbol name;
+} AliasMatch;
+
+// Per-thread lookup scratch.
+typedef struct AliasWorkspace {
+    uint32_t* counts;
+    uint32_t* stamps;
+    uint32_t* candidates;
+    uint32_t capacity;
+    uint32_t stamp;
+} AliasWorkspace;
+
+void init_alias_index(AliasIndex* index);
+void free_alias_index(AliasIndex* index);
+
+Symbol alias_add(AliasIndex* index, const char* name, uint32_t concept);
+uint32_t alias_sync_store(AliasIndex* index, const ConceptStore* store);
+
+uint32_t alias_lookup(const AliasIndex* index, const char* name, uint32_t* concepts, uint32_t capacity);
+
+void init_alias_workspace(AliasWorkspace* workspace);
+void free_alias_workspace(AliasWorkspace* workspace);
+uint32_t alias_fuzzy_lookup(const AliasIndex* index, AliasWorkspace* workspace, const char* query,
+                            uint32_t max_distance, uint32_t limit, AliasMatch* out);
+
+uint32_t edit_distance(const char* a, uint32_t a_length, const char* b, uint32_t b_length, uint32_t bound);
+
+#endif
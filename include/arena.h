@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// An "Arena" is a private heap for one store shard.
+//
+// With one global malloc, every shard's arrays are interleaved in the
+// same heap: shards contend on the allocator, and there is no way to say
+// "this shard's memory lives on socket 1". An arena instead maps its own
+// chunks from the OS and hands out blocks only to its owner.
+//
+// The store grows everything by doubling, so blocks come in power-of-two
+// size classes with one free list per class:
+//
+//     chunk (64MB, mmap)
+//     ┌──────┬──────┬──────────────┬────────────────────────────┬──────
+//     │ 64B  │ 64B  │ 256B         │ 1KB                        │ ...
+//     └──────┴──────┴──────────────┴────────────────────────────┴──────
+//        ↑ freed → free_lists[64B]      carved by a bump cursor
+//
+// - Each block starts with a 16-byte header holding its size, so
+//   arena_realloc() knows whether the new size still fits in place.
+// - Blocks of ARENA_LARGE_SIZE or more get their own mapping and go
+//   straight back to the OS when freed.
+// - `node` is the NUMA node of the shard that owns the arena (-1 for
+//   none). Every mapping is bound to it before first touch (numa.h), so
+//   the shard's arrays are local to the threads pinned next to it.
+//
+// An arena is not thread-safe: it belongs to whoever holds its shard's
+// write lock.
+
+// ----------------------------------------------------------------------------------------
+
+#define ARENA_CHUNK_SIZE ((size_t)64 << 20)
+#define ARENA_MIN_SHIFT 6                       // 64-byte blocks
+#define ARENA_LARGE_SHIFT 24                    // 16MB and up: own mapping
+#define ARENA_LARGE_SIZE ((size_t)1 << ARENA_LARGE_SHIFT)
+#define ARENA_CLASS_COUNT (ARENA_LARGE_SHIFT - ARENA_MIN_SHIFT)
+#define ARENA_HEADER 16
+
+typedef struct ArenaLarge ArenaLarge;
+
+typedef struct Arena {
+    char** chunks;
+    uint32_t chunk_count;
+    uint32_t chunk_capacity;
+    char* cursor;               // next free byte of the newest chunk
+    char* limit;
+
+    void* free_lists[ARENA_CLASS_COUNT];
+    ArenaLarge* large;          // live large blocks, so free_arena() can unmap them
+
+    int node;                   // NUMA node for new mappings, -1 for none
+    size_t mapped;              // bytes mapped from the OS
+    size_t in_use;              // bytes in live blocks, headers included
+} Arena;
+
+void init_arena(Arena* arena, int node);
+void free_arena(Arena* arena);
+void arena_set_node(Arena* arena, int node);
+
+void* arena_alloc(Arena* arena, size_t size);
+void* arena_realloc(Arena* arena, void* ptr, size_t size);
+void arena_free(Arena* arena, void* ptr);
+
+#endif
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include <stdint.h>
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// A "RoaringBitmap" is a compressed set of uint32 concept indexes.
+//
+// The 32-bit space is cut into 65536 chunks of 65536 values, keyed by the
+// high 16 bits. Each non-empty chunk gets one container holding the low
+// 16 bits of its members, in whichever form is smaller:
+//
+//     ARRAY  → sorted uint16_t[], up to 4096 entries (≤ 8KB)
+//     BITSET → 1024 x uint64_t, always 8KB
+//
+// 4096 is the break-even point: past it an array would be larger than
+// the bitset. Sparse types ("Planet") stay tiny; dense types ("Person")
+// cost one bit per concept.
+//
+// Memory Model:
+// ==============
+//
+//    RoaringBitmap
+//    ┌────────────────────────┐
+//    │ containers → ─────┐    │
+//    │ count      →   2  │    │
+//    └───────────────────┼────┘
+//                        ↓
+//    ┌──────────────────────────────┬──────────────────────────────┐
+//    │ key 0x0000  ARRAY  card 3    │ key 0x0002  BITSET card 9000 │
+//    │ [12, 80, 4000]               │ [1024 words]                 │
+//    └──────────────────────────────┴──────────────────────────────┘
+//    = {12, 80, 4000, 131072 + ...}
+//
+// Containers are kept sorted by key, so set operations are a merge over
+// the two container lists. Bitset-vs-bitset AND/OR/ANDNOT (the dense,
+// expensive case) runs through AVX2 / AVX-512 kernels chosen by
+// cpu_level(); array cases use merges and bit probes.
+//
+// A zeroed RoaringBitmap is a valid empty set.
+
+// ----------------------------------------------------------------------------------------
+
+#define ROARING_ARRAY_MAX 4096
+#define ROARING_BITSET_WORDS 1024
+
+typedef enum RoaringContainerType {
+    ROARING_ARRAY = 0,
+    ROARING_BITSET = 1
+} RoaringContainerType;
+
+typedef struct RoaringContainer {
+    uint16_t key;
+    uint8_t type;
+    uint32_t cardinality;
+    uint32_t capacity;          // ARRAY only: allocated uint16_t entries
+    union {
+        uint16_t* array;
+        uint64_t* bits;
+    } data;
+} RoaringContainer;
+
+typedef struct RoaringBitmap {
+    RoaringContainer* containers;
+    uint32_t count;
+    uint32_t capacity;
+} RoaringBitmap;
+
+void init_roaring(RoaringBitmap* bitmap);
+void free_roaring(RoaringBitmap* bitmap);
+void clear_roaring(RoaringBitmap* bitmap);
+
+void roaring_add(RoaringBitmap* bitmap, uint32_t value);
+void roaring_remove(RoaringBitmap* bitmap, uint32_t value);
+int roaring_contains(const RoaringBitmap* bitmap, uint32_t value);
+uint64_t roaring_cardinality(const RoaringBitmap* bitmap);
+
+// Set algebra. `out` must be initialized; its previous contents are
+// replaced. `out` may not alias either input.
+void roaring_and(const RoaringBitmap* a, const RoaringBitmap* b, RoaringBitmap* out);
+void roaring_or(const RoaringBitmap* a, const RoaringBitmap* b, RoaringBitmap* out);
+void roaring_andnot(const RoaringBitmap* a, const RoaringBitmap* b, RoaringBitmap* out);
+
+// Write the members in increasing order; `out` holds roaring_cardinality() entries.
+uint32_t roaring_to_array(const RoaringBitmap* bitmap, uint32_t* out);
+
+#endif
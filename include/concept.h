@@ -44,19 +44,32 @@
 // Memory Model:
 // ==============
 //
-//    Concept
-//    ┌───────────────────────┐
-//    │ id         → "john"   │
-//    │ type       → "Person" │
-//    │ slots      → ──────┐  │
-//    │ slot_count →    2  │  │
-//    │ slot_capacity → 4  │  │
-//    └───────────────────────┘
-//                       ↓
-//              ┌──────────────────────────────┐
-//              │ Slot 0: "owns" → → book1     │
-//              │ Slot 1: "likes" → → jane     │
-//              └──────────────────────────────┘
+//    Concept (64 bytes, allocated on a cache-line boundary)
+//    ┌──────────────────────────────────┐
+//    │ id            → "john"           │
+//    │ type          → "Person"         │
+//    │ slots         → ──────┐          │
+//    │ slot_count    →    2  │          │
+//    │ slot_capacity →    2  ↓          │
+//    │ inline_slots[0]: "owns"  → book1 │
+//    │ inline_slots[1]: "likes" → jane  │
+//    └──────────────────────────────────┘
+//
+// Most concepts are leaves with 0-3 slots, so the first
+// CONCEPT_INLINE_SLOTS slots live inside the Concept allocation itself
+// and `slots` points at `inline_slots`. Only when a concept outgrows
+// them do we spill to a heap array (and `slots` moves there):
+//
+//    Concept                             heap
+//    ┌───────────────────────┐           ┌──────────────────────────┐
+//    │ slots      → ─────────┼─────────→ │ Slot 0: "owns"  → book1  │
+//    │ slot_count →    3     │           │ Slot 1: "likes" → jane   │
+//    │ slot_capacity → 4     │           │ Slot 2: "hates" → enemy  │
+//    │ inline_slots (unused) │           │ (free)                   │
+//    └───────────────────────┘           └──────────────────────────┘
+//
+// Readers never need to care which case they are in: always go
+// through `concept->slots`.
 
 // ---
 // API Thoughts (to write later):
@@ -69,18 +82,31 @@ typedef struct Concept Concept;
 typedef struct Slot {
     char* name;
     Concept* target;
-} Slot
+} Slot;
+
+// Number of slots stored inline in the Concept before spilling to the heap.
+// The default of 2 keeps sizeof(Concept) at exactly 64 bytes on LP64
+// targets; override with -DCONCEPT_INLINE_SLOTS=N.
+#ifndef CONCEPT_INLINE_SLOTS
+#define CONCEPT_INLINE_SLOTS 2
+#endif
+
+// create_concept() aligns every Concept to this, so with the default
+// inline slots each one fills exactly one cache line.
+#define CONCEPT_ALIGNMENT 64
 
 struct Concept {
     char* id;
     char* types;
-    Slot* slots;
+    Slot* slots;            // == inline_slots until the first spill
     int slot_count;
     int slot_capacity;
-}
+    Slot inline_slots[CONCEPT_INLINE_SLOTS];
+};
 
 void print_concept(const Concept* concept);
 void add_slot(Concept* concept, const char* slot_name, Concept* target);
-void create_concept(const char* id, const char* type);
+Concept* create_concept(const char* id, const char* type);
+void free_concept(Concept* concept);
 
 #endif
@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef CPU_H
+#define CPU_H
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// Runtime CPU feature detection for the SIMD kernels.
+//
+// We build one binary with plain CFLAGS and compile each kernel variant
+// with __attribute__((target(...))), so the same executable runs on any
+// x86-64 and picks the widest path the machine supports.
+//
+// Levels are cumulative: AVX512 implies AVX2 implies SSE2.
+//     SSE2   → baseline x86-64
+//     AVX2   → AVX2 + FMA
+//     AVX512 → AVX-512 F + BW
+//
+// Set CLARITY_CPU_LEVEL=scalar|sse2|avx2|avx512 to cap the level (e.g.
+// to exercise a fallback path on a machine that has everything).
+
+// ----------------------------------------------------------------------------------------
+
+typedef enum CpuLevel {
+    CPU_LEVEL_SCALAR = 0,
+    CPU_LEVEL_SSE2,
+    CPU_LEVEL_AVX2,
+    CPU_LEVEL_AVX512
+} CpuLevel;
+
+CpuLevel cpu_level(void);
+const char* cpu_level_name(CpuLevel level);
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CLARITY_X86 1
+#else
+#define CLARITY_X86 0
+#endif
+
+#endif
@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef DISTANCE_H
+#define DISTANCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// Vector distance kernels for embedding search (README §3.1.1: a token
+// maps to argmin_i d(E(t), E(concept_i))). Brute-force and HNSW search
+// spend nearly all their time here.
+//
+// Formats:
+// ==============
+//
+//     fp32   float                  4 B / dim
+//     fp16   uint16_t, IEEE binary16   2 B / dim   halves memory traffic
+//     int16  int16_t                 2 B / dim   fixed-point codes (quantize.h)
+//     int8   int8_t                  1 B / dim   integer dot / L2, exact
+//
+// Metrics (smaller is always closer):
+//
+//     DISTANCE_L2              Σ (a_i - b_i)²          (squared, no root)
+//     DISTANCE_INNER_PRODUCT   1 - Σ a_i b_i
+//     DISTANCE_COSINE          1 - a·b / (|a| |b|)    (1 if either is zero)
+//
+// For int8 the sums are exact integers, returned as float; for int16
+// they are accumulated in fp32. Scales from quantization are the
+// caller's business.
+//
+// Kernels:
+// ==============
+//
+// As in scan.c, each kernel is compiled per level with target
+// attributes and picked once from cpu_level():
+//     scalar  plain loops (also used at the sse2 level)
+//     avx2    8 floats per FMA, F16C for fp16, vpmaddwd for int8
+//             (fp16 falls back to scalar on a CPU without F16C)
+//     avx512  16 floats per FMA, masked tails for fp32, 32 int8 per madd
+//
+// Batched forms:
+//     *_many    one query against `count` rows `stride` elements apart
+//               → out[count]
+//     *_matrix  `query_count` queries against `row_count` rows
+//               → out[query_count · row_count], row-major by query.
+//               Rows are swept in tiles that fit L1, so each tile is read
+//               from memory once for all queries.
+
+// ----------------------------------------------------------------------------------------
+
+typedef enum DistanceMetric {
+    DISTANCE_L2 = 0,
+    DISTANCE_INNER_PRODUCT,
+    DISTANCE_COSINE,
+} DistanceMetric;
+
+typedef struct Neighbor {
+    uint32_t concept;
+    float distance;
+} Neighbor;
+
+typedef float (*DistanceF32Fn)(const float* a, const float* b, uint32_t dimensions);
+
+const char* distance_kernel_name(void);
+
+// fp16 <-> fp32 (round to nearest even).
+uint16_t float_to_half(float value);
+float half_to_float(uint16_t half);
+void floats_to_halves(const float* src, uint32_t count, uint16_t* dst);
+void halves_to_floats(const uint16_t* src, uint32_t count, float* dst);
+
+// Raw kernels.
+float dot_f32(const float* a, const float* b, uint32_t dimensions);
+float l2sq_f32(const float* a, const float* b, uint32_t dimensions);
+float dot_f16(const uint16_t* a, const uint16_t* b, uint32_t dimensions);
+float l2sq_f16(const uint16_t* a, const uint16_t* b, uint32_t dimensions);
+float dot_i16(const int16_t* a, const int16_t* b, uint32_t dimensions);
+float l2sq_i16(const int16_t* a, const int16_t* b, uint32_t dimensions);
+int32_t dot_i8(const int8_t* a, const int8_t* b, uint32_t dimensions);
+int32_t l2sq_i8(const int8_t* a, const int8_t* b, uint32_t dimensions);
+
+float vector_norm(const float* a, uint32_t dimensions);
+
+// By metric.
+DistanceF32Fn distance_f32_kernel(DistanceMetric metric);
+float distance_f32(DistanceMetric metric, const float* a, const float* b, uint32_t dimensions);
+float distance_f16(DistanceMetric metric, const uint16_t* a, const uint16_t* b, uint32_t dimensions);
+float distance_i8(DistanceMetric metric, const int8_t* a, const int8_t* b, uint32_t dimensions);
+
+// Top-k selection: `heap` is a bounded max-heap of up to `limit`
+// entries; neighbors_sort() orders it nearest first (ties by concept).
+void neighbors_keep(Neighbor* heap, uint32_t* count, uint32_t limit, uint32_t concept, float distance);
+void neighbors_sort(Neighbor* neighbors, uint32_t count);
+
+void distance_f32_many(DistanceMetric metric, const float* query, const float* rows, size_t stride,
+                       uint32_t count, uint32_t dimensions, float* out);
+void distance_f16_many(DistanceMetric metric, const uint16_t* query, const uint16_t* rows, size_t stride,
+                       uint32_t count, uint32_t dimensions, float* out);
+void distance_i8_many(DistanceMetric metric, const int8_t* query, const int8_t* rows, size_t stride,
+                      uint32_t count, uint32_t dimensions, float* out);
+
+void distance_f32_matrix(DistanceMetric metric, const float* queries, size_t query_stride, uint32_t query_count,
+                         const float* rows, size_t row_stride, uint32_t row_count, uint32_t dimensions, float* out);
+void distance_f16_matrix(DistanceMetric metric, const uint16_t* queries, size_t query_stride, uint32_t query_count,
+                         const uint16_t* rows, size_t row_stride, uint32_t row_count, uint32_t dimensions, float* out);
+void distance_i8_matrix(DistanceMetric metric, const int8_t* queries, size_t query_stride, uint32_t query_count,
+                        const int8_t* rows, size_t row_stride, uint32_t row_count, uint32_t dimensions, float* out);
+
+#endif
@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <stdint.h>
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// Epoch-based reclamation: free memory only once no reader can still be
+// looking at it.
+//
+// Writers commit numbered versions (current = 1, 2, 3, ...). A reader
+// *pins* the version that was current when it started; while pinned it
+// may keep using any array it has loaded. When a writer replaces an
+// array (growth, compaction) it does not free the old one, it *retires*
+// it, tagged with the version being written:
+//
+//     version 7 being written:   names v1 ──retire(7)──→ retired list
+//                                names v2 (published)
+//
+//     reader pinned at 6   → may still hold v1, so v1 stays
+//     readers all at ≥ 7   → loaded v2 after it was published: free v1
+//
+// Reader slots are padded to a cache line each, so pinning and unpinning
+// on different threads never share a line.
+//
+// Moves:
+// ======
+//
+// Pinning keeps old arrays alive, but a reader also has to *locate* data
+// consistently (an array pointer plus an offset into it) while a writer
+// may be relocating it. `sequence` is a seqlock around such moves: odd
+// while one is in progress. Readers load their pointers and offsets
+// between epoch_read_begin() and epoch_read_retry() and go again if a
+// move overlapped. Writes that only add data past what readers can see
+// need no move, so under a steady stream of appends readers never retry.
+//
+// Threading:
+// ==========
+//
+// epoch_pin() / epoch_unpin() may be called from any thread. Everything
+// else (retire, commit, reclaim) belongs to the single writer, or to
+// whoever holds the writers' lock.
+
+// ----------------------------------------------------------------------------------------
+
+#define EPOCH_MAX_READERS 64
+#define EPOCH_IDLE UINT64_MAX
+
+typedef struct EpochReader {
+    uint64_t epoch;             // pinned version, EPOCH_IDLE if the slot is free
+    char pad[56];
+} EpochReader;
+
+typedef void (*EpochRelease)(void* context, void* ptr);
+
+typedef struct EpochRetired {
+    void* ptr;
+    uint64_t epoch;             // version that replaced it
+    EpochRelease release;       // NULL: free()
+    void* context;
+} EpochRetired;
+
+typedef struct EpochManager {
+    uint64_t current;           // last committed version
+    uint32_t sequence;          // odd while a move is in progress
+    uint32_t move_depth;        // writer only: nested epoch_move_begin() calls
+    EpochReader readers[EPOCH_MAX_READERS];
+
+    EpochRetired* retired;
+    uint32_t retired_count;
+    uint32_t retired_capacity;
+} EpochManager;
+
+void init_epochs(EpochManager* epochs);
+void free_epochs(EpochManager* epochs);
+
+int epoch_pin(EpochManager* epochs, uint64_t* epoch);
+void epoch_unpin(EpochManager* epochs, int reader);
+uint64_t epoch_oldest(const EpochManager* epochs);
+
+void epoch_retire(EpochManager* epochs, void* ptr);
+void epoch_retire_to(EpochManager* epochs, void* ptr, EpochRelease release, void* context);
+void epoch_commit(EpochManager* epochs);
+uint32_t epoch_reclaim(EpochManager* epochs);
+
+void epoch_move_begin(EpochManager* epochs);
+void epoch_move_end(EpochManager* epochs);
+uint32_t epoch_read_begin(const EpochManager* epochs);
+int epoch_read_retry(const EpochManager* epochs, uint32_t sequence);
+
+#endif
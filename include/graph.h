@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#include <stdint.h>
+#include "scheduler.h"
+#include "store.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// Whole-graph analytics over a ConceptStore: which concepts matter
+// (PageRank), what hangs together (weakly connected components) and
+// what the fan-out looks like (degree statistics). They feed fact
+// ranking for prompt injection and eviction (README §5.2, the
+// "representation explosion").
+//
+// The store's slot pools already are a CSR with gaps: per concept an
+// offset and a degree into one neighbors array, for both directions.
+// The algorithms read them in place; no copy is built.
+//
+// Parallelism:
+// ==============
+//
+// Everything is a parallel_for() over concept ranges on the given
+// scheduler (NULL runs single-threaded):
+//
+// - PageRank *pulls*: each concept sums the contributions of its
+//   in-slot sources and writes only its own score, so no two tasks
+//   write the same word. Only the per-range totals (dangling mass,
+//   change) are combined atomically, once per range.
+//
+// - Components are a concurrent union-find. A root is always linked
+//   under a smaller index, so parent[x] <= x forever; that makes a CAS
+//   on the root enough to link, and lets path halving use plain CASes
+//   too (every write moves a pointer to a smaller ancestor). Each
+//   component ends up labelled by its smallest concept index.
+//
+// Only current slots count (not history), and each slot is one edge:
+// two "knows" slots between the same pair weigh twice. The store must
+// not be written while these run.
+
+// ----------------------------------------------------------------------------------------
+
+#define PAGERANK_DAMPING 0.85f
+#define PAGERANK_TOLERANCE 1e-6f
+#define PAGERANK_MAX_ITERATIONS 100
+
+#define DEGREE_BUCKETS 33           // 0, then [2^(k-1), 2^k) for k = 1..32
+
+typedef struct DegreeStats {
+    uint32_t concept_count;
+    uint64_t slot_count;            // sum of the degrees
+    uint32_t min;
+    uint32_t max;
+    uint32_t max_concept;           // a concept with the max degree
+    double mean;
+    uint32_t histogram[DEGREE_BUCKETS];
+} DegreeStats;
+
+uint32_t store_pagerank(const ConceptStore* store, Scheduler* scheduler, const uint32_t* seeds, uint32_t seed_count,
+                        float damping, float tolerance, uint32_t max_iterations, float* scores);
+uint32_t store_components(const ConceptStore* store, Scheduler* scheduler, uint32_t* component);
+void store_degree_stats(const ConceptStore* store, Scheduler* scheduler, int incoming, DegreeStats* stats);
+
+uint32_t degree_bucket(uint32_t degree);
+
+#endif
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef HNSW_H
+#define HNSW_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "distance.h"
+#include "scheduler.h"
+#include "vectors.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// HNSW (Hierarchical Navigable Small World) index over the embeddings
+// of a ConceptVectorStore: approximate k nearest concepts in about
+// O(log N) distance computations (README §3.2.3, §7).
+//
+// Structure:
+// ==============
+//
+// Every concept is a node on level 0; each node is also on levels
+// 1..L with probability M^-L. Each level is a proximity graph: a node
+// keeps links to up to M nearby nodes (2M on level 0). A search starts
+// at the single top-level entry point, walks greedily downhill level by
+// level, then does a best-first search of width `ef` on level 0:
+//
+//     level 2:  E ─────────────── x
+//     level 1:  E ───── x ─── y ───── z
+//     level 0:  E ─ a ─ x ─ b ─ y ─ c ─ z ─ q  ← ef-wide search ends here
+//
+// Neighbors are chosen with the diversity heuristic: a candidate is
+// linked only if it is closer to the node than to every neighbor picked
+// so far, so links point in different directions instead of all into
+// one dense cluster.
+//
+// Memory Model:
+// ==============
+//
+// Node ids *are* concept indexes, so no id mapping. Per node:
+//
+//     links0 [node · (1 + 2M)]   → [count, n0, n1, ...]       level 0, flat
+//     upper  [node]              → [count, n0 .. nM-1] × level levels 1..level
+//     levels [node]              → -1 if not in the index
+//
+// Concurrency:
+// ==============
+//
+// - Inserts and searches run concurrently from any number of threads.
+// - Each node's link lists are guarded by a one-byte spinlock: readers
+//   copy the list out under it, writers update under it.
+// - The entry point / top level are guarded by `entry_lock`. An insert
+//   that raises the top level holds it for its whole insert, as in the
+//   reference implementation.
+// - Growing the per-node arrays takes `resize_lock` for writing; every
+//   insert and search holds it for reading.
+// - Search scratch (the visited set, one stamp per node, plus the link
+//   buffer, candidate and result heaps) is pooled: a search or insert
+//   takes one from the pool and returns it, so after warm-up a search
+//   allocates nothing.
+//
+// Deletion is not supported; concepts whose embedding changes must be
+// re-indexed by rebuilding. hnsw_save() / hnsw_load() write the graph
+// only: the vectors come from the ConceptVectorStore.
+
+// ----------------------------------------------------------------------------------------
+
+#define HNSW_DEFAULT_M 16
+#define HNSW_DEFAULT_EF_CONSTRUCTION 200
+#define HNSW_DEFAULT_EF_SEARCH 64
+#define HNSW_MAX_LEVEL 16
+#define HNSW_MAX_M 256
+
+typedef enum HnswMetric {
+    HNSW_METRIC_L2 = DISTANCE_L2,                       // squared euclidean
+    HNSW_METRIC_INNER_PRODUCT = DISTANCE_INNER_PRODUCT, // 1 - dot; cosine on normalized vectors
+    HNSW_METRIC_COSINE = DISTANCE_COSINE,
+} HnswMetric;
+
+typedef Neighbor HnswResult;
+
+typedef struct HnswScratch HnswScratch;
+
+typedef struct HnswIndex {
+    const ConceptVectorStore* vectors;
+    HnswMetric metric;
+    DistanceF32Fn distance;     // resolved once from metric and cpu_level()
+    uint32_t m;
+    uint32_t ef_construction;
+    uint32_t ef_search;
+
+    uint32_t capacity;          // nodes the arrays cover
+    uint32_t count;             // nodes inserted
+    int8_t* levels;
+    uint8_t* locks;
+    uint32_t* links0;
+    uint32_t** upper;
+
+    uint32_t entry;             // UINT32_MAX while empty
+    int32_t max_level;
+    pthread_mutex_t entry_lock;
+    pthread_rwlock_t resize_lock;
+
+    HnswScratch* scratch_pool;
+    pthread_mutex_t scratch_lock;
+} HnswIndex;
+
+void init_hnsw(HnswIndex* index, const ConceptVectorStore* vectors, HnswMetric metric,
+               uint32_t m, uint32_t ef_construction);
+void free_hnsw(HnswIndex* index);
+
+int hnsw_insert(HnswIndex* index, uint32_t concept);
+void hnsw_insert_all(HnswIndex* index, Scheduler* scheduler);
+uint32_t hnsw_search(HnswIndex* index, const float* query, uint32_t k, uint32_t ef, HnswResult* out);
+
+int hnsw_save(const HnswIndex* index, const char* path);
+int hnsw_load(HnswIndex* index, const ConceptVectorStore* vectors, const char* path);
+
+#endif
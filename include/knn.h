@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef KNN_H
+#define KNN_H
+
+#include <stdint.h>
+#include "distance.h"
+#include "hnsw.h"
+#include "scheduler.h"
+#include "vectors.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// Exact k nearest neighbors by brute force over a ConceptVectorStore:
+// the baseline for small stores (up to ~100K concepts) and the ground
+// truth for measuring approximate indexes (HNSW, LSH, quantized).
+//
+// Every metric reduces to dot products given the norms:
+//     L2      |q|² + |r|² - 2 q·r
+//     IP      1 - q·r
+//     cosine  1 - q·r / (|q| |r|)
+// so the work is a queries × rows matrix product, done GEMM-style.
+//
+// Blocking:
+// ==============
+//
+//              rows (tile of KNN_ROW_TILE, stays in L2)
+//            ┌──────────────────────────┐
+//   queries  │ 4×4 │ 4×4 │ 4×4 │ ...    │  ← a 4×4 micro-kernel keeps 16
+//   (blocks  │─────┼─────┼─────┤        │    dot products in registers
+//    of 4)   │ 4×4 │ ...                │    over the whole row stride
+//            └──────────────────────────┘
+//
+// - Queries are copied into zero-padded rows of the store's stride, so
+//   the kernels run over whole 64-byte lines with no tails.
+// - Each 4×4 block of dots is turned into distances and pushed straight
+//   into the per-query top-k heaps (fused; no N-sized distance buffer).
+// - Many queries: tasks take blocks of queries and sweep all rows.
+//   Few queries: tasks take row ranges with private heaps, merged at the
+//   end, so a single query still uses every worker.
+
+// ----------------------------------------------------------------------------------------
+
+#define KNN_ROW_TILE 256
+#define KNN_QUERY_BLOCK 4
+
+uint32_t knn_exact(const ConceptVectorStore* vectors, DistanceMetric metric, const float* queries, size_t stride,
+                   uint32_t query_count, uint32_t k, Scheduler* scheduler, Neighbor* out, uint32_t* counts);
+
+float knn_recall(const Neighbor* exact, const uint32_t* exact_counts, const Neighbor* approximate,
+                 const uint32_t* approximate_counts, uint32_t query_count, uint32_t k);
+float hnsw_recall(HnswIndex* index, const float* queries, size_t stride, uint32_t query_count,
+                  uint32_t k, uint32_t ef, Scheduler* scheduler);
+
+const char* knn_kernel_name(void);
+
+#endif
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef LSH_H
+#define LSH_H
+
+#include <stdint.h>
+#include "distance.h"
+#include "scheduler.h"
+#include "vectors.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// Random-hyperplane (SimHash) LSH over concept embeddings: the token →
+// concept bridge of README §3.1.1. Cheaper than HNSW as a first-stage
+// candidate generator run on every token of every forward pass.
+//
+// Hashing:
+// ==============
+//
+// A random hyperplane through the origin splits space in two; two
+// vectors at angle θ land on the same side with probability 1 - θ/π.
+// With B planes a vector gets a B-bit key, and near vectors share keys.
+//
+//     table t:  key_t(x) = [ sign(p_t0 · x), ..., sign(p_t,B-1 · x) ]
+//
+// L independent tables raise recall: a concept is a candidate if it
+// shares the key of the query in *any* table. On top of the keys, every
+// concept has a 128-bit signature from 128 more planes; its Hamming
+// distance to the query's estimates θ and filters candidates cheaply.
+//
+// Memory Model:
+// ==============
+//
+// Each table is a counting-sorted bucket array, so a bucket is one
+// contiguous run of ids and their signatures:
+//
+//     offsets[t]  [0, 3, 3, 7, ...]              2^B + 1 entries
+//     ids[t]      [c4 c9 c1 | | c2 c8 c3 c5 | ...]
+//     sigs[t]     [s4 s9 s1 | | s2 s8 s3 s5 | ...]  2 words per entry
+//
+// Scanning a bucket streams its signatures through a SIMD popcount of
+// (query ^ signature) and keeps those within `max_hamming`.
+//
+// The index is built in one pass from a ConceptVectorStore and is
+// read-only afterwards: rebuild it after embeddings change. Lookups
+// need an LshWorkspace each (per thread) for dedup across tables.
+
+// ----------------------------------------------------------------------------------------
+
+#define LSH_DEFAULT_TABLES 8
+#define LSH_DEFAULT_BITS 12
+#define LSH_MAX_BITS 20
+#define LSH_SIGNATURE_WORDS 2               // 128-bit signatures
+#define LSH_SIGNATURE_BITS (64 * LSH_SIGNATURE_WORDS)
+
+typedef struct LshIndex {
+    uint32_t dimensions;
+    uint32_t tables;
+    uint32_t bits;
+    uint32_t count;             // concepts indexed
+    uint32_t concept_span;      // highest concept + 1
+
+    float* planes;              // (tables · bits + LSH_SIGNATURE_BITS) × dimensions
+    uint32_t* offsets;          // tables × (2^bits + 1)
+    uint32_t* ids;              // tables × count
+    uint64_t* signatures;       // tables × count × LSH_SIGNATURE_WORDS, parallel to ids
+} LshIndex;
+
+typedef struct LshWorkspace {
+    uint32_t* stamps;
+    uint32_t capacity;
+    uint32_t tag;
+
+    Neighbor* found;            // candidates of the current query
+    uint32_t found_count;
+    uint32_t found_capacity;
+
+    float* projections;
+    uint32_t projection_capacity;
+} LshWorkspace;
+
+void init_lsh(LshIndex* index, uint32_t dimensions, uint32_t tables, uint32_t bits, uint64_t seed);
+void free_lsh(LshIndex* index);
+void lsh_build(LshIndex* index, const ConceptVectorStore* vectors, Scheduler* scheduler);
+
+void init_lsh_workspace(LshWorkspace* workspace);
+void free_lsh_workspace(LshWorkspace* workspace);
+
+uint32_t lsh_query(const LshIndex* index, LshWorkspace* workspace, const float* query, uint32_t max_hamming,
+                   int probe_neighbors, uint32_t limit, Neighbor* out);
+void lsh_query_batch(const LshIndex* index, LshWorkspace* workspace, const float* tokens, size_t stride,
+                     uint32_t token_count, uint32_t max_hamming, int probe_neighbors, uint32_t limit,
+                     Neighbor* out, uint32_t* counts);
+
+const char* lsh_kernel_name(void);
+
+#endif
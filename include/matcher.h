@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef MATCHER_H
+#define MATCHER_H
+
+#include <stdint.h>
+#include "store.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// Entity mention matching for token → concept resolution (README
+// §5.1.1). Instead of probing every span up to MAX_SPAN_LENGTH against
+// the concept table (n · L hash lookups per turn), all concept IDs and
+// aliases are compiled into one Aho–Corasick automaton that reports
+// every mention in a single left-to-right pass.
+//
+// Automaton:
+// ==============
+//
+// A trie of all patterns plus, per state, a failure link to the longest
+// proper suffix that is also a trie path, and a dictionary link to the
+// nearest state on that chain where a pattern ends:
+//
+//     patterns: he, she, his, hers          (* = a pattern ends here)
+//
+//     ()─h→(h)─e→(he)*─r→(her)─s→(hers)*
+//      │    └─i→(hi)─s→(his)*
+//      └─s→(s)─h→(sh)─e→(she)*
+//
+//     fail(sh) = h, fail(she) = he, dict(she) = he: reaching "she" also
+//     reports "he", without walking the fail chain state by state.
+//
+// Memory Model:
+// ==============
+//
+// States are numbered breadth-first (shallow, hot states first) and
+// kept in flat arrays: edges in CSR form with labels sorted per state
+// (1 byte label + 4 byte target), plus fail / dict / output per state,
+// and a direct 256-entry table for the root, which most bytes of
+// ordinary text fall back to. No per-node allocations.
+//
+// Incremental rebuild:
+// ==============
+//
+// Patterns live in up to MATCHER_MAX_LEVELS automata over consecutive
+// pattern ranges of geometrically shrinking size. Compiling makes the
+// pending patterns a new level, then merges it into the level before
+// while that one holds at most twice as many patterns, and builds only
+// the merged range:
+//
+//     sizes 40 12 + 5  → 40 12 5        (12 > 2·5)
+//     sizes 40 12 5 + 3 → 40 12 8 → 40 20 → 60
+//
+// Each level is more than twice the next, so there are at most 32, and
+// a rebuilt pattern always lands in a level at least 1.5 times larger
+// than the one it left: adding n patterns, in batches of any size,
+// costs O(n log n) total. Scans run every level.
+//
+// Options: ASCII case folding, and whole-word mentions only (no letter,
+// digit, '_' or UTF-8 byte right before or after the span).
+
+// ----------------------------------------------------------------------------------------
+
+#define MATCHER_FOLD_CASE 1
+#define MATCHER_WHOLE_WORDS 2
+#define MATCHER_MAX_LEVELS 33
+#define MATCHER_NONE UINT32_MAX
+
+typedef struct EntityMention {
+    uint32_t begin;             // byte (or token) offset
+    uint32_t end;               // one past the last
+    uint32_t concept;
+    uint32_t pattern;
+} EntityMention;
+
+typedef struct MatchPattern {
+    uint32_t offset;            // into the matcher's pool, text as added
+    uint32_t length;
+    uint32_t concept;
+} MatchPattern;
+
+typedef struct Automaton {
+    uint32_t state_count;
+    uint32_t* first_edge;       // state_count + 1 (CSR)
+    uint8_t* labels;
+    uint32_t* targets;
+    uint32_t* fail;
+    uint32_t* dict;             // MATCHER_NONE if no output on the fail chain
+    uint32_t* output;           // first pattern ending here, or MATCHER_NONE
+    uint32_t root_next[256];
+} Automaton;
+
+typedef struct MatcherLevel {
+    uint32_t begin;             // patterns [begin, end) are in `automaton`
+    uint32_t end;
+    Automaton automaton;
+} MatcherLevel;
+
+typedef struct EntityMatcher {
+    uint32_t flags;
+
+    char* pool;
+    uint32_t pool_size;
+    uint32_t pool_capacity;
+
+    MatchPattern* patterns;
+    uint32_t* pattern_next;     // next pattern with the same string (same end state)
+    uint32_t pattern_count;
+    uint32_t pattern_capacity;
+
+    uint32_t store_synced;      // concepts of the store already added
+    MatcherLevel levels[MATCHER_MAX_LEVELS];
+    uint32_t level_count;       // levels cover patterns [0, levels[level_count - 1].end)
+} EntityMatcher;
+
+void init_entity_matcher(EntityMatcher* matcher, uint32_t flags);
+void free_entity_matcher(EntityMatcher* matcher);
+
+uint32_t matcher_add(EntityMatcher* matcher, const char* text, uint32_t concept);
+uint32_t matcher_sync_store(EntityMatcher* matcher, const ConceptStore* store);
+void matcher_compile(EntityMatcher* matcher);
+
+uint32_t matcher_scan(const EntityMatcher* matcher, const char* text, uint32_t length,
+                      EntityMention* out, uint32_t capacity);
+uint32_t matcher_scan_tokens(const EntityMatcher* matcher, const char* const* tokens, uint32_t token_count,
+                             EntityMention* out, uint32_t capacity);
+
+#endif
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <stddef.h>
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// Minimal NUMA support, straight on the kernel interfaces so we do not
+// need libnuma at build or run time.
+//
+//     topology      ← /sys/devices/system/node/{online, nodeN/cpulist}
+//     memory policy ← mbind(2)
+//     thread pinning← sched_setaffinity via pthread_setaffinity_np()
+//     current node  ← getcpu(2)
+//
+// Memory is bound with MPOL_PREFERRED, not MPOL_BIND: if the node runs
+// out, the kernel falls back to another one instead of failing the
+// allocation. Policy applies at first touch, so bind fresh mappings
+// before writing to them; already-touched pages only move if asked.
+//
+// On a machine without NUMA (or without /sys) there is one node, 0,
+// and every call here is a harmless no-op.
+
+// ----------------------------------------------------------------------------------------
+
+#define NUMA_MAX_NODES 64
+
+int numa_node_count(void);
+int numa_node_cpu_count(int node);
+int numa_current_node(void);
+
+int numa_bind(void* memory, size_t length, int node, int move);
+int numa_pin_thread(int node);
+
+#endif
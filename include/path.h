@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef PATH_H
+#define PATH_H
+
+#include <stdint.h>
+#include "scheduler.h"
+#include "store.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// Path queries: "how is John related to Mary?"
+//
+// Bidirectional BFS:
+// ==============
+//
+// Search from both ends at once, one whole level at a time, always
+// growing the side whose frontier has fewer slots to scan. Two searches
+// of depth d/2 touch far fewer concepts than one of depth d, and picking
+// the cheaper side keeps a hub on one end from blowing up the search:
+//
+//     john ○──○──○  →  ←  ○──○ mary        (meet in the middle)
+//
+// Directed search follows slots source → target from `from` (and
+// target → source from `to`); undirected search uses both directions.
+// The result is the concept sequence plus, for each step, the slot name
+// and whether the slot points against the path ("mary knows john" is
+// a step john ← mary).
+//
+// Landmark index:
+// ==============
+//
+// For microsecond answers, pick L landmarks (the highest-degree
+// concepts) and store the undirected hop distance of every concept to
+// each of them, one byte each, concept-major so a query reads two rows
+// of L bytes:
+//
+//     distances[concept * L + l] = hops(concept, landmark l)   (255: none)
+//
+// Triangle inequality gives bounds on the undirected distance:
+//
+//     lower = max_l |d(u,l) - d(v,l)|      upper = min_l d(u,l) + d(l,v)
+//
+// so "within k hops?" is usually settled by the index alone (upper <= k
+// yes, lower > k no); only the undecided middle falls back to a BFS
+// bounded by k.
+//
+// Updates: adding a slot can only shorten distances. landmark_add_slot()
+// relaxes from the new slot's endpoints outwards, touching only concepts
+// whose distance actually drops, and grows the table for new concepts.
+// Retracting slots can lengthen distances, which the index cannot see:
+// rebuild after retractions.
+//
+// A PathWorkspace holds per-concept BFS state between queries (stamped
+// by query, so nothing is cleared); one per thread.
+
+// ----------------------------------------------------------------------------------------
+
+#define PATH_UNREACHABLE 255
+#define LANDMARK_DEFAULT_COUNT 16
+
+typedef struct PathStep {
+    uint32_t concept;
+    Symbol name;                // slot taken to reach it, SYMBOL_NONE for the first
+    uint8_t reversed;           // 1 if that slot points from this concept back
+} PathStep;
+
+typedef struct PathSide {
+    uint32_t* stamp;            // == query: seen on this side
+    uint32_t* parent;
+    Symbol* name;
+    uint8_t* reversed;
+    uint8_t* depth;
+    uint32_t* frontier;
+    uint32_t* next;
+} PathSide;
+
+typedef struct PathWorkspace {
+    PathSide sides[2];          // 0: from the source, 1: from the target
+    uint32_t capacity;
+    uint32_t query;
+} PathWorkspace;
+
+typedef struct LandmarkIndex {
+    uint32_t* landmarks;
+    uint32_t landmark_count;
+    uint8_t* distances;         // concept-major, landmark_count per concept
+    uint32_t capacity;          // concepts covered
+
+    uint32_t* queue;            // scratch for incremental updates
+    uint32_t queue_capacity;
+} LandmarkIndex;
+
+void init_path_workspace(PathWorkspace* workspace);
+void free_path_workspace(PathWorkspace* workspace);
+
+uint32_t store_shortest_path(const ConceptStore* store, PathWorkspace* workspace, uint32_t from, uint32_t to,
+                             uint32_t max_hops, int directed, PathStep* path);
+
+void build_landmark_index(LandmarkIndex* index, const ConceptStore* store, Scheduler* scheduler,
+                          uint32_t landmark_count);
+void free_landmark_index(LandmarkIndex* index);
+void landmark_add_slot(LandmarkIndex* index, const ConceptStore* store, uint32_t source, uint32_t target);
+void landmark_distance_bounds(const LandmarkIndex* index, uint32_t from, uint32_t to,
+                              uint32_t* lower, uint32_t* upper);
+
+int store_within_hops(const ConceptStore* store, const LandmarkIndex* index, PathWorkspace* workspace,
+                      uint32_t from, uint32_t to, uint32_t hops);
+
+#endif
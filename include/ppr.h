@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef PPR_H
+#define PPR_H
+
+#include <stdint.h>
+#include "store.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// Local personalized PageRank: "what in the graph is relevant to the
+// concepts this user turn mentions?" This is the relevance engine behind
+// the Symbolic Check step (README §3.3). BFS from the mentioned concepts
+// pulls in everything within k hops; PPR ranks by how much of a random
+// walk from them (restarting with probability alpha) ends up there.
+//
+// Forward push (Andersen–Chung–Lang):
+// ==============
+//
+// Keep an estimate p and a residual r (mass not yet settled). Start with
+// r = 1/|seeds| on each seed. Pushing concept u:
+//
+//     p[u] += alpha · r[u]
+//     each neighbor v gets (1 - alpha) · r[u] / degree(u) added to r[v]
+//     r[u]  = 0
+//
+// and u is pushed again only once r[u] >= epsilon · degree(u). Work is
+// bounded by 1 / (alpha · epsilon) pushes whatever the graph size, so
+// only the neighborhood that matters is touched.
+//
+// - Neighbors are out-slots *and* in-slots: "mary knows john" is as
+//   relevant to john as "john owns book".
+// - A concept without slots keeps its whole residual as estimate.
+// - `budget_ns` stops pushing when time runs out: the estimates so far
+//   are a valid (lower-bound) answer, just less precise.
+//
+// Workspace:
+// ==============
+//
+// A PushWorkspace keeps dense per-concept arrays between calls plus the
+// list of concepts it touched, so each query resets only those instead
+// of clearing O(concept_count) memory. One workspace per thread; the
+// store must not be written during a query.
+
+// ----------------------------------------------------------------------------------------
+
+#define PPR_ALPHA 0.15f
+#define PPR_EPSILON 1e-5f
+
+typedef struct RankedConcept {
+    uint32_t concept;
+    float score;
+} RankedConcept;
+
+typedef struct RelevantSlot {
+    uint32_t source;
+    Symbol name;
+    uint32_t target;
+    float score;
+} RelevantSlot;
+
+typedef struct PushWorkspace {
+    float* estimate;
+    float* residual;
+    uint8_t* queued;
+    uint32_t capacity;          // concepts the arrays cover
+
+    uint32_t* touched;          // concepts with nonzero estimate or residual
+    uint32_t touched_count;
+
+    uint32_t* queue;            // ring of `capacity` entries
+    uint32_t queue_head;
+    uint32_t queue_count;
+
+    uint32_t pushes;            // stats for the last query
+    int truncated;              // 1 if the time budget ran out
+} PushWorkspace;
+
+void init_push_workspace(PushWorkspace* workspace);
+void free_push_workspace(PushWorkspace* workspace);
+
+uint32_t personalized_push(const ConceptStore* store, PushWorkspace* workspace, const uint32_t* seeds,
+                           uint32_t seed_count, float alpha, float epsilon, uint64_t budget_ns,
+                           uint32_t k, RankedConcept* out);
+uint32_t top_k_relevant_slots(const ConceptStore* store, const PushWorkspace* workspace,
+                              uint32_t k, RelevantSlot* out);
+
+#endif
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef QUANTIZE_H
+#define QUANTIZE_H
+
+#include <stdint.h>
+#include "distance.h"
+#include "scheduler.h"
+#include "vectors.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// Quantized embedding storage (README §3.2.3): the same rows as a
+// ConceptVectorStore, encoded smaller, with distances computed on the
+// codes themselves.
+//
+// Formats (bytes per concept at 128 dimensions):
+// ==============
+//
+//     fp32 (vectors.h)   512                                      1x
+//     QUANT_FIXED_12_4   256   int16 = round(x · 16), |x| < 2048    2x
+//     QUANT_INT8         136   int8 = round(x / s), s = max|x|/127  ~4x
+//                              + per-row scale and norm
+//     QUANT_PQ           16+4  product quantization, M sub-vectors   ~25x
+//                              each replaced by 1 of 256 centroids
+//
+// Distances:
+// ==============
+//
+// - fixed 12.4: the query is encoded the same way and the int16 kernels
+//   of distance.h run on both codes; the results are scaled by 1/256.
+// - int8: symmetric too. dot = s_q · s_r · dot_i8(codes), and with the
+//   stored decoded norms, L2 = |q|² + |r|² - 2·dot.
+// - PQ: asymmetric (ADC). The query stays fp32; one table per query
+//   holds the distance (L2) or dot (IP / cosine) from each query
+//   sub-vector to each of the 256 centroids of its subspace, and a row
+//   costs M table lookups:
+//
+//       codes  [ 17 | 203 |  4 | ... ]     (M bytes)
+//       table  t[0][17] + t[1][203] + t[2][4] + ...
+//
+// Codes lose precision, so quantized_search() can re-rank: it keeps the
+// best `rerank` candidates by code distance, then recomputes those in
+// fp32 from a ConceptVectorStore and returns the best k of them;
+// candidates the store has no row for are dropped.
+//
+// Writers need external serialization; searches may run concurrently.
+
+// ----------------------------------------------------------------------------------------
+
+#define QUANT_FIXED_ONE 16.0f              // 12.4: 4 fraction bits
+#define PQ_CENTROIDS 256
+#define PQ_DEFAULT_SUBSPACES 16
+#define PQ_DEFAULT_ITERATIONS 12
+#define PQ_DEFAULT_SAMPLE 65536
+
+typedef enum QuantFormat {
+    QUANT_FIXED_12_4 = 0,
+    QUANT_INT8,
+    QUANT_PQ,
+} QuantFormat;
+
+typedef struct QuantizedVectors {
+    QuantFormat format;
+    uint32_t dimensions;
+    uint32_t code_bytes;        // bytes per row
+    uint32_t capacity;          // rows allocated
+    uint32_t n_concepts;
+
+    uint8_t* codes;             // capacity × code_bytes
+    float* scales;              // int8: per-row scale
+    float* norms;               // |decoded row|: int8, PQ and cosine
+    uint64_t* present;
+
+    // PQ only
+    uint32_t subspaces;
+    uint32_t sub_dimensions;
+    float* centroids;           // subspaces × 256 × sub_dimensions
+    int trained;
+} QuantizedVectors;
+
+typedef struct QuantizedQuery {
+    DistanceMetric metric;
+    float norm;                 // |decoded query|
+    float scale;                // int8
+    int16_t* fixed;             // QUANT_FIXED_12_4 codes
+    int8_t* bytes;              // QUANT_INT8 codes
+    float* table;               // QUANT_PQ: subspaces × 256
+} QuantizedQuery;
+
+void init_quantized(QuantizedVectors* quantized, QuantFormat format, uint32_t dimensions, uint32_t subspaces);
+void free_quantized(QuantizedVectors* quantized);
+
+int pq_train(QuantizedVectors* quantized, const ConceptVectorStore* vectors, Scheduler* scheduler,
+             uint32_t sample, uint32_t iterations);
+
+int quantized_attach(QuantizedVectors* quantized, uint32_t concept, const float* embedding);
+uint32_t quantize_store(QuantizedVectors* quantized, const ConceptVectorStore* vectors);
+void quantized_decode(const QuantizedVectors* quantized, uint32_t concept, float* out);
+
+static inline int quantized_present(const QuantizedVectors* quantized, uint32_t concept) {
+    return concept < quantized->capacity && (quantized->present[concept >> 6] >> (concept & 63)) & 1;
+}
+
+void prepare_quantized_query(const QuantizedVectors* quantized, DistanceMetric metric, const float* query,
+                             QuantizedQuery* prepared);
+void free_quantized_query(QuantizedQuery* prepared);
+float quantized_distance(const QuantizedVectors* quantized, const QuantizedQuery* prepared, uint32_t concept);
+
+uint32_t quantized_search(const QuantizedVectors* quantized, DistanceMetric metric, const float* query,
+                          uint32_t k, uint32_t rerank, const ConceptVectorStore* exact, Neighbor* out);
+
+#endif
@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <stdint.h>
+#include "store.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// Conjunctive pattern queries over a ConceptStore (README §7.3.1,
+// "Pattern-based retrieval").
+//
+// A pattern is a list of clauses separated by ';':
+//
+//     ?x type Person; ?x owns ?y; ?y type Object
+//
+//     - `?name` is a variable
+//     - `$1`, `$2`, ... are parameters, bound to concept indexes at run time
+//     - anything else in subject/object position is a concept ID
+//     - the predicate is a slot name, or the keyword `type`, in which
+//       case the object is a type name
+//
+// Every answer is one binding of all variables (concept indexes) such
+// that every clause holds. Answers are distinct. Concepts of reserved
+// types (store.h) are never bound, named or matched by a type clause.
+//
+// How it runs:
+// ============
+//
+// Variables are bound one at a time (Generic Join, a worst-case optimal
+// join). For the next variable, every clause that mentions it can
+// *propose* candidates:
+//
+//     ?x type Person       → type_index[Person]
+//     ?x owns ?y (y free)  → slot_source_index[owns]
+//     ?x owns ?y (y bound) → in-slots of y named "owns"
+//     ?y owns ?x (y bound) → out-slots of y named "owns"
+//
+// The smallest proposal is materialized and every other clause just
+// *verifies* each candidate (a type compare, a bitmap probe, or a scan
+// of the shorter of two segments). So the work per step is bounded by
+// the most selective clause, not by the product of the inputs.
+//
+// The variable order is chosen up front by a greedy cost model over the
+// store's statistics: bitmap cardinalities, per-slot-name fan-out
+// (slot_name_counts / |sources|) and the exact degree of constants.
+// Variables connected to already-bound ones go first, so we never build
+// a cross product unless the pattern itself is disconnected.
+//
+// Memory:
+// =======
+//
+// compile_query() allocates the Query; candidate buffers are owned by
+// the Query and reused (and only grown) across run_query() calls.
+// A Query reads the store but never modifies it.
+//
+// Prepared queries:
+// =================
+//
+// Retrieval templates are a handful of patterns run over and over with
+// different concepts plugged in:
+//
+//     Query* q = prepare_query(cache, "$1 owns ?y; ?y type Object");
+//     uint32_t john = find_concept_by_id(store, "john");
+//     run_prepared_query(q, &john, 1, on_answer, context);
+//
+// The QueryCache interns pattern strings (a SymbolTable, so a lookup is
+// one hash probe) and keeps one compiled Query per pattern. Parameters
+// are planned as "bound but unknown" (average fan-out), so the plan does
+// not depend on the values. After warm-up a run does no parsing, no
+// planning and no allocation.
+//
+// Plans go stale as the store grows. prepare_query() re-plans a cached
+// query once the store's concept or slot count has doubled since it was
+// planned, and re-parses an unsatisfiable one whenever new concepts or
+// symbols have appeared (the missing name may exist now).
+//
+// A Query (and so a QueryCache) is single-threaded: it holds the current
+// bindings. Give each thread its own cache.
+
+// ----------------------------------------------------------------------------------------
+
+#define QUERY_MAX_CLAUSES 16
+#define QUERY_MAX_VARIABLES 8
+#define QUERY_MAX_PARAMETERS 8
+#define QUERY_NAME_MAX 32
+
+typedef enum QueryTermKind {
+    QUERY_TERM_VARIABLE,
+    QUERY_TERM_CONSTANT,
+    QUERY_TERM_PARAMETER
+} QueryTermKind;
+
+typedef struct QueryTerm {
+    QueryTermKind kind;
+    uint32_t value;             // variable number, concept index or parameter number (0-based)
+} QueryTerm;
+
+typedef struct QueryClause {
+    QueryTerm subject;
+    Symbol predicate;           // slot name, or the type for type clauses
+    int is_type;
+    QueryTerm object;           // unused for type clauses
+} QueryClause;
+
+// How a clause constrains the variable bound at a given step.
+typedef enum QueryCheckMode {
+    QUERY_CHECK_TYPE,           // ?v type T
+    QUERY_CHECK_HAS_SOURCE,     // ?v p ?w, w not bound yet
+    QUERY_CHECK_HAS_TARGET,     // ?w p ?v, w not bound yet
+    QUERY_CHECK_TO_BOUND,       // ?v p o, o bound or constant
+    QUERY_CHECK_FROM_BOUND,     // s p ?v, s bound or constant
+    QUERY_CHECK_SELF            // ?v p ?v
+} QueryCheckMode;
+
+typedef struct QueryCheck {
+    uint32_t clause;
+    QueryCheckMode mode;
+} QueryCheck;
+
+typedef struct QueryStep {
+    uint32_t variable;
+    QueryCheck checks[QUERY_MAX_CLAUSES];
+    uint32_t check_count;
+    double estimate;            // planner's candidate estimate
+
+    uint32_t* candidates;       // reused across runs
+    uint32_t candidate_capacity;
+} QueryStep;
+
+typedef struct Query {
+    const ConceptStore* store;
+
+    QueryClause clauses[QUERY_MAX_CLAUSES];
+    uint32_t clause_count;
+
+    char variable_names[QUERY_MAX_VARIABLES][QUERY_NAME_MAX];
+    uint32_t variable_count;
+
+    uint32_t parameter_count;
+
+    QueryStep steps[QUERY_MAX_VARIABLES];   // one per variable, in binding order
+    int unsatisfiable;          // an ID, type or slot name is unknown
+
+    // Store size when the plan was made, to detect stale plans
+    uint32_t planned_concepts;
+    uint32_t planned_slots;
+    uint32_t planned_symbols;
+
+    uint32_t bindings[QUERY_MAX_VARIABLES];
+    uint32_t parameters[QUERY_MAX_PARAMETERS];
+} Query;
+
+typedef struct QueryCache {
+    const ConceptStore* store;
+    SymbolTable patterns;       // pattern string → symbol → queries[symbol]
+    Query** queries;
+    uint32_t query_capacity;
+} QueryCache;
+
+// Called once per answer with bindings[variable] = concept index.
+// Return nonzero to stop the query early.
+typedef int (*QueryCallback)(const uint32_t* bindings, void* user_data);
+
+Query* compile_query(const ConceptStore* store, const char* pattern);
+void free_query(Query* query);
+
+uint64_t run_query(Query* query, QueryCallback callback, void* user_data);
+uint64_t run_prepared_query(Query* query, const uint32_t* parameters, uint32_t parameter_count,
+                            QueryCallback callback, void* user_data);
+
+int query_variable(const Query* query, const char* name);
+void print_query_plan(const Query* query);
+
+QueryCache* create_query_cache(const ConceptStore* store);
+void free_query_cache(QueryCache* cache);
+Query* prepare_query(QueryCache* cache, const char* pattern);
+
+#endif
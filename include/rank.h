@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef RANK_H
+#define RANK_H
+
+#include <stdint.h>
+#include "store.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// Ranking slots by relevance.
+//
+// Prompt injection (README §3.2) can only afford a few facts per entity,
+// so we need "the k best slots of john" rather than all of them. A slot's
+// score is
+//
+//     score = weight * confidence
+//
+// from its SlotMeta (unweighted slots score 1.0).
+//
+// top_k_slots() keeps a bounded min-heap of the k best seen so far while
+// streaming the concept's segment once: O(degree · log k) time, no
+// allocation, and it reads the META column only for slots whose name
+// matches. Results come out best-first; ties keep insertion order.
+
+// ----------------------------------------------------------------------------------------
+
+typedef struct RankedSlot {
+    uint32_t target;
+    Symbol name;
+    float score;
+    uint32_t position;          // index within the concept's segment
+} RankedSlot;
+
+uint32_t top_k_slots(const ConceptStore* store, uint32_t concept, const char* slot_name,
+                     uint32_t k, RankedSlot* out);
+
+#endif
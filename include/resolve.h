@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef RESOLVE_H
+#define RESOLVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "matcher.h"
+#include "store.h"
+#include "vectors.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// Mention resolution (README §5.1.1): the matcher (matcher.h, trie.h)
+// yields every candidate span, overlapping and ambiguous ones included;
+// this stage scores each candidate and keeps the best non-overlapping
+// set.
+//
+// Confidence:
+// ==============
+//
+//     c(span) = P(concept) · ContextSimilarity(span, context)
+//
+// - P(concept): usage prior kept in the store (store_concept_prior()).
+// - ContextSimilarity: mean cosine between the concept's embedding and
+//   the embeddings of up to `window` tokens on each side of the span,
+//   mapped from [-1, 1] to [0, 1]. Dot products run on the SIMD kernels
+//   of distance.h; token norms are computed once per turn, on first use.
+//   A concept without an embedding (or a span without context) scores a
+//   neutral 1/2, so the prior alone decides.
+//
+// Selection:
+// ==============
+//
+// Greedy "highest confidence first" can take one strong span that blocks
+// two others worth more together. Instead, weighted interval scheduling
+// picks the set of non-overlapping spans with the largest total weight,
+// weight = confidence · tokens covered (so "new york city" is not beaten
+// by "new york" + "city" just for being one span):
+//
+//     spans sorted by end (counting sort on token index)
+//     p(j)     = number of spans ending at or before begin(j)
+//     best(j)  = max(best(j-1), weight(j) + best(p(j)))
+//
+// p(j) falls out of the counting sort's prefix sums, so the whole DP is
+// O(mentions + tokens). A ResolveWorkspace keeps every buffer between
+// turns, so resolving allocates nothing once warmed up.
+//
+// Resolution only reads the store; feed chosen concepts back with
+// store_record_usage() to keep the priors current.
+
+// ----------------------------------------------------------------------------------------
+
+#define RESOLVE_DEFAULT_WINDOW 4
+
+typedef struct ResolvedMention {
+    uint32_t begin;             // token index
+    uint32_t end;               // one past the last
+    uint32_t concept;
+    float confidence;
+} ResolvedMention;
+
+typedef struct ResolveWorkspace {
+    float* token_norms;         // < 0: not computed yet
+    uint32_t* end_offsets;      // counting sort by end
+    uint32_t token_capacity;
+
+    float* weights;
+    float* confidences;
+    uint32_t* order;            // mentions by end
+    float* best;
+    uint32_t mention_capacity;
+} ResolveWorkspace;
+
+void init_resolve_workspace(ResolveWorkspace* workspace);
+void free_resolve_workspace(ResolveWorkspace* workspace);
+
+uint32_t resolve_mentions(const ConceptStore* store, const ConceptVectorStore* vectors, const float* tokens,
+                          size_t stride, uint32_t token_count, const EntityMention* mentions,
+                          uint32_t mention_count, uint32_t window, ResolveWorkspace* workspace,
+                          ResolvedMention* out);
+
+#endif
@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stdint.h>
+#include "store.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// Filter scans over dense Symbol arrays.
+//
+// With interned symbols, "all concepts of type Person" is
+//     for i in 0..N: if type_symbols[i] == Person → emit i
+// and "all slots named owns on this hub" is the same loop over the hub's
+// slot_names segment. These loops are pure compare-and-compact, which is
+// exactly what SIMD is good at: 4/8/16 symbols compared per instruction,
+// the match mask turned into indexes with count-trailing-zeros.
+//
+// Two output shapes:
+//     - indexes: uint32_t positions of matches, caller sizes `out` for
+//                the worst case (`count` entries)
+//     - bitmap:  one bit per position, (count + 63) / 64 words, bit i of
+//                word w set ⇔ values[w*64 + i] == needle
+//
+// The kernel is chosen once at runtime from cpu_level() (see cpu.h).
+
+// ----------------------------------------------------------------------------------------
+
+uint32_t scan_symbol_indexes(const Symbol* values, uint32_t count, Symbol needle, uint32_t* out);
+void scan_symbol_bitmap(const Symbol* values, uint32_t count, Symbol needle, uint64_t* bitmap);
+const char* scan_kernel_name(void);
+
+// Store-level filters. `out` must hold concept_count (resp. degree) entries.
+uint32_t scan_concepts_by_type(const ConceptStore* store, const char* type, uint32_t* out);
+void scan_concepts_by_type_bitmap(const ConceptStore* store, const char* type, uint64_t* bitmap);
+uint32_t scan_slots_by_name(const ConceptStore* store, uint32_t concept, const char* slot_name, uint32_t* out);
+
+#endif
@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "shard.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// One work-stealing thread pool for every parallel store operation, so
+// graph algorithms, bulk loads and maintenance share the same cores
+// instead of each starting threads of its own.
+//
+// Workers:
+// ==============
+//
+// Each worker owns a Chase–Lev deque. It pushes and pops tasks at the
+// bottom (LIFO: the freshest, cache-hot work), while idle workers steal
+// from the top (FIFO: the oldest, usually largest pieces):
+//
+//                 steal ←  top ┌──────┬──────┬──────┐ bottom  ⇄ owner push / pop
+//                              │ big  │ half │ 1/4  │
+//                              └──────┴──────┴──────┘
+//
+// Only the owner touches `bottom`, so its push / pop are plain stores
+// plus one fence; thieves race each other on `top` with a CAS. The ring
+// doubles when full; replaced rings are kept until the scheduler is
+// freed because a thief may still be reading one.
+//
+// Every worker also has a mailbox: a small locked FIFO for tasks handed
+// to it from outside (another thread, or affinity). Its owner drains it
+// first, but others may steal from it too, so affinity is a preference,
+// never a stall.
+//
+// Worker i is pinned to NUMA node i mod node_count. Tasks for a shard go
+// to the mailbox of a worker on the shard's node (see shard.h).
+//
+// Fork-join:
+// ==============
+//
+// Tasks belong to a TaskGroup, which counts the ones not yet finished.
+// scheduler_wait() does not block: the waiting thread runs tasks itself
+// (its own first, then stolen) until the count reaches zero. Nested
+// parallel_for() inside a task is therefore fine, and so is waiting from
+// a thread that is not a worker.
+//
+// parallel_for() splits [begin, end) by halving: a worker keeps the left
+// half and pushes the right, until pieces are at most `grain` long.
+// Thieves take the big right halves, so load balances itself whatever
+// the per-concept cost.
+//
+// Sizing:
+// ==============
+//
+// The caller of scheduler_wait() works too, so shared_scheduler() starts
+// one worker fewer than there are CPUs (at least one): CPUs are busy,
+// not oversubscribed. CLARITY_WORKERS=n overrides the count. Idle
+// workers spin briefly, then sleep until work is queued.
+
+// ----------------------------------------------------------------------------------------
+
+typedef void (*TaskFn)(void* arg);
+typedef void (*RangeFn)(void* context, uint32_t begin, uint32_t end);
+typedef void (*ShardFn)(void* context, uint32_t shard);
+
+typedef struct Task Task;
+typedef struct TaskDeque TaskDeque;
+typedef struct Scheduler Scheduler;
+
+typedef struct TaskGroup {
+    Scheduler* scheduler;
+    uint32_t pending;           // spawned and not finished yet
+} TaskGroup;
+
+typedef struct Worker {
+    Scheduler* scheduler;
+    uint32_t index;
+    int node;
+    pthread_t thread;
+    uint64_t rng;               // victim selection
+
+    TaskDeque* deque;
+
+    pthread_mutex_t mailbox_lock;
+    Task** mailbox;             // ring of mailbox_capacity entries
+    uint32_t mailbox_head;
+    uint32_t mailbox_count;
+    uint32_t mailbox_capacity;
+} Worker;
+
+struct Scheduler {
+    Worker* workers;
+    uint32_t worker_count;
+    uint32_t next_mailbox;      // round-robin for tasks from outside
+
+    uint32_t queued;            // tasks pushed and not yet taken
+    uint32_t sleeping;
+    int stopping;
+    pthread_mutex_t sleep_lock;
+    pthread_cond_t wake;
+};
+
+Scheduler* create_scheduler(uint32_t worker_count);
+void free_scheduler(Scheduler* scheduler);
+Scheduler* shared_scheduler(void);
+
+uint32_t scheduler_worker_index(const Scheduler* scheduler);
+
+void init_task_group(TaskGroup* group, Scheduler* scheduler);
+void scheduler_spawn(TaskGroup* group, TaskFn fn, void* arg);
+void scheduler_spawn_on(TaskGroup* group, uint32_t worker, TaskFn fn, void* arg);
+void scheduler_wait(TaskGroup* group);
+
+void parallel_for(Scheduler* scheduler, uint32_t begin, uint32_t end, uint32_t grain,
+                  RangeFn fn, void* context);
+
+uint32_t scheduler_worker_for_shard(const Scheduler* scheduler, const ShardedStore* sharded, uint32_t shard);
+void parallel_for_shards(Scheduler* scheduler, ShardedStore* sharded, ShardFn fn, void* context);
+
+#endif
@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "arena.h"
+#include "store.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// A "ShardedStore" splits the concept graph across N independent
+// ConceptStores so writers and readers on different cores stop sharing
+// one table, one allocator and one lock.
+//
+// Placement:
+// ==============
+//
+// A concept lives in shard hash(id) mod N (the same FNV-1a as the symbol
+// tables, mixed, then reduced with a multiply-shift). Within its shard
+// it is an ordinary concept index, so every single-store feature
+// (queries, ranking, temporal slots, snapshots) works per shard unchanged.
+//
+// Each shard owns:
+//     - a ConceptStore whose arrays live in the shard's own Arena
+//     - its own type / slot-name indexes (they are the store's)
+//     - a rwlock: readers of one shard never block writers of another
+//     - a NUMA node it is pinned to (-1 until shard_set_node())
+//
+// Handles:
+// ==============
+//
+// Outside a shard a concept is named by a ConceptHandle, the pair
+// (shard, index) packed into 64 bits.
+//
+// A slot whose target is in another shard is stored through a *proxy*:
+// a local stand-in concept with ID "@shard:index" and type "@remote",
+// whose handle is recorded in `remote`. The target's shard gets the
+// mirror (proxy of the source → target), so its incoming slots are
+// complete too:
+//
+//     shard 0:  john ──owns──→ @1:7            remote[@1:7] = (1, 7)
+//     shard 1:  @0:3 ──owns──→ book (index 7)  remote[@0:3] = (0, 3)
+//
+// sharded_slots() / sharded_in_slots() resolve proxies back to handles,
+// so callers only ever see real concepts. IDs starting with '@' are
+// reserved for proxies. "@remote" is a reserved store type (store.h), so
+// proxies stay out of the shard's type and slot indexes and per-shard
+// queries never return them; a cross-shard slot is simply not visible
+// to a query on either shard.
+//
+// NUMA:
+// ==============
+//
+// shard_set_node() binds the shard's arena to a node (and migrates what
+// it already holds); sharded_spread_nodes() deals shards out round-robin
+// over all nodes. A worker that serves a shard calls shard_pin_thread()
+// so it runs on the same node as the shard's memory.
+//
+// The type / slot-name table is read on every filtered traversal, from
+// whichever node the reader is on. sharded_replicate_symbols() gives
+// each shard a frozen copy of it per node (in per-node arenas); readers
+// look up in their own node's copy and fall back to the master table
+// for names interned since. Call it again after bulk loads to refresh.
+//
+// Locking:
+// ==============
+//
+// Every call takes at most one shard lock at a time (a cross-shard slot
+// is two separate steps), so there is no lock ordering to get wrong.
+// Strings returned by sharded_concept_id() are valid until the next
+// write to that shard.
+
+// ----------------------------------------------------------------------------------------
+
+typedef uint64_t ConceptHandle;
+
+#define HANDLE_NONE UINT64_MAX
+#define SHARD_REMOTE_TYPE "@remote"
+
+static inline ConceptHandle make_handle(uint32_t shard, uint32_t index) {
+    return ((uint64_t)shard << 32) | index;
+}
+
+static inline uint32_t handle_shard(ConceptHandle handle) {
+    return (uint32_t)(handle >> 32);
+}
+
+static inline uint32_t handle_index(ConceptHandle handle) {
+    return (uint32_t)handle;
+}
+
+typedef struct StoreShard {
+    ConceptStore* store;
+    Arena arena;
+    pthread_rwlock_t lock;
+
+    ConceptHandle* remote;      // per local concept: owner if a proxy, else HANDLE_NONE
+    uint32_t remote_capacity;
+    uint32_t proxy_count;
+    uint32_t mirror_slots;      // slots that only mirror another shard's slot
+
+    int node;                   // NUMA node, -1 if not pinned
+    SymbolTable* replicas;      // per node copy of store->symbols, NULL if none
+} StoreShard;
+
+typedef struct ShardedStore {
+    StoreShard* shards;
+    uint32_t shard_count;
+
+    uint32_t node_count;
+    Arena* node_arenas;         // per node, hold the symbol replicas
+    pthread_mutex_t replica_lock;
+} ShardedStore;
+
+ShardedStore* create_sharded_store(uint32_t shard_count);
+void free_sharded_store(ShardedStore* sharded);
+
+uint32_t shard_of_id(const ShardedStore* sharded, const char* id);
+void shard_set_node(ShardedStore* sharded, uint32_t shard, int node);
+void sharded_spread_nodes(ShardedStore* sharded);
+int shard_pin_thread(ShardedStore* sharded, uint32_t shard);
+void sharded_replicate_symbols(ShardedStore* sharded);
+
+ConceptHandle sharded_create_concept(ShardedStore* sharded, const char* id, const char* type);
+ConceptHandle sharded_find_concept(ShardedStore* sharded, const char* id);
+const char* sharded_concept_id(ShardedStore* sharded, ConceptHandle concept);
+
+void sharded_add_slot(ShardedStore* sharded, ConceptHandle source, const char* slot_name, ConceptHandle target);
+
+uint32_t sharded_degree(ShardedStore* sharded, ConceptHandle concept);
+uint32_t sharded_in_degree(ShardedStore* sharded, ConceptHandle concept);
+uint32_t sharded_slots(ShardedStore* sharded, ConceptHandle concept, const char* slot_name, ConceptHandle* targets);
+uint32_t sharded_in_slots(ShardedStore* sharded, ConceptHandle concept, const char* slot_name, ConceptHandle* sources);
+
+uint64_t sharded_concept_count(ShardedStore* sharded);
+uint64_t sharded_slot_count(ShardedStore* sharded);
+
+#endif
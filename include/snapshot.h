@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include "store.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// A "StoreSnapshot" is a consistent, read-only view of a ConceptStore at
+// one committed version, for readers that need several lookups to agree
+// (building a prompt context) while writers keep adding slots.
+//
+//     store_enable_snapshots(store);               // once, up front
+//
+//     StoreSnapshot snapshot;                      // reader thread
+//     if (open_snapshot(store, &snapshot) == 0) {
+//         uint32_t john = snapshot_find_concept(&snapshot, "john");
+//         uint32_t n = snapshot_slots(&snapshot, john, NULL, targets, names);
+//         ...
+//         close_snapshot(&snapshot);
+//     }
+//
+// Opening pins the current version (epoch.h); until it is closed:
+//     - concepts created later are not found
+//     - a concept's slots are exactly those present at that version:
+//       later additions are skipped, later retractions are read back
+//       from the history pool
+//     - strings returned stay valid, even if the store grows
+//
+// Writers never wait for a snapshot. A reader only retries the few
+// loads that locate a segment if a write lands at the same moment.
+// Keep snapshots short: while one is open, arrays retired by writers
+// cannot be freed.
+
+// ----------------------------------------------------------------------------------------
+
+typedef struct StoreSnapshot {
+    const ConceptStore* store;
+    uint64_t version;
+    int reader;                 // slot in store->epochs
+    uint32_t concept_count;
+} StoreSnapshot;
+
+int open_snapshot(const ConceptStore* store, StoreSnapshot* snapshot);
+void close_snapshot(StoreSnapshot* snapshot);
+
+uint32_t snapshot_find_concept(const StoreSnapshot* snapshot, const char* id);
+const char* snapshot_concept_id(const StoreSnapshot* snapshot, uint32_t concept);
+const char* snapshot_concept_type(const StoreSnapshot* snapshot, uint32_t concept);
+const char* snapshot_symbol_name(const StoreSnapshot* snapshot, Symbol symbol);
+
+uint32_t snapshot_degree(const StoreSnapshot* snapshot, uint32_t concept);
+uint32_t snapshot_slots(const StoreSnapshot* snapshot, uint32_t concept, const char* slot_name,
+                        uint32_t* targets, Symbol* names);
+
+#endif
@@ -0,0 +1,344 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef STORE_H
+#define STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "arena.h"
+#include "epoch.h"
+#include "symbol.h"
+#include "bitmap.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// A "ConceptStore" holds a whole concept graph in structure-of-arrays form.
+//
+// The pointer-based Concept (concept.h) is great for building a few nodes
+// by hand, but it interleaves fields that are read at very different
+// rates:
+//
+//     hot  (every traversal): degree, where the slots are
+//     warm (filter queries):  type
+//     cold (printing/lookup): id string
+//
+// Here each field gets its own dense array indexed by concept index
+// (0, 1, 2, ... in creation order), so an algorithm only streams the
+// arrays it actually touches.
+//
+// Memory Model:
+// ==============
+//
+//    per concept (indexed by concept index i)
+//    ┌─────────────────────────────────────────────────┐
+//    │ slots.degrees[i]     → number of slots          │  hot
+//    │ slots.offsets[i]     → start of i's segment ──┐ │  hot
+//    │ slots.capacities[i]  → segment length         │ │
+//    │ type_symbols[i]      → Symbol ("Person")      │ │  warm
+//    │ ids (SymbolTable)    → symbol i == concept i  │ │  cold
+//    └───────────────────────────────────────────────┼─┘
+//                                                    ↓
+//    per slot (edge pool, one segment per concept)
+//    ┌─────────────────────────────────────────────────┐
+//    │ slots.names[]     → Symbol ("owns")             │
+//    │ slots.neighbors[] → concept index (book1)       │
+//    └─────────────────────────────────────────────────┘
+//
+// - Concept IDs live in their own SymbolTable whose symbol numbering is
+//   the concept index, so `ids.offsets` *is* the ID string offset array and
+//   find_concept_by_id() is one hash probe.
+// - Types and slot names share `symbols`.
+// - When a concept's segment is full, store_add_slot() moves it to the end
+//   of the edge pool with twice the room. The old segment becomes dead
+//   space, reclaimed by store_compact_slots() (run automatically before
+//   the pool itself has to grow).
+//
+// Incoming slots:
+// ==============
+//
+// `in_slots` is a second SlotPool with the same layout that mirrors every
+// slot from the target's side (neighbors = sources). Joins that bind the
+// object before the subject ("?x owns book1"), reverse traversal and pull
+// style graph algorithms read it instead of scanning every segment.
+
+// Usage priors:
+// ==============
+//
+// `usage_counts` records how often each concept was picked by mention
+// resolution (resolve.h). The prior P(concept) is the Laplace-smoothed
+// share of all uses, so concepts never seen yet still get some weight:
+//
+//     P(c) = (usage_counts[c] + 1) / (usage_total + concept_count)
+
+// Filter indexes:
+// ==============
+//
+// Set-algebra queries ("Persons who own something and like someone")
+// want concept *sets*, not scans. Three RoaringBitmaps per symbol,
+// maintained by store_create_concept() / store_add_slot():
+//
+//     type_index[Person]        → { concepts of type Person }
+//     slot_source_index[owns]   → { concepts with an "owns" slot }
+//     slot_target_index[owns]   → { concepts some "owns" slot points at }
+//
+// These arrays are indexed by Symbol; a symbol that is only ever used as
+// a type simply has empty slot bitmaps (and vice versa).
+//
+// Types starting with STORE_RESERVED_PREFIX are internal (shard proxies,
+// shard.h). Concepts of such a type are listed in `reserved` and nowhere
+// else: not in type_index, and not in the slot bitmaps as either end of
+// a slot. Queries never bind them (query.h).
+
+// Arenas:
+// ==============
+//
+// create_store_in_arena() puts the store's big arrays (slot pools, side
+// columns, per-concept arrays) in a caller-owned Arena instead of the
+// global heap; a sharded store gives each shard its own. Symbol tables
+// and bitmaps stay on malloc. The arena must outlive the store.
+
+// Slot side columns:
+// ==============
+//
+// Extra per-slot data (weights, confidences, timestamps, ...) lives in
+// optional columns parallel to `names` / `neighbors`. A column is NULL
+// until the first slot that needs it, then allocated for the whole pool
+// with every existing slot set to the column's default, and from then
+// on moved and compacted together with the segment it belongs to. Plain
+// traversal never reads it, so it costs nothing until it is used.
+//
+//     slots.names[]    [owns][likes][owns] ...
+//     slots.neighbors[][b1  ][mary ][b2  ] ...
+//     SLOT_COLUMN_META [w=.9][w=1  ][w=.2] ...   (SlotMeta, 16 bytes)
+
+// Temporal slots:
+// ==============
+//
+// Facts change ("John doesn't own that book anymore", README §4.4). A
+// slot may carry a validity interval [valid_from, valid_to) in the
+// VALIDITY column. Live segments only ever hold *open* slots
+// (valid_to == SLOT_TIME_MAX); store_retract_slot() closes a slot by
+// moving it out of `slots` / `in_slots` into `history`, a third SlotPool
+// with one segment per concept:
+//
+//     slots   (current)  john: [owns → book2, from 30]
+//     history (closed)   john: [owns → book1, 10 .. 30)
+//
+// So current-state reads (traversal, queries, indexes) never see closed
+// facts and pay nothing for them, and an "as of T" read is the current
+// segment plus the concept's own history segment, both filtered by
+// interval: store_slots_as_of().
+//
+// History is outgoing only. store_compact_history() drops closed slots
+// that ended before a retention window.
+
+// Snapshots:
+// ==============
+//
+// After store_enable_snapshots(), readers on other threads can open a
+// StoreSnapshot (snapshot.h) and see the graph exactly as of one
+// committed write while writers keep going. Every public write becomes
+// one version:
+//
+//     lock writers → change → commit version → reclaim → unlock
+//
+// Three rules keep a pinned reader's view intact without ever making a
+// writer wait for it:
+//
+// 1. Nothing a reader may have loaded is freed: grown or compacted
+//    arrays (slot pools, per-concept arrays, type symbols, symbol
+//    tables) are retired to `epochs` and freed once no snapshot is
+//    pinned at an older version.
+//
+// 2. No visible slot is overwritten: appends land past the old degree,
+//    and removal (retraction, history compaction) copies the segment
+//    elsewhere instead of shifting it in place.
+//
+// 3. Every slot records the versions it was added and retracted in
+//    (SLOT_COLUMN_VERSION), so a snapshot at version E keeps current
+//    slots with born <= E and history slots with born <= E < died.
+//
+// Readers locate a segment (array, offset, degree) under the epochs'
+// move seqlock. Only relocations, removals, compactions and array swaps
+// are moves; a plain append writes the slot and then publishes the new
+// degree with a release store, so readers do not retry for it.
+// Indexes, statistics and queries still describe the current state and
+// are not snapshot-safe.
+
+// ----------------------------------------------------------------------------------------
+
+#define CONCEPT_NONE UINT32_MAX
+#define STORE_RESERVED_PREFIX '@'
+
+typedef enum SlotColumn {
+    SLOT_COLUMN_META,           // SlotMeta
+    SLOT_COLUMN_VALIDITY,       // SlotValidity
+    SLOT_COLUMN_VERSION,        // SlotVersion
+    SLOT_COLUMN_COUNT
+} SlotColumn;
+
+// Edge relevance (README §3.2.1, §5.1.1). Unweighted slots read as
+// weight 1, confidence 1, timestamp 0.
+typedef struct SlotMeta {
+    float weight;
+    float confidence;
+    uint64_t timestamp;
+} SlotMeta;
+
+#define SLOT_TIME_MAX UINT64_MAX
+
+// Slots without an interval read as [0, SLOT_TIME_MAX): always valid.
+typedef struct SlotValidity {
+    uint64_t valid_from;
+    uint64_t valid_to;          // exclusive
+} SlotValidity;
+
+// Store versions a slot is visible in: [born, died). Slots from before
+// snapshots were enabled read as born at version 0.
+typedef struct SlotVersion {
+    uint64_t born;
+    uint64_t died;              // UINT64_MAX while current
+} SlotVersion;
+
+typedef struct SlotPool {
+    // Per concept
+    uint32_t* degrees;
+    uint32_t* offsets;
+    uint32_t* capacities;
+
+    // Per slot
+    Symbol* names;
+    uint32_t* neighbors;        // targets (outgoing) or sources (incoming)
+    uint32_t used;              // high-water mark of the pool
+    uint32_t capacity;
+    uint32_t dead;              // abandoned segment space
+
+    void* columns[SLOT_COLUMN_COUNT];   // optional, NULL until first use
+
+    EpochManager* epochs;       // set by store_enable_snapshots()
+    Arena* arena;               // NULL: malloc
+} SlotPool;
+
+typedef struct ConceptStore {
+    uint32_t concept_count;
+    uint32_t concept_capacity;
+
+    // Hot: traversal
+    SlotPool slots;             // concept → target
+    SlotPool in_slots;          // concept ← source
+    uint32_t slot_count;        // live slots across all concepts
+
+    // Closed slots, outgoing only
+    SlotPool history;
+    uint32_t history_count;
+
+    // Warm: filtering and mention resolution
+    Symbol* type_symbols;
+    uint32_t* usage_counts;     // times each concept was resolved
+    uint64_t usage_total;
+
+    // Cold: printing and lookup
+    SymbolTable ids;
+    SymbolTable symbols;
+
+    // Filter indexes and statistics, indexed by Symbol
+    RoaringBitmap* type_index;
+    RoaringBitmap* slot_source_index;
+    RoaringBitmap* slot_target_index;
+    uint32_t* slot_name_counts; // number of slots with that name
+    uint32_t index_capacity;
+    RoaringBitmap reserved;     // concepts of internal types, in no index
+
+    // Where slot pools and per-concept arrays live; NULL: malloc
+    Arena* arena;
+
+    // Snapshots, NULL until store_enable_snapshots()
+    EpochManager* epochs;
+    pthread_mutex_t write_lock;
+    uint32_t committed_concepts;        // concept_count as of epochs->current
+} ConceptStore;
+
+ConceptStore* create_store(void);
+ConceptStore* create_store_in_arena(Arena* arena);
+void free_store(ConceptStore* store);
+void store_enable_snapshots(ConceptStore* store);
+
+uint32_t store_create_concept(ConceptStore* store, const char* id, const char* type);
+void store_add_slot(ConceptStore* store, uint32_t concept, const char* slot_name, uint32_t target);
+void store_add_weighted_slot(ConceptStore* store, uint32_t concept, const char* slot_name, uint32_t target,
+                             float weight, float confidence, uint64_t timestamp);
+
+uint32_t find_concept_by_id(const ConceptStore* store, const char* id);
+const char* store_concept_id(const ConceptStore* store, uint32_t concept);
+const char* store_concept_type(const ConceptStore* store, uint32_t concept);
+
+void store_record_usage(ConceptStore* store, uint32_t concept, uint32_t count);
+float store_concept_prior(const ConceptStore* store, uint32_t concept);
+
+const RoaringBitmap* store_type_index(const ConceptStore* store, const char* type);
+const RoaringBitmap* store_slot_source_index(const ConceptStore* store, const char* slot_name);
+const RoaringBitmap* store_slot_target_index(const ConceptStore* store, const char* slot_name);
+
+void store_add_slot_at(ConceptStore* store, uint32_t concept, const char* slot_name, uint32_t target,
+                       uint64_t valid_from);
+uint32_t store_retract_slot(ConceptStore* store, uint32_t concept, const char* slot_name, uint32_t target,
+                            uint64_t valid_to);
+uint32_t store_slots_as_of(const ConceptStore* store, uint32_t concept, const char* slot_name, uint64_t as_of,
+                           uint32_t* targets, Symbol* names);
+uint32_t store_compact_history(ConceptStore* store, uint64_t now, uint64_t retention);
+
+int store_has_slot(const ConceptStore* store, uint32_t concept, Symbol slot_name, uint32_t target);
+
+void store_compact_slots(ConceptStore* store);
+void print_store_concept(const ConceptStore* store, uint32_t concept);
+
+// Segment accessors: the outgoing slots of `concept` are
+//     names[offset .. offset + degree) and neighbors[...] likewise.
+static inline int store_is_reserved(const ConceptStore* store, uint32_t concept) {
+    return roaring_contains(&store->reserved, concept);
+}
+
+static inline uint32_t store_degree(const ConceptStore* store, uint32_t concept) {
+    return store->slots.degrees[concept];
+}
+
+static inline const Symbol* store_slot_names(const ConceptStore* store, uint32_t concept) {
+    return store->slots.names + store->slots.offsets[concept];
+}
+
+static inline const uint32_t* store_slot_targets(const ConceptStore* store, uint32_t concept) {
+    return store->slots.neighbors + store->slots.offsets[concept];
+}
+
+// NULL if no slot in the store has ever been given a weight.
+static inline const SlotMeta* store_slot_meta(const ConceptStore* store, uint32_t concept) {
+    const SlotMeta* meta = (const SlotMeta*)store->slots.columns[SLOT_COLUMN_META];
+    return meta ? meta + store->slots.offsets[concept] : NULL;
+}
+
+// NULL if no slot in the store has ever been given an interval.
+static inline const SlotValidity* store_slot_validity(const ConceptStore* store, uint32_t concept) {
+    const SlotValidity* validity = (const SlotValidity*)store->slots.columns[SLOT_COLUMN_VALIDITY];
+    return validity ? validity + store->slots.offsets[concept] : NULL;
+}
+
+// Closed slots of `concept`; store_slots_as_of() needs room for
+// store_degree() + store_history_degree() results.
+static inline uint32_t store_history_degree(const ConceptStore* store, uint32_t concept) {
+    return store->history.degrees[concept];
+}
+
+static inline uint32_t store_in_degree(const ConceptStore* store, uint32_t concept) {
+    return store->in_slots.degrees[concept];
+}
+
+static inline const Symbol* store_in_slot_names(const ConceptStore* store, uint32_t concept) {
+    return store->in_slots.names + store->in_slots.offsets[concept];
+}
+
+static inline const uint32_t* store_in_slot_sources(const ConceptStore* store, uint32_t concept) {
+    return store->in_slots.neighbors + store->in_slots.offsets[concept];
+}
+
+#endif
@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "epoch.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// A "Symbol" is an interned string: every distinct string gets one small
+// integer, handed out in insertion order (0, 1, 2, ...).
+//
+// Types ("Person") and slot names ("owns") repeat across thousands of
+// concepts, so storing them as char* wastes memory and turns every
+// comparison into a strcmp. With symbols:
+//     - equality is an integer compare
+//     - "all concepts of type Person" becomes a scan over a uint32 array
+//
+// Memory Model:
+// ==============
+//
+//    SymbolTable
+//    ┌──────────────────────────┐
+//    │ pool    → "Person\0owns\0likes\0..."   (one growing char buffer)
+//    │ offsets → [0, 7, 12, ...]              (symbol → start in pool)
+//    │ buckets → { count, slots[count] }      (hash → symbol + 1, 0 = empty)
+//    └──────────────────────────┘
+//
+// - Lookup is a hash probe with linear probing (README §3.1.1).
+// - Strings are copied into the pool; callers keep their own memory.
+// - Pointers returned by symbol_name() are invalidated by the next
+//   intern_symbol() (the pool may move); copy them if you need them longer.
+//
+// Concurrent readers:
+// ==============
+//
+// With `epochs` set, grown arrays are retired instead of freed, and
+// buckets are published with release stores after the string they point
+// at. A reader pinned in `epochs` can then call find_symbol() /
+// symbol_name() while one writer interns: it sees each symbol either
+// fully or not at all, and its pointers stay valid until it unpins.
+//
+// The bucket array carries its own size: a reader loads one pointer and
+// gets a slot array and the mask that goes with it. (With the count in a
+// separate field, a reader could pair an old mask with a new array,
+// probe the wrong slots and miss a symbol that exists.)
+//
+// Copies:
+// ==============
+//
+// copy_symbol_table() lays a frozen copy out in one caller-provided
+// block of symbol_table_bytes() (buckets, offsets, pool), e.g. memory
+// bound to another NUMA node. A copy is for lookups only: never intern
+// into it or free_symbol_table() it; release the block instead.
+
+// ----------------------------------------------------------------------------------------
+
+typedef uint32_t Symbol;
+
+#define SYMBOL_NONE UINT32_MAX
+
+typedef struct SymbolBuckets {
+    uint32_t count;             // always a power of two
+    uint32_t slots[];
+} SymbolBuckets;
+
+typedef struct SymbolTable {
+    char* pool;
+    uint32_t pool_size;
+    uint32_t pool_capacity;
+
+    uint32_t* offsets;
+    uint32_t count;
+    uint32_t capacity;
+
+    SymbolBuckets* buckets;     // swapped as a whole on growth
+
+    EpochManager* epochs;       // NULL: free old arrays immediately
+} SymbolTable;
+
+void init_symbol_table(SymbolTable* table);
+void free_symbol_table(SymbolTable* table);
+
+Symbol intern_symbol(SymbolTable* table, const char* name);
+Symbol find_symbol(const SymbolTable* table, const char* name);
+const char* symbol_name(const SymbolTable* table, Symbol symbol);
+
+size_t symbol_table_bytes(const SymbolTable* table);
+void copy_symbol_table(SymbolTable* copy, const SymbolTable* table, void* memory);
+
+uint32_t hash_string(const char* str);
+
+#endif
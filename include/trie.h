@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef TRIE_H
+#define TRIE_H
+
+#include <stdint.h>
+#include "matcher.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// Concept detection on llama2.c token IDs (README §4: tokens → concepts).
+// Matching on detokenized text means decoding every sampled token and
+// re-scanning strings; matching on token IDs lets the sampling loop feed
+// each new token straight in and learn, in O(1) amortized, which concept
+// mentions end at it.
+//
+// Every concept ID and alias is encoded once with the model's tokenizer
+// (a TokenEncodeFn wrapping llama2.c's encode()) and inserted into a trie
+// over token IDs, with Aho–Corasick fail / dict links on top:
+//
+//     "new york"      → [ 716, 17526 ]
+//     "new york city" → [ 716, 17526, 4272 ]
+//     "york"          → [ 17526 ]
+//
+//     ()─716→(a)─17526→(b)*─4272→(c)*        fail(b) = d: a mention of
+//      └─17526→(d)*                           "new york" is also "york"
+//
+// llama2.c's encode() prepends the dummy space, so "york" encodes to the
+// mid-sentence piece " york": patterns line up with words as they occur
+// in running text. Subword splits differ by case, so add each casing to
+// be recognized as its own alias.
+//
+// Memory Model:
+// ==============
+//
+// - Edges (state, token) → child live in one open-addressed hash table
+//   keyed by the pair: a 32000-token vocabulary rules out per-state
+//   arrays, and a probe is O(1) regardless of fanout.
+// - The root, hit by almost every token, has a direct table of
+//   vocab_size entries instead.
+// - Per state: fail, dict, first pattern, incoming token, and
+//   first-child / next-sibling links for the breadth-first link pass.
+//
+// Updates:
+// ==============
+//
+// token_trie_add() extends the trie in place; token_trie_compile()
+// recomputes fail and dict links in one BFS. States only ever get added,
+// so a TokenStream in progress stays valid across updates. Neither call
+// may run concurrently with token_stream_push() on the same trie.
+
+// ----------------------------------------------------------------------------------------
+
+#define TOKEN_TRIE_MAX_PATTERN 64
+#define TOKEN_NONE UINT32_MAX
+
+// Tokenize `text` into at most `capacity` token IDs; returns how many.
+typedef uint32_t (*TokenEncodeFn)(void* context, const char* text, int* tokens, uint32_t capacity);
+
+typedef struct TokenPattern {
+    uint32_t length;            // in tokens
+    uint32_t concept;
+} TokenPattern;
+
+typedef struct TokenTrie {
+    uint32_t vocab_size;
+    uint32_t* root_next;        // vocab_size entries, 0 = no edge
+
+    uint64_t* edge_keys;        // (state << 32) | token, UINT64_MAX = empty
+    uint32_t* edge_targets;
+    uint32_t edge_count;
+    uint32_t edge_capacity;     // always a power of two
+
+    uint32_t* fail;
+    uint32_t* dict;             // TOKEN_NONE if no output on the fail chain
+    uint32_t* output;           // first pattern ending here, or TOKEN_NONE
+    uint32_t* label;            // token on the edge into the state
+    uint32_t* first_child;
+    uint32_t* next_sibling;
+    uint32_t state_count;
+    uint32_t state_capacity;
+
+    TokenPattern* patterns;
+    uint32_t* pattern_next;     // next pattern ending at the same state
+    uint32_t pattern_count;
+    uint32_t pattern_capacity;
+
+    uint32_t matcher_synced;    // matcher patterns already added
+    int compiled;               // fail / dict links are current
+} TokenTrie;
+
+typedef struct TokenStream {
+    uint32_t state;
+    uint32_t position;          // tokens pushed so far
+} TokenStream;
+
+void init_token_trie(TokenTrie* trie, uint32_t vocab_size);
+void free_token_trie(TokenTrie* trie);
+
+uint32_t token_trie_add(TokenTrie* trie, const int* tokens, uint32_t length, uint32_t concept);
+uint32_t token_trie_add_text(TokenTrie* trie, const char* text, uint32_t concept, TokenEncodeFn encode,
+                             void* context);
+uint32_t token_trie_sync_matcher(TokenTrie* trie, const EntityMatcher* matcher, TokenEncodeFn encode,
+                                 void* context);
+void token_trie_compile(TokenTrie* trie);
+
+void init_token_stream(TokenStream* stream);
+uint32_t token_stream_push(const TokenTrie* trie, TokenStream* stream, int token, EntityMention* out,
+                           uint32_t capacity);
+uint32_t token_trie_scan(const TokenTrie* trie, const int* tokens, uint32_t token_count, EntityMention* out,
+                         uint32_t capacity);
+
+#endif
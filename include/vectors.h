@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef VECTORS_H
+#define VECTORS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// A "ConceptVectorStore" holds one embedding per concept (README §3.2.3)
+// as a single matrix: row i is the embedding of concept index i.
+//
+// Memory Model:
+// ==============
+//
+//    vectors (one mmap, page aligned)
+//    ┌────────────────────────────────────────┬──────┐
+//    │ concept 0: d floats                    │ pad  │  ← stride floats = 64·k bytes
+//    │ concept 1: d floats                    │ pad  │
+//    │ concept 2: (none yet — untouched page) │      │
+//    └────────────────────────────────────────┴──────┘
+//
+// - Rows are padded to a multiple of 16 floats, so every row starts on
+//   a 64-byte (cache line / AVX-512) boundary and kernels may read the
+//   whole stride: the padding is always zero.
+// - Looking up concept i is `vectors + i * stride`: one multiply, no
+//   pointer chase, and a scan over many concepts is a strided stream.
+// - The mapping reserves address space for `max_concepts` rows up
+//   front without committing memory (MAP_NORESERVE); the kernel backs a
+//   page on first write, so concepts without embeddings cost nothing.
+//   Since the base never moves, readers can keep row pointers. Only
+//   attaching beyond max_concepts remaps (and may move) the matrix.
+// - `present` marks which rows hold an embedding. Detaching clears the
+//   bit and zeroes the row.
+//
+// Writers (attach / detach) need external serialization; readers of
+// rows that are not being written need none.
+
+// ----------------------------------------------------------------------------------------
+
+#define VECTOR_ALIGN_FLOATS 16
+#define VECTOR_DEFAULT_MAX_CONCEPTS ((uint32_t)1 << 22)
+
+typedef struct ConceptVectorStore {
+    float* vectors;
+    uint32_t dimensions;
+    uint32_t stride;            // floats per row, dimensions rounded up to 16
+    uint32_t capacity;          // rows the mapping covers
+    uint32_t n_concepts;        // rows with an embedding
+
+    uint64_t* present;          // one bit per row
+    size_t mapped;              // bytes of the matrix mapping
+} ConceptVectorStore;
+
+void init_vector_store(ConceptVectorStore* store, uint32_t dimensions, uint32_t max_concepts);
+void free_vector_store(ConceptVectorStore* store);
+
+float* vector_attach(ConceptVectorStore* store, uint32_t concept, const float* embedding);
+void vector_detach(ConceptVectorStore* store, uint32_t concept);
+
+static inline int vector_present(const ConceptVectorStore* store, uint32_t concept) {
+    return concept < store->capacity && (store->present[concept >> 6] >> (concept & 63)) & 1;
+}
+
+// Row of `concept`, or NULL if it has no embedding.
+static inline const float* vector_of(const ConceptVectorStore* store, uint32_t concept) {
+    return vector_present(store, concept) ? store->vectors + (size_t)concept * store->stride : NULL;
+}
+
+#endif
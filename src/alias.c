@@ -0,0 +1,420 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "alias.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GRAM_BEGIN 0x02         // padding: ^name$
+#define GRAM_END 0x03
+
+static void* alias_grow(void* ptr, size_t size, const char* what) {
+    void* grown = realloc(ptr, size ? size : 1);
+    if (!grown) {
+        fprintf(stderr, "Failed to allocate memory for %s.\n", what);
+        exit(1);
+    }
+    return grown;
+}
+
+static inline uint8_t fold_byte(uint8_t byte) {
+    return (byte >= 'A' && byte <= 'Z') ? (uint8_t)(byte + ('a' - 'A')) : byte;
+}
+
+// Fold `name` into `out` (ALIAS_MAX_LENGTH + 1 bytes); returns its
+// length, or ALIAS_NONE if it is empty or too long.
+static uint32_t fold_name(const char* name, char* out) {
+    uint32_t length = 0;
+    for (; name[length]; length++) {
+        if (length == ALIAS_MAX_LENGTH) return ALIAS_NONE;
+        out[length] = (char)fold_byte((uint8_t)name[length]);
+    }
+    out[length] = '\0';
+    return length ? length : ALIAS_NONE;
+}
+
+static int compare_grams(const void* a, const void* b) {
+    uint16_t x = *(const uint16_t*)a;
+    uint16_t y = *(const uint16_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Distinct bigrams of ^name$, sorted; returns how many.
+static uint32_t name_grams(const char* name, uint32_t length, uint16_t* grams) {
+    uint8_t previous = GRAM_BEGIN;
+    for (uint32_t i = 0; i <= length; i++) {
+        uint8_t byte = i < length ? (uint8_t)name[i] : GRAM_END;
+        grams[i] = (uint16_t)((previous << 8) | byte);
+        previous = byte;
+    }
+    qsort(grams, length + 1, sizeof(uint16_t), compare_grams);
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i <= length; i++) {
+        if (count == 0 || grams[count - 1] != grams[i]) grams[count++] = grams[i];
+    }
+    return count;
+}
+
+void init_alias_index(AliasIndex* index) {
+    if (!index) return;
+
+    memset(index, 0, sizeof(AliasIndex));
+    init_symbol_table(&index->names);
+    index->grams = calloc(ALIAS_GRAMS, sizeof(PostingList));
+    if (!index->grams) {
+        fprintf(stderr, "Failed to allocate memory for alias grams.\n");
+        exit(1);
+    }
+}
+
+void free_alias_index(AliasIndex* index) {
+    if (!index) return;
+
+    free_symbol_table(&index->names);
+    free(index->name_lengths);
+    free(index->first_entry);
+    free(index->entry_concepts);
+    free(index->entry_next);
+    if (index->grams) {
+        for (uint32_t g = 0; g < ALIAS_GRAMS; g++) free(index->grams[g].names);
+        free(index->grams);
+    }
+    memset(index, 0, sizeof(AliasIndex));
+}
+
+// ---
+// Alias table
+// ---
+
+static void index_name(AliasIndex* index, Symbol name, const char* text, uint32_t length) {
+    if (name >= index->name_capacity) {
+        uint32_t capacity = index->name_capacity ? index->name_capacity * 2 : 64;
+        index->name_lengths = alias_grow(index->name_lengths, capacity, "alias names");
+        index->first_entry = alias_grow(index->first_entry, capacity * sizeof(uint32_t), "alias names");
+        index->name_capacity = capacity;
+    }
+    index->name_lengths[name] = (uint8_t)length;
+    index->first_entry[name] = ALIAS_NONE;
+
+    uint16_t grams[ALIAS_MAX_LENGTH + 1];
+    uint32_t count = name_grams(text, length, grams);
+    for (uint32_t i = 0; i < count; i++) {
+        PostingList* list = &index->grams[grams[i]];
+        if (list->count == list->capacity) {
+            list->capacity = list->capacity ? list->capacity * 2 : 4;
+            list->names = alias_grow(list->names, list->capacity * sizeof(uint32_t), "alias postings");
+        }
+        list->names[list->count++] = name;
+    }
+}
+
+// Symbol alias_add(AliasIndex* index, const char* name, uint32_t concept);
+//
+// Make `name` resolve to `concept` (in addition to any concepts it
+// already names). Returns the name's symbol, or SYMBOL_NONE if the name
+// is empty or longer than ALIAS_MAX_LENGTH. Adding a pair twice is a
+// no-op.
+
+Symbol alias_add(AliasIndex* index, const char* name, uint32_t concept) {
+    if (!index || !name) return SYMBOL_NONE;
+
+    char folded[ALIAS_MAX_LENGTH + 1];
+    uint32_t length = fold_name(name, folded);
+    if (length == ALIAS_NONE) return SYMBOL_NONE;
+
+    uint32_t known = index->names.count;
+    Symbol symbol = intern_symbol(&index->names, folded);
+    if (symbol >= known) index_name(index, symbol, folded, length);
+
+    for (uint32_t e = index->first_entry[symbol]; e != ALIAS_NONE; e = index->entry_next[e]) {
+        if (index->entry_concepts[e] == concept) return symbol;
+    }
+
+    if (index->entry_count == index->entry_capacity) {
+        uint32_t capacity = index->entry_capacity ? index->entry_capacity * 2 : 64;
+        index->entry_concepts = alias_grow(index->entry_concepts, capacity * sizeof(uint32_t), "alias entries");
+        index->entry_next = alias_grow(index->entry_next, capacity * sizeof(uint32_t), "alias entries");
+        index->entry_capacity = capacity;
+    }
+    uint32_t entry = index->entry_count++;
+    index->entry_concepts[entry] = concept;
+    index->entry_next[entry] = index->first_entry[symbol];
+    index->first_entry[symbol] = entry;
+    return symbol;
+}
+
+// uint32_t alias_sync_store(AliasIndex* index, const ConceptStore* store);
+//
+// Add the ID of every concept created in `store` since the last sync as
+// a name of that concept; returns how many were added. Reserved
+// concepts (shard proxies, store.h) have no name to resolve and are
+// skipped.
+
+uint32_t alias_sync_store(AliasIndex* index, const ConceptStore* store) {
+    if (!index || !store) return 0;
+
+    uint32_t added = 0;
+    for (uint32_t concept = index->store_synced; concept < store->concept_count; concept++) {
+        if (store_is_reserved(store, concept)) continue;
+        if (alias_add(index, store_concept_id(store, concept), concept) != SYMBOL_NONE) added++;
+    }
+    index->store_synced = store->concept_count;
+    return added;
+}
+
+// uint32_t alias_lookup(const AliasIndex* index, const char* name, uint32_t* concepts, uint32_t capacity);
+//
+// Exact (case-folded) lookup: writes up to `capacity` concepts named
+// `name` and returns how many there are.
+
+uint32_t alias_lookup(const AliasIndex* index, const char* name, uint32_t* concepts, uint32_t capacity) {
+    if (!index || !name) return 0;
+
+    char folded[ALIAS_MAX_LENGTH + 1];
+    if (fold_name(name, folded) == ALIAS_NONE) return 0;
+    Symbol symbol = find_symbol(&index->names, folded);
+    if (symbol == SYMBOL_NONE) return 0;
+
+    uint32_t count = 0;
+    for (uint32_t e = index->first_entry[symbol]; e != ALIAS_NONE; e = index->entry_next[e]) {
+        if (concepts && count < capacity) concepts[count] = index->entry_concepts[e];
+        count++;
+    }
+    return count;
+}
+
+// ---
+// Edit distance
+// ---
+
+// Myers / Hyyrö bit-parallel Levenshtein distance of the pattern
+// described by `peq` (bit i of peq[c] set when pattern[i] == c; length
+// m <= 64) to `text`. Column j of the DP is kept as vertical +1 / -1
+// delta bit vectors; `score` tracks the last row. Returns bound + 1 as
+// soon as the distance is certain to exceed `bound`.
+static uint32_t myers_distance(const uint64_t* peq, uint32_t m, const char* text, uint32_t n, uint32_t bound) {
+    uint64_t high = (uint64_t)1 << (m - 1);
+    uint64_t pv = ~(uint64_t)0;
+    uint64_t mv = 0;
+    uint32_t score = m;
+
+    for (uint32_t j = 0; j < n; j++) {
+        uint64_t eq = peq[(uint8_t)text[j]];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & high) score++;
+        else if (mh & high) score--;
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+
+        // Each remaining character can lower the score by at most one.
+        if (score > bound + (n - 1 - j)) return bound + 1;
+    }
+    return score <= bound ? score : bound + 1;
+}
+
+// Two-row DP for patterns longer than 64 bytes. Names are at most
+// ALIAS_MAX_LENGTH, so their row fits on the stack; longer strings
+// passed to edit_distance() take a heap row.
+static uint32_t row_distance(const char* a, uint32_t a_length, const char* b, uint32_t b_length, uint32_t bound) {
+    uint32_t stack[ALIAS_MAX_LENGTH + 2];
+    uint32_t* row = stack;
+    if (a_length > ALIAS_MAX_LENGTH) {
+        row = malloc(((size_t)a_length + 1) * sizeof(uint32_t));
+        if (!row) {
+            fprintf(stderr, "Failed to allocate memory for edit distance row.\n");
+            exit(1);
+        }
+    }
+    for (uint32_t i = 0; i <= a_length; i++) row[i] = i;
+
+    for (uint32_t j = 1; j <= b_length; j++) {
+        uint32_t diagonal = row[0];
+        uint32_t smallest = row[0] = j;
+        for (uint32_t i = 1; i <= a_length; i++) {
+            uint32_t above = row[i];
+            uint32_t value = diagonal + (a[i - 1] != b[j - 1]);
+            if (above + 1 < value) value = above + 1;
+            if (row[i - 1] + 1 < value) value = row[i - 1] + 1;
+            row[i] = value;
+            diagonal = above;
+            if (value < smallest) smallest = value;
+        }
+        if (smallest > bound) break;
+    }
+    uint32_t distance = row[a_length] <= bound ? row[a_length] : bound + 1;
+    if (row != stack) free(row);
+    return distance;
+}
+
+// uint32_t edit_distance(const char* a, uint32_t a_length, const char* b, uint32_t b_length, uint32_t bound);
+//
+// Levenshtein distance of two byte strings, or bound + 1 if it exceeds
+// `bound`. Bit-parallel when either string fits in 64 bytes. The
+// distance is at most the longer length, so a larger bound is lowered
+// to it first and bound + 1 never wraps.
+
+uint32_t edit_distance(const char* a, uint32_t a_length, const char* b, uint32_t b_length, uint32_t bound) {
+    uint32_t longest = a_length > b_length ? a_length : b_length;
+    if (bound > longest) bound = longest;
+
+    uint32_t gap = a_length > b_length ? a_length - b_length : b_length - a_length;
+    if (gap > bound) return bound + 1;
+    if (a_length == 0 || b_length == 0) return gap;
+
+    if (a_length > 64) {
+        const char* swap = a;
+        a = b;
+        b = swap;
+        uint32_t swap_length = a_length;
+        a_length = b_length;
+        b_length = swap_length;
+    }
+    if (a_length > 64) return row_distance(a, a_length, b, b_length, bound);
+
+    uint64_t peq[256];
+    memset(peq, 0, sizeof(peq));
+    for (uint32_t i = 0; i < a_length; i++) peq[(uint8_t)a[i]] |= (uint64_t)1 << i;
+    return myers_distance(peq, a_length, b, b_length, bound);
+}
+
+// ---
+// Fuzzy lookup
+// ---
+
+void init_alias_workspace(AliasWorkspace* workspace) {
+    if (!workspace) return;
+    memset(workspace, 0, sizeof(AliasWorkspace));
+}
+
+void free_alias_workspace(AliasWorkspace* workspace) {
+    if (!workspace) return;
+    free(workspace->counts);
+    free(workspace->stamps);
+    free(workspace->candidates);
+    memset(workspace, 0, sizeof(AliasWorkspace));
+}
+
+static void reserve_alias_workspace(AliasWorkspace* workspace, uint32_t names) {
+    if (names <= workspace->capacity) return;
+
+    uint32_t capacity = workspace->capacity ? workspace->capacity : 64;
+    while (capacity < names) capacity *= 2;
+    workspace->counts = alias_grow(workspace->counts, capacity * sizeof(uint32_t), "alias workspace");
+    workspace->stamps = alias_grow(workspace->stamps, capacity * sizeof(uint32_t), "alias workspace");
+    workspace->candidates = alias_grow(workspace->candidates, capacity * sizeof(uint32_t), "alias workspace");
+    memset(workspace->stamps + workspace->capacity, 0, (capacity - workspace->capacity) * sizeof(uint32_t));
+    workspace->capacity = capacity;
+}
+
+static int compare_names(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// uint32_t alias_fuzzy_lookup(const AliasIndex* index, AliasWorkspace* workspace, const char* query,
+//                             uint32_t max_distance, uint32_t limit, AliasMatch* out);
+//
+// Goal:
+// ======
+// Every (name, concept) pair whose name is within `max_distance` edits
+// of `query` (case-folded), nearest first, then by name symbol. Writes
+// up to `limit` to `out` and returns how many were written.
+//
+// Key Steps:
+// ========================
+//
+// 1. Candidates: names sharing at least distinct_bigrams - 2k bigrams
+//    with the query, counted with stamps along its posting lists, whose
+//    length is within k of the query's. A bound <= 0 prunes nothing, so
+//    then every name of a fitting length is a candidate.
+// 2. Verify each candidate with the bit-parallel distance (pattern =
+//    the query, built once), which stops early past the bound.
+// 3. Emit by distance 0..k; within one distance, by name symbol.
+
+uint32_t alias_fuzzy_lookup(const AliasIndex* index, AliasWorkspace* workspace, const char* query,
+                            uint32_t max_distance, uint32_t limit, AliasMatch* out) {
+    if (!index || !workspace || !query || !out || limit == 0) return 0;
+
+    char folded[ALIAS_MAX_LENGTH + 1];
+    uint32_t length = fold_name(query, folded);
+    if (length == ALIAS_NONE) return 0;
+    if (max_distance > ALIAS_MAX_LENGTH) max_distance = ALIAS_MAX_LENGTH;
+
+    uint32_t names = index->names.count;
+    reserve_alias_workspace(workspace, names);
+    if (++workspace->stamp == 0) {
+        memset(workspace->stamps, 0, workspace->capacity * sizeof(uint32_t));
+        workspace->stamp = 1;
+    }
+    uint32_t stamp = workspace->stamp;
+    uint32_t* counts = workspace->counts;
+    uint32_t* stamps = workspace->stamps;
+    uint32_t* candidates = workspace->candidates;
+    uint32_t candidate_count = 0;
+
+    uint32_t shortest = length > max_distance ? length - max_distance : 0;
+    uint32_t longest = length + max_distance;
+
+    uint16_t grams[ALIAS_MAX_LENGTH + 1];
+    uint32_t gram_count = name_grams(folded, length, grams);
+    int64_t threshold = (int64_t)gram_count - 2 * (int64_t)max_distance;
+
+    if (threshold <= 0) {
+        for (uint32_t name = 0; name < names; name++) {
+            uint32_t name_length = index->name_lengths[name];
+            if (name_length >= shortest && name_length <= longest) candidates[candidate_count++] = name;
+        }
+    } else {
+        for (uint32_t g = 0; g < gram_count; g++) {
+            const PostingList* list = &index->grams[grams[g]];
+            for (uint32_t i = 0; i < list->count; i++) {
+                uint32_t name = list->names[i];
+                if (stamps[name] != stamp) {
+                    stamps[name] = stamp;
+                    counts[name] = 0;
+                }
+                if (++counts[name] != (uint32_t)threshold) continue;
+                uint32_t name_length = index->name_lengths[name];
+                if (name_length >= shortest && name_length <= longest) candidates[candidate_count++] = name;
+            }
+        }
+        qsort(candidates, candidate_count, sizeof(uint32_t), compare_names);
+    }
+
+    // Verify; counts[] now holds each candidate's distance.
+    uint64_t peq[256];
+    if (length <= 64) {
+        memset(peq, 0, sizeof(peq));
+        for (uint32_t i = 0; i < length; i++) peq[(uint8_t)folded[i]] |= (uint64_t)1 << i;
+    }
+    uint32_t kept = 0;
+    for (uint32_t c = 0; c < candidate_count; c++) {
+        uint32_t name = candidates[c];
+        const char* text = symbol_name(&index->names, name);
+        uint32_t name_length = index->name_lengths[name];
+        uint32_t distance = length <= 64 ? myers_distance(peq, length, text, name_length, max_distance)
+                                         : edit_distance(folded, length, text, name_length, max_distance);
+        if (distance > max_distance) continue;
+        counts[name] = distance;
+        candidates[kept++] = name;
+    }
+
+    uint32_t written = 0;
+    for (uint32_t distance = 0; distance <= max_distance && written < limit; distance++) {
+        for (uint32_t c = 0; c < kept && written < limit; c++) {
+            uint32_t name = candidates[c];
+            if (counts[name] != distance) continue;
+            for (uint32_t e = index->first_entry[name]; e != ALIAS_NONE && written < limit; e = index->entry_next[e]) {
+                out[written++] = (AliasMatch){ index->entry_concepts[e], distance, name };
+            }
+        }
+    }
+    return written;
+}
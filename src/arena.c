@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "arena.h"
+#include "numa.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Sits in the first ARENA_HEADER bytes of every block.
+typedef struct ArenaHeader {
+    uint64_t size;              // whole block (or mapping) in bytes
+    uint64_t large;             // 1 if the block has its own mapping
+} ArenaHeader;
+
+// Large mappings start with these links, then the header, then data.
+struct ArenaLarge {
+    ArenaLarge* prev;
+    ArenaLarge* next;
+};
+
+static void* arena_map(Arena* arena, size_t size) {
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        fprintf(stderr, "Failed to map %zu bytes for arena.\n", size);
+        exit(1);
+    }
+    if (arena->node >= 0) {
+        numa_bind(memory, size, arena->node, 0);    // before first touch
+    }
+    arena->mapped += size;
+    return memory;
+}
+
+void init_arena(Arena* arena, int node) {
+    if (!arena) return;
+    memset(arena, 0, sizeof(Arena));
+    arena->node = node;
+}
+
+void free_arena(Arena* arena) {
+    if (!arena) return;
+
+    for (uint32_t i = 0; i < arena->chunk_count; i++) {
+        munmap(arena->chunks[i], ARENA_CHUNK_SIZE);
+    }
+    free(arena->chunks);
+
+    ArenaLarge* large = arena->large;
+    while (large) {
+        ArenaLarge* next = large->next;
+        ArenaHeader* header = (ArenaHeader*)(large + 1);
+        munmap(large, header->size);
+        large = next;
+    }
+
+    init_arena(arena, arena->node);
+}
+
+// Re-home the arena: new mappings prefer `node`, and pages already
+// mapped are migrated there. -1 stops binding (existing pages stay put).
+void arena_set_node(Arena* arena, int node) {
+    if (!arena || arena->node == node) return;
+
+    arena->node = node;
+    if (node < 0) return;
+
+    for (uint32_t i = 0; i < arena->chunk_count; i++) {
+        numa_bind(arena->chunks[i], ARENA_CHUNK_SIZE, node, 1);
+    }
+    for (ArenaLarge* large = arena->large; large; large = large->next) {
+        ArenaHeader* header = (ArenaHeader*)(large + 1);
+        numa_bind(large, header->size, node, 1);
+    }
+}
+
+// Smallest class whose blocks hold `size` bytes (header included).
+static uint32_t size_shift(size_t size) {
+    uint32_t shift = ARENA_MIN_SHIFT;
+    while (((size_t)1 << shift) < size) {
+        shift++;
+    }
+    return shift;
+}
+
+static void push_free(Arena* arena, char* block, uint32_t shift) {
+    *(void**)block = arena->free_lists[shift - ARENA_MIN_SHIFT];
+    arena->free_lists[shift - ARENA_MIN_SHIFT] = block;
+}
+
+// Start a new chunk. The unused tail of the old one is cut into the
+// largest blocks that fit and put on the free lists rather than lost.
+static void new_chunk(Arena* arena) {
+    size_t tail = (size_t)(arena->limit - arena->cursor);
+    for (uint32_t shift = ARENA_LARGE_SHIFT - 1; shift >= ARENA_MIN_SHIFT; shift--) {
+        size_t block = (size_t)1 << shift;
+        while (tail >= block) {
+            push_free(arena, arena->cursor, shift);
+            arena->cursor += block;
+            tail -= block;
+        }
+    }
+
+    if (arena->chunk_count >= arena->chunk_capacity) {
+        uint32_t new_capacity = arena->chunk_capacity ? arena->chunk_capacity * 2 : 8;
+        char** new_chunks = realloc(arena->chunks, new_capacity * sizeof(char*));
+        if (!new_chunks) {
+            fprintf(stderr, "Failed to allocate memory for arena chunks.\n");
+            exit(1);
+        }
+        arena->chunks = new_chunks;
+        arena->chunk_capacity = new_capacity;
+    }
+
+    char* chunk = arena_map(arena, ARENA_CHUNK_SIZE);
+    arena->chunks[arena->chunk_count++] = chunk;
+    arena->cursor = chunk;
+    arena->limit = chunk + ARENA_CHUNK_SIZE;
+}
+
+static void* alloc_large(Arena* arena, size_t size) {
+    long page = sysconf(_SC_PAGESIZE);
+    size_t length = size + sizeof(ArenaLarge) + ARENA_HEADER;
+    length = (length + (size_t)page - 1) & ~((size_t)page - 1);
+
+    ArenaLarge* large = arena_map(arena, length);
+    large->prev = NULL;
+    large->next = arena->large;
+    if (arena->large) arena->large->prev = large;
+    arena->large = large;
+
+    ArenaHeader* header = (ArenaHeader*)(large + 1);
+    header->size = length;
+    header->large = 1;
+    arena->in_use += length;
+    return (char*)header + ARENA_HEADER;
+}
+
+// void* arena_alloc(Arena* arena, size_t size);
+//
+// Pop a block of the right class, or carve one from the current chunk.
+// Blocks are multiples of 64 bytes carved in order from page-aligned
+// chunks, so data is always 16-byte aligned like malloc's.
+
+void* arena_alloc(Arena* arena, size_t size) {
+    if (!arena) return NULL;
+
+    size_t needed = size + ARENA_HEADER;
+    if (needed > ARENA_LARGE_SIZE / 2) {
+        return alloc_large(arena, size);
+    }
+
+    uint32_t shift = size_shift(needed);
+    size_t block_size = (size_t)1 << shift;
+
+    char* block = arena->free_lists[shift - ARENA_MIN_SHIFT];
+    if (block) {
+        arena->free_lists[shift - ARENA_MIN_SHIFT] = *(void**)block;
+    } else {
+        if ((size_t)(arena->limit - arena->cursor) < block_size) {
+            new_chunk(arena);
+        }
+        block = arena->cursor;
+        arena->cursor += block_size;
+    }
+
+    ArenaHeader* header = (ArenaHeader*)block;
+    header->size = block_size;
+    header->large = 0;
+    arena->in_use += block_size;
+    return block + ARENA_HEADER;
+}
+
+void arena_free(Arena* arena, void* ptr) {
+    if (!arena || !ptr) return;
+
+    ArenaHeader* header = (ArenaHeader*)((char*)ptr - ARENA_HEADER);
+    arena->in_use -= header->size;
+
+    if (header->large) {
+        ArenaLarge* large = (ArenaLarge*)header - 1;
+        if (large->prev) large->prev->next = large->next;
+        else arena->large = large->next;
+        if (large->next) large->next->prev = large->prev;
+        munmap(large, header->size);
+        return;
+    }
+
+    push_free(arena, (char*)header, size_shift(header->size));
+}
+
+// void* arena_realloc(Arena* arena, void* ptr, size_t size);
+//
+// Same contract as realloc(). A block that already has room (the class
+// was rounded up) is returned unchanged; otherwise the data moves to a
+// new block and the old one is freed.
+
+void* arena_realloc(Arena* arena, void* ptr, size_t size) {
+    if (!arena) return NULL;
+    if (!ptr) return arena_alloc(arena, size);
+
+    ArenaHeader* header = (ArenaHeader*)((char*)ptr - ARENA_HEADER);
+    size_t capacity = header->size - ARENA_HEADER - (header->large ? sizeof(ArenaLarge) : 0);
+    if (size <= capacity) return ptr;
+
+    void* new_ptr = arena_alloc(arena, size);
+    memcpy(new_ptr, ptr, capacity);
+    arena_free(arena, ptr);
+    return new_ptr;
+}
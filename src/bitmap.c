@@ -0,0 +1,629 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "bitmap.h"
+#include "cpu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if CLARITY_X86
+#include <immintrin.h>
+#endif
+
+typedef enum BitsetOp {
+    BITSET_AND,
+    BITSET_OR,
+    BITSET_ANDNOT
+} BitsetOp;
+
+static void* roaring_alloc(void* ptr, size_t size) {
+    void* new_ptr = realloc(ptr, size);
+    if (!new_ptr) {
+        fprintf(stderr, "Failed to allocate memory for roaring bitmap.\n");
+        exit(1);
+    }
+    return new_ptr;
+}
+
+// ---
+// Bitset kernels: out = a OP b over 1024 words, returning popcount(out)
+// ---
+
+static uint32_t bitset_kernel_scalar(BitsetOp op, const uint64_t* a, const uint64_t* b, uint64_t* out) {
+    uint32_t cardinality = 0;
+    for (uint32_t i = 0; i < ROARING_BITSET_WORDS; i++) {
+        uint64_t word = (op == BITSET_AND) ? (a[i] & b[i])
+                      : (op == BITSET_OR)  ? (a[i] | b[i])
+                      :                      (a[i] & ~b[i]);
+        out[i] = word;
+        cardinality += (uint32_t)__builtin_popcountll(word);
+    }
+    return cardinality;
+}
+
+#if CLARITY_X86
+
+// One vector op per iteration, then hardware popcnt over the words just
+// written (AVX2 has no vector popcount, and this keeps AVX-512 within
+// the F+BW baseline that cpu_level() promises).
+#define BITSET_KERNEL_BODY(VEC, LOAD, STORE, AND, OR, ANDNOT, LANES)               \
+    uint32_t cardinality = 0;                                                       \
+    for (uint32_t i = 0; i < ROARING_BITSET_WORDS; i += LANES) {                    \
+        VEC va = LOAD((const void*)(a + i));                                        \
+        VEC vb = LOAD((const void*)(b + i));                                        \
+        VEC vr = (op == BITSET_AND) ? AND(va, vb)                                   \
+               : (op == BITSET_OR)  ? OR(va, vb)                                    \
+               :                      ANDNOT(vb, va);                               \
+        STORE((void*)(out + i), vr);                                                \
+        for (uint32_t j = 0; j < LANES; j++) {                                      \
+            cardinality += (uint32_t)__builtin_popcountll(out[i + j]);              \
+        }                                                                           \
+    }                                                                               \
+    return cardinality;
+
+__attribute__((target("avx2,popcnt")))
+static uint32_t bitset_kernel_avx2(BitsetOp op, const uint64_t* a, const uint64_t* b, uint64_t* out) {
+    BITSET_KERNEL_BODY(__m256i, _mm256_loadu_si256, _mm256_storeu_si256,
+                       _mm256_and_si256, _mm256_or_si256, _mm256_andnot_si256, 4)
+}
+
+__attribute__((target("avx512f,popcnt")))
+static uint32_t bitset_kernel_avx512(BitsetOp op, const uint64_t* a, const uint64_t* b, uint64_t* out) {
+    BITSET_KERNEL_BODY(__m512i, _mm512_loadu_si512, _mm512_storeu_si512,
+                       _mm512_and_si512, _mm512_or_si512, _mm512_andnot_si512, 8)
+}
+
+#undef BITSET_KERNEL_BODY
+
+#endif
+
+static uint32_t bitset_kernel(BitsetOp op, const uint64_t* a, const uint64_t* b, uint64_t* out) {
+#if CLARITY_X86
+    CpuLevel level = cpu_level();
+    if (level >= CPU_LEVEL_AVX512) return bitset_kernel_avx512(op, a, b, out);
+    if (level >= CPU_LEVEL_AVX2) return bitset_kernel_avx2(op, a, b, out);
+#endif
+    return bitset_kernel_scalar(op, a, b, out);
+}
+
+// ---
+// Container helpers
+// ---
+
+static int bit_test(const uint64_t* bits, uint16_t low) {
+    return (int)((bits[low >> 6] >> (low & 63)) & 1);
+}
+
+static void make_array(RoaringContainer* container, uint16_t key, uint32_t capacity) {
+    container->key = key;
+    container->type = ROARING_ARRAY;
+    container->cardinality = 0;
+    container->capacity = capacity;
+    container->data.array = capacity ? roaring_alloc(NULL, capacity * sizeof(uint16_t)) : NULL;
+}
+
+static void make_bitset(RoaringContainer* container, uint16_t key) {
+    container->key = key;
+    container->type = ROARING_BITSET;
+    container->cardinality = 0;
+    container->capacity = 0;
+    container->data.bits = calloc(ROARING_BITSET_WORDS, sizeof(uint64_t));
+    if (!container->data.bits) {
+        fprintf(stderr, "Failed to allocate memory for roaring bitset.\n");
+        exit(1);
+    }
+}
+
+static void free_container(RoaringContainer* container) {
+    if (container->type == ROARING_ARRAY) {
+        free(container->data.array);
+    } else {
+        free(container->data.bits);
+    }
+    container->data.array = NULL;
+}
+
+static void copy_container(const RoaringContainer* src, RoaringContainer* dst) {
+    if (src->type == ROARING_ARRAY) {
+        make_array(dst, src->key, src->cardinality);
+        memcpy(dst->data.array, src->data.array, src->cardinality * sizeof(uint16_t));
+    } else {
+        make_bitset(dst, src->key);
+        memcpy(dst->data.bits, src->data.bits, ROARING_BITSET_WORDS * sizeof(uint64_t));
+    }
+    dst->cardinality = src->cardinality;
+}
+
+static void array_to_bitset(RoaringContainer* container) {
+    RoaringContainer bitset;
+    make_bitset(&bitset, container->key);
+    for (uint32_t i = 0; i < container->cardinality; i++) {
+        uint16_t low = container->data.array[i];
+        bitset.data.bits[low >> 6] |= 1ULL << (low & 63);
+    }
+    bitset.cardinality = container->cardinality;
+    free_container(container);
+    *container = bitset;
+}
+
+static void bitset_to_array(RoaringContainer* container) {
+    RoaringContainer array;
+    make_array(&array, container->key, container->cardinality);
+    for (uint32_t w = 0; w < ROARING_BITSET_WORDS; w++) {
+        uint64_t word = container->data.bits[w];
+        while (word) {
+            array.data.array[array.cardinality++] = (uint16_t)(w * 64 + (uint32_t)__builtin_ctzll(word));
+            word &= word - 1;
+        }
+    }
+    free_container(container);
+    *container = array;
+}
+
+// Bitsets that shrink to ROARING_ARRAY_MAX or below go back to arrays.
+static void normalize_container(RoaringContainer* container) {
+    if (container->type == ROARING_BITSET && container->cardinality <= ROARING_ARRAY_MAX) {
+        bitset_to_array(container);
+    }
+}
+
+// Binary search by key. Returns the index, or -(insert position) - 1.
+static int32_t find_container(const RoaringBitmap* bitmap, uint16_t key) {
+    int32_t low = 0;
+    int32_t high = (int32_t)bitmap->count - 1;
+    while (low <= high) {
+        int32_t mid = (low + high) / 2;
+        uint16_t mid_key = bitmap->containers[mid].key;
+        if (mid_key == key) return mid;
+        if (mid_key < key) low = mid + 1;
+        else high = mid - 1;
+    }
+    return -(low + 1);
+}
+
+static RoaringContainer* insert_container_at(RoaringBitmap* bitmap, uint32_t position) {
+    if (bitmap->count >= bitmap->capacity) {
+        uint32_t new_capacity = bitmap->capacity ? bitmap->capacity * 2 : 4;
+        bitmap->containers = roaring_alloc(bitmap->containers, new_capacity * sizeof(RoaringContainer));
+        bitmap->capacity = new_capacity;
+    }
+    memmove(bitmap->containers + position + 1, bitmap->containers + position,
+            (bitmap->count - position) * sizeof(RoaringContainer));
+    bitmap->count++;
+    return &bitmap->containers[position];
+}
+
+// Take ownership of `container` as the new last container of `bitmap`.
+// Set operations produce keys in increasing order, so append is enough.
+// Empty results are dropped.
+static void append_container(RoaringBitmap* bitmap, RoaringContainer* container) {
+    if (container->cardinality == 0) {
+        free_container(container);
+        return;
+    }
+    *insert_container_at(bitmap, bitmap->count) = *container;
+}
+
+// ---
+// Public API
+// ---
+
+void init_roaring(RoaringBitmap* bitmap) {
+    if (!bitmap) return;
+    bitmap->containers = NULL;
+    bitmap->count = 0;
+    bitmap->capacity = 0;
+}
+
+void clear_roaring(RoaringBitmap* bitmap) {
+    if (!bitmap) return;
+    for (uint32_t i = 0; i < bitmap->count; i++) {
+        free_container(&bitmap->containers[i]);
+    }
+    bitmap->count = 0;
+}
+
+void free_roaring(RoaringBitmap* bitmap) {
+    if (!bitmap) return;
+    clear_roaring(bitmap);
+    free(bitmap->containers);
+    init_roaring(bitmap);
+}
+
+// void roaring_add(RoaringBitmap* bitmap, uint32_t value);
+//
+// Key Steps:
+// ========================
+//
+// 1. Find (or create) the container for value >> 16.
+//
+// 2. ARRAY: binary-search the low bits; insert with memmove if absent.
+//    Concept indexes are handed out in increasing order, so the common
+//    case is an append at the end with no search hit and no memmove.
+//
+// 3. If the array passes ROARING_ARRAY_MAX, convert to a bitset.
+//
+// 4. BITSET: set the bit, bump cardinality only if it was clear.
+
+void roaring_add(RoaringBitmap* bitmap, uint32_t value) {
+    if (!bitmap) return;
+
+    uint16_t key = (uint16_t)(value >> 16);
+    uint16_t low = (uint16_t)(value & 0xFFFF);
+
+    RoaringContainer* container;
+    if (bitmap->count && bitmap->containers[bitmap->count - 1].key == key) {
+        container = &bitmap->containers[bitmap->count - 1];
+    } else {
+        int32_t position = find_container(bitmap, key);
+        if (position >= 0) {
+            container = &bitmap->containers[position];
+        } else {
+            container = insert_container_at(bitmap, (uint32_t)(-position - 1));
+            make_array(container, key, 4);
+        }
+    }
+
+    if (container->type == ROARING_BITSET) {
+        uint64_t mask = 1ULL << (low & 63);
+        if (!(container->data.bits[low >> 6] & mask)) {
+            container->data.bits[low >> 6] |= mask;
+            container->cardinality++;
+        }
+        return;
+    }
+
+    uint16_t* array = container->data.array;
+    uint32_t cardinality = container->cardinality;
+    uint32_t position = cardinality;
+    if (cardinality && array[cardinality - 1] >= low) {
+        uint32_t lo = 0, hi = cardinality;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (array[mid] < low) lo = mid + 1;
+            else hi = mid;
+        }
+        if (array[lo] == low) return;
+        position = lo;
+    }
+
+    if (cardinality >= ROARING_ARRAY_MAX) {
+        array_to_bitset(container);
+        container->data.bits[low >> 6] |= 1ULL << (low & 63);
+        container->cardinality++;
+        return;
+    }
+
+    if (cardinality >= container->capacity) {
+        uint32_t new_capacity = container->capacity ? container->capacity * 2 : 4;
+        if (new_capacity > ROARING_ARRAY_MAX) new_capacity = ROARING_ARRAY_MAX;
+        container->data.array = roaring_alloc(container->data.array, new_capacity * sizeof(uint16_t));
+        container->capacity = new_capacity;
+        array = container->data.array;
+    }
+
+    memmove(array + position + 1, array + position, (cardinality - position) * sizeof(uint16_t));
+    array[position] = low;
+    container->cardinality++;
+}
+
+// void roaring_remove(RoaringBitmap* bitmap, uint32_t value);
+//
+// Clear the value if present. A bitset that drops to ROARING_ARRAY_MAX
+// goes back to an array; a container that becomes empty is removed.
+
+void roaring_remove(RoaringBitmap* bitmap, uint32_t value) {
+    if (!bitmap) return;
+
+    int32_t position = find_container(bitmap, (uint16_t)(value >> 16));
+    if (position < 0) return;
+
+    RoaringContainer* container = &bitmap->containers[position];
+    uint16_t low = (uint16_t)(value & 0xFFFF);
+
+    if (container->type == ROARING_BITSET) {
+        uint64_t mask = 1ULL << (low & 63);
+        if (!(container->data.bits[low >> 6] & mask)) return;
+        container->data.bits[low >> 6] &= ~mask;
+        container->cardinality--;
+        normalize_container(container);
+    } else {
+        uint32_t lo = 0, hi = container->cardinality;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (container->data.array[mid] < low) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo >= container->cardinality || container->data.array[lo] != low) return;
+        memmove(container->data.array + lo, container->data.array + lo + 1,
+                (container->cardinality - lo - 1) * sizeof(uint16_t));
+        container->cardinality--;
+    }
+
+    if (container->cardinality == 0) {
+        free_container(container);
+        memmove(bitmap->containers + position, bitmap->containers + position + 1,
+                (bitmap->count - (uint32_t)position - 1) * sizeof(RoaringContainer));
+        bitmap->count--;
+    }
+}
+
+int roaring_contains(const RoaringBitmap* bitmap, uint32_t value) {
+    if (!bitmap) return 0;
+
+    int32_t position = find_container(bitmap, (uint16_t)(value >> 16));
+    if (position < 0) return 0;
+
+    const RoaringContainer* container = &bitmap->containers[position];
+    uint16_t low = (uint16_t)(value & 0xFFFF);
+    if (container->type == ROARING_BITSET) {
+        return bit_test(container->data.bits, low);
+    }
+
+    uint32_t lo = 0, hi = container->cardinality;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (container->data.array[mid] < low) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < container->cardinality && container->data.array[lo] == low;
+}
+
+uint64_t roaring_cardinality(const RoaringBitmap* bitmap) {
+    if (!bitmap) return 0;
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < bitmap->count; i++) {
+        total += bitmap->containers[i].cardinality;
+    }
+    return total;
+}
+
+uint32_t roaring_to_array(const RoaringBitmap* bitmap, uint32_t* out) {
+    if (!bitmap || !out) return 0;
+
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < bitmap->count; i++) {
+        const RoaringContainer* container = &bitmap->containers[i];
+        uint32_t high = (uint32_t)container->key << 16;
+        if (container->type == ROARING_ARRAY) {
+            for (uint32_t j = 0; j < container->cardinality; j++) {
+                out[written++] = high | container->data.array[j];
+            }
+        } else {
+            for (uint32_t w = 0; w < ROARING_BITSET_WORDS; w++) {
+                uint64_t word = container->data.bits[w];
+                while (word) {
+                    out[written++] = high | (w * 64 + (uint32_t)__builtin_ctzll(word));
+                    word &= word - 1;
+                }
+            }
+        }
+    }
+    return written;
+}
+
+// ---
+// Container-level set operations
+// ---
+
+// Smallest index in sorted[lo..count) with sorted[index] >= value,
+// found by galloping (1, 2, 4, ...) then binary search.
+static uint32_t gallop(const uint16_t* sorted, uint32_t lo, uint32_t count, uint16_t value) {
+    uint32_t step = 1;
+    uint32_t hi = lo;
+    while (hi < count && sorted[hi] < value) {
+        lo = hi + 1;
+        hi += step;
+        step *= 2;
+    }
+    if (hi > count) hi = count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (sorted[mid] < value) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void and_containers(const RoaringContainer* a, const RoaringContainer* b, RoaringContainer* out) {
+    if (a->type == ROARING_BITSET && b->type == ROARING_BITSET) {
+        make_bitset(out, a->key);
+        out->cardinality = bitset_kernel(BITSET_AND, a->data.bits, b->data.bits, out->data.bits);
+        normalize_container(out);
+        return;
+    }
+
+    if (a->type == ROARING_BITSET) {
+        const RoaringContainer* swap = a;
+        a = b;
+        b = swap;
+    }
+
+    // a is an ARRAY from here on
+    uint32_t capacity = a->cardinality;
+    if (b->type == ROARING_ARRAY && b->cardinality < capacity) {
+        capacity = b->cardinality;
+    }
+    make_array(out, a->key, capacity);
+    uint16_t* result = out->data.array;
+    uint32_t found = 0;
+
+    if (b->type == ROARING_BITSET) {
+        for (uint32_t i = 0; i < a->cardinality; i++) {
+            uint16_t low = a->data.array[i];
+            result[found] = low;
+            found += (uint32_t)bit_test(b->data.bits, low);
+        }
+    } else {
+        const RoaringContainer* small = a->cardinality <= b->cardinality ? a : b;
+        const RoaringContainer* large = small == a ? b : a;
+        if (large->cardinality > small->cardinality * 64) {
+            uint32_t cursor = 0;
+            for (uint32_t i = 0; i < small->cardinality && cursor < large->cardinality; i++) {
+                cursor = gallop(large->data.array, cursor, large->cardinality, small->data.array[i]);
+                if (cursor < large->cardinality && large->data.array[cursor] == small->data.array[i]) {
+                    result[found++] = small->data.array[i];
+                }
+            }
+        } else {
+            uint32_t i = 0, j = 0;
+            while (i < a->cardinality && j < b->cardinality) {
+                uint16_t x = a->data.array[i];
+                uint16_t y = b->data.array[j];
+                if (x == y) { result[found++] = x; i++; j++; }
+                else if (x < y) i++;
+                else j++;
+            }
+        }
+    }
+    out->cardinality = found;
+}
+
+static void or_containers(const RoaringContainer* a, const RoaringContainer* b, RoaringContainer* out) {
+    if (a->type == ROARING_BITSET && b->type == ROARING_BITSET) {
+        make_bitset(out, a->key);
+        out->cardinality = bitset_kernel(BITSET_OR, a->data.bits, b->data.bits, out->data.bits);
+        return;
+    }
+
+    if (a->type == ROARING_ARRAY && b->type == ROARING_ARRAY &&
+        a->cardinality + b->cardinality <= ROARING_ARRAY_MAX) {
+        make_array(out, a->key, a->cardinality + b->cardinality);
+        uint16_t* result = out->data.array;
+        uint32_t i = 0, j = 0, found = 0;
+        while (i < a->cardinality && j < b->cardinality) {
+            uint16_t x = a->data.array[i];
+            uint16_t y = b->data.array[j];
+            if (x == y) { result[found++] = x; i++; j++; }
+            else if (x < y) { result[found++] = x; i++; }
+            else { result[found++] = y; j++; }
+        }
+        while (i < a->cardinality) result[found++] = a->data.array[i++];
+        while (j < b->cardinality) result[found++] = b->data.array[j++];
+        out->cardinality = found;
+        return;
+    }
+
+    // At least one side is (or the union may become) dense: go through a bitset
+    if (a->type == ROARING_BITSET) {
+        copy_container(a, out);
+    } else if (b->type == ROARING_BITSET) {
+        copy_container(b, out);
+        b = a;
+    } else {
+        copy_container(a, out);
+        array_to_bitset(out);
+    }
+    for (uint32_t i = 0; i < b->cardinality; i++) {
+        uint16_t low = b->data.array[i];
+        uint64_t mask = 1ULL << (low & 63);
+        if (!(out->data.bits[low >> 6] & mask)) {
+            out->data.bits[low >> 6] |= mask;
+            out->cardinality++;
+        }
+    }
+    normalize_container(out);
+}
+
+static void andnot_containers(const RoaringContainer* a, const RoaringContainer* b, RoaringContainer* out) {
+    if (a->type == ROARING_BITSET && b->type == ROARING_BITSET) {
+        make_bitset(out, a->key);
+        out->cardinality = bitset_kernel(BITSET_ANDNOT, a->data.bits, b->data.bits, out->data.bits);
+        normalize_container(out);
+        return;
+    }
+
+    if (a->type == ROARING_BITSET) {
+        copy_container(a, out);
+        for (uint32_t i = 0; i < b->cardinality; i++) {
+            uint16_t low = b->data.array[i];
+            uint64_t mask = 1ULL << (low & 63);
+            if (out->data.bits[low >> 6] & mask) {
+                out->data.bits[low >> 6] &= ~mask;
+                out->cardinality--;
+            }
+        }
+        normalize_container(out);
+        return;
+    }
+
+    make_array(out, a->key, a->cardinality);
+    uint16_t* result = out->data.array;
+    uint32_t found = 0;
+    if (b->type == ROARING_BITSET) {
+        for (uint32_t i = 0; i < a->cardinality; i++) {
+            uint16_t low = a->data.array[i];
+            result[found] = low;
+            found += (uint32_t)!bit_test(b->data.bits, low);
+        }
+    } else {
+        uint32_t j = 0;
+        for (uint32_t i = 0; i < a->cardinality; i++) {
+            uint16_t low = a->data.array[i];
+            while (j < b->cardinality && b->data.array[j] < low) j++;
+            if (j < b->cardinality && b->data.array[j] == low) continue;
+            result[found++] = low;
+        }
+    }
+    out->cardinality = found;
+}
+
+// void roaring_and / roaring_or / roaring_andnot(a, b, out);
+//
+// Goal:
+// ======
+// Merge the two sorted container lists by key:
+//
+//     key only in a  → AND: skip     OR: copy    ANDNOT: copy
+//     key only in b  → AND: skip     OR: copy    ANDNOT: skip
+//     key in both    → container-level operation
+//
+// Results arrive in key order, so each one is appended to `out`.
+
+static void roaring_merge(const RoaringBitmap* a, const RoaringBitmap* b, RoaringBitmap* out, BitsetOp op) {
+    if (!a || !b || !out) return;
+    clear_roaring(out);
+
+    uint32_t i = 0, j = 0;
+    while (i < a->count || j < b->count) {
+        RoaringContainer result;
+        int has_a = i < a->count;
+        int has_b = j < b->count;
+
+        if (has_a && has_b && a->containers[i].key == b->containers[j].key) {
+            if (op == BITSET_AND) and_containers(&a->containers[i], &b->containers[j], &result);
+            else if (op == BITSET_OR) or_containers(&a->containers[i], &b->containers[j], &result);
+            else andnot_containers(&a->containers[i], &b->containers[j], &result);
+            append_container(out, &result);
+            i++;
+            j++;
+        } else if (has_a && (!has_b || a->containers[i].key < b->containers[j].key)) {
+            if (op != BITSET_AND) {
+                copy_container(&a->containers[i], &result);
+                append_container(out, &result);
+            }
+            i++;
+        } else {
+            if (op == BITSET_OR) {
+                copy_container(&b->containers[j], &result);
+                append_container(out, &result);
+            }
+            j++;
+        }
+
+        if (op == BITSET_AND && (i >= a->count || j >= b->count)) break;
+        if (op == BITSET_ANDNOT && i >= a->count) break;
+    }
+}
+
+void roaring_and(const RoaringBitmap* a, const RoaringBitmap* b, RoaringBitmap* out) {
+    roaring_merge(a, b, out, BITSET_AND);
+}
+
+void roaring_or(const RoaringBitmap* a, const RoaringBitmap* b, RoaringBitmap* out) {
+    roaring_merge(a, b, out, BITSET_OR);
+}
+
+void roaring_andnot(const RoaringBitmap* a, const RoaringBitmap* b, RoaringBitmap* out) {
+    roaring_merge(a, b, out, BITSET_ANDNOT);
+}
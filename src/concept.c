@@ -49,9 +49,9 @@ void print_concept(const Concept* concept) {
 
     for (int i = 0; i < concept->slot_count; i++) {
         printf("\t#%d\n", i+1);
-        printf("\t\tName: %s\n", concept>slots[i].name);
+        printf("\t\tName: %s\n", concept->slots[i].name);
         if (concept->slots[i].target) {
-            printf("\t\tTarget: %s\n", concept>slots[i].target.id);
+            printf("\t\tTarget: %s\n", concept->slots[i].target->id);
         } else {
             printf("\t\tTarget: (null)\n");
         }
@@ -83,11 +83,15 @@ void print_concept(const Concept* concept) {
 //
 // 1. Is there room in the array?
 //    - If slot_count < slot_capacity → yes, we can insert directly.
+//    - A fresh concept starts with CONCEPT_INLINE_SLOTS of capacity that
+//      lives inside the Concept itself, so small concepts never allocate.
 //    - If not, we need to resize the array (grow it).
 //
 // 2. Do we own the memory for the array?
-//    - Yes, so we can realloc if needed.
-//    - We’ll start simple: double the capacity each time we grow.
+//    - Inline storage: no, it's part of the Concept. The first spill
+//      mallocs a heap array and copies the inline slots over.
+//    - Heap storage: yes, so we can realloc if needed.
+//    - We double the capacity each time we grow.
 //
 // 3. Who owns the string memory for `slot_name`?
 //    - It’s passed in as `const char*`, but we need to duplicate it
@@ -107,12 +111,18 @@ void add_slot(Concept* concept, const char* slot_name, Concept* target) {
 
     // 1. Resize if needed
     if (concept->slot_count >= concept->slot_capacity) {
-        int new_capacity = (concept->slot_capacity == 0) ? 2 : concet->slot_capacity * 2;
-        Slot* new_slots = realloc(concept->slots, new_capacity * size_of(Slot));
+        int new_capacity = (concept->slot_capacity == 0) ? 2 : concept->slot_capacity * 2;
+        int spilling = (concept->slots == concept->inline_slots);
+        Slot* new_slots = spilling
+            ? malloc(new_capacity * sizeof(Slot))
+            : realloc(concept->slots, new_capacity * sizeof(Slot));
         if (!new_slots) {
             fprintf(stderr, "Failed to allocate memory for slots.\n");
             exit(1);
         }
+        if (spilling) {
+            memcpy(new_slots, concept->inline_slots, concept->slot_count * sizeof(Slot));
+        }
         concept->slots = new_slots;
         concept->slot_capacity = new_capacity;
     }
@@ -149,10 +159,10 @@ void add_slot(Concept* concept, const char* slot_name, Concept* target) {
 //    - Use strdup() to copy the caller's string into heap memory
 //    - We take ownership of the new memory (caller keeps theirs)
 //
-// 3. Initialize the slots array to NULL.
+// 3. Point the slots array at the inline storage.
 //    - slot_count = 0
-//    - slot_capacity = 0
-//    - slots = NULL  (until the first add_slot() call)
+//    - slot_capacity = CONCEPT_INLINE_SLOTS
+//    - slots = inline_slots  (until add_slot() spills to the heap)
 //
 // 4. Return the pointer to the new Concept.
 //
@@ -165,9 +175,10 @@ void add_slot(Concept* concept, const char* slot_name, Concept* target) {
 //    ┌───────────────────────────────┐
 //    │ id         → "john" (heap)    │
 //    │ types      → "Person" (heap)  │
-//    │ slots      → NULL             │
+//    │ slots      → inline_slots     │
 //    │ slot_count → 0                │
-//    │ slot_capacity → 0             │
+//    │ slot_capacity → INLINE (2)    │
+//    │ inline_slots[] (uninit)       │
 //    └───────────────────────────────┘
 //
 // NOTE:
@@ -176,7 +187,10 @@ void add_slot(Concept* concept, const char* slot_name, Concept* target) {
 //
 
 Concept* create_concept(const char* id, const char* type) {
-    Concept* concept = (Concept*)malloc(sizeof(Concept));
+    // Cache-line aligned so a default Concept never straddles two lines;
+    // aligned_alloc wants a size that is a multiple of the alignment.
+    size_t size = (sizeof(Concept) + CONCEPT_ALIGNMENT - 1) / CONCEPT_ALIGNMENT * CONCEPT_ALIGNMENT;
+    Concept* concept = (Concept*)aligned_alloc(CONCEPT_ALIGNMENT, size);
     if (!concept) {
         fprintf(stderr, "Failed to allocate memory for Concept.\n");
         exit(1);
@@ -194,9 +208,9 @@ Concept* create_concept(const char* id, const char* type) {
         exit(1);
     }
 
-    concept->slots = NULL;
+    concept->slots = concept->inline_slots;
     concept->slot_count = 0;
-    concept->slot_capacity = 0;
+    concept->slot_capacity = CONCEPT_INLINE_SLOTS;
 
     return concept;
 }
@@ -225,7 +239,7 @@ Concept* create_concept(const char* id, const char* type) {
 // 3. Loop through each Slot:
 //    - Free slot.name (if not NULL)
 //
-// 4. Free the slots array
+// 4. Free the slots array, unless it is still the inline storage
 //
 // 5. Free the Concept itself
 //
@@ -248,7 +262,9 @@ void free_concept(Concept* concept) {
         free(concept->slots[i].name);
     }
 
-    free(concept->slots);
+    if (concept->slots != concept->inline_slots) {
+        free(concept->slots);
+    }
 
     free(concept);
 }
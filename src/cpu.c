@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "cpu.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char* level_names[] = { "scalar", "sse2", "avx2", "avx512" };
+
+static CpuLevel detect_level(void) {
+    CpuLevel level = CPU_LEVEL_SCALAR;
+#if CLARITY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        level = CPU_LEVEL_SSE2;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        level = CPU_LEVEL_AVX2;
+    }
+    if (level == CPU_LEVEL_AVX2 &&
+        __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        level = CPU_LEVEL_AVX512;
+    }
+#endif
+    return level;
+}
+
+// CpuLevel cpu_level(void);
+//
+// Detected once, then cached. The cache is a plain int written with the
+// same value by every racing thread, so no locking is needed.
+
+CpuLevel cpu_level(void) {
+    static int cached = -1;
+    if (cached >= 0) return (CpuLevel)cached;
+
+    CpuLevel level = detect_level();
+
+    const char* cap = getenv("CLARITY_CPU_LEVEL");
+    if (cap) {
+        for (int i = 0; i <= CPU_LEVEL_AVX512; i++) {
+            if (strcmp(cap, level_names[i]) == 0 && (CpuLevel)i < level) {
+                level = (CpuLevel)i;
+            }
+        }
+    }
+
+    cached = (int)level;
+    return level;
+}
+
+const char* cpu_level_name(CpuLevel level) {
+    if (level > CPU_LEVEL_AVX512) return "unknown";
+    return level_names[level];
+}
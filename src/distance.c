@@ -0,0 +1,1057 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "distance.h"
+#include "cpu.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if CLARITY_X86
+#include <immintrin.h>
+#endif
+
+// Rows of fp32 per matrix tile are sized so one tile stays in L1.
+#define DISTANCE_TILE_BYTES (24 * 1024)
+
+typedef struct DistanceKernels {
+    const char* name;
+    float (*dot_f32)(const float* a, const float* b, uint32_t n);
+    float (*l2sq_f32)(const float* a, const float* b, uint32_t n);
+    void (*cosine_f32)(const float* a, const float* b, uint32_t n, float parts[3]);    // a·b, a·a, b·b
+    float (*dot_f16)(const uint16_t* a, const uint16_t* b, uint32_t n);
+    float (*l2sq_f16)(const uint16_t* a, const uint16_t* b, uint32_t n);
+    void (*cosine_f16)(const uint16_t* a, const uint16_t* b, uint32_t n, float parts[3]);
+    float (*dot_i16)(const int16_t* a, const int16_t* b, uint32_t n);
+    float (*l2sq_i16)(const int16_t* a, const int16_t* b, uint32_t n);
+    int32_t (*dot_i8)(const int8_t* a, const int8_t* b, uint32_t n);
+    int32_t (*l2sq_i8)(const int8_t* a, const int8_t* b, uint32_t n);
+    void (*cosine_i8)(const int8_t* a, const int8_t* b, uint32_t n, int32_t parts[3]);
+    void (*to_halves)(const float* src, uint32_t n, uint16_t* dst);
+    void (*to_floats)(const uint16_t* src, uint32_t n, float* dst);
+} DistanceKernels;
+
+// ---
+// fp16 conversion
+// ---
+
+uint16_t float_to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    uint32_t magnitude = bits & 0x7fffffff;
+
+    if (magnitude >= 0x7f800000) {                          // inf / nan
+        return sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0);
+    }
+    if (magnitude >= 0x477ff000) return sign | 0x7c00;      // rounds past 65504
+    if (magnitude < 0x38800000) {                           // half subnormal
+        if (magnitude <= 0x33000000) return sign;           // ≤ 2^-25 rounds to zero
+        uint32_t exponent = magnitude >> 23;
+        uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+        uint32_t shift = 126 - exponent;
+        uint32_t rounded = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (rounded & 1))) rounded++;
+        return sign | (uint16_t)rounded;
+    }
+
+    uint32_t rounded = (magnitude - (112u << 23)) >> 13;
+    uint32_t rest = magnitude & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (rounded & 1))) rounded++;
+    return sign | (uint16_t)rounded;
+}
+
+float half_to_float(uint16_t half) {
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+    uint32_t bits;
+
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        } else {
+            exponent = 113;
+            while (!(mantissa & 0x400)) {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+    } else if (exponent == 31) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static float square_root(float x) {
+#if CLARITY_X86
+    return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(x)));
+#else
+    if (x <= 0.0f) return 0.0f;
+    float root = x > 1.0f ? x : 1.0f;
+    for (int i = 0; i < 32; i++) {
+        root = 0.5f * (root + x / root);
+    }
+    return root;
+#endif
+}
+
+// ---
+// Scalar fallback
+// ---
+
+static float dot_f32_scalar(const float* a, const float* b, uint32_t n) {
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static float l2sq_f32_scalar(const float* a, const float* b, uint32_t n) {
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < n; i++) {
+        float diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+static void cosine_f32_scalar(const float* a, const float* b, uint32_t n, float parts[3]) {
+    float ab = 0.0f, aa = 0.0f, bb = 0.0f;
+    for (uint32_t i = 0; i < n; i++) {
+        ab += a[i] * b[i];
+        aa += a[i] * a[i];
+        bb += b[i] * b[i];
+    }
+    parts[0] = ab;
+    parts[1] = aa;
+    parts[2] = bb;
+}
+
+static float dot_f16_scalar(const uint16_t* a, const uint16_t* b, uint32_t n) {
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < n; i++) {
+        sum += half_to_float(a[i]) * half_to_float(b[i]);
+    }
+    return sum;
+}
+
+static float l2sq_f16_scalar(const uint16_t* a, const uint16_t* b, uint32_t n) {
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < n; i++) {
+        float diff = half_to_float(a[i]) - half_to_float(b[i]);
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+static void cosine_f16_scalar(const uint16_t* a, const uint16_t* b, uint32_t n, float parts[3]) {
+    float ab = 0.0f, aa = 0.0f, bb = 0.0f;
+    for (uint32_t i = 0; i < n; i++) {
+        float x = half_to_float(a[i]);
+        float y = half_to_float(b[i]);
+        ab += x * y;
+        aa += x * x;
+        bb += y * y;
+    }
+    parts[0] = ab;
+    parts[1] = aa;
+    parts[2] = bb;
+}
+
+static float dot_i16_scalar(const int16_t* a, const int16_t* b, uint32_t n) {
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < n; i++) {
+        sum += (float)a[i] * (float)b[i];
+    }
+    return sum;
+}
+
+static float l2sq_i16_scalar(const int16_t* a, const int16_t* b, uint32_t n) {
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < n; i++) {
+        float diff = (float)a[i] - (float)b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+static int32_t dot_i8_scalar(const int8_t* a, const int8_t* b, uint32_t n) {
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        sum += (int32_t)a[i] * b[i];
+    }
+    return sum;
+}
+
+static int32_t l2sq_i8_scalar(const int8_t* a, const int8_t* b, uint32_t n) {
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        int32_t diff = (int32_t)a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+static void cosine_i8_scalar(const int8_t* a, const int8_t* b, uint32_t n, int32_t parts[3]) {
+    int32_t ab = 0, aa = 0, bb = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        ab += (int32_t)a[i] * b[i];
+        aa += (int32_t)a[i] * a[i];
+        bb += (int32_t)b[i] * b[i];
+    }
+    parts[0] = ab;
+    parts[1] = aa;
+    parts[2] = bb;
+}
+
+static void to_halves_scalar(const float* src, uint32_t n, uint16_t* dst) {
+    for (uint32_t i = 0; i < n; i++) {
+        dst[i] = float_to_half(src[i]);
+    }
+}
+
+static void to_floats_scalar(const uint16_t* src, uint32_t n, float* dst) {
+    for (uint32_t i = 0; i < n; i++) {
+        dst[i] = half_to_float(src[i]);
+    }
+}
+
+#if CLARITY_X86
+
+// ---
+// AVX2 + FMA: 8 lanes, two accumulators to hide FMA latency; the fp16
+// kernels and conversions also need F16C (see half_kernels())
+// ---
+
+__attribute__((target("avx2,fma")))
+static inline float sum_avx2(__m256 v) {
+    __m128 low = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    low = _mm_add_ps(low, _mm_movehl_ps(low, low));
+    low = _mm_add_ss(low, _mm_shuffle_ps(low, low, 1));
+    return _mm_cvtss_f32(low);
+}
+
+__attribute__((target("avx2,fma")))
+static inline int32_t sum_i32_avx2(__m256i v) {
+    __m128i low = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    low = _mm_add_epi32(low, _mm_shuffle_epi32(low, 0x4e));
+    low = _mm_add_epi32(low, _mm_shuffle_epi32(low, 0xb1));
+    return _mm_cvtsi128_si32(low);
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static inline __m256 load_f16_avx2(const uint16_t* p) {
+    return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)p));
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_f32_avx2(const float* a, const float* b, uint32_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    float sum = sum_avx2(_mm256_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static float l2sq_f32_avx2(const float* a, const float* b, uint32_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        acc0 = _mm256_fmadd_ps(d, d, acc0);
+    }
+    float sum = sum_avx2(_mm256_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        float diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static void cosine_f32_avx2(const float* a, const float* b, uint32_t n, float parts[3]) {
+    __m256 ab = _mm256_setzero_ps();
+    __m256 aa = _mm256_setzero_ps();
+    __m256 bb = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(a + i);
+        __m256 y = _mm256_loadu_ps(b + i);
+        ab = _mm256_fmadd_ps(x, y, ab);
+        aa = _mm256_fmadd_ps(x, x, aa);
+        bb = _mm256_fmadd_ps(y, y, bb);
+    }
+    parts[0] = sum_avx2(ab);
+    parts[1] = sum_avx2(aa);
+    parts[2] = sum_avx2(bb);
+    for (; i < n; i++) {
+        parts[0] += a[i] * b[i];
+        parts[1] += a[i] * a[i];
+        parts[2] += b[i] * b[i];
+    }
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static float dot_f16_avx2(const uint16_t* a, const uint16_t* b, uint32_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(load_f16_avx2(a + i), load_f16_avx2(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(load_f16_avx2(a + i + 8), load_f16_avx2(b + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(load_f16_avx2(a + i), load_f16_avx2(b + i), acc0);
+    }
+    float sum = sum_avx2(_mm256_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        sum += half_to_float(a[i]) * half_to_float(b[i]);
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static float l2sq_f16_avx2(const uint16_t* a, const uint16_t* b, uint32_t n) {
+    __m256 acc = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 d = _mm256_sub_ps(load_f16_avx2(a + i), load_f16_avx2(b + i));
+        acc = _mm256_fmadd_ps(d, d, acc);
+    }
+    float sum = sum_avx2(acc);
+    for (; i < n; i++) {
+        float diff = half_to_float(a[i]) - half_to_float(b[i]);
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static void cosine_f16_avx2(const uint16_t* a, const uint16_t* b, uint32_t n, float parts[3]) {
+    __m256 ab = _mm256_setzero_ps();
+    __m256 aa = _mm256_setzero_ps();
+    __m256 bb = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = load_f16_avx2(a + i);
+        __m256 y = load_f16_avx2(b + i);
+        ab = _mm256_fmadd_ps(x, y, ab);
+        aa = _mm256_fmadd_ps(x, x, aa);
+        bb = _mm256_fmadd_ps(y, y, bb);
+    }
+    parts[0] = sum_avx2(ab);
+    parts[1] = sum_avx2(aa);
+    parts[2] = sum_avx2(bb);
+    for (; i < n; i++) {
+        float x = half_to_float(a[i]);
+        float y = half_to_float(b[i]);
+        parts[0] += x * y;
+        parts[1] += x * x;
+        parts[2] += y * y;
+    }
+}
+
+// int16 is widened to fp32 (exact) and fed to FMA: a pairwise int32
+// madd could overflow on two -32768 products, and L2 differences do not
+// fit int16 at all.
+
+__attribute__((target("avx2,fma")))
+static inline __m256 load_i16_avx2(const int16_t* p) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)p)));
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_i16_avx2(const int16_t* a, const int16_t* b, uint32_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(load_i16_avx2(a + i), load_i16_avx2(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(load_i16_avx2(a + i + 8), load_i16_avx2(b + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(load_i16_avx2(a + i), load_i16_avx2(b + i), acc0);
+    }
+    float sum = sum_avx2(_mm256_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        sum += (float)a[i] * (float)b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static float l2sq_i16_avx2(const int16_t* a, const int16_t* b, uint32_t n) {
+    __m256 acc = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 d = _mm256_sub_ps(load_i16_avx2(a + i), load_i16_avx2(b + i));
+        acc = _mm256_fmadd_ps(d, d, acc);
+    }
+    float sum = sum_avx2(acc);
+    for (; i < n; i++) {
+        float diff = (float)a[i] - (float)b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+// int8 is widened to int16 and multiplied pairwise into int32 with
+// vpmaddwd: 16 products per instruction, no overflow for |x| ≤ 128.
+
+__attribute__((target("avx2,fma")))
+static inline __m256i load_i8_avx2(const int8_t* p) {
+    return _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)p));
+}
+
+__attribute__((target("avx2,fma")))
+static int32_t dot_i8_avx2(const int8_t* a, const int8_t* b, uint32_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(load_i8_avx2(a + i), load_i8_avx2(b + i)));
+    }
+    int32_t sum = sum_i32_avx2(acc);
+    for (; i < n; i++) {
+        sum += (int32_t)a[i] * b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static int32_t l2sq_i8_avx2(const int8_t* a, const int8_t* b, uint32_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i d = _mm256_sub_epi16(load_i8_avx2(a + i), load_i8_avx2(b + i));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(d, d));
+    }
+    int32_t sum = sum_i32_avx2(acc);
+    for (; i < n; i++) {
+        int32_t diff = (int32_t)a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static void cosine_i8_avx2(const int8_t* a, const int8_t* b, uint32_t n, int32_t parts[3]) {
+    __m256i ab = _mm256_setzero_si256();
+    __m256i aa = _mm256_setzero_si256();
+    __m256i bb = _mm256_setzero_si256();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i x = load_i8_avx2(a + i);
+        __m256i y = load_i8_avx2(b + i);
+        ab = _mm256_add_epi32(ab, _mm256_madd_epi16(x, y));
+        aa = _mm256_add_epi32(aa, _mm256_madd_epi16(x, x));
+        bb = _mm256_add_epi32(bb, _mm256_madd_epi16(y, y));
+    }
+    parts[0] = sum_i32_avx2(ab);
+    parts[1] = sum_i32_avx2(aa);
+    parts[2] = sum_i32_avx2(bb);
+    for (; i < n; i++) {
+        parts[0] += (int32_t)a[i] * b[i];
+        parts[1] += (int32_t)a[i] * a[i];
+        parts[2] += (int32_t)b[i] * b[i];
+    }
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static void to_halves_avx2(const float* src, uint32_t n, uint16_t* dst) {
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_si128((__m128i*)(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+    }
+    for (; i < n; i++) {
+        dst[i] = float_to_half(src[i]);
+    }
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static void to_floats_avx2(const uint16_t* src, uint32_t n, float* dst) {
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, load_f16_avx2(src + i));
+    }
+    for (; i < n; i++) {
+        dst[i] = half_to_float(src[i]);
+    }
+}
+
+// ---
+// AVX-512: 16 lanes; fp32 tails use a masked load instead of a loop
+// ---
+
+__attribute__((target("avx512f,avx512bw")))
+static inline __mmask16 tail_mask(uint32_t remaining) {
+    return (__mmask16)((1u << remaining) - 1);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512 load_f16_avx512(const uint16_t* p) {
+    return _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)p));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static float dot_f32_avx512(const float* a, const float* b, uint32_t n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+    }
+    if (i < n) {
+        __mmask16 mask = tail_mask(n - i);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), acc1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static float l2sq_f32_avx512(const float* a, const float* b, uint32_t n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        __m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16));
+        acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm512_fmadd_ps(d1, d1, acc1);
+    }
+    for (; i + 16 <= n; i += 16) {
+        __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        acc0 = _mm512_fmadd_ps(d, d, acc0);
+    }
+    if (i < n) {
+        __mmask16 mask = tail_mask(n - i);
+        __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i));
+        acc1 = _mm512_fmadd_ps(d, d, acc1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void cosine_f32_avx512(const float* a, const float* b, uint32_t n, float parts[3]) {
+    __m512 ab = _mm512_setzero_ps();
+    __m512 aa = _mm512_setzero_ps();
+    __m512 bb = _mm512_setzero_ps();
+    for (uint32_t i = 0; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? (__mmask16)0xffff : tail_mask(n - i);
+        __m512 x = _mm512_maskz_loadu_ps(mask, a + i);
+        __m512 y = _mm512_maskz_loadu_ps(mask, b + i);
+        ab = _mm512_fmadd_ps(x, y, ab);
+        aa = _mm512_fmadd_ps(x, x, aa);
+        bb = _mm512_fmadd_ps(y, y, bb);
+    }
+    parts[0] = _mm512_reduce_add_ps(ab);
+    parts[1] = _mm512_reduce_add_ps(aa);
+    parts[2] = _mm512_reduce_add_ps(bb);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static float dot_f16_avx512(const uint16_t* a, const uint16_t* b, uint32_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc = _mm512_fmadd_ps(load_f16_avx512(a + i), load_f16_avx512(b + i), acc);
+    }
+    float sum = _mm512_reduce_add_ps(acc);
+    for (; i < n; i++) {
+        sum += half_to_float(a[i]) * half_to_float(b[i]);
+    }
+    return sum;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static float l2sq_f16_avx512(const uint16_t* a, const uint16_t* b, uint32_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 d = _mm512_sub_ps(load_f16_avx512(a + i), load_f16_avx512(b + i));
+        acc = _mm512_fmadd_ps(d, d, acc);
+    }
+    float sum = _mm512_reduce_add_ps(acc);
+    for (; i < n; i++) {
+        float diff = half_to_float(a[i]) - half_to_float(b[i]);
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void cosine_f16_avx512(const uint16_t* a, const uint16_t* b, uint32_t n, float parts[3]) {
+    __m512 ab = _mm512_setzero_ps();
+    __m512 aa = _mm512_setzero_ps();
+    __m512 bb = _mm512_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 x = load_f16_avx512(a + i);
+        __m512 y = load_f16_avx512(b + i);
+        ab = _mm512_fmadd_ps(x, y, ab);
+        aa = _mm512_fmadd_ps(x, x, aa);
+        bb = _mm512_fmadd_ps(y, y, bb);
+    }
+    parts[0] = _mm512_reduce_add_ps(ab);
+    parts[1] = _mm512_reduce_add_ps(aa);
+    parts[2] = _mm512_reduce_add_ps(bb);
+    for (; i < n; i++) {
+        float x = half_to_float(a[i]);
+        float y = half_to_float(b[i]);
+        parts[0] += x * y;
+        parts[1] += x * x;
+        parts[2] += y * y;
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512 load_i16_avx512(const int16_t* p) {
+    return _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i*)p)));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static float dot_i16_avx512(const int16_t* a, const int16_t* b, uint32_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc = _mm512_fmadd_ps(load_i16_avx512(a + i), load_i16_avx512(b + i), acc);
+    }
+    float sum = _mm512_reduce_add_ps(acc);
+    for (; i < n; i++) {
+        sum += (float)a[i] * (float)b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static float l2sq_i16_avx512(const int16_t* a, const int16_t* b, uint32_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 d = _mm512_sub_ps(load_i16_avx512(a + i), load_i16_avx512(b + i));
+        acc = _mm512_fmadd_ps(d, d, acc);
+    }
+    float sum = _mm512_reduce_add_ps(acc);
+    for (; i < n; i++) {
+        float diff = (float)a[i] - (float)b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512i load_i8_avx512(const int8_t* p) {
+    return _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)p));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static int32_t dot_i8_avx512(const int8_t* a, const int8_t* b, uint32_t n) {
+    __m512i acc = _mm512_setzero_si512();
+    uint32_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc = _mm512_add_epi32(acc, _mm512_madd_epi16(load_i8_avx512(a + i), load_i8_avx512(b + i)));
+    }
+    int32_t sum = _mm512_reduce_add_epi32(acc);
+    for (; i < n; i++) {
+        sum += (int32_t)a[i] * b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static int32_t l2sq_i8_avx512(const int8_t* a, const int8_t* b, uint32_t n) {
+    __m512i acc = _mm512_setzero_si512();
+    uint32_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512i d = _mm512_sub_epi16(load_i8_avx512(a + i), load_i8_avx512(b + i));
+        acc = _mm512_add_epi32(acc, _mm512_madd_epi16(d, d));
+    }
+    int32_t sum = _mm512_reduce_add_epi32(acc);
+    for (; i < n; i++) {
+        int32_t diff = (int32_t)a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void cosine_i8_avx512(const int8_t* a, const int8_t* b, uint32_t n, int32_t parts[3]) {
+    __m512i ab = _mm512_setzero_si512();
+    __m512i aa = _mm512_setzero_si512();
+    __m512i bb = _mm512_setzero_si512();
+    uint32_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512i x = load_i8_avx512(a + i);
+        __m512i y = load_i8_avx512(b + i);
+        ab = _mm512_add_epi32(ab, _mm512_madd_epi16(x, y));
+        aa = _mm512_add_epi32(aa, _mm512_madd_epi16(x, x));
+        bb = _mm512_add_epi32(bb, _mm512_madd_epi16(y, y));
+    }
+    parts[0] = _mm512_reduce_add_epi32(ab);
+    parts[1] = _mm512_reduce_add_epi32(aa);
+    parts[2] = _mm512_reduce_add_epi32(bb);
+    for (; i < n; i++) {
+        parts[0] += (int32_t)a[i] * b[i];
+        parts[1] += (int32_t)a[i] * a[i];
+        parts[2] += (int32_t)b[i] * b[i];
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void to_halves_avx512(const float* src, uint32_t n, uint16_t* dst) {
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm512_cvtps_ph(_mm512_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+    }
+    for (; i < n; i++) {
+        dst[i] = float_to_half(src[i]);
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void to_floats_avx512(const uint16_t* src, uint32_t n, float* dst) {
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(dst + i, load_f16_avx512(src + i));
+    }
+    for (; i < n; i++) {
+        dst[i] = half_to_float(src[i]);
+    }
+}
+
+#endif
+
+// The sse2 level has no kernels of its own: at 4 lanes without FMA the
+// compiler's vectorized scalar loops do as well.
+static const DistanceKernels distance_kernels_table[] = {
+    { "scalar", dot_f32_scalar, l2sq_f32_scalar, cosine_f32_scalar,
+      dot_f16_scalar, l2sq_f16_scalar, cosine_f16_scalar,
+      dot_i16_scalar, l2sq_i16_scalar,
+      dot_i8_scalar, l2sq_i8_scalar, cosine_i8_scalar,
+      to_halves_scalar, to_floats_scalar },
+#if CLARITY_X86
+    { "scalar", dot_f32_scalar, l2sq_f32_scalar, cosine_f32_scalar,
+      dot_f16_scalar, l2sq_f16_scalar, cosine_f16_scalar,
+      dot_i16_scalar, l2sq_i16_scalar,
+      dot_i8_scalar, l2sq_i8_scalar, cosine_i8_scalar,
+      to_halves_scalar, to_floats_scalar },
+    { "avx2", dot_f32_avx2, l2sq_f32_avx2, cosine_f32_avx2,
+      dot_f16_avx2, l2sq_f16_avx2, cosine_f16_avx2,
+      dot_i16_avx2, l2sq_i16_avx2,
+      dot_i8_avx2, l2sq_i8_avx2, cosine_i8_avx2,
+      to_halves_avx2, to_floats_avx2 },
+    { "avx512", dot_f32_avx512, l2sq_f32_avx512, cosine_f32_avx512,
+      dot_f16_avx512, l2sq_f16_avx512, cosine_f16_avx512,
+      dot_i16_avx512, l2sq_i16_avx512,
+      dot_i8_avx512, l2sq_i8_avx512, cosine_i8_avx512,
+      to_halves_avx512, to_floats_avx512 },
+#endif
+};
+
+static const DistanceKernels* distance_kernels(void) {
+#if CLARITY_X86
+    return &distance_kernels_table[cpu_level()];
+#else
+    return &distance_kernels_table[0];
+#endif
+}
+
+// F16C is a CPUID bit of its own, so it is not part of the avx2 level:
+// the avx2 fp16 kernels and conversions need it on top of AVX2 + FMA,
+// and without it fp16 stays on the scalar kernels. AVX-512 converts
+// half floats itself.
+static const DistanceKernels* half_kernels(void) {
+#if CLARITY_X86
+    CpuLevel level = cpu_level();
+    if (level == CPU_LEVEL_AVX2 && !__builtin_cpu_supports("f16c")) level = CPU_LEVEL_SCALAR;
+    return &distance_kernels_table[level];
+#else
+    return &distance_kernels_table[0];
+#endif
+}
+
+const char* distance_kernel_name(void) {
+    return distance_kernels()->name;
+}
+
+void floats_to_halves(const float* src, uint32_t count, uint16_t* dst) {
+    if (!src || !dst) return;
+    half_kernels()->to_halves(src, count, dst);
+}
+
+void halves_to_floats(const uint16_t* src, uint32_t count, float* dst) {
+    if (!src || !dst) return;
+    half_kernels()->to_floats(src, count, dst);
+}
+
+// ---
+// Raw kernels
+// ---
+
+float dot_f32(const float* a, const float* b, uint32_t dimensions) {
+    return distance_kernels()->dot_f32(a, b, dimensions);
+}
+
+float l2sq_f32(const float* a, const float* b, uint32_t dimensions) {
+    return distance_kernels()->l2sq_f32(a, b, dimensions);
+}
+
+float dot_f16(const uint16_t* a, const uint16_t* b, uint32_t dimensions) {
+    return half_kernels()->dot_f16(a, b, dimensions);
+}
+
+float l2sq_f16(const uint16_t* a, const uint16_t* b, uint32_t dimensions) {
+    return half_kernels()->l2sq_f16(a, b, dimensions);
+}
+
+float dot_i16(const int16_t* a, const int16_t* b, uint32_t dimensions) {
+    return distance_kernels()->dot_i16(a, b, dimensions);
+}
+
+float l2sq_i16(const int16_t* a, const int16_t* b, uint32_t dimensions) {
+    return distance_kernels()->l2sq_i16(a, b, dimensions);
+}
+
+int32_t dot_i8(const int8_t* a, const int8_t* b, uint32_t dimensions) {
+    return distance_kernels()->dot_i8(a, b, dimensions);
+}
+
+int32_t l2sq_i8(const int8_t* a, const int8_t* b, uint32_t dimensions) {
+    return distance_kernels()->l2sq_i8(a, b, dimensions);
+}
+
+float vector_norm(const float* a, uint32_t dimensions) {
+    return square_root(distance_kernels()->dot_f32(a, a, dimensions));
+}
+
+// ---
+// By metric
+// ---
+
+static float cosine_from_parts(float ab, float aa, float bb) {
+    if (aa <= 0.0f || bb <= 0.0f) return 1.0f;
+    return 1.0f - ab / (square_root(aa) * square_root(bb));
+}
+
+static float inner_product_f32(const float* a, const float* b, uint32_t dimensions) {
+    return 1.0f - distance_kernels()->dot_f32(a, b, dimensions);
+}
+
+static float cosine_f32(const float* a, const float* b, uint32_t dimensions) {
+    float parts[3];
+    distance_kernels()->cosine_f32(a, b, dimensions, parts);
+    return cosine_from_parts(parts[0], parts[1], parts[2]);
+}
+
+// The L2 entry is the level's kernel itself, so callers that resolve a
+// function once (HNSW) skip the dispatch on every pair.
+DistanceF32Fn distance_f32_kernel(DistanceMetric metric) {
+    switch (metric) {
+    case DISTANCE_INNER_PRODUCT: return inner_product_f32;
+    case DISTANCE_COSINE:        return cosine_f32;
+    default:                     return distance_kernels()->l2sq_f32;
+    }
+}
+
+float distance_f32(DistanceMetric metric, const float* a, const float* b, uint32_t dimensions) {
+    return distance_f32_kernel(metric)(a, b, dimensions);
+}
+
+float distance_f16(DistanceMetric metric, const uint16_t* a, const uint16_t* b, uint32_t dimensions) {
+    const DistanceKernels* kernels = half_kernels();
+    switch (metric) {
+    case DISTANCE_INNER_PRODUCT:
+        return 1.0f - kernels->dot_f16(a, b, dimensions);
+    case DISTANCE_COSINE: {
+        float parts[3];
+        kernels->cosine_f16(a, b, dimensions, parts);
+        return cosine_from_parts(parts[0], parts[1], parts[2]);
+    }
+    default:
+        return kernels->l2sq_f16(a, b, dimensions);
+    }
+}
+
+float distance_i8(DistanceMetric metric, const int8_t* a, const int8_t* b, uint32_t dimensions) {
+    const DistanceKernels* kernels = distance_kernels();
+    switch (metric) {
+    case DISTANCE_INNER_PRODUCT:
+        return 1.0f - (float)kernels->dot_i8(a, b, dimensions);
+    case DISTANCE_COSINE: {
+        int32_t parts[3];
+        kernels->cosine_i8(a, b, dimensions, parts);
+        return cosine_from_parts((float)parts[0], (float)parts[1], (float)parts[2]);
+    }
+    default:
+        return (float)kernels->l2sq_i8(a, b, dimensions);
+    }
+}
+
+// ---
+// Top-k
+// ---
+
+void neighbors_keep(Neighbor* heap, uint32_t* count, uint32_t limit, uint32_t concept, float distance) {
+    uint32_t index;
+    if (*count < limit) {
+        index = (*count)++;
+        while (index > 0 && heap[(index - 1) / 2].distance < distance) {
+            heap[index] = heap[(index - 1) / 2];
+            index = (index - 1) / 2;
+        }
+    } else {
+        if (limit == 0 || distance >= heap[0].distance) return;
+        index = 0;
+        for (;;) {
+            uint32_t child = 2 * index + 1;
+            if (child >= *count) break;
+            if (child + 1 < *count && heap[child + 1].distance > heap[child].distance) child++;
+            if (heap[child].distance <= distance) break;
+            heap[index] = heap[child];
+            index = child;
+        }
+    }
+    heap[index].concept = concept;
+    heap[index].distance = distance;
+}
+
+static int compare_neighbors(const void* a, const void* b) {
+    const Neighbor* x = a;
+    const Neighbor* y = b;
+    if (x->distance != y->distance) return (x->distance > y->distance) - (x->distance < y->distance);
+    return (x->concept > y->concept) - (x->concept < y->concept);
+}
+
+void neighbors_sort(Neighbor* neighbors, uint32_t count) {
+    if (neighbors && count > 1) qsort(neighbors, count, sizeof(Neighbor), compare_neighbors);
+}
+
+// ---
+// Batched
+// ---
+//
+// The next row is prefetched while the current one is scored; rows are
+// usually strided rows of a ConceptVectorStore, which the hardware
+// prefetcher follows anyway, but gathered rows (HNSW) are not.
+
+void distance_f32_many(DistanceMetric metric, const float* query, const float* rows, size_t stride,
+                       uint32_t count, uint32_t dimensions, float* out) {
+    if (!query || !rows || !out) return;
+
+    DistanceF32Fn kernel = distance_f32_kernel(metric);
+    for (uint32_t i = 0; i < count; i++) {
+        if (i + 1 < count) __builtin_prefetch(rows + (i + 1) * stride);
+        out[i] = kernel(query, rows + i * stride, dimensions);
+    }
+}
+
+void distance_f16_many(DistanceMetric metric, const uint16_t* query, const uint16_t* rows, size_t stride,
+                       uint32_t count, uint32_t dimensions, float* out) {
+    if (!query || !rows || !out) return;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (i + 1 < count) __builtin_prefetch(rows + (i + 1) * stride);
+        out[i] = distance_f16(metric, query, rows + i * stride, dimensions);
+    }
+}
+
+void distance_i8_many(DistanceMetric metric, const int8_t* query, const int8_t* rows, size_t stride,
+                      uint32_t count, uint32_t dimensions, float* out) {
+    if (!query || !rows || !out) return;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (i + 1 < count) __builtin_prefetch(rows + (i + 1) * stride);
+        out[i] = distance_i8(metric, query, rows + i * stride, dimensions);
+    }
+}
+
+static uint32_t tile_rows(size_t row_bytes) {
+    size_t rows = DISTANCE_TILE_BYTES / (row_bytes ? row_bytes : 1);
+    return rows ? (uint32_t)rows : 1;
+}
+
+// void distance_f32_matrix(DistanceMetric metric, const float* queries, size_t query_stride, uint32_t query_count,
+//                          const float* rows, size_t row_stride, uint32_t row_count, uint32_t dimensions, float* out);
+//
+// Goal:
+// ======
+// out[q · row_count + r] = d(queries[q], rows[r]) for all pairs.
+//
+// Key Steps:
+// ========================
+//
+// 1. Cut the rows into tiles of about DISTANCE_TILE_BYTES.
+// 2. For each tile, score every query against it: the tile is loaded
+//    into L1 once and reused query_count times, instead of streaming
+//    the whole row set from memory once per query.
+
+void distance_f32_matrix(DistanceMetric metric, const float* queries, size_t query_stride, uint32_t query_count,
+                         const float* rows, size_t row_stride, uint32_t row_count, uint32_t dimensions, float* out) {
+    if (!queries || !rows || !out) return;
+
+    uint32_t tile = tile_rows(dimensions * sizeof(float));
+    for (uint32_t begin = 0; begin < row_count; begin += tile) {
+        uint32_t count = row_count - begin < tile ? row_count - begin : tile;
+        for (uint32_t q = 0; q < query_count; q++) {
+            distance_f32_many(metric, queries + q * query_stride, rows + begin * row_stride, row_stride,
+                              count, dimensions, out + (size_t)q * row_count + begin);
+        }
+    }
+}
+
+void distance_f16_matrix(DistanceMetric metric, const uint16_t* queries, size_t query_stride, uint32_t query_count,
+                         const uint16_t* rows, size_t row_stride, uint32_t row_count, uint32_t dimensions, float* out) {
+    if (!queries || !rows || !out) return;
+
+    uint32_t tile = tile_rows(dimensions * sizeof(uint16_t));
+    for (uint32_t begin = 0; begin < row_count; begin += tile) {
+        uint32_t count = row_count - begin < tile ? row_count - begin : tile;
+        for (uint32_t q = 0; q < query_count; q++) {
+            distance_f16_many(metric, queries + q * query_stride, rows + begin * row_stride, row_stride,
+                              count, dimensions, out + (size_t)q * row_count + begin);
+        }
+    }
+}
+
+void distance_i8_matrix(DistanceMetric metric, const int8_t* queries, size_t query_stride, uint32_t query_count,
+                        const int8_t* rows, size_t row_stride, uint32_t row_count, uint32_t dimensions, float* out) {
+    if (!queries || !rows || !out) return;
+
+    uint32_t tile = tile_rows(dimensions);
+    for (uint32_t begin = 0; begin < row_count; begin += tile) {
+        uint32_t count = row_count - begin < tile ? row_count - begin : tile;
+        for (uint32_t q = 0; q < query_count; q++) {
+            distance_i8_many(metric, queries + q * query_stride, rows + begin * row_stride, row_stride,
+                             count, dimensions, out + (size_t)q * row_count + begin);
+        }
+    }
+}
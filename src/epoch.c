@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "epoch.h"
+#include "cpu.h"
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if CLARITY_X86
+#include <immintrin.h>
+#endif
+
+#define EPOCH_SPINS_BEFORE_YIELD 64
+
+void init_epochs(EpochManager* epochs) {
+    if (!epochs) return;
+
+    epochs->current = 0;
+    epochs->sequence = 0;
+    epochs->move_depth = 0;
+    for (int i = 0; i < EPOCH_MAX_READERS; i++) {
+        epochs->readers[i].epoch = EPOCH_IDLE;
+    }
+    epochs->retired = NULL;
+    epochs->retired_count = 0;
+    epochs->retired_capacity = 0;
+}
+
+static void release_retired(const EpochRetired* retired) {
+    if (retired->release) {
+        retired->release(retired->context, retired->ptr);
+    } else {
+        free(retired->ptr);
+    }
+}
+
+// Nobody can be pinned any more, so everything retired goes.
+void free_epochs(EpochManager* epochs) {
+    if (!epochs) return;
+
+    for (uint32_t i = 0; i < epochs->retired_count; i++) {
+        release_retired(&epochs->retired[i]);
+    }
+    free(epochs->retired);
+    epochs->retired = NULL;
+    epochs->retired_count = 0;
+    epochs->retired_capacity = 0;
+}
+
+// int epoch_pin(EpochManager* epochs, uint64_t* epoch);
+//
+// Goal:
+// ======
+// Claim a reader slot holding the current version; return the slot, or
+// -1 if all EPOCH_MAX_READERS are taken.
+//
+// Key Questions:
+// ========================
+//
+// 1. What if a writer commits between reading `current` and publishing
+//    the pin?
+//    - The writer may already have scanned the slots and missed us.
+//      So after publishing, re-read `current` (seq_cst on both sides):
+//      if it moved, pin the new value and check again. Once it is
+//      stable, any later reclaim is guaranteed to see the pin.
+
+int epoch_pin(EpochManager* epochs, uint64_t* epoch) {
+    if (!epochs) return -1;
+
+    uint64_t version = __atomic_load_n(&epochs->current, __ATOMIC_SEQ_CST);
+    int reader = -1;
+    for (int i = 0; i < EPOCH_MAX_READERS && reader < 0; i++) {
+        uint64_t idle = EPOCH_IDLE;
+        if (__atomic_compare_exchange_n(&epochs->readers[i].epoch, &idle, version, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            reader = i;
+        }
+    }
+    if (reader < 0) return -1;
+
+    for (;;) {
+        uint64_t now = __atomic_load_n(&epochs->current, __ATOMIC_SEQ_CST);
+        if (now == version) break;
+        version = now;
+        __atomic_store_n(&epochs->readers[reader].epoch, version, __ATOMIC_SEQ_CST);
+    }
+
+    if (epoch) *epoch = version;
+    return reader;
+}
+
+void epoch_unpin(EpochManager* epochs, int reader) {
+    if (!epochs || reader < 0 || reader >= EPOCH_MAX_READERS) return;
+    __atomic_store_n(&epochs->readers[reader].epoch, EPOCH_IDLE, __ATOMIC_RELEASE);
+}
+
+// Smallest pinned version, or `current` when no reader is pinned.
+uint64_t epoch_oldest(const EpochManager* epochs) {
+    uint64_t oldest = __atomic_load_n(&epochs->current, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < EPOCH_MAX_READERS; i++) {
+        uint64_t pinned = __atomic_load_n(&epochs->readers[i].epoch, __ATOMIC_SEQ_CST);
+        if (pinned < oldest) oldest = pinned;
+    }
+    return oldest;
+}
+
+// Tag `ptr` with the version being written (current + 1).
+void epoch_retire(EpochManager* epochs, void* ptr) {
+    epoch_retire_to(epochs, ptr, NULL, NULL);
+}
+
+// Same, for memory that did not come from malloc: `release(context, ptr)`
+// frees it once it is safe.
+void epoch_retire_to(EpochManager* epochs, void* ptr, EpochRelease release, void* context) {
+    if (!epochs || !ptr) return;
+
+    if (epochs->retired_count >= epochs->retired_capacity) {
+        uint32_t new_capacity = epochs->retired_capacity ? epochs->retired_capacity * 2 : 16;
+        EpochRetired* new_retired = realloc(epochs->retired, new_capacity * sizeof(EpochRetired));
+        if (!new_retired) {
+            fprintf(stderr, "Failed to allocate memory for retired list.\n");
+            exit(1);
+        }
+        epochs->retired = new_retired;
+        epochs->retired_capacity = new_capacity;
+    }
+    epochs->retired[epochs->retired_count].ptr = ptr;
+    epochs->retired[epochs->retired_count].epoch = epochs->current + 1;
+    epochs->retired[epochs->retired_count].release = release;
+    epochs->retired[epochs->retired_count].context = context;
+    epochs->retired_count++;
+}
+
+// Publish the version being written. Everything the writer stored
+// before this is visible to readers that pin afterwards.
+void epoch_commit(EpochManager* epochs) {
+    if (!epochs) return;
+    __atomic_store_n(&epochs->current, epochs->current + 1, __ATOMIC_SEQ_CST);
+}
+
+// uint32_t epoch_reclaim(EpochManager* epochs);
+//
+// Free every retired pointer whose replacing version is <= the oldest
+// pin: no pinned reader can have loaded it. Returns how many were freed.
+
+uint32_t epoch_reclaim(EpochManager* epochs) {
+    if (!epochs || !epochs->retired_count) return 0;
+
+    uint64_t oldest = epoch_oldest(epochs);
+    uint32_t kept = 0;
+    uint32_t freed = 0;
+    for (uint32_t i = 0; i < epochs->retired_count; i++) {
+        if (epochs->retired[i].epoch <= oldest) {
+            release_retired(&epochs->retired[i]);
+            freed++;
+        } else {
+            epochs->retired[kept++] = epochs->retired[i];
+        }
+    }
+    epochs->retired_count = kept;
+    return freed;
+}
+
+// ---
+// Move seqlock
+// ---
+//
+// Moves nest (a removal that triggers a compaction is one move), so
+// only the outermost begin/end touch `sequence`.
+
+void epoch_move_begin(EpochManager* epochs) {
+    if (!epochs || epochs->move_depth++) return;
+    __atomic_store_n(&epochs->sequence, epochs->sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void epoch_move_end(EpochManager* epochs) {
+    if (!epochs || --epochs->move_depth) return;
+    __atomic_store_n(&epochs->sequence, epochs->sequence + 1, __ATOMIC_RELEASE);
+}
+
+// Wait out a move in progress and return the (even) sequence to check
+// against afterwards. Moves are short, so spin first; yield if the
+// writer seems to have been descheduled mid-move.
+uint32_t epoch_read_begin(const EpochManager* epochs) {
+    for (uint32_t spins = 0;; spins++) {
+        uint32_t sequence = __atomic_load_n(&epochs->sequence, __ATOMIC_ACQUIRE);
+        if (!(sequence & 1)) return sequence;
+        if (spins >= EPOCH_SPINS_BEFORE_YIELD) {
+            sched_yield();
+        } else {
+#if CLARITY_X86
+            _mm_pause();
+#endif
+        }
+    }
+}
+
+// Nonzero if a move overlapped the loads since epoch_read_begin(). The
+// fence also orders those loads before anything the reader does next.
+int epoch_read_retry(const EpochManager* epochs, uint32_t sequence) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&epochs->sequence, __ATOMIC_RELAXED) != sequence;
+}
@@ -0,0 +1,331 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "graph.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GRAPH_GRAIN 1024            // concepts per parallel_for() piece
+
+// Once per range, so a CAS loop is cheap enough.
+static void atomic_add_double(double* target, double value) {
+    double old;
+    double sum;
+    __atomic_load(target, &old, __ATOMIC_RELAXED);
+    do {
+        sum = old + value;
+    } while (!__atomic_compare_exchange(target, &old, &sum, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+static float* alloc_floats(uint32_t count, const char* what) {
+    float* array = (float*)malloc((size_t)count * sizeof(float));
+    if (!array) {
+        fprintf(stderr, "Failed to allocate memory for %s.\n", what);
+        exit(1);
+    }
+    return array;
+}
+
+// ---
+// PageRank
+// ---
+
+typedef struct PageRankPass {
+    const ConceptStore* store;
+    const float* scores;
+    float* contributions;       // score / out-degree, per source
+    float* next;
+    const float* teleport;      // NULL: uniform
+    float uniform;
+    float damping;
+    double dangling;            // mass of concepts without out-slots
+    double change;              // L1 distance between scores and next
+} PageRankPass;
+
+static void contribute_range(void* context, uint32_t begin, uint32_t end) {
+    PageRankPass* pass = (PageRankPass*)context;
+    double dangling = 0.0;
+    for (uint32_t concept = begin; concept < end; concept++) {
+        uint32_t degree = store_degree(pass->store, concept);
+        if (degree) {
+            pass->contributions[concept] = pass->scores[concept] / (float)degree;
+        } else {
+            pass->contributions[concept] = 0.0f;
+            dangling += pass->scores[concept];
+        }
+    }
+    atomic_add_double(&pass->dangling, dangling);
+}
+
+static void pull_range(void* context, uint32_t begin, uint32_t end) {
+    PageRankPass* pass = (PageRankPass*)context;
+    const ConceptStore* store = pass->store;
+    double change = 0.0;
+    for (uint32_t concept = begin; concept < end; concept++) {
+        const uint32_t* sources = store_in_slot_sources(store, concept);
+        uint32_t degree = store_in_degree(store, concept);
+        double sum = 0.0;
+        for (uint32_t i = 0; i < degree; i++) {
+            sum += pass->contributions[sources[i]];
+        }
+
+        double teleport = pass->teleport ? pass->teleport[concept] : pass->uniform;
+        float score = (float)((1.0 - pass->damping) * teleport + pass->damping * (sum + pass->dangling * teleport));
+        pass->next[concept] = score;
+        double delta = (double)score - pass->scores[concept];
+        change += delta < 0 ? -delta : delta;
+    }
+    atomic_add_double(&pass->change, change);
+}
+
+// uint32_t store_pagerank(const ConceptStore* store, Scheduler* scheduler, const uint32_t* seeds, uint32_t seed_count,
+//                         float damping, float tolerance, uint32_t max_iterations, float* scores);
+//
+// Goal:
+// ======
+// PageRank of every concept into scores[0..concept_count), summing to 1.
+// With seeds it is *personalized*: random jumps (and the mass of
+// concepts without out-slots) go back to the seeds only, so scores
+// measure relevance to them. Returns the iterations run.
+//
+// Key Steps:
+// ========================
+//
+// 1. Start from the teleport distribution (uniform, or 1/seed_count on
+//    each seed).
+//
+// 2. Each iteration is two parallel passes: every source publishes
+//    score / out-degree (and dangling mass is summed); then every
+//    concept pulls from its in-slot sources:
+//        next = (1 - d) · t + d · (Σ contributions + dangling · t)
+//
+// 3. Stop once the L1 change drops below `tolerance`, or after
+//    `max_iterations`.
+
+uint32_t store_pagerank(const ConceptStore* store, Scheduler* scheduler, const uint32_t* seeds, uint32_t seed_count,
+                        float damping, float tolerance, uint32_t max_iterations, float* scores) {
+    if (!store || !scores || store->concept_count == 0) return 0;
+
+    uint32_t count = store->concept_count;
+    float* teleport = NULL;
+    if (seeds && seed_count) {
+        teleport = alloc_floats(count, "PageRank teleport");
+        memset(teleport, 0, (size_t)count * sizeof(float));
+        uint32_t valid = 0;
+        for (uint32_t i = 0; i < seed_count; i++) {
+            valid += (uint32_t)(seeds[i] < count);
+        }
+        for (uint32_t i = 0; i < seed_count; i++) {
+            if (seeds[i] < count) teleport[seeds[i]] += 1.0f / (float)valid;
+        }
+        if (!valid) {
+            free(teleport);
+            teleport = NULL;
+        }
+    }
+
+    PageRankPass pass;
+    pass.store = store;
+    pass.contributions = alloc_floats(count, "PageRank contributions");
+    pass.teleport = teleport;
+    pass.uniform = 1.0f / (float)count;
+    pass.damping = damping;
+
+    float* current = scores;
+    float* next = alloc_floats(count, "PageRank scores");
+    float* spare = next;
+    for (uint32_t concept = 0; concept < count; concept++) {
+        current[concept] = teleport ? teleport[concept] : pass.uniform;
+    }
+
+    uint32_t iterations = 0;
+    while (iterations < max_iterations) {
+        pass.scores = current;
+        pass.next = next;
+        pass.dangling = 0.0;
+        pass.change = 0.0;
+        parallel_for(scheduler, 0, count, GRAPH_GRAIN, contribute_range, &pass);
+        parallel_for(scheduler, 0, count, GRAPH_GRAIN, pull_range, &pass);
+        iterations++;
+
+        float* swap = current;
+        current = next;
+        next = swap;
+        if (pass.change < tolerance) break;
+    }
+
+    if (current != scores) {
+        memcpy(scores, current, (size_t)count * sizeof(float));
+    }
+    free(spare);
+    free(pass.contributions);
+    free(teleport);
+    return iterations;
+}
+
+// ---
+// Weakly connected components
+// ---
+
+// Root of x, halving the path on the way: each visited node is pointed
+// at its grandparent. A failed CAS just means someone else shortened it.
+static uint32_t find_root(uint32_t* parent, uint32_t x) {
+    for (;;) {
+        uint32_t up = __atomic_load_n(&parent[x], __ATOMIC_RELAXED);
+        if (up == x) return x;
+        uint32_t grand = __atomic_load_n(&parent[up], __ATOMIC_RELAXED);
+        if (grand != up) {
+            __atomic_compare_exchange_n(&parent[x], &up, grand, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        }
+        x = up;
+    }
+}
+
+// Link the larger root under the smaller. The CAS fails only if that
+// root stopped being a root meanwhile: find again and retry.
+static void unite(uint32_t* parent, uint32_t a, uint32_t b) {
+    for (;;) {
+        a = find_root(parent, a);
+        b = find_root(parent, b);
+        if (a == b) return;
+        if (a < b) {
+            uint32_t swap = a;
+            a = b;
+            b = swap;
+        }
+        uint32_t expected = a;
+        if (__atomic_compare_exchange_n(&parent[a], &expected, b, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return;
+        }
+    }
+}
+
+typedef struct ComponentPass {
+    const ConceptStore* store;
+    uint32_t* parent;
+    uint32_t roots;
+} ComponentPass;
+
+static void init_parent_range(void* context, uint32_t begin, uint32_t end) {
+    ComponentPass* pass = (ComponentPass*)context;
+    for (uint32_t concept = begin; concept < end; concept++) {
+        pass->parent[concept] = concept;
+    }
+}
+
+static void unite_range(void* context, uint32_t begin, uint32_t end) {
+    ComponentPass* pass = (ComponentPass*)context;
+    for (uint32_t concept = begin; concept < end; concept++) {
+        const uint32_t* targets = store_slot_targets(pass->store, concept);
+        uint32_t degree = store_degree(pass->store, concept);
+        for (uint32_t i = 0; i < degree; i++) {
+            unite(pass->parent, concept, targets[i]);
+        }
+    }
+}
+
+static void label_range(void* context, uint32_t begin, uint32_t end) {
+    ComponentPass* pass = (ComponentPass*)context;
+    uint32_t roots = 0;
+    for (uint32_t concept = begin; concept < end; concept++) {
+        uint32_t root = find_root(pass->parent, concept);
+        __atomic_store_n(&pass->parent[concept], root, __ATOMIC_RELAXED);
+        roots += (uint32_t)(root == concept);
+    }
+    __atomic_add_fetch(&pass->roots, roots, __ATOMIC_RELAXED);
+}
+
+// uint32_t store_components(const ConceptStore* store, Scheduler* scheduler, uint32_t* component);
+//
+// Weakly connected components (slot direction ignored). Writes, per
+// concept, the smallest concept index of its component, and returns how
+// many components there are. `component` doubles as the union-find
+// parent array, so no other memory is needed.
+
+uint32_t store_components(const ConceptStore* store, Scheduler* scheduler, uint32_t* component) {
+    if (!store || !component) return 0;
+
+    ComponentPass pass;
+    pass.store = store;
+    pass.parent = component;
+    pass.roots = 0;
+
+    uint32_t count = store->concept_count;
+    parallel_for(scheduler, 0, count, GRAPH_GRAIN, init_parent_range, &pass);
+    parallel_for(scheduler, 0, count, GRAPH_GRAIN, unite_range, &pass);
+    parallel_for(scheduler, 0, count, GRAPH_GRAIN, label_range, &pass);
+    return pass.roots;
+}
+
+// ---
+// Degree statistics
+// ---
+
+uint32_t degree_bucket(uint32_t degree) {
+    return degree ? 32 - (uint32_t)__builtin_clz(degree) : 0;
+}
+
+typedef struct DegreePass {
+    const ConceptStore* store;
+    int incoming;
+    DegreeStats* stats;
+    pthread_mutex_t lock;       // merging one range's partial stats
+} DegreePass;
+
+static void degree_range(void* context, uint32_t begin, uint32_t end) {
+    DegreePass* pass = (DegreePass*)context;
+
+    DegreeStats local;
+    memset(&local, 0, sizeof(local));
+    local.min = UINT32_MAX;
+    for (uint32_t concept = begin; concept < end; concept++) {
+        uint32_t degree = pass->incoming ? store_in_degree(pass->store, concept) : store_degree(pass->store, concept);
+        local.slot_count += degree;
+        if (degree < local.min) local.min = degree;
+        if (degree > local.max || concept == begin) {
+            local.max = degree;
+            local.max_concept = concept;
+        }
+        local.histogram[degree_bucket(degree)]++;
+    }
+
+    pthread_mutex_lock(&pass->lock);
+    DegreeStats* stats = pass->stats;
+    stats->slot_count += local.slot_count;
+    if (local.min < stats->min) stats->min = local.min;
+    if (local.max > stats->max || (local.max == stats->max && local.max_concept < stats->max_concept)) {
+        stats->max = local.max;
+        stats->max_concept = local.max_concept;
+    }
+    for (uint32_t i = 0; i < DEGREE_BUCKETS; i++) {
+        stats->histogram[i] += local.histogram[i];
+    }
+    pthread_mutex_unlock(&pass->lock);
+}
+
+// void store_degree_stats(const ConceptStore* store, Scheduler* scheduler, int incoming, DegreeStats* stats);
+//
+// Out-degree (or in-degree with `incoming`) distribution: min, max (and
+// the first concept that has it), mean, and a log2 histogram.
+
+void store_degree_stats(const ConceptStore* store, Scheduler* scheduler, int incoming, DegreeStats* stats) {
+    if (!store || !stats) return;
+
+    memset(stats, 0, sizeof(DegreeStats));
+    stats->concept_count = store->concept_count;
+    if (store->concept_count == 0) return;
+
+    stats->min = UINT32_MAX;
+    stats->max_concept = UINT32_MAX;
+
+    DegreePass pass;
+    pass.store = store;
+    pass.incoming = incoming;
+    pass.stats = stats;
+    pthread_mutex_init(&pass.lock, NULL);
+    parallel_for(scheduler, 0, store->concept_count, GRAPH_GRAIN, degree_range, &pass);
+    pthread_mutex_destroy(&pass.lock);
+
+    stats->mean = (double)stats->slot_count / stats->concept_count;
+}
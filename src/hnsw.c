@@ -0,0 +1,779 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "hnsw.h"
+#include "cpu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if CLARITY_X86
+#include <immintrin.h>
+#endif
+
+#define HNSW_NONE UINT32_MAX
+#define HNSW_MAGIC 0x57534e48u      // "HNSW"
+#define HNSW_VERSION 1
+#define HNSW_MIN_CAPACITY 1024
+
+typedef struct HnswEntry {
+    float distance;
+    uint32_t node;
+} HnswEntry;
+
+// Everything one search or insert needs, kept in index->scratch_pool
+// between calls and only ever grown.
+struct HnswScratch {
+    uint32_t* stamps;           // visited set: stamps[node] == tag
+    uint32_t capacity;
+    uint32_t tag;
+
+    uint32_t* links;            // one copied link list, 2M + 1
+    uint32_t* chosen;           // neighbors picked on insert, 2M
+    HnswEntry* candidates;
+    uint32_t candidate_capacity;
+    HnswEntry* results;         // ef + 1
+    HnswEntry* found;           // ef
+    uint32_t ef_capacity;
+
+    HnswScratch* next;
+};
+
+// Binary heap over HnswEntry; `max` picks the ordering.
+typedef struct HnswHeap {
+    HnswEntry* items;
+    uint32_t count;
+    int max;
+} HnswHeap;
+
+static void* hnsw_alloc(size_t size, const char* what) {
+    void* ptr = malloc(size);
+    if (!ptr) {
+        fprintf(stderr, "Failed to allocate memory for %s.\n", what);
+        exit(1);
+    }
+    return ptr;
+}
+
+static void* hnsw_grow(void* ptr, size_t size, const char* what) {
+    void* new_ptr = realloc(ptr, size);
+    if (!new_ptr) {
+        fprintf(stderr, "Failed to allocate memory for %s.\n", what);
+        exit(1);
+    }
+    return new_ptr;
+}
+
+// ---
+// Heaps
+// ---
+
+static int heap_above(const HnswHeap* heap, const HnswEntry* a, const HnswEntry* b) {
+    return heap->max ? a->distance > b->distance : a->distance < b->distance;
+}
+
+static void heap_push(HnswHeap* heap, float distance, uint32_t node) {
+    uint32_t index = heap->count++;
+    heap->items[index].distance = distance;
+    heap->items[index].node = node;
+    while (index > 0) {
+        uint32_t parent = (index - 1) / 2;
+        if (!heap_above(heap, &heap->items[index], &heap->items[parent])) break;
+        HnswEntry swap = heap->items[index];
+        heap->items[index] = heap->items[parent];
+        heap->items[parent] = swap;
+        index = parent;
+    }
+}
+
+static HnswEntry heap_pop(HnswHeap* heap) {
+    HnswEntry top = heap->items[0];
+    heap->items[0] = heap->items[--heap->count];
+    uint32_t index = 0;
+    for (;;) {
+        uint32_t child = 2 * index + 1;
+        if (child >= heap->count) break;
+        if (child + 1 < heap->count && heap_above(heap, &heap->items[child + 1], &heap->items[child])) child++;
+        if (!heap_above(heap, &heap->items[child], &heap->items[index])) break;
+        HnswEntry swap = heap->items[index];
+        heap->items[index] = heap->items[child];
+        heap->items[child] = swap;
+        index = child;
+    }
+    return top;
+}
+
+// Drain a max-heap into `out` nearest first; returns the count.
+static uint32_t heap_drain_sorted(HnswHeap* heap, HnswEntry* out) {
+    uint32_t count = heap->count;
+    for (uint32_t i = count; i > 0; i--) {
+        out[i - 1] = heap_pop(heap);
+    }
+    return count;
+}
+
+// ---
+// Nodes
+// ---
+
+static float distance(const HnswIndex* index, const float* a, const float* b) {
+    return index->distance(a, b, index->vectors->dimensions);
+}
+
+static const float* node_vector(const HnswIndex* index, uint32_t node) {
+    return index->vectors->vectors + (size_t)node * index->vectors->stride;
+}
+
+static uint32_t max_links(const HnswIndex* index, int level) {
+    return level == 0 ? 2 * index->m : index->m;
+}
+
+static uint32_t* links_of(const HnswIndex* index, uint32_t node, int level) {
+    if (level == 0) return index->links0 + (size_t)node * (1 + 2 * index->m);
+    return index->upper[node] + (size_t)(level - 1) * (1 + index->m);
+}
+
+static void lock_node(HnswIndex* index, uint32_t node) {
+    while (__atomic_test_and_set(&index->locks[node], __ATOMIC_ACQUIRE)) {
+#if CLARITY_X86
+        _mm_pause();
+#endif
+    }
+}
+
+static void unlock_node(HnswIndex* index, uint32_t node) {
+    __atomic_clear(&index->locks[node], __ATOMIC_RELEASE);
+}
+
+// Copy a link list out under its node's lock.
+static uint32_t copy_links(HnswIndex* index, uint32_t node, int level, uint32_t* out) {
+    lock_node(index, node);
+    const uint32_t* list = links_of(index, node, level);
+    uint32_t count = list[0];
+    memcpy(out, list + 1, count * sizeof(uint32_t));
+    unlock_node(index, node);
+    return count;
+}
+
+// Caller holds resize_lock for writing.
+static void grow_nodes(HnswIndex* index, uint32_t concept) {
+    uint32_t old = index->capacity;
+    uint32_t new_capacity = old ? old * 2 : HNSW_MIN_CAPACITY;
+    while (new_capacity <= concept) {
+        new_capacity *= 2;
+    }
+
+    size_t list0 = 1 + 2 * (size_t)index->m;
+    index->levels = hnsw_grow(index->levels, new_capacity, "HNSW levels");
+    index->locks = hnsw_grow(index->locks, new_capacity, "HNSW locks");
+    index->links0 = hnsw_grow(index->links0, new_capacity * list0 * sizeof(uint32_t), "HNSW links");
+    index->upper = hnsw_grow(index->upper, new_capacity * sizeof(uint32_t*), "HNSW upper links");
+
+    memset(index->levels + old, -1, new_capacity - old);
+    memset(index->locks + old, 0, new_capacity - old);
+    memset(index->links0 + old * list0, 0, (new_capacity - old) * list0 * sizeof(uint32_t));
+    memset(index->upper + old, 0, (new_capacity - old) * sizeof(uint32_t*));
+    index->capacity = new_capacity;
+}
+
+// Take the resize lock for reading with `concept` covered.
+static void read_covering(HnswIndex* index, uint32_t concept) {
+    for (;;) {
+        pthread_rwlock_rdlock(&index->resize_lock);
+        if (concept < index->capacity) return;
+        pthread_rwlock_unlock(&index->resize_lock);
+
+        pthread_rwlock_wrlock(&index->resize_lock);
+        if (concept >= index->capacity) grow_nodes(index, concept);
+        pthread_rwlock_unlock(&index->resize_lock);
+    }
+}
+
+// ---
+// Scratch
+// ---
+
+// Take a scratch from the pool (or a new one) sized for the current
+// node capacity and width `ef`. Caller holds resize_lock for reading.
+static HnswScratch* acquire_scratch(HnswIndex* index, uint32_t ef) {
+    pthread_mutex_lock(&index->scratch_lock);
+    HnswScratch* scratch = index->scratch_pool;
+    if (scratch) index->scratch_pool = scratch->next;
+    pthread_mutex_unlock(&index->scratch_lock);
+
+    if (!scratch) {
+        scratch = hnsw_alloc(sizeof(HnswScratch), "HNSW search scratch");
+        memset(scratch, 0, sizeof(HnswScratch));
+        scratch->links = hnsw_alloc((2 * index->m + 1) * sizeof(uint32_t), "HNSW link buffer");
+        scratch->chosen = hnsw_alloc(2 * index->m * sizeof(uint32_t), "HNSW neighbors");
+        scratch->candidate_capacity = index->capacity < 4096 ? index->capacity : 4096;
+        scratch->candidates = hnsw_alloc(scratch->candidate_capacity * sizeof(HnswEntry), "HNSW candidates");
+    }
+    if (scratch->capacity < index->capacity) {
+        free(scratch->stamps);
+        scratch->stamps = calloc(index->capacity, sizeof(uint32_t));
+        if (!scratch->stamps) {
+            fprintf(stderr, "Failed to allocate memory for HNSW visited set.\n");
+            exit(1);
+        }
+        scratch->capacity = index->capacity;
+        scratch->tag = 0;
+    }
+    // search_layer() starts from at most ef entries, all of which go
+    // into candidates before it can grow the heap.
+    if (scratch->candidate_capacity < ef) {
+        scratch->candidate_capacity = ef;
+        scratch->candidates = hnsw_grow(scratch->candidates, ef * sizeof(HnswEntry), "HNSW candidates");
+    }
+    if (scratch->ef_capacity < ef) {
+        scratch->results = hnsw_grow(scratch->results, (ef + 1) * sizeof(HnswEntry), "HNSW results");
+        scratch->found = hnsw_grow(scratch->found, ef * sizeof(HnswEntry), "HNSW search results");
+        scratch->ef_capacity = ef;
+    }
+    return scratch;
+}
+
+static void release_scratch(HnswIndex* index, HnswScratch* scratch) {
+    pthread_mutex_lock(&index->scratch_lock);
+    scratch->next = index->scratch_pool;
+    index->scratch_pool = scratch;
+    pthread_mutex_unlock(&index->scratch_lock);
+}
+
+// Start a new visited set: bump the tag, clearing only on wrap-around.
+static void clear_visited(HnswScratch* scratch) {
+    if (++scratch->tag == 0) {
+        memset(scratch->stamps, 0, scratch->capacity * sizeof(uint32_t));
+        scratch->tag = 1;
+    }
+}
+
+// ---
+// Search
+// ---
+
+// Greedy walk on `level`: move to the closest neighbor until none is
+// closer. Used above the levels where work is done.
+static uint32_t greedy_step(HnswIndex* index, const float* query, uint32_t node, float* node_distance,
+                            int level, uint32_t* buffer) {
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        uint32_t count = copy_links(index, node, level, buffer);
+        for (uint32_t i = 0; i < count; i++) {
+            float d = distance(index, query, node_vector(index, buffer[i]));
+            if (d < *node_distance) {
+                *node_distance = d;
+                node = buffer[i];
+                changed = 1;
+            }
+        }
+    }
+    return node;
+}
+
+// uint32_t search_layer(HnswIndex* index, HnswScratch* scratch, const float* query, const HnswEntry* entries,
+//                       uint32_t entry_count, uint32_t ef, int level, HnswEntry* out);
+//
+// Best-first search of width `ef` on one level from `entries`; writes
+// the (up to) ef nearest found into `out`, nearest first. Heaps, link
+// buffer and visited set come from `scratch` (sized for ef); at most ef
+// entries.
+//
+// Key Steps:
+// ========================
+//
+// 1. `candidates` (min-heap) is the frontier, `results` (max-heap, at
+//    most ef) the best so far.
+//
+// 2. Pop the nearest candidate; once it is farther than the worst
+//    result with results full, nothing left can improve them: stop.
+//
+// 3. Otherwise scan its links; unvisited neighbors closer than the
+//    worst result (or any, while results is not full) join both.
+
+static uint32_t search_layer(HnswIndex* index, HnswScratch* scratch, const float* query, const HnswEntry* entries,
+                             uint32_t entry_count, uint32_t ef, int level, HnswEntry* out) {
+    clear_visited(scratch);
+    uint32_t* stamps = scratch->stamps;
+    uint32_t tag = scratch->tag;
+    uint32_t* buffer = scratch->links;
+
+    // Each visited node enters candidates at most once.
+    HnswHeap candidates = { scratch->candidates, 0, 0 };
+    HnswHeap results = { scratch->results, 0, 1 };
+
+    for (uint32_t i = 0; i < entry_count; i++) {
+        uint32_t node = entries[i].node;
+        if (stamps[node] == tag) continue;
+        stamps[node] = tag;
+        heap_push(&candidates, entries[i].distance, node);
+        heap_push(&results, entries[i].distance, node);
+        if (results.count > ef) heap_pop(&results);
+    }
+
+    while (candidates.count) {
+        HnswEntry nearest = heap_pop(&candidates);
+        if (results.count >= ef && nearest.distance > results.items[0].distance) break;
+
+        uint32_t count = copy_links(index, nearest.node, level, buffer);
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t node = buffer[i];
+            if (stamps[node] == tag) continue;
+            stamps[node] = tag;
+
+            float d = distance(index, query, node_vector(index, node));
+            if (results.count < ef || d < results.items[0].distance) {
+                if (candidates.count == scratch->candidate_capacity) {
+                    scratch->candidate_capacity *= 2;
+                    scratch->candidates = hnsw_grow(scratch->candidates,
+                                                    scratch->candidate_capacity * sizeof(HnswEntry),
+                                                    "HNSW candidates");
+                    candidates.items = scratch->candidates;
+                }
+                heap_push(&candidates, d, node);
+                heap_push(&results, d, node);
+                if (results.count > ef) heap_pop(&results);
+            }
+        }
+    }
+
+    return heap_drain_sorted(&results, out);
+}
+
+// Diversity heuristic over `candidates` (nearest first): keep one only
+// if it is nearer to the base than to everything kept before it.
+static uint32_t select_neighbors(const HnswIndex* index, const HnswEntry* candidates, uint32_t count,
+                                 uint32_t limit, uint32_t* out) {
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < count && kept < limit; i++) {
+        const float* vector = node_vector(index, candidates[i].node);
+        int diverse = 1;
+        for (uint32_t j = 0; j < kept && diverse; j++) {
+            if (distance(index, vector, node_vector(index, out[j])) < candidates[i].distance) diverse = 0;
+        }
+        if (diverse) out[kept++] = candidates[i].node;
+    }
+    return kept;
+}
+
+static int compare_entries(const void* a, const void* b) {
+    float da = ((const HnswEntry*)a)->distance;
+    float db = ((const HnswEntry*)b)->distance;
+    return (da > db) - (da < db);
+}
+
+// Add `node` to the links of `neighbor` on `level`. A full list is
+// re-selected with the heuristic from its links plus `node`.
+static void link_back(HnswIndex* index, uint32_t neighbor, uint32_t node, int level) {
+    uint32_t limit = max_links(index, level);
+    HnswEntry pool[2 * HNSW_DEFAULT_M + 1 > 64 ? 2 * HNSW_DEFAULT_M + 1 : 64];
+    HnswEntry* candidates = limit + 1 <= sizeof(pool) / sizeof(pool[0])
+                          ? pool : hnsw_alloc((limit + 1) * sizeof(HnswEntry), "HNSW neighbor pool");
+
+    lock_node(index, neighbor);
+    uint32_t* list = links_of(index, neighbor, level);
+    uint32_t count = list[0];
+    int linked = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        linked |= list[1 + i] == node;
+    }
+
+    if (!linked && count < limit) {
+        list[1 + count] = node;
+        list[0] = count + 1;
+    } else if (!linked) {
+        const float* base = node_vector(index, neighbor);
+        for (uint32_t i = 0; i < count; i++) {
+            candidates[i].node = list[1 + i];
+            candidates[i].distance = distance(index, base, node_vector(index, list[1 + i]));
+        }
+        candidates[count].node = node;
+        candidates[count].distance = distance(index, base, node_vector(index, node));
+        qsort(candidates, count + 1, sizeof(HnswEntry), compare_entries);
+        list[0] = select_neighbors(index, candidates, count + 1, limit, list + 1);
+    }
+    unlock_node(index, neighbor);
+
+    if (candidates != pool) free(candidates);
+}
+
+static int random_level(uint32_t m) {
+    static __thread uint64_t state;
+    if (!state) state = (uint64_t)(uintptr_t)&state * 0x9E3779B97F4A7C15ull | 1;
+
+    int level = 0;
+    for (;;) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        if (level >= HNSW_MAX_LEVEL - 1 || state % m != 0) return level;
+        level++;
+    }
+}
+
+// ---
+// Lifecycle
+// ---
+
+void init_hnsw(HnswIndex* index, const ConceptVectorStore* vectors, HnswMetric metric,
+               uint32_t m, uint32_t ef_construction) {
+    if (!index) return;
+
+    memset(index, 0, sizeof(HnswIndex));
+    index->vectors = vectors;
+    index->metric = metric;
+    index->distance = distance_f32_kernel((DistanceMetric)metric);
+    index->m = m < 2 ? HNSW_DEFAULT_M : m > HNSW_MAX_M ? HNSW_MAX_M : m;
+    index->ef_construction = ef_construction ? ef_construction : HNSW_DEFAULT_EF_CONSTRUCTION;
+    index->ef_search = HNSW_DEFAULT_EF_SEARCH;
+    index->entry = HNSW_NONE;
+    index->max_level = -1;
+    pthread_mutex_init(&index->entry_lock, NULL);
+    pthread_rwlock_init(&index->resize_lock, NULL);
+    pthread_mutex_init(&index->scratch_lock, NULL);
+}
+
+void free_hnsw(HnswIndex* index) {
+    if (!index) return;
+
+    for (uint32_t i = 0; i < index->capacity; i++) {
+        free(index->upper[i]);
+    }
+    free(index->levels);
+    free(index->locks);
+    free(index->links0);
+    free(index->upper);
+
+    HnswScratch* scratch = index->scratch_pool;
+    while (scratch) {
+        HnswScratch* next = scratch->next;
+        free(scratch->stamps);
+        free(scratch->links);
+        free(scratch->chosen);
+        free(scratch->candidates);
+        free(scratch->results);
+        free(scratch->found);
+        free(scratch);
+        scratch = next;
+    }
+
+    pthread_mutex_destroy(&index->entry_lock);
+    pthread_rwlock_destroy(&index->resize_lock);
+    pthread_mutex_destroy(&index->scratch_lock);
+    memset(index, 0, sizeof(HnswIndex));
+}
+
+// ---
+// Insert
+// ---
+
+// int hnsw_insert(HnswIndex* index, uint32_t concept);
+//
+// Goal:
+// ======
+// Add `concept` (which must have an embedding) to the index. Returns 1
+// if inserted, 0 if it already was, -1 if it has no embedding. Safe to
+// call from many threads at once.
+//
+// Key Steps:
+// ========================
+//
+// 1. Draw a level and claim the node with a CAS on levels[concept], so
+//    two threads inserting the same concept cannot both proceed.
+//
+// 2. Read the entry point. If this node will be the new top, keep
+//    entry_lock until the end so nobody else raises the top meanwhile.
+//
+// 3. Greedy-walk down to the node's level, then on each level from
+//    there to 0: search ef_construction wide, link to the heuristic's
+//    pick of M (2M on level 0), and link each pick back.
+
+int hnsw_insert(HnswIndex* index, uint32_t concept) {
+    if (!index || !vector_present(index->vectors, concept)) return -1;
+
+    read_covering(index, concept);
+
+    int level = random_level(index->m);
+    uint32_t* upper = NULL;
+    if (level > 0) {
+        upper = calloc((size_t)level * (1 + index->m), sizeof(uint32_t));
+        if (!upper) {
+            fprintf(stderr, "Failed to allocate memory for HNSW upper links.\n");
+            exit(1);
+        }
+    }
+    // Nobody reaches the node before it is linked below, so its upper
+    // lists can be published after the claim.
+    int8_t absent = -1;
+    if (!__atomic_compare_exchange_n(&index->levels[concept], &absent, (int8_t)level, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        free(upper);
+        pthread_rwlock_unlock(&index->resize_lock);
+        return 0;
+    }
+    index->upper[concept] = upper;
+
+    const float* query = node_vector(index, concept);
+
+    pthread_mutex_lock(&index->entry_lock);
+    uint32_t entry = index->entry;
+    int top = index->max_level;
+    if (entry == HNSW_NONE) {
+        __atomic_store_n(&index->entry, concept, __ATOMIC_RELAXED);
+        __atomic_store_n(&index->max_level, level, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&index->entry_lock);
+        __atomic_add_fetch(&index->count, 1, __ATOMIC_RELAXED);
+        pthread_rwlock_unlock(&index->resize_lock);
+        return 1;
+    }
+    int raises_top = level > top;
+    if (!raises_top) pthread_mutex_unlock(&index->entry_lock);
+
+    HnswScratch* scratch = acquire_scratch(index, index->ef_construction);
+    uint32_t* buffer = scratch->links;
+    HnswEntry* found = scratch->found;
+    uint32_t* chosen = scratch->chosen;
+
+    float entry_distance = distance(index, query, node_vector(index, entry));
+    for (int l = top; l > level; l--) {
+        entry = greedy_step(index, query, entry, &entry_distance, l, buffer);
+    }
+
+    found[0].node = entry;
+    found[0].distance = entry_distance;
+    uint32_t found_count = 1;
+    for (int l = level < top ? level : top; l >= 0; l--) {
+        found_count = search_layer(index, scratch, query, found, found_count, index->ef_construction, l, found);
+        uint32_t count = select_neighbors(index, found, found_count, max_links(index, l), chosen);
+
+        lock_node(index, concept);
+        uint32_t* list = links_of(index, concept, l);
+        memcpy(list + 1, chosen, count * sizeof(uint32_t));
+        list[0] = count;
+        unlock_node(index, concept);
+
+        for (uint32_t i = 0; i < count; i++) {
+            link_back(index, chosen[i], concept, l);
+        }
+    }
+
+    if (raises_top) {
+        __atomic_store_n(&index->entry, concept, __ATOMIC_RELAXED);
+        __atomic_store_n(&index->max_level, level, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&index->entry_lock);
+    }
+
+    release_scratch(index, scratch);
+    __atomic_add_fetch(&index->count, 1, __ATOMIC_RELAXED);
+    pthread_rwlock_unlock(&index->resize_lock);
+    return 1;
+}
+
+typedef struct HnswBuild {
+    HnswIndex* index;
+} HnswBuild;
+
+static void insert_range(void* context, uint32_t begin, uint32_t end) {
+    HnswIndex* index = ((HnswBuild*)context)->index;
+    for (uint32_t concept = begin; concept < end; concept++) {
+        if (vector_present(index->vectors, concept)) hnsw_insert(index, concept);
+    }
+}
+
+// Insert every concept that has an embedding, in parallel.
+void hnsw_insert_all(HnswIndex* index, Scheduler* scheduler) {
+    if (!index) return;
+
+    const ConceptVectorStore* vectors = index->vectors;
+    uint32_t end = 0;
+    for (uint32_t word = (vectors->capacity + 63) / 64; word > 0 && !end; word--) {
+        uint64_t bits = vectors->present[word - 1];
+        if (bits) end = (word - 1) * 64 + 64 - (uint32_t)__builtin_clzll(bits);
+    }
+    if (!end) return;
+
+    pthread_rwlock_wrlock(&index->resize_lock);
+    if (end - 1 >= index->capacity) grow_nodes(index, end - 1);
+    pthread_rwlock_unlock(&index->resize_lock);
+
+    HnswBuild build = { index };
+    parallel_for(scheduler, 0, end, 256, insert_range, &build);
+}
+
+// uint32_t hnsw_search(HnswIndex* index, const float* query, uint32_t k, uint32_t ef, HnswResult* out);
+//
+// The (up to) k nearest concepts to `query`, nearest first. `ef` is the
+// search width (0: ef_search); it is raised to k if smaller.
+
+uint32_t hnsw_search(HnswIndex* index, const float* query, uint32_t k, uint32_t ef, HnswResult* out) {
+    if (!index || !query || !out || k == 0) return 0;
+    if (ef == 0) ef = index->ef_search;
+    if (ef < k) ef = k;
+
+    pthread_rwlock_rdlock(&index->resize_lock);
+    int top = __atomic_load_n(&index->max_level, __ATOMIC_ACQUIRE);
+    uint32_t entry = __atomic_load_n(&index->entry, __ATOMIC_RELAXED);
+    if (top < 0 || entry == HNSW_NONE) {
+        pthread_rwlock_unlock(&index->resize_lock);
+        return 0;
+    }
+
+    HnswScratch* scratch = acquire_scratch(index, ef);
+    HnswEntry* found = scratch->found;
+
+    float entry_distance = distance(index, query, node_vector(index, entry));
+    for (int l = top; l > 0; l--) {
+        entry = greedy_step(index, query, entry, &entry_distance, l, scratch->links);
+    }
+    found[0].node = entry;
+    found[0].distance = entry_distance;
+    uint32_t count = search_layer(index, scratch, query, found, 1, ef, 0, found);
+    pthread_rwlock_unlock(&index->resize_lock);
+
+    if (count > k) count = k;
+    for (uint32_t i = 0; i < count; i++) {
+        out[i].concept = found[i].node;
+        out[i].distance = found[i].distance;
+    }
+    release_scratch(index, scratch);
+    return count;
+}
+
+// ---
+// Serialization
+// ---
+//
+// Little-endian, native layout:
+//     header  magic, version, metric, m, ef_construction, ef_search,
+//             dimensions, node span, entry, max_level, count   (u32 each)
+//     nodes   per node < span: level (i8); if >= 0, its link lists for
+//             levels 0..level as [count, ids...]
+//
+// The caller must not insert while saving.
+
+int hnsw_save(const HnswIndex* index, const char* path) {
+    if (!index || !path) return -1;
+
+    FILE* file = fopen(path, "wb");
+    if (!file) return -1;
+
+    uint32_t span = 0;
+    for (uint32_t node = 0; node < index->capacity; node++) {
+        if (index->levels[node] >= 0) span = node + 1;
+    }
+
+    uint32_t header[11] = {
+        HNSW_MAGIC, HNSW_VERSION, (uint32_t)index->metric, index->m, index->ef_construction,
+        index->ef_search, index->vectors->dimensions, span, index->entry, (uint32_t)index->max_level,
+        index->count,
+    };
+    int ok = fwrite(header, sizeof(header), 1, file) == 1;
+
+    for (uint32_t node = 0; node < span && ok; node++) {
+        int8_t level = index->levels[node];
+        ok = fwrite(&level, 1, 1, file) == 1;
+        for (int l = 0; l <= level && ok; l++) {
+            const uint32_t* list = links_of(index, node, l);
+            ok = fwrite(list, sizeof(uint32_t), 1 + list[0], file) == 1 + list[0];
+        }
+    }
+
+    if (fclose(file) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+static int valid_metric(uint32_t metric) {
+    return metric == HNSW_METRIC_L2 || metric == HNSW_METRIC_INNER_PRODUCT || metric == HNSW_METRIC_COSINE;
+}
+
+// The graph read from a file must be one hnsw_insert() could have
+// built: every node has a vector, links on level l only reach nodes
+// that are on level l, the entry point is on the top level, and the
+// header's count matches the nodes.
+static int valid_graph(const HnswIndex* index, uint32_t span, uint32_t entry, uint32_t max_level,
+                       uint32_t count) {
+    if (span == 0) return count == 0;
+    if (entry >= span || index->levels[entry] < 0 || (uint32_t)index->levels[entry] != max_level) return 0;
+
+    uint32_t nodes = 0;
+    for (uint32_t node = 0; node < span; node++) {
+        int level = index->levels[node];
+        if (level < 0) continue;
+        if (!vector_present(index->vectors, node)) return 0;
+        nodes++;
+        for (int l = 0; l <= level; l++) {
+            const uint32_t* list = links_of(index, node, l);
+            for (uint32_t i = 0; i < list[0]; i++) {
+                if (index->levels[list[1 + i]] < l) return 0;
+            }
+        }
+    }
+    return nodes == count;
+}
+
+// int hnsw_load(HnswIndex* index, const ConceptVectorStore* vectors, const char* path);
+//
+// Replace `index` (initialized or zeroed) with the graph in `path`,
+// searching over `vectors`, which must have the same dimensions and
+// the same embeddings as when it was saved. Returns 0 or -1; a file
+// that is truncated, has an unknown metric or M, or describes a graph
+// that is not a valid index over `vectors` fails. A refused header
+// leaves `index` as it was; a later failure leaves it empty but usable.
+
+int hnsw_load(HnswIndex* index, const ConceptVectorStore* vectors, const char* path) {
+    if (!index || !vectors || !path) return -1;
+
+    FILE* file = fopen(path, "rb");
+    if (!file) return -1;
+
+    uint32_t header[11];
+    if (fread(header, sizeof(header), 1, file) != 1 || header[0] != HNSW_MAGIC ||
+        header[1] != HNSW_VERSION || !valid_metric(header[2]) || header[3] < 2 || header[3] > HNSW_MAX_M ||
+        header[6] != vectors->dimensions) {
+        fclose(file);
+        return -1;
+    }
+
+    if (index->vectors) free_hnsw(index);
+    init_hnsw(index, vectors, (HnswMetric)header[2], header[3], header[4]);
+    index->ef_search = header[5];
+    uint32_t span = header[7];
+    if (span) grow_nodes(index, span - 1);
+
+    int ok = 1;
+    for (uint32_t node = 0; node < span && ok; node++) {
+        int8_t level;
+        ok = fread(&level, 1, 1, file) == 1 && level < HNSW_MAX_LEVEL;
+        if (!ok || level < 0) continue;
+
+        index->levels[node] = level;
+        if (level > 0) {
+            index->upper[node] = calloc((size_t)level * (1 + index->m), sizeof(uint32_t));
+            if (!index->upper[node]) {
+                fprintf(stderr, "Failed to allocate memory for HNSW upper links.\n");
+                exit(1);
+            }
+        }
+        for (int l = 0; l <= level && ok; l++) {
+            uint32_t* list = links_of(index, node, l);
+            ok = fread(list, sizeof(uint32_t), 1, file) == 1 && list[0] <= max_links(index, l) &&
+                 fread(list + 1, sizeof(uint32_t), list[0], file) == list[0];
+            for (uint32_t i = 0; ok && i < list[0]; i++) {
+                ok = list[1 + i] < span;
+            }
+        }
+    }
+    fclose(file);
+
+    if (!ok || !valid_graph(index, span, header[8], header[9], header[10])) {
+        const ConceptVectorStore* keep = index->vectors;
+        free_hnsw(index);
+        init_hnsw(index, keep, (HnswMetric)header[2], header[3], header[4]);
+        return -1;
+    }
+
+    index->entry = span ? header[8] : HNSW_NONE;
+    index->max_level = span ? (int32_t)header[9] : -1;
+    index->count = header[10];
+    return 0;
+}
@@ -0,0 +1,427 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "knn.h"
+#include "cpu.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if CLARITY_X86
+#include <immintrin.h>
+#endif
+
+// Row-parallel mode below this many queries.
+#define KNN_FEW_QUERIES 16
+
+typedef struct KnnKernels {
+    const char* name;
+    // out[i · 4 + j] = queries[i] · rows[j] over n floats, n a multiple of 16.
+    void (*dots)(const float* const* queries, const float* const* rows, uint32_t n, float* out);
+} KnnKernels;
+
+static void* knn_alloc(size_t size, const char* what) {
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) {
+        fprintf(stderr, "Failed to allocate memory for %s.\n", what);
+        exit(1);
+    }
+    return ptr;
+}
+
+// ---
+// Micro-kernels
+// ---
+
+static void dots_scalar(const float* const* queries, const float* const* rows, uint32_t n, float* out) {
+    for (uint32_t i = 0; i < 4; i++) {
+        for (uint32_t j = 0; j < 4; j++) {
+            float sum = 0.0f;
+            for (uint32_t d = 0; d < n; d++) {
+                sum += queries[i][d] * rows[j][d];
+            }
+            out[i * 4 + j] = sum;
+        }
+    }
+}
+
+#if CLARITY_X86
+
+__attribute__((target("avx2,fma")))
+static inline float sum_avx2(__m256 v) {
+    __m128 low = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    low = _mm_add_ps(low, _mm_movehl_ps(low, low));
+    low = _mm_add_ss(low, _mm_shuffle_ps(low, low, 1));
+    return _mm_cvtss_f32(low);
+}
+
+// AVX2 has 16 registers: a 4×4 block of accumulators would spill, so
+// the block is done as two 4×2 halves (8 accumulators + 6 loads).
+__attribute__((target("avx2,fma")))
+static void dots_avx2(const float* const* queries, const float* const* rows, uint32_t n, float* out) {
+    for (uint32_t half = 0; half < 4; half += 2) {
+        const float* r0 = rows[half];
+        const float* r1 = rows[half + 1];
+        __m256 acc[4][2];
+        for (uint32_t i = 0; i < 4; i++) {
+            acc[i][0] = _mm256_setzero_ps();
+            acc[i][1] = _mm256_setzero_ps();
+        }
+        for (uint32_t d = 0; d < n; d += 8) {
+            __m256 y0 = _mm256_loadu_ps(r0 + d);
+            __m256 y1 = _mm256_loadu_ps(r1 + d);
+            for (uint32_t i = 0; i < 4; i++) {
+                __m256 x = _mm256_loadu_ps(queries[i] + d);
+                acc[i][0] = _mm256_fmadd_ps(x, y0, acc[i][0]);
+                acc[i][1] = _mm256_fmadd_ps(x, y1, acc[i][1]);
+            }
+        }
+        for (uint32_t i = 0; i < 4; i++) {
+            out[i * 4 + half] = sum_avx2(acc[i][0]);
+            out[i * 4 + half + 1] = sum_avx2(acc[i][1]);
+        }
+    }
+}
+
+// AVX-512 has 32 registers: all 16 accumulators fit, and each loaded
+// 16-float chunk of a row or query is reused 4 times.
+__attribute__((target("avx512f")))
+static void dots_avx512(const float* const* queries, const float* const* rows, uint32_t n, float* out) {
+    __m512 acc[4][4];
+    for (uint32_t i = 0; i < 4; i++) {
+        for (uint32_t j = 0; j < 4; j++) {
+            acc[i][j] = _mm512_setzero_ps();
+        }
+    }
+    for (uint32_t d = 0; d < n; d += 16) {
+        __m512 y0 = _mm512_loadu_ps(rows[0] + d);
+        __m512 y1 = _mm512_loadu_ps(rows[1] + d);
+        __m512 y2 = _mm512_loadu_ps(rows[2] + d);
+        __m512 y3 = _mm512_loadu_ps(rows[3] + d);
+        for (uint32_t i = 0; i < 4; i++) {
+            __m512 x = _mm512_loadu_ps(queries[i] + d);
+            acc[i][0] = _mm512_fmadd_ps(x, y0, acc[i][0]);
+            acc[i][1] = _mm512_fmadd_ps(x, y1, acc[i][1]);
+            acc[i][2] = _mm512_fmadd_ps(x, y2, acc[i][2]);
+            acc[i][3] = _mm512_fmadd_ps(x, y3, acc[i][3]);
+        }
+    }
+    for (uint32_t i = 0; i < 4; i++) {
+        for (uint32_t j = 0; j < 4; j++) {
+            out[i * 4 + j] = _mm512_reduce_add_ps(acc[i][j]);
+        }
+    }
+}
+
+#endif
+
+static const KnnKernels knn_kernels_table[] = {
+    { "scalar", dots_scalar },
+#if CLARITY_X86
+    { "scalar", dots_scalar },
+    { "avx2",   dots_avx2 },
+    { "avx512", dots_avx512 },
+#endif
+};
+
+static const KnnKernels* knn_kernels(void) {
+#if CLARITY_X86
+    return &knn_kernels_table[cpu_level()];
+#else
+    return &knn_kernels_table[0];
+#endif
+}
+
+const char* knn_kernel_name(void) {
+    return knn_kernels()->name;
+}
+
+// ---
+// Search
+// ---
+
+typedef struct KnnSearch {
+    const ConceptVectorStore* vectors;
+    DistanceMetric metric;
+    uint32_t k;
+
+    const float* queries;       // padded, query_count rounded up to 4 rows
+    const float* query_squares; // |q|²
+    const float* query_norms;   // |q|
+    uint32_t query_count;
+
+    const uint32_t* rows;       // concepts with an embedding
+    const float* row_squares;
+    const float* row_norms;
+    uint32_t row_count;
+
+    Neighbor* heaps;            // query_count × k
+    uint32_t* heap_counts;
+    pthread_mutex_t merge_lock;
+} KnnSearch;
+
+static float distance_from_dot(const KnnSearch* search, uint32_t query, uint32_t row, float dot) {
+    switch (search->metric) {
+    case DISTANCE_INNER_PRODUCT:
+        return 1.0f - dot;
+    case DISTANCE_COSINE:
+        if (search->query_norms[query] <= 0.0f || search->row_norms[row] <= 0.0f) return 1.0f;
+        return 1.0f - dot / (search->query_norms[query] * search->row_norms[row]);
+    default: {
+        float l2 = search->query_squares[query] + search->row_squares[row] - 2.0f * dot;
+        return l2 > 0.0f ? l2 : 0.0f;
+    }
+    }
+}
+
+// void scan_block(const KnnSearch* search, uint32_t query_begin, uint32_t query_end, uint32_t row_begin,
+//                 uint32_t row_end, Neighbor* heaps, uint32_t* heap_counts);
+//
+// Score queries [query_begin, query_end) against rows [row_begin,
+// row_end) into `heaps` (k per query, indexed from query_begin). Row
+// tiles outside, query blocks of 4 inside, so a tile is reused by every
+// query block while it is hot. Short blocks repeat their last query or
+// row and the extra results are dropped.
+
+static void scan_block(const KnnSearch* search, uint32_t query_begin, uint32_t query_end, uint32_t row_begin,
+                       uint32_t row_end, Neighbor* heaps, uint32_t* heap_counts) {
+    const KnnKernels* kernels = knn_kernels();
+    const ConceptVectorStore* vectors = search->vectors;
+    uint32_t stride = vectors->stride;
+    float dots[16];
+
+    for (uint32_t tile = row_begin; tile < row_end; tile += KNN_ROW_TILE) {
+        uint32_t tile_end = row_end - tile < KNN_ROW_TILE ? row_end : tile + KNN_ROW_TILE;
+        for (uint32_t q = query_begin; q < query_end; q += KNN_QUERY_BLOCK) {
+            const float* queries[4];
+            for (uint32_t i = 0; i < 4; i++) {
+                uint32_t query = q + i < query_end ? q + i : query_end - 1;
+                queries[i] = search->queries + (size_t)query * stride;
+            }
+
+            for (uint32_t r = tile; r < tile_end; r += 4) {
+                const float* rows[4];
+                for (uint32_t j = 0; j < 4; j++) {
+                    uint32_t row = r + j < tile_end ? r + j : tile_end - 1;
+                    rows[j] = vectors->vectors + (size_t)search->rows[row] * stride;
+                }
+                kernels->dots(queries, rows, stride, dots);
+
+                for (uint32_t i = 0; i < 4 && q + i < query_end; i++) {
+                    uint32_t local = q + i - query_begin;
+                    for (uint32_t j = 0; j < 4 && r + j < tile_end; j++) {
+                        neighbors_keep(heaps + (size_t)local * search->k, &heap_counts[local], search->k,
+                                       search->rows[r + j], distance_from_dot(search, q + i, r + j, dots[i * 4 + j]));
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void query_range(void* context, uint32_t begin, uint32_t end) {
+    KnnSearch* search = context;
+    uint32_t query_begin = begin * KNN_QUERY_BLOCK;
+    uint32_t query_end = end * KNN_QUERY_BLOCK < search->query_count ? end * KNN_QUERY_BLOCK : search->query_count;
+    scan_block(search, query_begin, query_end, 0, search->row_count,
+               search->heaps + (size_t)query_begin * search->k, search->heap_counts + query_begin);
+}
+
+static void row_range(void* context, uint32_t begin, uint32_t end) {
+    KnnSearch* search = context;
+    uint32_t row_begin = begin * KNN_ROW_TILE;
+    uint32_t row_end = end * KNN_ROW_TILE < search->row_count ? end * KNN_ROW_TILE : search->row_count;
+
+    Neighbor* heaps = knn_alloc((size_t)search->query_count * search->k * sizeof(Neighbor), "k-NN heaps");
+    uint32_t* counts = calloc(search->query_count, sizeof(uint32_t));
+    if (!counts) {
+        fprintf(stderr, "Failed to allocate memory for k-NN heaps.\n");
+        exit(1);
+    }
+    scan_block(search, 0, search->query_count, row_begin, row_end, heaps, counts);
+
+    pthread_mutex_lock(&search->merge_lock);
+    for (uint32_t q = 0; q < search->query_count; q++) {
+        for (uint32_t i = 0; i < counts[q]; i++) {
+            const Neighbor* found = &heaps[(size_t)q * search->k + i];
+            neighbors_keep(search->heaps + (size_t)q * search->k, &search->heap_counts[q], search->k,
+                           found->concept, found->distance);
+        }
+    }
+    pthread_mutex_unlock(&search->merge_lock);
+
+    free(counts);
+    free(heaps);
+}
+
+static void norm_range(void* context, uint32_t begin, uint32_t end) {
+    KnnSearch* search = context;
+    for (uint32_t i = begin; i < end; i++) {
+        const float* row = vector_of(search->vectors, search->rows[i]);
+        ((float*)search->row_squares)[i] = dot_f32(row, row, search->vectors->dimensions);
+        ((float*)search->row_norms)[i] = vector_norm(row, search->vectors->dimensions);
+    }
+}
+
+// uint32_t knn_exact(const ConceptVectorStore* vectors, DistanceMetric metric, const float* queries, size_t stride,
+//                    uint32_t query_count, uint32_t k, Scheduler* scheduler, Neighbor* out, uint32_t* counts);
+//
+// Goal:
+// ======
+// For each of `query_count` queries (`stride` floats apart), its exact
+// k nearest concepts, nearest first: query q's go to out[q · k ..] and
+// their number to counts[q]. Returns min(k, concepts with embeddings).
+//
+// Key Steps:
+// ========================
+//
+// 1. List the concepts with embeddings; compute their norms in
+//    parallel. Copy the queries into zero-padded stride-wide rows.
+//
+// 2. Many queries: parallel over query blocks, each sweeping all rows.
+//    Few: parallel over row tiles with private heaps, merged at the end.
+//
+// 3. Sort each heap nearest first.
+
+uint32_t knn_exact(const ConceptVectorStore* vectors, DistanceMetric metric, const float* queries, size_t stride,
+                   uint32_t query_count, uint32_t k, Scheduler* scheduler, Neighbor* out, uint32_t* counts) {
+    if (!vectors || !queries || !out || !counts || k == 0 || query_count == 0) return 0;
+
+    uint32_t dimensions = vectors->dimensions;
+    uint32_t row_count = vectors->n_concepts;
+    uint32_t* rows = knn_alloc(row_count * sizeof(uint32_t), "k-NN rows");
+    uint32_t listed = 0;
+    for (uint32_t word = 0; word < (vectors->capacity + 63) / 64 && listed < row_count; word++) {
+        uint64_t bits = vectors->present[word];
+        while (bits) {
+            rows[listed++] = word * 64 + (uint32_t)__builtin_ctzll(bits);
+            bits &= bits - 1;
+        }
+    }
+
+    uint32_t padded_count = (query_count + 3) / 4 * 4;
+    float* padded = calloc((size_t)padded_count * vectors->stride, sizeof(float));
+    float* query_squares = knn_alloc(query_count * sizeof(float), "k-NN query norms");
+    float* query_norms = knn_alloc(query_count * sizeof(float), "k-NN query norms");
+    if (!padded) {
+        fprintf(stderr, "Failed to allocate memory for k-NN queries.\n");
+        exit(1);
+    }
+    for (uint32_t q = 0; q < query_count; q++) {
+        memcpy(padded + (size_t)q * vectors->stride, queries + q * stride, dimensions * sizeof(float));
+        query_squares[q] = dot_f32(queries + q * stride, queries + q * stride, dimensions);
+        query_norms[q] = vector_norm(queries + q * stride, dimensions);
+    }
+
+    KnnSearch search = {
+        vectors, metric, k,
+        padded, query_squares, query_norms, query_count,
+        rows, knn_alloc(row_count * sizeof(float), "k-NN row norms"),
+        knn_alloc(row_count * sizeof(float), "k-NN row norms"), row_count,
+        out, counts,
+        PTHREAD_MUTEX_INITIALIZER,
+    };
+    memset(counts, 0, query_count * sizeof(uint32_t));
+    parallel_for(scheduler, 0, row_count, 1024, norm_range, &search);
+
+    if (query_count < KNN_FEW_QUERIES) {
+        parallel_for(scheduler, 0, (row_count + KNN_ROW_TILE - 1) / KNN_ROW_TILE, 1, row_range, &search);
+    } else {
+        parallel_for(scheduler, 0, padded_count / KNN_QUERY_BLOCK, 1, query_range, &search);
+    }
+
+    for (uint32_t q = 0; q < query_count; q++) {
+        neighbors_sort(out + (size_t)q * k, counts[q]);
+    }
+
+    pthread_mutex_destroy(&search.merge_lock);
+    free((float*)search.row_norms);
+    free((float*)search.row_squares);
+    free(query_norms);
+    free(query_squares);
+    free(padded);
+    free(rows);
+    return k < row_count ? k : row_count;
+}
+
+// ---
+// Recall
+// ---
+
+// float knn_recall(const Neighbor* exact, const uint32_t* exact_counts, const Neighbor* approximate,
+//                  const uint32_t* approximate_counts, uint32_t query_count, uint32_t k);
+//
+// recall@k: the fraction of the exact top k (per query, min(k, found))
+// that the approximate top k also returned, matched by concept. Both
+// result sets are laid out as knn_exact() writes them (k per query).
+
+float knn_recall(const Neighbor* exact, const uint32_t* exact_counts, const Neighbor* approximate,
+                 const uint32_t* approximate_counts, uint32_t query_count, uint32_t k) {
+    if (!exact || !exact_counts || !approximate || !approximate_counts) return 0.0f;
+
+    uint64_t hits = 0;
+    uint64_t wanted = 0;
+    for (uint32_t q = 0; q < query_count; q++) {
+        const Neighbor* truth = exact + (size_t)q * k;
+        const Neighbor* found = approximate + (size_t)q * k;
+        uint32_t truth_count = exact_counts[q] < k ? exact_counts[q] : k;
+        uint32_t found_count = approximate_counts[q] < k ? approximate_counts[q] : k;
+
+        wanted += truth_count;
+        for (uint32_t i = 0; i < found_count; i++) {
+            for (uint32_t j = 0; j < truth_count; j++) {
+                if (found[i].concept == truth[j].concept) {
+                    hits++;
+                    break;
+                }
+            }
+        }
+    }
+    return wanted ? (float)((double)hits / (double)wanted) : 1.0f;
+}
+
+typedef struct HnswBatch {
+    HnswIndex* index;
+    const float* queries;
+    size_t stride;
+    uint32_t k;
+    uint32_t ef;
+    Neighbor* out;
+    uint32_t* counts;
+} HnswBatch;
+
+static void hnsw_range(void* context, uint32_t begin, uint32_t end) {
+    HnswBatch* batch = context;
+    for (uint32_t q = begin; q < end; q++) {
+        batch->counts[q] = hnsw_search(batch->index, batch->queries + q * batch->stride, batch->k, batch->ef,
+                                       batch->out + (size_t)q * batch->k);
+    }
+}
+
+// float hnsw_recall(HnswIndex* index, const float* queries, size_t stride, uint32_t query_count,
+//                   uint32_t k, uint32_t ef, Scheduler* scheduler);
+//
+// recall@k of `index` searched with width `ef` (0: its ef_search)
+// against knn_exact() over the same vectors and metric.
+
+float hnsw_recall(HnswIndex* index, const float* queries, size_t stride, uint32_t query_count,
+                  uint32_t k, uint32_t ef, Scheduler* scheduler) {
+    if (!index || !queries || k == 0 || query_count == 0) return 0.0f;
+
+    Neighbor* exact = knn_alloc((size_t)query_count * k * sizeof(Neighbor), "recall results");
+    Neighbor* approximate = knn_alloc((size_t)query_count * k * sizeof(Neighbor), "recall results");
+    uint32_t* exact_counts = knn_alloc(query_count * sizeof(uint32_t), "recall counts");
+    uint32_t* approximate_counts = knn_alloc(query_count * sizeof(uint32_t), "recall counts");
+
+    knn_exact(index->vectors, (DistanceMetric)index->metric, queries, stride, query_count, k, scheduler,
+              exact, exact_counts);
+    HnswBatch batch = { index, queries, stride, k, ef, approximate, approximate_counts };
+    parallel_for(scheduler, 0, query_count, 4, hnsw_range, &batch);
+
+    float recall = knn_recall(exact, exact_counts, approximate, approximate_counts, query_count, k);
+    free(approximate_counts);
+    free(exact_counts);
+    free(approximate);
+    free(exact);
+    return recall;
+}
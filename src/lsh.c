@@ -0,0 +1,440 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "lsh.h"
+#include "cpu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if CLARITY_X86
+#include <immintrin.h>
+#endif
+
+#define LSH_CHUNK 256
+
+typedef struct LshKernels {
+    const char* name;
+    // Hamming distance of `query` to each of `count` signatures.
+    void (*hamming)(const uint64_t* query, const uint64_t* signatures, uint32_t count, uint32_t* out);
+} LshKernels;
+
+static void* lsh_alloc(size_t size, const char* what) {
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) {
+        fprintf(stderr, "Failed to allocate memory for %s.\n", what);
+        exit(1);
+    }
+    return ptr;
+}
+
+// ---
+// Hamming kernels
+// ---
+
+static void hamming_scalar(const uint64_t* query, const uint64_t* signatures, uint32_t count, uint32_t* out) {
+    for (uint32_t i = 0; i < count; i++) {
+        const uint64_t* signature = signatures + (size_t)i * LSH_SIGNATURE_WORDS;
+        out[i] = (uint32_t)(__builtin_popcountll(query[0] ^ signature[0]) +
+                            __builtin_popcountll(query[1] ^ signature[1]));
+    }
+}
+
+#if CLARITY_X86
+
+// Byte popcount by nibble lookup (pshufb), then vpsadbw sums the bytes
+// of every 64-bit lane. Two lanes make one 128-bit signature.
+
+__attribute__((target("avx2")))
+static void hamming_avx2(const uint64_t* query, const uint64_t* signatures, uint32_t count, uint32_t* out) {
+    const __m256i nibbles = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                             0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    const __m256i key = _mm256_setr_epi64x((long long)query[0], (long long)query[1],
+                                           (long long)query[0], (long long)query[1]);
+    uint32_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m256i bits = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(signatures + (size_t)i * 2)), key);
+        __m256i low = _mm256_and_si256(bits, low_mask);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(bits, 4), low_mask);
+        __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(nibbles, low), _mm256_shuffle_epi8(nibbles, high));
+        __m256i lanes = _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+        uint64_t sums[4];
+        _mm256_storeu_si256((__m256i*)sums, lanes);
+        out[i] = (uint32_t)(sums[0] + sums[1]);
+        out[i + 1] = (uint32_t)(sums[2] + sums[3]);
+    }
+    hamming_scalar(query, signatures + (size_t)i * 2, count - i, out + i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void hamming_avx512(const uint64_t* query, const uint64_t* signatures, uint32_t count, uint32_t* out) {
+    const __m512i nibbles = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+    const __m512i low_mask = _mm512_set1_epi8(0x0f);
+    const __m512i key = _mm512_broadcast_i32x4(_mm_set_epi64x((long long)query[1], (long long)query[0]));
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m512i bits = _mm512_xor_si512(_mm512_loadu_si512((const void*)(signatures + (size_t)i * 2)), key);
+        __m512i low = _mm512_and_si512(bits, low_mask);
+        __m512i high = _mm512_and_si512(_mm512_srli_epi16(bits, 4), low_mask);
+        __m512i bytes = _mm512_add_epi8(_mm512_shuffle_epi8(nibbles, low), _mm512_shuffle_epi8(nibbles, high));
+        __m512i lanes = _mm512_sad_epu8(bytes, _mm512_setzero_si512());
+        uint64_t sums[8];
+        _mm512_storeu_si512((void*)sums, lanes);
+        for (uint32_t j = 0; j < 4; j++) {
+            out[i + j] = (uint32_t)(sums[2 * j] + sums[2 * j + 1]);
+        }
+    }
+    hamming_scalar(query, signatures + (size_t)i * 2, count - i, out + i);
+}
+
+#endif
+
+static const LshKernels lsh_kernels_table[] = {
+    { "scalar", hamming_scalar },
+#if CLARITY_X86
+    { "scalar", hamming_scalar },
+    { "avx2",   hamming_avx2 },
+    { "avx512", hamming_avx512 },
+#endif
+};
+
+static const LshKernels* lsh_kernels(void) {
+#if CLARITY_X86
+    return &lsh_kernels_table[cpu_level()];
+#else
+    return &lsh_kernels_table[0];
+#endif
+}
+
+const char* lsh_kernel_name(void) {
+    return lsh_kernels()->name;
+}
+
+// ---
+// Hashing
+// ---
+
+static uint32_t plane_count(const LshIndex* index) {
+    return index->tables * index->bits + LSH_SIGNATURE_BITS;
+}
+
+static void project(const LshIndex* index, const float* vector, float* projections) {
+    uint32_t planes = plane_count(index);
+    for (uint32_t p = 0; p < planes; p++) {
+        projections[p] = dot_f32(index->planes + (size_t)p * index->dimensions, vector, index->dimensions);
+    }
+}
+
+static uint32_t table_key(const LshIndex* index, const float* projections, uint32_t table) {
+    const float* own = projections + table * index->bits;
+    uint32_t key = 0;
+    for (uint32_t b = 0; b < index->bits; b++) {
+        key |= (uint32_t)(own[b] > 0.0f) << b;
+    }
+    return key;
+}
+
+static void signature_of(const LshIndex* index, const float* projections, uint64_t* signature) {
+    const float* own = projections + index->tables * index->bits;
+    for (uint32_t w = 0; w < LSH_SIGNATURE_WORDS; w++) {
+        uint64_t word = 0;
+        for (uint32_t b = 0; b < 64; b++) {
+            word |= (uint64_t)(own[w * 64 + b] > 0.0f) << b;
+        }
+        signature[w] = word;
+    }
+}
+
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// void init_lsh(LshIndex* index, uint32_t dimensions, uint32_t tables, uint32_t bits, uint64_t seed);
+//
+// Draw the hyperplanes (0 tables / bits: the defaults; bits is capped at
+// LSH_MAX_BITS). Plane components are approximately normal (sum of 12
+// uniforms), which makes plane directions uniform on the sphere. The
+// same seed gives the same index.
+
+void init_lsh(LshIndex* index, uint32_t dimensions, uint32_t tables, uint32_t bits, uint64_t seed) {
+    if (!index) return;
+
+    memset(index, 0, sizeof(LshIndex));
+    index->dimensions = dimensions;
+    index->tables = tables ? tables : LSH_DEFAULT_TABLES;
+    index->bits = bits ? bits : LSH_DEFAULT_BITS;
+    if (index->bits > LSH_MAX_BITS) index->bits = LSH_MAX_BITS;
+
+    uint64_t state = seed ? seed : 0x9E3779B97F4A7C15ull;
+    size_t values = (size_t)plane_count(index) * dimensions;
+    index->planes = lsh_alloc(values * sizeof(float), "LSH planes");
+    for (size_t i = 0; i < values; i++) {
+        float sum = 0.0f;
+        for (int j = 0; j < 12; j++) {
+            sum += (float)(next_random(&state) >> 40) / (float)(1 << 24);
+        }
+        index->planes[i] = sum - 6.0f;
+    }
+
+    size_t buckets = (size_t)index->tables * (((size_t)1 << index->bits) + 1);
+    index->offsets = calloc(buckets, sizeof(uint32_t));
+    if (!index->offsets) {
+        fprintf(stderr, "Failed to allocate memory for LSH buckets.\n");
+        exit(1);
+    }
+}
+
+void free_lsh(LshIndex* index) {
+    if (!index) return;
+
+    free(index->planes);
+    free(index->offsets);
+    free(index->ids);
+    free(index->signatures);
+    memset(index, 0, sizeof(LshIndex));
+}
+
+typedef struct LshBuild {
+    const LshIndex* index;
+    const ConceptVectorStore* vectors;
+    const uint32_t* concepts;
+    uint32_t* keys;             // count × tables
+    uint64_t* signatures;       // count × LSH_SIGNATURE_WORDS
+} LshBuild;
+
+static void hash_range(void* context, uint32_t begin, uint32_t end) {
+    LshBuild* build = context;
+    const LshIndex* index = build->index;
+    float* projections = lsh_alloc(plane_count(index) * sizeof(float), "LSH projections");
+
+    for (uint32_t i = begin; i < end; i++) {
+        project(index, vector_of(build->vectors, build->concepts[i]), projections);
+        for (uint32_t t = 0; t < index->tables; t++) {
+            build->keys[(size_t)i * index->tables + t] = table_key(index, projections, t);
+        }
+        signature_of(index, projections, build->signatures + (size_t)i * LSH_SIGNATURE_WORDS);
+    }
+    free(projections);
+}
+
+// void lsh_build(LshIndex* index, const ConceptVectorStore* vectors, Scheduler* scheduler);
+//
+// Goal:
+// ======
+// (Re)build the bucket arrays from every embedding of `vectors`.
+//
+// Key Steps:
+// ========================
+//
+// 1. Hash every concept in parallel: one key per table plus the
+//    signature, all from a single pass of plane projections.
+//
+// 2. Per table, counting-sort the concepts by key: count, prefix-sum
+//    into offsets, scatter ids and signatures. Buckets keep concept
+//    order, so the layout is deterministic.
+
+void lsh_build(LshIndex* index, const ConceptVectorStore* vectors, Scheduler* scheduler) {
+    if (!index || !vectors || vectors->dimensions != index->dimensions) return;
+
+    uint32_t count = vectors->n_concepts;
+    uint32_t* concepts = lsh_alloc(count * sizeof(uint32_t), "LSH concepts");
+    uint32_t found = 0;
+    for (uint32_t word = 0; word < (vectors->capacity + 63) / 64 && found < count; word++) {
+        uint64_t bits = vectors->present[word];
+        while (bits) {
+            concepts[found++] = word * 64 + (uint32_t)__builtin_ctzll(bits);
+            bits &= bits - 1;
+        }
+    }
+
+    LshBuild build = {
+        index, vectors, concepts,
+        lsh_alloc((size_t)count * index->tables * sizeof(uint32_t), "LSH keys"),
+        lsh_alloc((size_t)count * LSH_SIGNATURE_WORDS * sizeof(uint64_t), "LSH signatures"),
+    };
+    parallel_for(scheduler, 0, count, 64, hash_range, &build);
+
+    free(index->ids);
+    free(index->signatures);
+    index->ids = lsh_alloc((size_t)count * index->tables * sizeof(uint32_t), "LSH bucket ids");
+    index->signatures = lsh_alloc((size_t)count * index->tables * LSH_SIGNATURE_WORDS * sizeof(uint64_t),
+                                  "LSH bucket signatures");
+    index->count = count;
+    index->concept_span = count ? concepts[count - 1] + 1 : 0;
+
+    uint32_t buckets = 1u << index->bits;
+    for (uint32_t t = 0; t < index->tables; t++) {
+        uint32_t* offsets = index->offsets + (size_t)t * (buckets + 1);
+        uint32_t* ids = index->ids + (size_t)t * count;
+        uint64_t* signatures = index->signatures + (size_t)t * count * LSH_SIGNATURE_WORDS;
+
+        memset(offsets, 0, (buckets + 1) * sizeof(uint32_t));
+        for (uint32_t i = 0; i < count; i++) {
+            offsets[build.keys[(size_t)i * index->tables + t] + 1]++;
+        }
+        for (uint32_t b = 0; b < buckets; b++) {
+            offsets[b + 1] += offsets[b];
+        }
+
+        // Scatter with offsets[key] as the cursor, then shift back.
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t slot = offsets[build.keys[(size_t)i * index->tables + t]]++;
+            ids[slot] = concepts[i];
+            memcpy(signatures + (size_t)slot * LSH_SIGNATURE_WORDS,
+                   build.signatures + (size_t)i * LSH_SIGNATURE_WORDS, LSH_SIGNATURE_WORDS * sizeof(uint64_t));
+        }
+        memmove(offsets + 1, offsets, buckets * sizeof(uint32_t));
+        offsets[0] = 0;
+    }
+
+    free(build.signatures);
+    free(build.keys);
+    free(concepts);
+}
+
+// ---
+// Lookup
+// ---
+
+void init_lsh_workspace(LshWorkspace* workspace) {
+    if (!workspace) return;
+    memset(workspace, 0, sizeof(LshWorkspace));
+}
+
+void free_lsh_workspace(LshWorkspace* workspace) {
+    if (!workspace) return;
+
+    free(workspace->stamps);
+    free(workspace->found);
+    free(workspace->projections);
+    memset(workspace, 0, sizeof(LshWorkspace));
+}
+
+static void prepare_workspace(const LshIndex* index, LshWorkspace* workspace) {
+    if (workspace->capacity < index->concept_span) {
+        free(workspace->stamps);
+        workspace->stamps = calloc(index->concept_span, sizeof(uint32_t));
+        if (!workspace->stamps) {
+            fprintf(stderr, "Failed to allocate memory for LSH workspace.\n");
+            exit(1);
+        }
+        workspace->capacity = index->concept_span;
+        workspace->tag = 0;
+    }
+    if (++workspace->tag == 0) {
+        memset(workspace->stamps, 0, workspace->capacity * sizeof(uint32_t));
+        workspace->tag = 1;
+    }
+    if (workspace->projection_capacity < plane_count(index)) {
+        free(workspace->projections);
+        workspace->projection_capacity = plane_count(index);
+        workspace->projections = lsh_alloc(workspace->projection_capacity * sizeof(float), "LSH projections");
+    }
+    workspace->found_count = 0;
+}
+
+static void scan_bucket(const LshIndex* index, LshWorkspace* workspace, uint32_t table, uint32_t key,
+                        const uint64_t* query, uint32_t max_hamming) {
+    const uint32_t* offsets = index->offsets + (size_t)table * ((1u << index->bits) + 1);
+    const uint32_t* ids = index->ids + (size_t)table * index->count;
+    const uint64_t* signatures = index->signatures + (size_t)table * index->count * LSH_SIGNATURE_WORDS;
+    const LshKernels* kernels = lsh_kernels();
+    uint32_t distances[LSH_CHUNK];
+
+    for (uint32_t begin = offsets[key]; begin < offsets[key + 1]; begin += LSH_CHUNK) {
+        uint32_t count = offsets[key + 1] - begin < LSH_CHUNK ? offsets[key + 1] - begin : LSH_CHUNK;
+        kernels->hamming(query, signatures + (size_t)begin * LSH_SIGNATURE_WORDS, count, distances);
+
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t concept = ids[begin + i];
+            if (distances[i] > max_hamming || workspace->stamps[concept] == workspace->tag) continue;
+            workspace->stamps[concept] = workspace->tag;
+
+            if (workspace->found_count == workspace->found_capacity) {
+                workspace->found_capacity = workspace->found_capacity ? workspace->found_capacity * 2 : 256;
+                workspace->found = realloc(workspace->found, workspace->found_capacity * sizeof(Neighbor));
+                if (!workspace->found) {
+                    fprintf(stderr, "Failed to allocate memory for LSH candidates.\n");
+                    exit(1);
+                }
+            }
+            workspace->found[workspace->found_count].concept = concept;
+            workspace->found[workspace->found_count].distance = (float)distances[i];
+            workspace->found_count++;
+        }
+    }
+}
+
+// uint32_t lsh_query(const LshIndex* index, LshWorkspace* workspace, const float* query, uint32_t max_hamming,
+//                    int probe_neighbors, uint32_t limit, Neighbor* out);
+//
+// Goal:
+// ======
+// Candidate concepts for `query`: every concept sharing a bucket with it
+// in any table whose signature is within `max_hamming` bits (of
+// LSH_SIGNATURE_BITS) of the query's. Writes up to `limit` of them to
+// `out`, fewest differing bits first (the distance field holds the bit
+// count), and returns how many.
+//
+// Key Steps:
+// ========================
+//
+// 1. Project the query once; derive its L keys and signature.
+// 2. Scan its bucket in every table; with `probe_neighbors`, also the
+//    B buckets one bit away (multi-probe: more recall, fewer tables).
+// 3. Stamps dedup concepts found in several tables; a counting sort on
+//    the bit count (0..128) orders the result without comparisons.
+
+uint32_t lsh_query(const LshIndex* index, LshWorkspace* workspace, const float* query, uint32_t max_hamming,
+                   int probe_neighbors, uint32_t limit, Neighbor* out) {
+    if (!index || !workspace || !query || !out || limit == 0 || index->count == 0) return 0;
+
+    prepare_workspace(index, workspace);
+    project(index, query, workspace->projections);
+
+    uint64_t signature[LSH_SIGNATURE_WORDS];
+    signature_of(index, workspace->projections, signature);
+    for (uint32_t t = 0; t < index->tables; t++) {
+        uint32_t key = table_key(index, workspace->projections, t);
+        scan_bucket(index, workspace, t, key, signature, max_hamming);
+        for (uint32_t b = 0; probe_neighbors && b < index->bits; b++) {
+            scan_bucket(index, workspace, t, key ^ (1u << b), signature, max_hamming);
+        }
+    }
+
+    uint32_t histogram[LSH_SIGNATURE_BITS + 2] = { 0 };
+    for (uint32_t i = 0; i < workspace->found_count; i++) {
+        histogram[(uint32_t)workspace->found[i].distance + 1]++;
+    }
+    for (uint32_t d = 0; d <= LSH_SIGNATURE_BITS; d++) {
+        histogram[d + 1] += histogram[d];
+    }
+    for (uint32_t i = 0; i < workspace->found_count; i++) {
+        uint32_t slot = histogram[(uint32_t)workspace->found[i].distance]++;
+        if (slot < limit) out[slot] = workspace->found[i];
+    }
+    return workspace->found_count < limit ? workspace->found_count : limit;
+}
+
+// void lsh_query_batch(const LshIndex* index, LshWorkspace* workspace, const float* tokens, size_t stride,
+//                      uint32_t token_count, uint32_t max_hamming, int probe_neighbors, uint32_t limit,
+//                      Neighbor* out, uint32_t* counts);
+//
+// lsh_query() for a whole token sequence (`token_count` embeddings,
+// `stride` floats apart): token t's candidates go to out[t · limit ..]
+// and their number to counts[t]. The planes and bucket offsets stay in
+// cache across the sequence and the workspace is reused throughout.
+
+void lsh_query_batch(const LshIndex* index, LshWorkspace* workspace, const float* tokens, size_t stride,
+                     uint32_t token_count, uint32_t max_hamming, int probe_neighbors, uint32_t limit,
+                     Neighbor* out, uint32_t* counts) {
+    if (!tokens || !out || !counts) return;
+
+    for (uint32_t t = 0; t < token_count; t++) {
+        counts[t] = lsh_query(index, workspace, tokens + t * stride, max_hamming, probe_neighbors, limit,
+                              out + (size_t)t * limit);
+    }
+}
@@ -1,5 +1,7 @@
 // SPDX-License-Identifier: CAL-1.0
 
+#include "concept.h"
+
 int main() {
     Concept* john = create_concept("john", "Person");
     Concept* book = create_concept("book", "Object");
@@ -7,5 +9,8 @@ int main() {
     add_slot(john, "owns", book);
     print_concept(john);
 
+    free_concept(john);
+    free_concept(book);
+
     return 0;
 }
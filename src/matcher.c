@@ -0,0 +1,486 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "matcher.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Past this many edges a state's labels are binary searched.
+#define MATCHER_LINEAR_EDGES 8
+
+typedef struct PatternKey {
+    const uint8_t* text;
+    uint32_t length;
+    uint32_t pattern;
+} PatternKey;
+
+static void* matcher_alloc(size_t size, const char* what) {
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) {
+        fprintf(stderr, "Failed to allocate memory for %s.\n", what);
+        exit(1);
+    }
+    return ptr;
+}
+
+static void* matcher_grow(void* ptr, size_t size, const char* what) {
+    void* grown = realloc(ptr, size ? size : 1);
+    if (!grown) {
+        fprintf(stderr, "Failed to allocate memory for %s.\n", what);
+        exit(1);
+    }
+    return grown;
+}
+
+static inline uint8_t fold_byte(uint8_t byte) {
+    return (byte >= 'A' && byte <= 'Z') ? (uint8_t)(byte + ('a' - 'A')) : byte;
+}
+
+static inline int is_word_byte(uint8_t byte) {
+    return (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z') || (byte >= '0' && byte <= '9') ||
+           byte == '_' || byte >= 0x80;
+}
+
+static void free_automaton(Automaton* automaton) {
+    free(automaton->first_edge);
+    free(automaton->labels);
+    free(automaton->targets);
+    free(automaton->fail);
+    free(automaton->dict);
+    free(automaton->output);
+    memset(automaton, 0, sizeof(Automaton));
+}
+
+void init_entity_matcher(EntityMatcher* matcher, uint32_t flags) {
+    if (!matcher) return;
+    memset(matcher, 0, sizeof(EntityMatcher));
+    matcher->flags = flags;
+}
+
+void free_entity_matcher(EntityMatcher* matcher) {
+    if (!matcher) return;
+    free(matcher->pool);
+    free(matcher->patterns);
+    free(matcher->pattern_next);
+    for (uint32_t level = 0; level < matcher->level_count; level++) free_automaton(&matcher->levels[level].automaton);
+    memset(matcher, 0, sizeof(EntityMatcher));
+}
+
+// ---
+// Patterns
+// ---
+
+// uint32_t matcher_add(EntityMatcher* matcher, const char* text, uint32_t concept);
+//
+// Register `text` as a surface form of `concept` and return its pattern
+// id (MATCHER_NONE for an empty string). The text is kept as given, so
+// other indexes can read the surface form back (trie.h); a
+// folding matcher folds it when compiling. Not matched until the next
+// matcher_compile().
+
+uint32_t matcher_add(EntityMatcher* matcher, const char* text, uint32_t concept) {
+    if (!matcher || !text || !text[0]) return MATCHER_NONE;
+
+    uint32_t length = (uint32_t)strlen(text);
+    if (matcher->pool_size + length + 1 > matcher->pool_capacity) {
+        uint32_t capacity = matcher->pool_capacity ? matcher->pool_capacity : 1024;
+        while (capacity < matcher->pool_size + length + 1) capacity *= 2;
+        matcher->pool = matcher_grow(matcher->pool, capacity, "matcher pool");
+        matcher->pool_capacity = capacity;
+    }
+    if (matcher->pattern_count == matcher->pattern_capacity) {
+        uint32_t capacity = matcher->pattern_capacity ? matcher->pattern_capacity * 2 : 64;
+        matcher->patterns = matcher_grow(matcher->patterns, capacity * sizeof(MatchPattern), "matcher patterns");
+        matcher->pattern_next = matcher_grow(matcher->pattern_next, capacity * sizeof(uint32_t), "matcher patterns");
+        matcher->pattern_capacity = capacity;
+    }
+
+    memcpy(matcher->pool + matcher->pool_size, text, length + 1);
+
+    uint32_t pattern = matcher->pattern_count++;
+    matcher->patterns[pattern] = (MatchPattern){ matcher->pool_size, length, concept };
+    matcher->pattern_next[pattern] = MATCHER_NONE;
+    matcher->pool_size += length + 1;
+    return pattern;
+}
+
+// uint32_t matcher_sync_store(EntityMatcher* matcher, const ConceptStore* store);
+//
+// Add the ID of every concept created in `store` since the last sync as
+// a pattern of that concept; returns how many were added. Reserved
+// concepts (shard proxies, store.h) are not entities and are skipped.
+
+uint32_t matcher_sync_store(EntityMatcher* matcher, const ConceptStore* store) {
+    if (!matcher || !store) return 0;
+
+    uint32_t added = 0;
+    for (uint32_t concept = matcher->store_synced; concept < store->concept_count; concept++) {
+        if (store_is_reserved(store, concept)) continue;
+        const char* id = store_concept_id(store, concept);
+        if (id && matcher_add(matcher, id, concept) != MATCHER_NONE) added++;
+    }
+    matcher->store_synced = store->concept_count;
+    return added;
+}
+
+// ---
+// Construction
+// ---
+
+static int compare_keys(const void* a, const void* b) {
+    const PatternKey* x = a;
+    const PatternKey* y = b;
+    uint32_t shorter = x->length < y->length ? x->length : y->length;
+    int order = memcmp(x->text, y->text, shorter);
+    if (order) return order;
+    if (x->length != y->length) return x->length < y->length ? -1 : 1;
+    return x->pattern < y->pattern ? -1 : (x->pattern > y->pattern);
+}
+
+static uint32_t automaton_goto(const Automaton* automaton, uint32_t state, uint8_t byte) {
+    uint32_t low = automaton->first_edge[state];
+    uint32_t high = automaton->first_edge[state + 1];
+    const uint8_t* labels = automaton->labels;
+
+    if (high - low <= MATCHER_LINEAR_EDGES) {
+        for (uint32_t e = low; e < high; e++) {
+            if (labels[e] == byte) return automaton->targets[e];
+            if (labels[e] > byte) break;
+        }
+        return MATCHER_NONE;
+    }
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (labels[middle] < byte) low = middle + 1;
+        else high = middle;
+    }
+    return (low < automaton->first_edge[state + 1] && labels[low] == byte) ? automaton->targets[low] : MATCHER_NONE;
+}
+
+static inline uint32_t automaton_step(const Automaton* automaton, uint32_t state, uint8_t byte) {
+    while (state != 0) {
+        uint32_t next = automaton_goto(automaton, state, byte);
+        if (next != MATCHER_NONE) return next;
+        state = automaton->fail[state];
+    }
+    return automaton->root_next[byte];
+}
+
+// static void build_automaton(EntityMatcher* matcher, Automaton* automaton, uint32_t begin, uint32_t end);
+//
+// Goal:
+// ======
+// Compile patterns [begin, end) of `matcher` into `automaton`.
+//
+// Key Steps:
+// ========================
+//
+// 1. Sort the pattern strings. Consecutive keys share their longest
+//    common prefix, so the trie is built with a path stack and no
+//    lookups: only the suffix past the LCP creates nodes. Children are
+//    created in label order.
+// 2. Counting-sort the edges by parent into CSR, then renumber the
+//    states breadth-first.
+// 3. In BFS order every state's fail target is already final, so fail
+//    and dict links are filled in one forward pass.
+
+static void build_automaton(EntityMatcher* matcher, Automaton* automaton, uint32_t begin, uint32_t end) {
+    free_automaton(automaton);
+    uint32_t count = end - begin;
+    if (count == 0) return;
+
+    PatternKey* keys = matcher_alloc(count * sizeof(PatternKey), "matcher keys");
+    size_t total = 0;
+    for (uint32_t i = 0; i < count; i++) total += matcher->patterns[begin + i].length;
+
+    // The pool keeps patterns as added; a folding matcher keys on a
+    // folded copy.
+    uint8_t* folded = (matcher->flags & MATCHER_FOLD_CASE) ? matcher_alloc(total, "matcher keys") : NULL;
+    size_t folded_size = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const MatchPattern* pattern = &matcher->patterns[begin + i];
+        const uint8_t* text = (const uint8_t*)matcher->pool + pattern->offset;
+        if (folded) {
+            for (uint32_t j = 0; j < pattern->length; j++) folded[folded_size + j] = fold_byte(text[j]);
+            text = folded + folded_size;
+            folded_size += pattern->length;
+        }
+        keys[i] = (PatternKey){ text, pattern->length, begin + i };
+    }
+    qsort(keys, count, sizeof(PatternKey), compare_keys);
+
+    // Trie in creation (DFS) order.
+    uint32_t max_nodes = (uint32_t)total + 1;
+    uint32_t* parent = matcher_alloc(max_nodes * sizeof(uint32_t), "matcher trie");
+    uint8_t* label = matcher_alloc(max_nodes, "matcher trie");
+    uint32_t* output = matcher_alloc(max_nodes * sizeof(uint32_t), "matcher trie");
+    uint32_t* path = matcher_alloc(max_nodes * sizeof(uint32_t), "matcher trie");
+    uint32_t nodes = 1;
+    output[0] = MATCHER_NONE;
+    path[0] = 0;
+
+    const PatternKey* previous = NULL;
+    for (uint32_t i = 0; i < count; i++) {
+        const PatternKey* key = &keys[i];
+        uint32_t shared = 0;
+        if (previous) {
+            uint32_t limit = previous->length < key->length ? previous->length : key->length;
+            while (shared < limit && previous->text[shared] == key->text[shared]) shared++;
+        }
+        for (uint32_t d = shared; d < key->length; d++) {
+            parent[nodes] = path[d];
+            label[nodes] = key->text[d];
+            output[nodes] = MATCHER_NONE;
+            path[d + 1] = nodes++;
+        }
+        // Equal strings end at the same node; keep them chained in id order.
+        uint32_t node = path[key->length];
+        if (output[node] == MATCHER_NONE) {
+            output[node] = key->pattern;
+        } else {
+            uint32_t last = output[node];
+            while (matcher->pattern_next[last] != MATCHER_NONE) last = matcher->pattern_next[last];
+            matcher->pattern_next[last] = key->pattern;
+        }
+        matcher->pattern_next[key->pattern] = MATCHER_NONE;
+        previous = key;
+    }
+
+    // Edges grouped by parent, in creation order (= label order).
+    uint32_t* child_start = calloc(nodes + 1, sizeof(uint32_t));
+    uint32_t* children = matcher_alloc(nodes * sizeof(uint32_t), "matcher trie");
+    if (!child_start) {
+        fprintf(stderr, "Failed to allocate memory for matcher trie.\n");
+        exit(1);
+    }
+    for (uint32_t v = 1; v < nodes; v++) child_start[parent[v] + 1]++;
+    for (uint32_t v = 0; v < nodes; v++) child_start[v + 1] += child_start[v];
+    for (uint32_t v = 1; v < nodes; v++) children[child_start[parent[v]]++] = v;
+    for (uint32_t v = nodes; v > 0; v--) child_start[v] = child_start[v - 1];
+    child_start[0] = 0;
+
+    // Breadth-first renumbering: order[new] = old.
+    uint32_t* order = path;
+    uint32_t* renumber = parent;
+    uint32_t head = 0, tail = 0;
+    order[tail++] = 0;
+    while (head < tail) {
+        uint32_t old = order[head++];
+        for (uint32_t e = child_start[old]; e < child_start[old + 1]; e++) order[tail++] = children[e];
+    }
+    for (uint32_t state = 0; state < nodes; state++) renumber[order[state]] = state;
+
+    automaton->state_count = nodes;
+    automaton->first_edge = matcher_alloc((nodes + 1) * sizeof(uint32_t), "matcher automaton");
+    automaton->labels = matcher_alloc(nodes, "matcher automaton");
+    automaton->targets = matcher_alloc(nodes * sizeof(uint32_t), "matcher automaton");
+    automaton->fail = matcher_alloc(nodes * sizeof(uint32_t), "matcher automaton");
+    automaton->dict = matcher_alloc(nodes * sizeof(uint32_t), "matcher automaton");
+    automaton->output = matcher_alloc(nodes * sizeof(uint32_t), "matcher automaton");
+
+    uint32_t edge = 0;
+    for (uint32_t state = 0; state < nodes; state++) {
+        uint32_t old = order[state];
+        automaton->first_edge[state] = edge;
+        automaton->output[state] = output[old];
+        for (uint32_t e = child_start[old]; e < child_start[old + 1]; e++) {
+            automaton->labels[edge] = label[children[e]];
+            automaton->targets[edge++] = renumber[children[e]];
+        }
+    }
+    automaton->first_edge[nodes] = edge;
+
+    for (uint32_t byte = 0; byte < 256; byte++) {
+        uint32_t next = automaton_goto(automaton, 0, (uint8_t)byte);
+        automaton->root_next[byte] = next == MATCHER_NONE ? 0 : next;
+    }
+
+    automaton->fail[0] = 0;
+    automaton->dict[0] = MATCHER_NONE;
+    for (uint32_t state = 0; state < nodes; state++) {
+        for (uint32_t e = automaton->first_edge[state]; e < automaton->first_edge[state + 1]; e++) {
+            uint32_t child = automaton->targets[e];
+            uint32_t fail = state ? automaton_step(automaton, automaton->fail[state], automaton->labels[e]) : 0;
+            automaton->fail[child] = fail;
+            automaton->dict[child] = automaton->output[fail] != MATCHER_NONE ? fail : automaton->dict[fail];
+        }
+    }
+
+    free(keys);
+    free(folded);
+    free(parent);
+    free(label);
+    free(output);
+    free(path);
+    free(child_start);
+    free(children);
+}
+
+// void matcher_compile(EntityMatcher* matcher);
+//
+// Make every pattern added so far matchable. The patterns added since
+// the last compile become a new level, merged into the previous level
+// while that one holds at most twice as many (see "Incremental rebuild" in
+// matcher.h); only the final merged range is built. Must not run
+// concurrently with scans.
+
+void matcher_compile(EntityMatcher* matcher) {
+    if (!matcher) return;
+    uint32_t count = matcher->level_count;
+    uint32_t begin = count ? matcher->levels[count - 1].end : 0;
+    if (begin == matcher->pattern_count) return;
+
+    while (count > 0) {
+        MatcherLevel* previous = &matcher->levels[count - 1];
+        if (previous->end - previous->begin > 2 * (uint64_t)(matcher->pattern_count - begin)) break;
+        begin = previous->begin;
+        free_automaton(&previous->automaton);
+        count--;
+    }
+
+    MatcherLevel* level = &matcher->levels[count];
+    level->begin = begin;
+    level->end = matcher->pattern_count;
+    build_automaton(matcher, &level->automaton, begin, matcher->pattern_count);
+    matcher->level_count = count + 1;
+}
+
+// ---
+// Scanning
+// ---
+
+typedef struct MentionSink {
+    EntityMention* out;
+    uint32_t capacity;
+    uint32_t found;
+} MentionSink;
+
+static inline void sink_push(MentionSink* sink, uint32_t begin, uint32_t end, uint32_t concept, uint32_t pattern) {
+    if (sink->found < sink->capacity) sink->out[sink->found] = (EntityMention){ begin, end, concept, pattern };
+    sink->found++;
+}
+
+static int compare_mentions(const void* a, const void* b) {
+    const EntityMention* x = a;
+    const EntityMention* y = b;
+    if (x->begin != y->begin) return x->begin < y->begin ? -1 : 1;
+    if (x->end != y->end) return x->end > y->end ? -1 : 1;
+    return x->pattern < y->pattern ? -1 : (x->pattern > y->pattern);
+}
+
+static void scan_text(const EntityMatcher* matcher, const Automaton* automaton, const uint8_t* text,
+                      uint32_t length, MentionSink* sink) {
+    int fold = (matcher->flags & MATCHER_FOLD_CASE) != 0;
+    int whole = (matcher->flags & MATCHER_WHOLE_WORDS) != 0;
+    uint32_t state = 0;
+
+    for (uint32_t i = 0; i < length; i++) {
+        state = automaton_step(automaton, state, fold ? fold_byte(text[i]) : text[i]);
+        if (whole && i + 1 < length && is_word_byte(text[i + 1])) continue;
+
+        uint32_t hit = automaton->output[state] != MATCHER_NONE ? state : automaton->dict[state];
+        while (hit != MATCHER_NONE) {
+            for (uint32_t p = automaton->output[hit]; p != MATCHER_NONE; p = matcher->pattern_next[p]) {
+                const MatchPattern* pattern = &matcher->patterns[p];
+                uint32_t begin = i + 1 - pattern->length;
+                if (whole && begin > 0 && is_word_byte(text[begin - 1])) break;
+                sink_push(sink, begin, i + 1, pattern->concept, p);
+            }
+            hit = automaton->dict[hit];
+        }
+    }
+}
+
+// uint32_t matcher_scan(const EntityMatcher* matcher, const char* text, uint32_t length,
+//                       EntityMention* out, uint32_t capacity);
+//
+// Report every mention of a compiled pattern in `text` (overlapping and
+// nested ones included) as byte ranges, sorted by start, longer spans
+// first. Writes up to `capacity` to `out` and returns the total found,
+// so a caller can retry with a bigger buffer. Read-only: any number of
+// threads may scan one matcher.
+
+uint32_t matcher_scan(const EntityMatcher* matcher, const char* text, uint32_t length,
+                      EntityMention* out, uint32_t capacity) {
+    if (!matcher || !text) return 0;
+
+    MentionSink sink = { out, out ? capacity : 0, 0 };
+    for (uint32_t level = 0; level < matcher->level_count; level++) {
+        scan_text(matcher, &matcher->levels[level].automaton, (const uint8_t*)text, length, &sink);
+    }
+
+    uint32_t written = sink.found < sink.capacity ? sink.found : sink.capacity;
+    if (written > 1) qsort(out, written, sizeof(EntityMention), compare_mentions);
+    return sink.found;
+}
+
+static uint32_t find_token(const uint32_t* offsets, uint32_t token_count, uint32_t offset) {
+    uint32_t low = 0, high = token_count;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (offsets[middle] < offset) low = middle + 1;
+        else high = middle;
+    }
+    return (low < token_count && offsets[low] == offset) ? low : MATCHER_NONE;
+}
+
+static void scan_tokens(const EntityMatcher* matcher, const Automaton* automaton, const char* const* tokens,
+                        uint32_t token_count, const uint32_t* starts, MentionSink* sink) {
+    int fold = (matcher->flags & MATCHER_FOLD_CASE) != 0;
+    uint32_t state = 0;
+    uint32_t position = 0;
+
+    for (uint32_t t = 0; t < token_count; t++) {
+        if (t > 0) {
+            state = automaton_step(automaton, state, ' ');
+            position++;
+        }
+        const uint8_t* token = (const uint8_t*)(tokens[t] ? tokens[t] : "");
+        for (; *token; token++) {
+            state = automaton_step(automaton, state, fold ? fold_byte(*token) : *token);
+            position++;
+        }
+        if (position == starts[t]) continue;
+
+        // Only spans ending here, at a token end, can be token-aligned.
+        uint32_t hit = automaton->output[state] != MATCHER_NONE ? state : automaton->dict[state];
+        while (hit != MATCHER_NONE) {
+            for (uint32_t p = automaton->output[hit]; p != MATCHER_NONE; p = matcher->pattern_next[p]) {
+                uint32_t first = find_token(starts, t + 1, position - matcher->patterns[p].length);
+                if (first != MATCHER_NONE) sink_push(sink, first, t + 1, matcher->patterns[p].concept, p);
+            }
+            hit = automaton->dict[hit];
+        }
+    }
+}
+
+// uint32_t matcher_scan_tokens(const EntityMatcher* matcher, const char* const* tokens, uint32_t token_count,
+//                              EntityMention* out, uint32_t capacity);
+//
+// matcher_scan() over a tokenized turn: the tokens are matched as if
+// joined by single spaces, and only mentions covering whole tokens are
+// reported, with begin / end as token indices. No joined copy is made;
+// bytes are fed to the automaton straight from the tokens.
+
+uint32_t matcher_scan_tokens(const EntityMatcher* matcher, const char* const* tokens, uint32_t token_count,
+                             EntityMention* out, uint32_t capacity) {
+    if (!matcher || !tokens || token_count == 0) return 0;
+
+    uint32_t* starts = matcher_alloc(token_count * sizeof(uint32_t), "token offsets");
+    uint32_t position = 0;
+    for (uint32_t t = 0; t < token_count; t++) {
+        if (t > 0) position++;
+        starts[t] = position;
+        position += tokens[t] ? (uint32_t)strlen(tokens[t]) : 0;
+    }
+
+    MentionSink sink = { out, out ? capacity : 0, 0 };
+    for (uint32_t level = 0; level < matcher->level_count; level++) {
+        scan_tokens(matcher, &matcher->levels[level].automaton, tokens, token_count, starts, &sink);
+    }
+    free(starts);
+
+    uint32_t written = sink.found < sink.capacity ? sink.found : sink.capacity;
+    if (written > 1) qsort(out, written, sizeof(EntityMention), compare_mentions);
+    return sink.found;
+}
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#define _GNU_SOURCE
+#include "numa.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define NUMA_SYSFS "/sys/devices/system/node"
+#define NUMA_MPOL_PREFERRED 1
+#define NUMA_MPOL_MF_MOVE (1 << 1)
+
+// Parse a kernel list ("0-3,8,10-11") and call `visit` for each number
+// in it. Returns -1 if the file cannot be read.
+static int read_list(const char* path, void (*visit)(int value, void* context), void* context) {
+    FILE* file = fopen(path, "r");
+    if (!file) return -1;
+
+    char line[4096];
+    if (!fgets(line, sizeof(line), file)) {
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    char* p = line;
+    while (*p >= '0' && *p <= '9') {
+        long first = strtol(p, &p, 10);
+        long last = first;
+        if (*p == '-') {
+            last = strtol(p + 1, &p, 10);
+        }
+        for (long value = first; value <= last; value++) {
+            visit((int)value, context);
+        }
+        if (*p == ',') p++;
+    }
+    return 0;
+}
+
+static void keep_max(int value, void* context) {
+    int* highest = (int*)context;
+    if (value > *highest) *highest = value;
+}
+
+static void add_cpu(int value, void* context) {
+    if (value < CPU_SETSIZE) CPU_SET(value, (cpu_set_t*)context);
+}
+
+static int node_cpus(int node, cpu_set_t* cpus) {
+    char path[128];
+    snprintf(path, sizeof(path), NUMA_SYSFS "/node%d/cpulist", node);
+    CPU_ZERO(cpus);
+    return read_list(path, add_cpu, cpus);
+}
+
+// int numa_node_count(void);
+//
+// Highest online node + 1, capped at NUMA_MAX_NODES; 1 when /sys has no
+// node directory. Cached after the first call like cpu_level().
+
+int numa_node_count(void) {
+    static int cached = 0;
+    if (cached > 0) return cached;
+
+    int highest = 0;
+    read_list(NUMA_SYSFS "/online", keep_max, &highest);
+    int count = highest + 1;
+    if (count > NUMA_MAX_NODES) count = NUMA_MAX_NODES;
+
+    cached = count;
+    return count;
+}
+
+int numa_node_cpu_count(int node) {
+    cpu_set_t cpus;
+    if (node < 0 || node_cpus(node, &cpus) < 0) return 0;
+    return CPU_COUNT(&cpus);
+}
+
+// Node of the CPU this thread is running on right now (it may migrate
+// right after unless pinned). 0 if the kernel will not say.
+int numa_current_node(void) {
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) return 0;
+    return (int)node;
+}
+
+// int numa_bind(void* memory, size_t length, int node, int move);
+//
+// Goal:
+// ======
+// Prefer `node` for the pages of [memory, memory + length), which must
+// be page aligned (a mapping or whole chunk). With `move`, pages that
+// were already touched migrate too. Returns 0, or -1 if the kernel
+// refused (no NUMA support, bad node); the memory still works then.
+
+int numa_bind(void* memory, size_t length, int node, int move) {
+    if (!memory || !length || node < 0 || node >= NUMA_MAX_NODES) return -1;
+
+    unsigned long mask = 1UL << node;
+    long result = syscall(SYS_mbind, memory, length, NUMA_MPOL_PREFERRED, &mask,
+                          (unsigned long)NUMA_MAX_NODES + 1, move ? NUMA_MPOL_MF_MOVE : 0);
+    return result == 0 ? 0 : -1;
+}
+
+// Restrict the calling thread to the CPUs of `node`. Returns -1 (and
+// leaves the affinity alone) if the node has no CPUs we can see.
+int numa_pin_thread(int node) {
+    cpu_set_t cpus;
+    if (node < 0 || node_cpus(node, &cpus) < 0 || CPU_COUNT(&cpus) == 0) return -1;
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0 ? 0 : -1;
+}
@@ -0,0 +1,472 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "path.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PATH_NONE UINT32_MAX
+
+static void* grow(void* ptr, size_t size, const char* what) {
+    void* new_ptr = realloc(ptr, size);
+    if (!new_ptr) {
+        fprintf(stderr, "Failed to allocate memory for %s.\n", what);
+        exit(1);
+    }
+    return new_ptr;
+}
+
+void init_path_workspace(PathWorkspace* workspace) {
+    if (!workspace) return;
+    memset(workspace, 0, sizeof(PathWorkspace));
+}
+
+void free_path_workspace(PathWorkspace* workspace) {
+    if (!workspace) return;
+
+    for (int s = 0; s < 2; s++) {
+        PathSide* side = &workspace->sides[s];
+        free(side->stamp);
+        free(side->parent);
+        free(side->name);
+        free(side->reversed);
+        free(side->depth);
+        free(side->frontier);
+        free(side->next);
+    }
+    init_path_workspace(workspace);
+}
+
+// Cover `concept_count` concepts and start a new query stamp. Stamps
+// are only cleared when the counter wraps.
+static uint32_t prepare(PathWorkspace* workspace, uint32_t concept_count) {
+    if (concept_count > workspace->capacity) {
+        for (int s = 0; s < 2; s++) {
+            PathSide* side = &workspace->sides[s];
+            side->stamp = grow(side->stamp, concept_count * sizeof(uint32_t), "path stamps");
+            side->parent = grow(side->parent, concept_count * sizeof(uint32_t), "path parents");
+            side->name = grow(side->name, concept_count * sizeof(Symbol), "path names");
+            side->reversed = grow(side->reversed, concept_count, "path directions");
+            side->depth = grow(side->depth, concept_count, "path depths");
+            side->frontier = grow(side->frontier, concept_count * sizeof(uint32_t), "path frontier");
+            side->next = grow(side->next, concept_count * sizeof(uint32_t), "path frontier");
+            memset(side->stamp + workspace->capacity, 0, (concept_count - workspace->capacity) * sizeof(uint32_t));
+        }
+        workspace->capacity = concept_count;
+    }
+
+    if (++workspace->query == 0) {
+        for (int s = 0; s < 2; s++) {
+            memset(workspace->sides[s].stamp, 0, workspace->capacity * sizeof(uint32_t));
+        }
+        workspace->query = 1;
+    }
+    return workspace->query;
+}
+
+// Slots side `s` scans from a concept: the source side goes along
+// slots, the target side against them; undirected does both.
+static uint32_t side_degree(const ConceptStore* store, int s, int directed, uint32_t concept) {
+    if (!directed) return store_degree(store, concept) + store_in_degree(store, concept);
+    return s == 0 ? store_degree(store, concept) : store_in_degree(store, concept);
+}
+
+// Where the two searches touched: `near` was expanded on side `side`
+// and found `far`, already seen by the other side.
+typedef struct PathMeet {
+    int side;
+    uint32_t near;
+    uint32_t far;
+    Symbol name;
+    uint8_t near_to_far;        // the slot is stored near → far
+    uint32_t length;
+} PathMeet;
+
+typedef struct PathSearch {
+    const ConceptStore* store;
+    PathWorkspace* workspace;
+    uint32_t query;
+    int directed;
+    PathMeet meet;
+} PathSearch;
+
+// Visit one slot between `concept` (on side s) and `neighbor`.
+// Side 0 records path steps parent → node, side 1 node → parent; the
+// `reversed` flag is relative to that direction.
+static void visit(PathSearch* search, int s, uint32_t concept, uint32_t neighbor, Symbol name,
+                  uint8_t concept_to_neighbor, uint32_t* next_count, uint64_t* next_cost) {
+    PathSide* side = &search->workspace->sides[s];
+    PathSide* other = &search->workspace->sides[1 - s];
+
+    if (other->stamp[neighbor] == search->query) {
+        uint32_t length = side->depth[concept] + 1u + other->depth[neighbor];
+        if (length < search->meet.length) {
+            search->meet.side = s;
+            search->meet.near = concept;
+            search->meet.far = neighbor;
+            search->meet.name = name;
+            search->meet.near_to_far = concept_to_neighbor;
+            search->meet.length = length;
+        }
+    }
+    if (side->stamp[neighbor] == search->query) return;
+
+    side->stamp[neighbor] = search->query;
+    side->parent[neighbor] = concept;
+    side->name[neighbor] = name;
+    side->reversed[neighbor] = (uint8_t)(s == 0 ? !concept_to_neighbor : concept_to_neighbor);
+    side->depth[neighbor] = (uint8_t)(side->depth[concept] + 1);
+    side->next[(*next_count)++] = neighbor;
+    *next_cost += side_degree(search->store, s, search->directed, neighbor);
+}
+
+// uint32_t search_path(PathSearch* search, uint32_t from, uint32_t to, uint32_t max_hops);
+//
+// Goal:
+// ======
+// Length in slots of a shortest path (at most max_hops), or PATH_NONE;
+// search->meet says where the two trees join.
+//
+// Key Steps:
+// ========================
+//
+// 1. Each side keeps a frontier and the number of slots it would scan
+//    to expand it. Expand the cheaper side by one whole level.
+//
+// 2. Every slot that reaches a concept the other side has seen is a
+//    candidate; keep the shortest. Stop after the level that found one:
+//    any shorter path would have met in this level or earlier.
+
+static uint32_t search_path(PathSearch* search, uint32_t from, uint32_t to, uint32_t max_hops) {
+    const ConceptStore* store = search->store;
+    PathWorkspace* workspace = search->workspace;
+    search->query = prepare(workspace, store->concept_count);
+    search->meet.length = PATH_NONE;
+    if (max_hops > PATH_UNREACHABLE - 1) max_hops = PATH_UNREACHABLE - 1;
+
+    uint32_t counts[2];
+    uint64_t costs[2];
+    uint32_t depths[2] = { 0, 0 };
+    uint32_t ends[2] = { from, to };
+    for (int s = 0; s < 2; s++) {
+        PathSide* side = &workspace->sides[s];
+        side->stamp[ends[s]] = search->query;
+        side->parent[ends[s]] = ends[s];
+        side->depth[ends[s]] = 0;
+        side->frontier[0] = ends[s];
+        counts[s] = 1;
+        costs[s] = side_degree(store, s, search->directed, ends[s]);
+    }
+
+    while (counts[0] && counts[1] && depths[0] + depths[1] < max_hops) {
+        int s = costs[0] <= costs[1] ? 0 : 1;
+        PathSide* side = &workspace->sides[s];
+
+        uint32_t next_count = 0;
+        uint64_t next_cost = 0;
+        for (uint32_t i = 0; i < counts[s]; i++) {
+            uint32_t concept = side->frontier[i];
+            if (s == 0 || !search->directed) {
+                const Symbol* names = store_slot_names(store, concept);
+                const uint32_t* targets = store_slot_targets(store, concept);
+                for (uint32_t j = 0; j < store_degree(store, concept); j++) {
+                    visit(search, s, concept, targets[j], names[j], 1, &next_count, &next_cost);
+                }
+            }
+            if (s == 1 || !search->directed) {
+                const Symbol* names = store_in_slot_names(store, concept);
+                const uint32_t* sources = store_in_slot_sources(store, concept);
+                for (uint32_t j = 0; j < store_in_degree(store, concept); j++) {
+                    visit(search, s, concept, sources[j], names[j], 0, &next_count, &next_cost);
+                }
+            }
+        }
+
+        uint32_t* swap = side->frontier;
+        side->frontier = side->next;
+        side->next = swap;
+        counts[s] = next_count;
+        costs[s] = next_cost;
+        depths[s]++;
+
+        if (search->meet.length != PATH_NONE) break;
+    }
+
+    return search->meet.length <= max_hops ? search->meet.length : PATH_NONE;
+}
+
+// uint32_t store_shortest_path(const ConceptStore* store, PathWorkspace* workspace, uint32_t from, uint32_t to,
+//                              uint32_t max_hops, int directed, PathStep* path);
+//
+// Goal:
+// ======
+// Write a shortest path from `from` to `to` of at most `max_hops` slots
+// into `path` (max_hops + 1 entries) and return its number of concepts,
+// or 0 if there is none. path[0] is `from`, the last entry is `to`.
+
+uint32_t store_shortest_path(const ConceptStore* store, PathWorkspace* workspace, uint32_t from, uint32_t to,
+                             uint32_t max_hops, int directed, PathStep* path) {
+    if (!store || !workspace || !path) return 0;
+    if (from >= store->concept_count || to >= store->concept_count) return 0;
+
+    path[0].concept = from;
+    path[0].name = SYMBOL_NONE;
+    path[0].reversed = 0;
+    if (from == to) return 1;
+
+    PathSearch search;
+    search.store = store;
+    search.workspace = workspace;
+    search.directed = directed;
+    if (search_path(&search, from, to, max_hops) == PATH_NONE) return 0;
+
+    const PathMeet* meet = &search.meet;
+    const PathSide* forward = &workspace->sides[0];
+    const PathSide* backward = &workspace->sides[1];
+    uint32_t forward_end = meet->side == 0 ? meet->near : meet->far;
+    uint32_t backward_end = meet->side == 0 ? meet->far : meet->near;
+
+    // The source tree, walked up from its end of the meeting slot.
+    uint32_t length = forward->depth[forward_end];
+    for (uint32_t concept = forward_end, i = length; i > 0; concept = forward->parent[concept], i--) {
+        path[i].concept = concept;
+        path[i].name = forward->name[concept];
+        path[i].reversed = forward->reversed[concept];
+    }
+
+    // The meeting slot, stored near → far or far → near.
+    uint8_t along = meet->side == 0 ? meet->near_to_far : (uint8_t)!meet->near_to_far;
+    path[length + 1].concept = backward_end;
+    path[length + 1].name = meet->name;
+    path[length + 1].reversed = (uint8_t)!along;
+
+    // The target tree, walked down towards `to`.
+    uint32_t count = length + 2;
+    for (uint32_t concept = backward_end; concept != to; concept = backward->parent[concept]) {
+        path[count].concept = backward->parent[concept];
+        path[count].name = backward->name[concept];
+        path[count].reversed = backward->reversed[concept];
+        count++;
+    }
+    return count;
+}
+
+// ---
+// Landmark index
+// ---
+
+static uint8_t* landmark_row(const LandmarkIndex* index, uint32_t concept) {
+    return index->distances + (size_t)concept * index->landmark_count;
+}
+
+typedef struct LandmarkBuild {
+    LandmarkIndex* index;
+    const ConceptStore* store;
+} LandmarkBuild;
+
+// Undirected BFS from landmark l, writing column l. Depths saturate
+// at PATH_UNREACHABLE - 1; what lies beyond stays "unreachable".
+static void landmark_bfs(void* context, uint32_t begin, uint32_t end) {
+    LandmarkBuild* build = (LandmarkBuild*)context;
+    LandmarkIndex* index = build->index;
+    const ConceptStore* store = build->store;
+    uint32_t count = index->landmark_count;
+
+    uint32_t* queue = grow(NULL, (size_t)index->capacity * sizeof(uint32_t), "landmark queue");
+    for (uint32_t l = begin; l < end; l++) {
+        uint32_t head = 0;
+        uint32_t tail = 0;
+        queue[tail++] = index->landmarks[l];
+        index->distances[(size_t)index->landmarks[l] * count + l] = 0;
+
+        while (head < tail) {
+            uint32_t concept = queue[head++];
+            uint8_t depth = index->distances[(size_t)concept * count + l];
+            if (depth >= PATH_UNREACHABLE - 1) continue;
+
+            for (int direction = 0; direction < 2; direction++) {
+                const uint32_t* neighbors = direction ? store_in_slot_sources(store, concept) : store_slot_targets(store, concept);
+                uint32_t degree = direction ? store_in_degree(store, concept) : store_degree(store, concept);
+                for (uint32_t i = 0; i < degree; i++) {
+                    uint8_t* cell = &index->distances[(size_t)neighbors[i] * count + l];
+                    if (*cell != PATH_UNREACHABLE) continue;
+                    *cell = (uint8_t)(depth + 1);
+                    queue[tail++] = neighbors[i];
+                }
+            }
+        }
+    }
+    free(queue);
+}
+
+// Keep the `count` highest-degree concepts, best first (insertion into
+// a short sorted array; count is small).
+static uint32_t pick_landmarks(const ConceptStore* store, uint32_t* landmarks, uint32_t count) {
+    uint32_t kept = 0;
+    for (uint32_t concept = 0; concept < store->concept_count; concept++) {
+        uint32_t degree = store_degree(store, concept) + store_in_degree(store, concept);
+        if (kept == count && degree <= store_degree(store, landmarks[kept - 1]) + store_in_degree(store, landmarks[kept - 1])) {
+            continue;
+        }
+        uint32_t i = kept < count ? kept++ : count - 1;
+        while (i > 0) {
+            uint32_t above = landmarks[i - 1];
+            if (store_degree(store, above) + store_in_degree(store, above) >= degree) break;
+            landmarks[i] = above;
+            i--;
+        }
+        landmarks[i] = concept;
+    }
+    return kept;
+}
+
+// void build_landmark_index(LandmarkIndex* index, const ConceptStore* store, Scheduler* scheduler,
+//                           uint32_t landmark_count);
+//
+// (Re)build from scratch: pick the landmarks, then one BFS per landmark,
+// in parallel on `scheduler` (each writes only its own column).
+
+void build_landmark_index(LandmarkIndex* index, const ConceptStore* store, Scheduler* scheduler,
+                          uint32_t landmark_count) {
+    if (!index || !store) return;
+
+    free_landmark_index(index);
+    if (landmark_count == 0) landmark_count = LANDMARK_DEFAULT_COUNT;
+    if (landmark_count > store->concept_count) landmark_count = store->concept_count;
+    if (landmark_count == 0) return;
+
+    index->landmarks = grow(NULL, landmark_count * sizeof(uint32_t), "landmarks");
+    index->landmark_count = pick_landmarks(store, index->landmarks, landmark_count);
+    index->capacity = store->concept_count;
+    index->distances = grow(NULL, (size_t)index->capacity * index->landmark_count, "landmark distances");
+    memset(index->distances, PATH_UNREACHABLE, (size_t)index->capacity * index->landmark_count);
+
+    LandmarkBuild build = { index, store };
+    parallel_for(scheduler, 0, index->landmark_count, 1, landmark_bfs, &build);
+}
+
+void free_landmark_index(LandmarkIndex* index) {
+    if (!index) return;
+
+    free(index->landmarks);
+    free(index->distances);
+    free(index->queue);
+    memset(index, 0, sizeof(LandmarkIndex));
+}
+
+// Concepts created since the build start out unreachable.
+static void cover_concepts(LandmarkIndex* index, uint32_t concept_count) {
+    if (concept_count > index->capacity) {
+        size_t old = (size_t)index->capacity * index->landmark_count;
+        size_t size = (size_t)concept_count * index->landmark_count;
+        index->distances = grow(index->distances, size, "landmark distances");
+        memset(index->distances + old, PATH_UNREACHABLE, size - old);
+        index->capacity = concept_count;
+    }
+    if (concept_count > index->queue_capacity) {
+        index->queue = grow(index->queue, concept_count * sizeof(uint32_t), "landmark queue");
+        index->queue_capacity = concept_count;
+    }
+}
+
+// Lower `start`'s distance to landmark l to `depth`, then spread the
+// improvement. Unit weights and FIFO order mean each concept improves
+// at most once, so the queue never holds more than concept_count.
+static void relax_from(LandmarkIndex* index, const ConceptStore* store, uint32_t l, uint32_t start, uint8_t depth) {
+    uint32_t head = 0;
+    uint32_t tail = 0;
+    landmark_row(index, start)[l] = depth;
+    index->queue[tail++] = start;
+
+    while (head < tail) {
+        uint32_t concept = index->queue[head++];
+        uint8_t next = (uint8_t)(landmark_row(index, concept)[l] + 1);
+        if (next >= PATH_UNREACHABLE) continue;
+
+        for (int direction = 0; direction < 2; direction++) {
+            const uint32_t* neighbors = direction ? store_in_slot_sources(store, concept) : store_slot_targets(store, concept);
+            uint32_t degree = direction ? store_in_degree(store, concept) : store_degree(store, concept);
+            for (uint32_t i = 0; i < degree; i++) {
+                uint8_t* cell = &landmark_row(index, neighbors[i])[l];
+                if (*cell <= next) continue;
+                *cell = next;
+                index->queue[tail++] = neighbors[i];
+            }
+        }
+    }
+}
+
+// void landmark_add_slot(LandmarkIndex* index, const ConceptStore* store, uint32_t source, uint32_t target);
+//
+// Call after store_add_slot(source, ..., target). For each landmark, if
+// the new slot shortens the way to one endpoint, relax from there.
+
+void landmark_add_slot(LandmarkIndex* index, const ConceptStore* store, uint32_t source, uint32_t target) {
+    if (!index || !store || !index->landmark_count) return;
+    if (source >= store->concept_count || target >= store->concept_count) return;
+
+    cover_concepts(index, store->concept_count);
+    for (uint32_t l = 0; l < index->landmark_count; l++) {
+        uint32_t to_source = landmark_row(index, source)[l];
+        uint32_t to_target = landmark_row(index, target)[l];
+        if (to_source + 1 < to_target && to_source + 1 < PATH_UNREACHABLE) {
+            relax_from(index, store, l, target, (uint8_t)(to_source + 1));
+        } else if (to_target + 1 < to_source && to_target + 1 < PATH_UNREACHABLE) {
+            relax_from(index, store, l, source, (uint8_t)(to_target + 1));
+        }
+    }
+}
+
+// void landmark_distance_bounds(const LandmarkIndex* index, uint32_t from, uint32_t to,
+//                               uint32_t* lower, uint32_t* upper);
+//
+// Bounds on the undirected hop distance (see NOTES). `upper` is
+// UINT32_MAX if no landmark reaches both. An unreachable (255) entry
+// still bounds from below: the true distance is at least 255 there.
+
+void landmark_distance_bounds(const LandmarkIndex* index, uint32_t from, uint32_t to,
+                              uint32_t* lower, uint32_t* upper) {
+    uint32_t low = 0;
+    uint32_t high = UINT32_MAX;
+    if (index && from < index->capacity && to < index->capacity) {
+        if (from == to) high = 0;
+        const uint8_t* a = landmark_row(index, from);
+        const uint8_t* b = landmark_row(index, to);
+        for (uint32_t l = 0; l < index->landmark_count; l++) {
+            if (a[l] == PATH_UNREACHABLE && b[l] == PATH_UNREACHABLE) continue;
+            uint32_t gap = a[l] > b[l] ? (uint32_t)(a[l] - b[l]) : (uint32_t)(b[l] - a[l]);
+            if (gap > low) low = gap;
+            if (a[l] != PATH_UNREACHABLE && b[l] != PATH_UNREACHABLE && (uint32_t)a[l] + b[l] < high) {
+                high = (uint32_t)a[l] + b[l];
+            }
+        }
+    }
+    if (lower) *lower = low;
+    if (upper) *upper = high;
+}
+
+// int store_within_hops(const ConceptStore* store, const LandmarkIndex* index, PathWorkspace* workspace,
+//                       uint32_t from, uint32_t to, uint32_t hops);
+//
+// 1 if `to` is within `hops` undirected slots of `from`, else 0. The
+// index (optional) answers most queries; the rest run a bidirectional
+// BFS bounded by `hops`.
+
+int store_within_hops(const ConceptStore* store, const LandmarkIndex* index, PathWorkspace* workspace,
+                      uint32_t from, uint32_t to, uint32_t hops) {
+    if (!store || !workspace || from >= store->concept_count || to >= store->concept_count) return 0;
+    if (from == to) return 1;
+
+    if (index) {
+        uint32_t lower, upper;
+        landmark_distance_bounds(index, from, to, &lower, &upper);
+        if (upper <= hops) return 1;
+        if (lower > hops) return 0;
+    }
+
+    PathSearch search;
+    search.store = store;
+    search.workspace = workspace;
+    search.directed = 0;
+    return search_path(&search, from, to, hops) != PATH_NONE;
+}
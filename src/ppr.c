@@ -0,0 +1,332 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "ppr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PPR_QUEUED 1
+#define PPR_TOUCHED 2
+#define PPR_CLOCK_EVERY 64          // pushes between budget checks
+
+void init_push_workspace(PushWorkspace* workspace) {
+    if (!workspace) return;
+    memset(workspace, 0, sizeof(PushWorkspace));
+}
+
+void free_push_workspace(PushWorkspace* workspace) {
+    if (!workspace) return;
+
+    free(workspace->estimate);
+    free(workspace->residual);
+    free(workspace->queued);
+    free(workspace->touched);
+    free(workspace->queue);
+    init_push_workspace(workspace);
+}
+
+static void* grow(void* ptr, size_t size, const char* what) {
+    void* new_ptr = realloc(ptr, size);
+    if (!new_ptr) {
+        fprintf(stderr, "Failed to allocate memory for %s.\n", what);
+        exit(1);
+    }
+    return new_ptr;
+}
+
+// Zero what the last query touched, then cover the store's concepts.
+// New entries are zeroed too, so the arrays are all-zero afterwards.
+static void prepare(PushWorkspace* workspace, uint32_t concept_count) {
+    for (uint32_t i = 0; i < workspace->touched_count; i++) {
+        uint32_t concept = workspace->touched[i];
+        workspace->estimate[concept] = 0.0f;
+        workspace->residual[concept] = 0.0f;
+        workspace->queued[concept] = 0;
+    }
+    workspace->touched_count = 0;
+    workspace->queue_head = 0;
+    workspace->queue_count = 0;
+    workspace->pushes = 0;
+    workspace->truncated = 0;
+
+    if (concept_count <= workspace->capacity) return;
+
+    uint32_t old = workspace->capacity;
+    uint32_t added = concept_count - old;
+    workspace->estimate = grow(workspace->estimate, concept_count * sizeof(float), "push estimates");
+    workspace->residual = grow(workspace->residual, concept_count * sizeof(float), "push residuals");
+    workspace->queued = grow(workspace->queued, concept_count, "push flags");
+    workspace->touched = grow(workspace->touched, concept_count * sizeof(uint32_t), "push touched list");
+    workspace->queue = grow(workspace->queue, concept_count * sizeof(uint32_t), "push queue");
+    memset(workspace->estimate + old, 0, added * sizeof(float));
+    memset(workspace->residual + old, 0, added * sizeof(float));
+    memset(workspace->queued + old, 0, added);
+    workspace->capacity = concept_count;
+}
+
+static uint32_t total_degree(const ConceptStore* store, uint32_t concept) {
+    return store_degree(store, concept) + store_in_degree(store, concept);
+}
+
+static void touch(PushWorkspace* workspace, uint32_t concept) {
+    if (workspace->queued[concept] & PPR_TOUCHED) return;
+    workspace->queued[concept] |= PPR_TOUCHED;
+    workspace->touched[workspace->touched_count++] = concept;
+}
+
+// A concept is in the queue at most once, so `capacity` entries suffice.
+static void enqueue(PushWorkspace* workspace, uint32_t concept) {
+    if (workspace->queued[concept] & PPR_QUEUED) return;
+    workspace->queued[concept] |= PPR_QUEUED;
+    uint32_t tail = (workspace->queue_head + workspace->queue_count) % workspace->capacity;
+    workspace->queue[tail] = concept;
+    workspace->queue_count++;
+}
+
+static uint32_t dequeue(PushWorkspace* workspace) {
+    uint32_t concept = workspace->queue[workspace->queue_head];
+    workspace->queue_head = (workspace->queue_head + 1) % workspace->capacity;
+    workspace->queue_count--;
+    workspace->queued[concept] &= (uint8_t)~PPR_QUEUED;
+    return concept;
+}
+
+static void add_residual(const ConceptStore* store, PushWorkspace* workspace, uint32_t concept,
+                         float mass, float epsilon) {
+    touch(workspace, concept);
+    workspace->residual[concept] += mass;
+    if (workspace->residual[concept] >= epsilon * (float)total_degree(store, concept)) {
+        enqueue(workspace, concept);
+    }
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Min-heap of the k best concepts, worst at the root; ties favour the
+// lower concept index.
+static int concept_worse(const RankedConcept* a, const RankedConcept* b) {
+    if (a->score != b->score) return a->score < b->score;
+    return a->concept > b->concept;
+}
+
+static void concept_sift_down(RankedConcept* heap, uint32_t index, uint32_t count) {
+    for (;;) {
+        uint32_t child = 2 * index + 1;
+        if (child >= count) return;
+        if (child + 1 < count && concept_worse(&heap[child + 1], &heap[child])) child++;
+        if (!concept_worse(&heap[child], &heap[index])) return;
+        RankedConcept swap = heap[index];
+        heap[index] = heap[child];
+        heap[child] = swap;
+        index = child;
+    }
+}
+
+static void concept_sift_up(RankedConcept* heap, uint32_t index) {
+    while (index > 0) {
+        uint32_t parent = (index - 1) / 2;
+        if (!concept_worse(&heap[index], &heap[parent])) return;
+        RankedConcept swap = heap[index];
+        heap[index] = heap[parent];
+        heap[parent] = swap;
+        index = parent;
+    }
+}
+
+// uint32_t personalized_push(const ConceptStore* store, PushWorkspace* workspace, const uint32_t* seeds,
+//                            uint32_t seed_count, float alpha, float epsilon, uint64_t budget_ns,
+//                            uint32_t k, RankedConcept* out);
+//
+// Goal:
+// ======
+// Approximate PPR from `seeds` by forward push (see NOTES), then write
+// the k concepts with the highest estimate into `out`, best first, and
+// return how many were written. `budget_ns` = 0 means no time limit.
+// The full estimates stay in the workspace until the next query.
+//
+// Key Steps:
+// ========================
+//
+// 1. Reset the concepts the previous query touched; seed the residuals.
+//
+// 2. Push queued concepts FIFO until none is above its threshold or
+//    the budget is spent (the clock is read every PPR_CLOCK_EVERY
+//    pushes, not every push).
+//
+// 3. Select the top k among touched concepts with a bounded heap.
+
+uint32_t personalized_push(const ConceptStore* store, PushWorkspace* workspace, const uint32_t* seeds,
+                           uint32_t seed_count, float alpha, float epsilon, uint64_t budget_ns,
+                           uint32_t k, RankedConcept* out) {
+    if (!store || !workspace || !seeds) return 0;
+
+    prepare(workspace, store->concept_count);
+
+    uint32_t valid = 0;
+    for (uint32_t i = 0; i < seed_count; i++) {
+        valid += (uint32_t)(seeds[i] < store->concept_count);
+    }
+    if (!valid) return 0;
+    for (uint32_t i = 0; i < seed_count; i++) {
+        if (seeds[i] < store->concept_count) {
+            add_residual(store, workspace, seeds[i], 1.0f / (float)valid, epsilon);
+            enqueue(workspace, seeds[i]);
+        }
+    }
+
+    uint64_t deadline = budget_ns ? now_ns() + budget_ns : 0;
+    while (workspace->queue_count) {
+        if (deadline && workspace->pushes % PPR_CLOCK_EVERY == 0 && now_ns() >= deadline) {
+            workspace->truncated = 1;
+            break;
+        }
+
+        uint32_t concept = dequeue(workspace);
+        float mass = workspace->residual[concept];
+        uint32_t degree = total_degree(store, concept);
+        workspace->residual[concept] = 0.0f;
+        workspace->pushes++;
+
+        if (degree == 0) {
+            workspace->estimate[concept] += mass;
+            continue;
+        }
+
+        workspace->estimate[concept] += alpha * mass;
+        float share = (1.0f - alpha) * mass / (float)degree;
+        if (share == 0.0f) continue;
+
+        const uint32_t* targets = store_slot_targets(store, concept);
+        for (uint32_t i = 0; i < store_degree(store, concept); i++) {
+            add_residual(store, workspace, targets[i], share, epsilon);
+        }
+        const uint32_t* sources = store_in_slot_sources(store, concept);
+        for (uint32_t i = 0; i < store_in_degree(store, concept); i++) {
+            add_residual(store, workspace, sources[i], share, epsilon);
+        }
+    }
+
+    if (!out || k == 0) return 0;
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < workspace->touched_count; i++) {
+        uint32_t concept = workspace->touched[i];
+        RankedConcept candidate = { concept, workspace->estimate[concept] };
+        if (candidate.score <= 0.0f) continue;
+        if (count < k) {
+            out[count] = candidate;
+            concept_sift_up(out, count++);
+        } else if (concept_worse(&out[0], &candidate)) {
+            out[0] = candidate;
+            concept_sift_down(out, 0, count);
+        }
+    }
+
+    for (uint32_t end = count; end > 1; end--) {
+        RankedConcept swap = out[0];
+        out[0] = out[end - 1];
+        out[end - 1] = swap;
+        concept_sift_down(out, 0, end - 1);
+    }
+    return count;
+}
+
+// Min-heap for slots, same shape as the concept one.
+static int slot_worse(const RelevantSlot* a, const RelevantSlot* b) {
+    if (a->score != b->score) return a->score < b->score;
+    if (a->source != b->source) return a->source > b->source;
+    return a->target > b->target;
+}
+
+static void slot_sift_down(RelevantSlot* heap, uint32_t index, uint32_t count) {
+    for (;;) {
+        uint32_t child = 2 * index + 1;
+        if (child >= count) return;
+        if (child + 1 < count && slot_worse(&heap[child + 1], &heap[child])) child++;
+        if (!slot_worse(&heap[child], &heap[index])) return;
+        RelevantSlot swap = heap[index];
+        heap[index] = heap[child];
+        heap[child] = swap;
+        index = child;
+    }
+}
+
+static void slot_sift_up(RelevantSlot* heap, uint32_t index) {
+    while (index > 0) {
+        uint32_t parent = (index - 1) / 2;
+        if (!slot_worse(&heap[index], &heap[parent])) return;
+        RelevantSlot swap = heap[index];
+        heap[index] = heap[parent];
+        heap[parent] = swap;
+        index = parent;
+    }
+}
+
+static void offer_slot(RelevantSlot* out, uint32_t k, uint32_t* count, RelevantSlot candidate) {
+    if (*count < k) {
+        out[*count] = candidate;
+        slot_sift_up(out, (*count)++);
+    } else if (slot_worse(&out[0], &candidate)) {
+        out[0] = candidate;
+        slot_sift_down(out, 0, *count);
+    }
+}
+
+// Relevance an endpoint passes to each of its slots.
+static float flow(const ConceptStore* store, const PushWorkspace* workspace, uint32_t concept) {
+    uint32_t degree = total_degree(store, concept);
+    return degree ? workspace->estimate[concept] / (float)degree : 0.0f;
+}
+
+// uint32_t top_k_relevant_slots(const ConceptStore* store, const PushWorkspace* workspace,
+//                               uint32_t k, RelevantSlot* out);
+//
+// Goal:
+// ======
+// The k facts most worth injecting after personalized_push(): a slot
+// scores the relevance flowing through it from both ends,
+//
+//     score(s → t) = p[s] / degree(s) + p[t] / degree(t)
+//
+// Only touched concepts have p > 0, so scanning their out-slots, plus
+// the in-slots of touched targets whose source was never reached, sees
+// every slot with a nonzero score exactly once. Best first.
+
+uint32_t top_k_relevant_slots(const ConceptStore* store, const PushWorkspace* workspace,
+                              uint32_t k, RelevantSlot* out) {
+    if (!store || !workspace || !out || k == 0 || workspace->capacity < store->concept_count) return 0;
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < workspace->touched_count; i++) {
+        uint32_t concept = workspace->touched[i];
+        float own = flow(store, workspace, concept);
+
+        const Symbol* names = store_slot_names(store, concept);
+        const uint32_t* targets = store_slot_targets(store, concept);
+        for (uint32_t j = 0; j < store_degree(store, concept); j++) {
+            RelevantSlot candidate = { concept, names[j], targets[j], own + flow(store, workspace, targets[j]) };
+            if (candidate.score > 0.0f) offer_slot(out, k, &count, candidate);
+        }
+
+        const Symbol* in_names = store_in_slot_names(store, concept);
+        const uint32_t* sources = store_in_slot_sources(store, concept);
+        for (uint32_t j = 0; j < store_in_degree(store, concept); j++) {
+            if (workspace->queued[sources[j]] & PPR_TOUCHED) continue;     // seen as its out-slot
+            RelevantSlot candidate = { sources[j], in_names[j], concept, own };
+            if (candidate.score > 0.0f) offer_slot(out, k, &count, candidate);
+        }
+    }
+
+    for (uint32_t end = count; end > 1; end--) {
+        RelevantSlot swap = out[0];
+        out[0] = out[end - 1];
+        out[end - 1] = swap;
+        slot_sift_down(out, 0, end - 1);
+    }
+    return count;
+}
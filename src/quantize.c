@@ -0,0 +1,528 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "quantize.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define QUANT_MIN_CAPACITY 1024
+
+static void* quant_alloc(size_t size, const char* what) {
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) {
+        fprintf(stderr, "Failed to allocate memory for %s.\n", what);
+        exit(1);
+    }
+    return ptr;
+}
+
+static void* quant_grow(void* ptr, size_t size, const char* what) {
+    void* new_ptr = realloc(ptr, size);
+    if (!new_ptr) {
+        fprintf(stderr, "Failed to allocate memory for %s.\n", what);
+        exit(1);
+    }
+    return new_ptr;
+}
+
+// Round half away from zero, saturating to [low, high].
+static int32_t quantize_value(float x, float low, float high) {
+    if (x <= low) return (int32_t)low;
+    if (x >= high) return (int32_t)high;
+    return (int32_t)(x >= 0.0f ? x + 0.5f : x - 0.5f);
+}
+
+static float cosine_distance(float dot, float norm_a, float norm_b) {
+    if (norm_a <= 0.0f || norm_b <= 0.0f) return 1.0f;
+    return 1.0f - dot / (norm_a * norm_b);
+}
+
+// void init_quantized(QuantizedVectors* quantized, QuantFormat format, uint32_t dimensions, uint32_t subspaces);
+//
+// `subspaces` is for QUANT_PQ only (0: PQ_DEFAULT_SUBSPACES). It is
+// lowered to the nearest count that divides `dimensions`, so every
+// sub-vector has the same length.
+
+void init_quantized(QuantizedVectors* quantized, QuantFormat format, uint32_t dimensions, uint32_t subspaces) {
+    if (!quantized) return;
+
+    memset(quantized, 0, sizeof(QuantizedVectors));
+    quantized->format = format;
+    quantized->dimensions = dimensions;
+
+    switch (format) {
+    case QUANT_FIXED_12_4:
+        quantized->code_bytes = dimensions * sizeof(int16_t);
+        break;
+    case QUANT_INT8:
+        quantized->code_bytes = dimensions;
+        break;
+    case QUANT_PQ:
+        if (subspaces == 0) subspaces = PQ_DEFAULT_SUBSPACES;
+        if (subspaces > dimensions) subspaces = dimensions ? dimensions : 1;
+        while (dimensions % subspaces) {
+            subspaces--;
+        }
+        quantized->subspaces = subspaces;
+        quantized->sub_dimensions = dimensions / subspaces;
+        quantized->code_bytes = subspaces;
+        break;
+    }
+}
+
+void free_quantized(QuantizedVectors* quantized) {
+    if (!quantized) return;
+
+    free(quantized->codes);
+    free(quantized->scales);
+    free(quantized->norms);
+    free(quantized->present);
+    free(quantized->centroids);
+    memset(quantized, 0, sizeof(QuantizedVectors));
+}
+
+static void grow_rows(QuantizedVectors* quantized, uint32_t concept) {
+    uint32_t old = quantized->capacity;
+    uint32_t new_capacity = old ? old : QUANT_MIN_CAPACITY;
+    while (new_capacity <= concept) {
+        new_capacity *= 2;
+    }
+
+    size_t old_words = ((size_t)old + 63) / 64;
+    size_t new_words = ((size_t)new_capacity + 63) / 64;
+    quantized->codes = quant_grow(quantized->codes, (size_t)new_capacity * quantized->code_bytes, "quantized codes");
+    quantized->scales = quant_grow(quantized->scales, new_capacity * sizeof(float), "quantized scales");
+    quantized->norms = quant_grow(quantized->norms, new_capacity * sizeof(float), "quantized norms");
+    quantized->present = quant_grow(quantized->present, new_words * sizeof(uint64_t), "quantized presence bits");
+
+    memset(quantized->codes + (size_t)old * quantized->code_bytes, 0,
+           (size_t)(new_capacity - old) * quantized->code_bytes);
+    memset(quantized->scales + old, 0, (new_capacity - old) * sizeof(float));
+    memset(quantized->norms + old, 0, (new_capacity - old) * sizeof(float));
+    memset(quantized->present + old_words, 0, (new_words - old_words) * sizeof(uint64_t));
+    quantized->capacity = new_capacity;
+}
+
+static const float* centroid_of(const QuantizedVectors* quantized, uint32_t subspace, uint32_t centroid) {
+    return quantized->centroids + ((size_t)subspace * PQ_CENTROIDS + centroid) * quantized->sub_dimensions;
+}
+
+static uint8_t nearest_centroid(const QuantizedVectors* quantized, uint32_t subspace, const float* sub) {
+    uint32_t best = 0;
+    float best_distance = 0.0f;
+    for (uint32_t c = 0; c < PQ_CENTROIDS; c++) {
+        float d = l2sq_f32(sub, centroid_of(quantized, subspace, c), quantized->sub_dimensions);
+        if (c == 0 || d < best_distance) {
+            best = c;
+            best_distance = d;
+        }
+    }
+    return (uint8_t)best;
+}
+
+// ---
+// Encoding
+// ---
+
+static void encode_fixed(const float* embedding, uint32_t dimensions, int16_t* codes) {
+    for (uint32_t i = 0; i < dimensions; i++) {
+        codes[i] = (int16_t)quantize_value(embedding[i] * QUANT_FIXED_ONE, -32768.0f, 32767.0f);
+    }
+}
+
+// Returns the scale: decoded = code · scale.
+static float encode_int8(const float* embedding, uint32_t dimensions, int8_t* codes) {
+    float largest = 0.0f;
+    for (uint32_t i = 0; i < dimensions; i++) {
+        float magnitude = embedding[i] < 0.0f ? -embedding[i] : embedding[i];
+        if (magnitude > largest) largest = magnitude;
+    }
+
+    float scale = largest / 127.0f;
+    for (uint32_t i = 0; i < dimensions; i++) {
+        codes[i] = scale > 0.0f ? (int8_t)quantize_value(embedding[i] / scale, -127.0f, 127.0f) : 0;
+    }
+    return scale;
+}
+
+static void decode_row(const QuantizedVectors* quantized, uint32_t concept, float* out) {
+    const uint8_t* row = quantized->codes + (size_t)concept * quantized->code_bytes;
+    switch (quantized->format) {
+    case QUANT_FIXED_12_4: {
+        const int16_t* codes = (const int16_t*)row;
+        for (uint32_t i = 0; i < quantized->dimensions; i++) {
+            out[i] = codes[i] / QUANT_FIXED_ONE;
+        }
+        break;
+    }
+    case QUANT_INT8: {
+        const int8_t* codes = (const int8_t*)row;
+        float scale = quantized->scales[concept];
+        for (uint32_t i = 0; i < quantized->dimensions; i++) {
+            out[i] = codes[i] * scale;
+        }
+        break;
+    }
+    case QUANT_PQ:
+        for (uint32_t s = 0; s < quantized->subspaces; s++) {
+            memcpy(out + s * quantized->sub_dimensions, centroid_of(quantized, s, row[s]),
+                   quantized->sub_dimensions * sizeof(float));
+        }
+        break;
+    }
+}
+
+// int quantized_attach(QuantizedVectors* quantized, uint32_t concept, const float* embedding);
+//
+// Encode `embedding` as the row of `concept`, replacing any previous
+// one. Returns 0, or -1 for a PQ store that is not trained yet.
+
+int quantized_attach(QuantizedVectors* quantized, uint32_t concept, const float* embedding) {
+    if (!quantized || !embedding || concept == UINT32_MAX) return -1;
+    if (quantized->format == QUANT_PQ && !quantized->trained) return -1;
+    if (concept >= quantized->capacity) grow_rows(quantized, concept);
+
+    uint8_t* row = quantized->codes + (size_t)concept * quantized->code_bytes;
+    switch (quantized->format) {
+    case QUANT_FIXED_12_4:
+        encode_fixed(embedding, quantized->dimensions, (int16_t*)row);
+        break;
+    case QUANT_INT8:
+        quantized->scales[concept] = encode_int8(embedding, quantized->dimensions, (int8_t*)row);
+        break;
+    case QUANT_PQ:
+        for (uint32_t s = 0; s < quantized->subspaces; s++) {
+            row[s] = nearest_centroid(quantized, s, embedding + s * quantized->sub_dimensions);
+        }
+        break;
+    }
+
+    // Norms are of the decoded row, so code distances stay consistent.
+    float* decoded = quant_alloc(quantized->dimensions * sizeof(float), "decoded row");
+    decode_row(quantized, concept, decoded);
+    quantized->norms[concept] = vector_norm(decoded, quantized->dimensions);
+    free(decoded);
+
+    if (!quantized_present(quantized, concept)) {
+        quantized->present[concept >> 6] |= (uint64_t)1 << (concept & 63);
+        quantized->n_concepts++;
+    }
+    return 0;
+}
+
+// Encode every embedding of `vectors`; returns how many were encoded.
+uint32_t quantize_store(QuantizedVectors* quantized, const ConceptVectorStore* vectors) {
+    if (!quantized || !vectors || vectors->dimensions != quantized->dimensions) return 0;
+
+    uint32_t encoded = 0;
+    for (uint32_t word = 0; word < (vectors->capacity + 63) / 64; word++) {
+        uint64_t bits = vectors->present[word];
+        while (bits) {
+            uint32_t concept = word * 64 + (uint32_t)__builtin_ctzll(bits);
+            bits &= bits - 1;
+            if (quantized_attach(quantized, concept, vector_of(vectors, concept)) == 0) encoded++;
+        }
+    }
+    return encoded;
+}
+
+void quantized_decode(const QuantizedVectors* quantized, uint32_t concept, float* out) {
+    if (!quantized || !out) return;
+    if (!quantized_present(quantized, concept)) {
+        memset(out, 0, quantized->dimensions * sizeof(float));
+        return;
+    }
+    decode_row(quantized, concept, out);
+}
+
+// ---
+// Product quantizer training
+// ---
+
+typedef struct PqAssign {
+    const QuantizedVectors* quantized;
+    const float* samples;
+    uint32_t subspace;
+    uint8_t* assignment;
+} PqAssign;
+
+static void assign_range(void* context, uint32_t begin, uint32_t end) {
+    PqAssign* assign = context;
+    const QuantizedVectors* quantized = assign->quantized;
+    for (uint32_t i = begin; i < end; i++) {
+        const float* sub = assign->samples + (size_t)i * quantized->dimensions +
+                           assign->subspace * quantized->sub_dimensions;
+        assign->assignment[i] = nearest_centroid(quantized, assign->subspace, sub);
+    }
+}
+
+// int pq_train(QuantizedVectors* quantized, const ConceptVectorStore* vectors, Scheduler* scheduler,
+//              uint32_t sample, uint32_t iterations);
+//
+// Goal:
+// ======
+// Learn the 256 centroids of every subspace with k-means over (up to)
+// `sample` embeddings of `vectors`. Returns 0, or -1 if the store is not
+// PQ or there is nothing to train on. Rows encoded before re-training
+// must be re-encoded.
+//
+// Key Steps:
+// ========================
+//
+// 1. Take an evenly spaced sample of the present rows (0:
+//    PQ_DEFAULT_SAMPLE) into one dense buffer.
+//
+// 2. Per subspace, seed the centroids with evenly spaced samples, then
+//    run Lloyd iterations (0: PQ_DEFAULT_ITERATIONS): assign every
+//    sample in parallel, recompute the means, and reseed any empty
+//    centroid from a pseudo-random sample.
+
+int pq_train(QuantizedVectors* quantized, const ConceptVectorStore* vectors, Scheduler* scheduler,
+             uint32_t sample, uint32_t iterations) {
+    if (!quantized || !vectors || quantized->format != QUANT_PQ) return -1;
+    if (vectors->dimensions != quantized->dimensions || vectors->n_concepts == 0) return -1;
+    if (sample == 0) sample = PQ_DEFAULT_SAMPLE;
+    if (sample > vectors->n_concepts) sample = vectors->n_concepts;
+    if (iterations == 0) iterations = PQ_DEFAULT_ITERATIONS;
+
+    uint32_t dimensions = quantized->dimensions;
+    uint32_t sub_dimensions = quantized->sub_dimensions;
+
+    uint32_t* rows = quant_alloc(vectors->n_concepts * sizeof(uint32_t), "PQ sample rows");
+    uint32_t row_count = 0;
+    for (uint32_t concept = 0; concept < vectors->capacity && row_count < vectors->n_concepts; concept++) {
+        if (vector_present(vectors, concept)) rows[row_count++] = concept;
+    }
+    if (sample > row_count) sample = row_count;
+
+    float* samples = quant_alloc((size_t)sample * dimensions * sizeof(float), "PQ samples");
+    for (uint32_t i = 0; i < sample; i++) {
+        uint32_t concept = rows[(uint64_t)i * row_count / sample];
+        memcpy(samples + (size_t)i * dimensions, vector_of(vectors, concept), dimensions * sizeof(float));
+    }
+    free(rows);
+
+    free(quantized->centroids);
+    quantized->centroids = quant_alloc((size_t)quantized->subspaces * PQ_CENTROIDS * sub_dimensions * sizeof(float),
+                                       "PQ centroids");
+    uint8_t* assignment = quant_alloc(sample, "PQ assignment");
+    uint32_t* counts = quant_alloc(PQ_CENTROIDS * sizeof(uint32_t), "PQ counts");
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+
+    for (uint32_t s = 0; s < quantized->subspaces; s++) {
+        float* centroids = (float*)centroid_of(quantized, s, 0);
+        for (uint32_t c = 0; c < PQ_CENTROIDS; c++) {
+            const float* source = samples + (size_t)((uint64_t)c * sample / PQ_CENTROIDS) * dimensions +
+                                  s * sub_dimensions;
+            memcpy(centroids + (size_t)c * sub_dimensions, source, sub_dimensions * sizeof(float));
+        }
+
+        PqAssign assign = { quantized, samples, s, assignment };
+        for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+            parallel_for(scheduler, 0, sample, 256, assign_range, &assign);
+
+            memset(centroids, 0, PQ_CENTROIDS * sub_dimensions * sizeof(float));
+            memset(counts, 0, PQ_CENTROIDS * sizeof(uint32_t));
+            for (uint32_t i = 0; i < sample; i++) {
+                const float* sub = samples + (size_t)i * dimensions + s * sub_dimensions;
+                float* mean = centroids + (size_t)assignment[i] * sub_dimensions;
+                for (uint32_t d = 0; d < sub_dimensions; d++) {
+                    mean[d] += sub[d];
+                }
+                counts[assignment[i]]++;
+            }
+
+            for (uint32_t c = 0; c < PQ_CENTROIDS; c++) {
+                float* mean = centroids + (size_t)c * sub_dimensions;
+                if (counts[c] == 0) {
+                    seed ^= seed << 13;
+                    seed ^= seed >> 7;
+                    seed ^= seed << 17;
+                    memcpy(mean, samples + (size_t)(seed % sample) * dimensions + s * sub_dimensions,
+                           sub_dimensions * sizeof(float));
+                    continue;
+                }
+                for (uint32_t d = 0; d < sub_dimensions; d++) {
+                    mean[d] /= (float)counts[c];
+                }
+            }
+        }
+    }
+
+    free(counts);
+    free(assignment);
+    free(samples);
+    quantized->trained = 1;
+    return 0;
+}
+
+// ---
+// Queries
+// ---
+
+// void prepare_quantized_query(const QuantizedVectors* quantized, DistanceMetric metric, const float* query,
+//                              QuantizedQuery* prepared);
+//
+// Encode `query` once for many quantized_distance() calls: codes for
+// fixed-point and int8, the ADC table for PQ.
+
+void prepare_quantized_query(const QuantizedVectors* quantized, DistanceMetric metric, const float* query,
+                             QuantizedQuery* prepared) {
+    if (!prepared) return;
+
+    memset(prepared, 0, sizeof(QuantizedQuery));
+    prepared->metric = metric;
+    if (!quantized || !query) return;
+
+    uint32_t dimensions = quantized->dimensions;
+    float* decoded = quant_alloc(dimensions * sizeof(float), "decoded query");
+
+    switch (quantized->format) {
+    case QUANT_FIXED_12_4:
+        prepared->fixed = quant_alloc(dimensions * sizeof(int16_t), "query codes");
+        encode_fixed(query, dimensions, prepared->fixed);
+        for (uint32_t i = 0; i < dimensions; i++) {
+            decoded[i] = prepared->fixed[i] / QUANT_FIXED_ONE;
+        }
+        prepared->norm = vector_norm(decoded, dimensions);
+        break;
+    case QUANT_INT8:
+        prepared->bytes = quant_alloc(dimensions, "query codes");
+        prepared->scale = encode_int8(query, dimensions, prepared->bytes);
+        for (uint32_t i = 0; i < dimensions; i++) {
+            decoded[i] = prepared->bytes[i] * prepared->scale;
+        }
+        prepared->norm = vector_norm(decoded, dimensions);
+        break;
+    case QUANT_PQ:
+        if (!quantized->trained) break;
+        prepared->table = quant_alloc((size_t)quantized->subspaces * PQ_CENTROIDS * sizeof(float), "PQ table");
+        for (uint32_t s = 0; s < quantized->subspaces; s++) {
+            const float* sub = query + s * quantized->sub_dimensions;
+            float* table = prepared->table + (size_t)s * PQ_CENTROIDS;
+            for (uint32_t c = 0; c < PQ_CENTROIDS; c++) {
+                const float* centroid = centroid_of(quantized, s, c);
+                table[c] = metric == DISTANCE_L2 ? l2sq_f32(sub, centroid, quantized->sub_dimensions)
+                                                 : dot_f32(sub, centroid, quantized->sub_dimensions);
+            }
+        }
+        prepared->norm = vector_norm(query, dimensions);
+        break;
+    }
+    free(decoded);
+}
+
+void free_quantized_query(QuantizedQuery* prepared) {
+    if (!prepared) return;
+
+    free(prepared->fixed);
+    free(prepared->bytes);
+    free(prepared->table);
+    memset(prepared, 0, sizeof(QuantizedQuery));
+}
+
+// float quantized_distance(const QuantizedVectors* quantized, const QuantizedQuery* prepared, uint32_t concept);
+//
+// Distance from the prepared query to the codes of `concept`, in the
+// metric the query was prepared for. Concepts without a row (or an
+// unprepared query) are infinitely far.
+
+float quantized_distance(const QuantizedVectors* quantized, const QuantizedQuery* prepared, uint32_t concept) {
+    if (!quantized || !prepared || !quantized_present(quantized, concept)) return __builtin_inff();
+
+    const uint8_t* row = quantized->codes + (size_t)concept * quantized->code_bytes;
+    float row_norm = quantized->norms[concept];
+    float dot;
+
+    switch (quantized->format) {
+    case QUANT_FIXED_12_4:
+        if (!prepared->fixed) return __builtin_inff();
+        if (prepared->metric == DISTANCE_L2) {
+            return l2sq_i16(prepared->fixed, (const int16_t*)row, quantized->dimensions) /
+                   (QUANT_FIXED_ONE * QUANT_FIXED_ONE);
+        }
+        dot = dot_i16(prepared->fixed, (const int16_t*)row, quantized->dimensions) /
+              (QUANT_FIXED_ONE * QUANT_FIXED_ONE);
+        break;
+    case QUANT_INT8:
+        if (!prepared->bytes) return __builtin_inff();
+        dot = prepared->scale * quantized->scales[concept] *
+              (float)dot_i8(prepared->bytes, (const int8_t*)row, quantized->dimensions);
+        if (prepared->metric == DISTANCE_L2) {
+            float l2 = prepared->norm * prepared->norm + row_norm * row_norm - 2.0f * dot;
+            return l2 > 0.0f ? l2 : 0.0f;
+        }
+        break;
+    case QUANT_PQ: {
+        if (!prepared->table) return __builtin_inff();
+        float sum = 0.0f;
+        for (uint32_t s = 0; s < quantized->subspaces; s++) {
+            sum += prepared->table[(size_t)s * PQ_CENTROIDS + row[s]];
+        }
+        if (prepared->metric == DISTANCE_L2) return sum;
+        dot = sum;
+        break;
+    }
+    default:
+        return __builtin_inff();
+    }
+
+    if (prepared->metric == DISTANCE_COSINE) return cosine_distance(dot, prepared->norm, row_norm);
+    return 1.0f - dot;
+}
+
+// ---
+// Search
+// ---
+
+// uint32_t quantized_search(const QuantizedVectors* quantized, DistanceMetric metric, const float* query,
+//                           uint32_t k, uint32_t rerank, const ConceptVectorStore* exact, Neighbor* out);
+//
+// Goal:
+// ======
+// The (up to) k nearest concepts to `query` by a full scan of the codes,
+// nearest first. With `exact` and rerank > k, the best `rerank` by code
+// distance are re-scored in fp32 from `exact` and the best k of those
+// are returned with their exact distances. Candidates with no row in
+// `exact` are dropped: a code distance does not rank against exact
+// ones, so fewer than k may come back.
+
+uint32_t quantized_search(const QuantizedVectors* quantized, DistanceMetric metric, const float* query,
+                          uint32_t k, uint32_t rerank, const ConceptVectorStore* exact, Neighbor* out) {
+    if (!quantized || !query || !out || k == 0) return 0;
+
+    uint32_t limit = exact && rerank > k ? rerank : k;
+    Neighbor* heap = quant_alloc(limit * sizeof(Neighbor), "search candidates");
+    uint32_t count = 0;
+
+    QuantizedQuery prepared;
+    prepare_quantized_query(quantized, metric, query, &prepared);
+    for (uint32_t word = 0; word < (quantized->capacity + 63) / 64; word++) {
+        uint64_t bits = quantized->present[word];
+        while (bits) {
+            uint32_t concept = word * 64 + (uint32_t)__builtin_ctzll(bits);
+            bits &= bits - 1;
+            neighbors_keep(heap, &count, limit, concept, quantized_distance(quantized, &prepared, concept));
+        }
+    }
+    free_quantized_query(&prepared);
+
+    if (limit > k) {
+        DistanceF32Fn kernel = distance_f32_kernel(metric);
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            const float* row = vector_of(exact, heap[i].concept);
+            if (!row) continue;
+            heap[kept].concept = heap[i].concept;
+            heap[kept].distance = kernel(query, row, quantized->dimensions);
+            kept++;
+        }
+        count = kept;
+    }
+    neighbors_sort(heap, count);
+
+    if (count > k) count = k;
+    memcpy(out, heap, count * sizeof(Neighbor));
+    free(heap);
+    return count;
+}
@@ -0,0 +1,676 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "query.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* check_mode_names[] = {
+    "type", "has-source", "has-target", "to-bound", "from-bound", "self"
+};
+
+// ---
+// Parsing
+// ---
+
+// Look up or register a variable name ("?x" → 0). Returns -1 when the
+// query already has QUERY_MAX_VARIABLES variables.
+static int intern_variable(Query* query, const char* name) {
+    for (uint32_t i = 0; i < query->variable_count; i++) {
+        if (strcmp(query->variable_names[i], name) == 0) return (int)i;
+    }
+    if (query->variable_count >= QUERY_MAX_VARIABLES) return -1;
+
+    snprintf(query->variable_names[query->variable_count], QUERY_NAME_MAX, "%s", name);
+    return (int)query->variable_count++;
+}
+
+// Resolve a subject/object token. Unknown concept IDs make the query
+// unsatisfiable rather than invalid: the concept may simply not exist yet.
+// Reserved (internal) concepts are never matched, so they count as unknown.
+static int parse_term(Query* query, const char* token, QueryTerm* term) {
+    if (token[0] == '?') {
+        if (strlen(token) >= QUERY_NAME_MAX) {
+            fprintf(stderr, "Query error: variable name too long: %s\n", token);
+            return 0;
+        }
+        int variable = intern_variable(query, token);
+        if (variable < 0) {
+            fprintf(stderr, "Query error: more than %d variables\n", QUERY_MAX_VARIABLES);
+            return 0;
+        }
+        term->kind = QUERY_TERM_VARIABLE;
+        term->value = (uint32_t)variable;
+        return 1;
+    }
+
+    if (token[0] == '$') {
+        char* end = NULL;
+        long number = strtol(token + 1, &end, 10);
+        if (!end || *end || number < 1 || number > QUERY_MAX_PARAMETERS) {
+            fprintf(stderr, "Query error: parameters are $1..$%d, got %s\n", QUERY_MAX_PARAMETERS, token);
+            return 0;
+        }
+        term->kind = QUERY_TERM_PARAMETER;
+        term->value = (uint32_t)(number - 1);
+        if (query->parameter_count < (uint32_t)number) query->parameter_count = (uint32_t)number;
+        return 1;
+    }
+
+    term->kind = QUERY_TERM_CONSTANT;
+    term->value = find_concept_by_id(query->store, token);
+    if (term->value != CONCEPT_NONE && store_is_reserved(query->store, term->value)) term->value = CONCEPT_NONE;
+    if (term->value == CONCEPT_NONE) {
+        query->unsatisfiable = 1;
+    }
+    return 1;
+}
+
+static int parse_clause(Query* query, char* text) {
+    char* tokens[4];
+    int token_count = 0;
+    char* save = NULL;
+    for (char* token = strtok_r(text, " \t\r\n", &save); token; token = strtok_r(NULL, " \t\r\n", &save)) {
+        if (token_count == 4) break;
+        tokens[token_count++] = token;
+    }
+
+    if (token_count == 0) return 1;     // empty clause, e.g. a trailing ';'
+    if (token_count != 3) {
+        fprintf(stderr, "Query error: expected 'subject predicate object' in clause starting '%s'\n", tokens[0]);
+        return 0;
+    }
+    if (query->clause_count >= QUERY_MAX_CLAUSES) {
+        fprintf(stderr, "Query error: more than %d clauses\n", QUERY_MAX_CLAUSES);
+        return 0;
+    }
+    if (tokens[1][0] == '?') {
+        fprintf(stderr, "Query error: variable predicates are not supported: %s\n", tokens[1]);
+        return 0;
+    }
+
+    QueryClause* clause = &query->clauses[query->clause_count];
+    if (!parse_term(query, tokens[0], &clause->subject)) return 0;
+
+    clause->is_type = (strcmp(tokens[1], "type") == 0);
+    if (clause->is_type) {
+        if (tokens[2][0] == '?') {
+            fprintf(stderr, "Query error: the type in '%s type %s' must be a name\n", tokens[0], tokens[2]);
+            return 0;
+        }
+        clause->predicate = tokens[2][0] == STORE_RESERVED_PREFIX ? SYMBOL_NONE
+                                                                 : find_symbol(&query->store->symbols, tokens[2]);
+        clause->object.kind = QUERY_TERM_CONSTANT;
+        clause->object.value = CONCEPT_NONE;
+    } else {
+        clause->predicate = find_symbol(&query->store->symbols, tokens[1]);
+        if (!parse_term(query, tokens[2], &clause->object)) return 0;
+    }
+
+    if (clause->predicate == SYMBOL_NONE || clause->predicate >= query->store->index_capacity) {
+        query->unsatisfiable = 1;
+    }
+
+    query->clause_count++;
+    return 1;
+}
+
+// ---
+// Planning
+// ---
+
+static int is_variable(const QueryTerm* term, uint32_t variable) {
+    return term->kind == QUERY_TERM_VARIABLE && term->value == variable;
+}
+
+static int mentions(const QueryClause* clause, uint32_t variable) {
+    return is_variable(&clause->subject, variable) ||
+           (!clause->is_type && is_variable(&clause->object, variable));
+}
+
+static int term_is_bound(const QueryTerm* term, const int* bound) {
+    return term->kind != QUERY_TERM_VARIABLE || bound[term->value];
+}
+
+static QueryCheckMode check_mode(const QueryClause* clause, uint32_t variable, const int* bound) {
+    if (clause->is_type) return QUERY_CHECK_TYPE;
+
+    int subject = is_variable(&clause->subject, variable);
+    int object = is_variable(&clause->object, variable);
+    if (subject && object) return QUERY_CHECK_SELF;
+    if (subject) {
+        return term_is_bound(&clause->object, bound) ? QUERY_CHECK_TO_BOUND : QUERY_CHECK_HAS_SOURCE;
+    }
+    return term_is_bound(&clause->subject, bound) ? QUERY_CHECK_FROM_BOUND : QUERY_CHECK_HAS_TARGET;
+}
+
+static double bitmap_size(const RoaringBitmap* index, Symbol symbol) {
+    return (double)roaring_cardinality(&index[symbol]);
+}
+
+// Expected number of candidates this clause would propose for the
+// variable. Constants give exact degrees; bound variables and parameters
+// use the average fan-out/fan-in of the slot name.
+static double check_estimate(const Query* query, const QueryClause* clause, QueryCheckMode mode) {
+    const ConceptStore* store = query->store;
+    Symbol p = clause->predicate;
+    if (p == SYMBOL_NONE || p >= store->index_capacity) return 0.0;
+
+    switch (mode) {
+    case QUERY_CHECK_TYPE:
+        return bitmap_size(store->type_index, p);
+    case QUERY_CHECK_HAS_SOURCE:
+    case QUERY_CHECK_SELF:
+        return bitmap_size(store->slot_source_index, p);
+    case QUERY_CHECK_HAS_TARGET:
+        return bitmap_size(store->slot_target_index, p);
+    case QUERY_CHECK_TO_BOUND: {
+        if (clause->object.kind == QUERY_TERM_CONSTANT) {
+            return clause->object.value == CONCEPT_NONE ? 0.0 : store_in_degree(store, clause->object.value);
+        }
+        double targets = bitmap_size(store->slot_target_index, p);
+        return targets ? store->slot_name_counts[p] / targets : 0.0;
+    }
+    case QUERY_CHECK_FROM_BOUND: {
+        if (clause->subject.kind == QUERY_TERM_CONSTANT) {
+            return clause->subject.value == CONCEPT_NONE ? 0.0 : store_degree(store, clause->subject.value);
+        }
+        double sources = bitmap_size(store->slot_source_index, p);
+        return sources ? store->slot_name_counts[p] / sources : 0.0;
+    }
+    }
+    return 0.0;
+}
+
+// static void plan_query(Query* query);
+//
+// Goal:
+// ======
+// Fill `steps` with a variable order and, for each step, the clauses
+// that constrain that variable.
+//
+// Key Steps:
+// ========================
+//
+// 1. Greedy order: repeatedly pick the unbound variable with the
+//    smallest estimate, preferring variables joined to something already
+//    bound (constants count as bound from the start).
+//
+// 2. With the order fixed, record for each step how every clause that
+//    mentions its variable applies there (check_mode with everything
+//    bound by earlier steps).
+//
+// 3. Remember the store size the plan was made for.
+
+static void plan_query(Query* query) {
+    int bound[QUERY_MAX_VARIABLES] = {0};
+
+    query->planned_concepts = query->store->concept_count;
+    query->planned_slots = query->store->slot_count;
+    query->planned_symbols = query->store->symbols.count;
+
+    for (uint32_t depth = 0; depth < query->variable_count; depth++) {
+        int best = -1;
+        int best_connected = 0;
+        double best_estimate = 0.0;
+
+        for (uint32_t v = 0; v < query->variable_count; v++) {
+            if (bound[v]) continue;
+
+            int connected = 0;
+            double estimate = -1.0;
+            for (uint32_t c = 0; c < query->clause_count; c++) {
+                const QueryClause* clause = &query->clauses[c];
+                if (!mentions(clause, v)) continue;
+
+                QueryCheckMode mode = check_mode(clause, v, bound);
+                double clause_estimate = check_estimate(query, clause, mode);
+                if (estimate < 0.0 || clause_estimate < estimate) estimate = clause_estimate;
+                if (mode == QUERY_CHECK_TO_BOUND || mode == QUERY_CHECK_FROM_BOUND) connected = 1;
+            }
+
+            if (best < 0 || connected > best_connected ||
+                (connected == best_connected && estimate < best_estimate)) {
+                best = (int)v;
+                best_connected = connected;
+                best_estimate = estimate;
+            }
+        }
+
+        query->steps[depth].variable = (uint32_t)best;
+        query->steps[depth].estimate = best_estimate;
+        bound[best] = 1;
+    }
+
+    memset(bound, 0, sizeof(bound));
+    for (uint32_t depth = 0; depth < query->variable_count; depth++) {
+        QueryStep* step = &query->steps[depth];
+        step->check_count = 0;
+        for (uint32_t c = 0; c < query->clause_count; c++) {
+            if (!mentions(&query->clauses[c], step->variable)) continue;
+            step->checks[step->check_count].clause = c;
+            step->checks[step->check_count].mode = check_mode(&query->clauses[c], step->variable, bound);
+            step->check_count++;
+        }
+        bound[step->variable] = 1;
+    }
+}
+
+// Parse `pattern` into an empty (or reset) Query. Returns 0 on a
+// malformed pattern, after printing why.
+static int parse_pattern(Query* query, const char* pattern) {
+    char* text = strdup(pattern);
+    if (!text) {
+        fprintf(stderr, "Failed to allocate memory for query text.\n");
+        exit(1);
+    }
+
+    int ok = 1;
+    char* save = NULL;
+    for (char* clause = strtok_r(text, ";", &save); clause && ok; clause = strtok_r(NULL, ";", &save)) {
+        ok = parse_clause(query, clause);
+    }
+    free(text);
+
+    if (ok && query->clause_count == 0) {
+        fprintf(stderr, "Query error: empty pattern\n");
+        ok = 0;
+    }
+    return ok;
+}
+
+// Query* compile_query(const ConceptStore* store, const char* pattern);
+//
+// Parse and plan. Returns NULL (after printing why) if the pattern is
+// malformed; a well-formed pattern that names unknown concepts, types or
+// slots compiles fine and simply has no answers.
+
+Query* compile_query(const ConceptStore* store, const char* pattern) {
+    if (!store || !pattern) return NULL;
+
+    Query* query = (Query*)calloc(1, sizeof(Query));
+    if (!query) {
+        fprintf(stderr, "Failed to allocate memory for Query.\n");
+        exit(1);
+    }
+    query->store = store;
+
+    if (!parse_pattern(query, pattern)) {
+        free(query);
+        return NULL;
+    }
+
+    plan_query(query);
+    return query;
+}
+
+void free_query(Query* query) {
+    if (!query) return;
+    for (uint32_t i = 0; i < QUERY_MAX_VARIABLES; i++) {
+        free(query->steps[i].candidates);
+    }
+    free(query);
+}
+
+int query_variable(const Query* query, const char* name) {
+    if (!query || !name) return -1;
+    for (uint32_t i = 0; i < query->variable_count; i++) {
+        const char* stored = query->variable_names[i];
+        if (strcmp(stored, name) == 0 || strcmp(stored + 1, name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+// ---
+// Execution
+// ---
+
+static uint32_t term_value(const Query* query, const QueryTerm* term) {
+    switch (term->kind) {
+    case QUERY_TERM_CONSTANT:  return term->value;
+    case QUERY_TERM_PARAMETER: return query->parameters[term->value];
+    case QUERY_TERM_VARIABLE:  break;
+    }
+    return query->bindings[term->value];
+}
+
+static void reserve_candidates(QueryStep* step, uint32_t needed) {
+    if (needed <= step->candidate_capacity) return;
+
+    uint32_t new_capacity = step->candidate_capacity ? step->candidate_capacity : 16;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    uint32_t* candidates = realloc(step->candidates, new_capacity * sizeof(uint32_t));
+    if (!candidates) {
+        fprintf(stderr, "Failed to allocate memory for query candidates.\n");
+        exit(1);
+    }
+    step->candidates = candidates;
+    step->candidate_capacity = new_capacity;
+}
+
+// In-place sort without qsort(), whose glibc implementation may malloc
+// a scratch buffer. Neighbor lists are short, so insertion sort covers
+// the common case and heapsort bounds the hubs.
+static void sift_down(uint32_t* values, uint32_t root, uint32_t count) {
+    for (;;) {
+        uint32_t child = 2 * root + 1;
+        if (child >= count) return;
+        if (child + 1 < count && values[child + 1] > values[child]) child++;
+        if (values[root] >= values[child]) return;
+        uint32_t swap = values[root];
+        values[root] = values[child];
+        values[child] = swap;
+        root = child;
+    }
+}
+
+static void sort_indexes(uint32_t* values, uint32_t count) {
+    if (count <= 32) {
+        for (uint32_t i = 1; i < count; i++) {
+            uint32_t value = values[i];
+            uint32_t j = i;
+            while (j > 0 && values[j - 1] > value) {
+                values[j] = values[j - 1];
+                j--;
+            }
+            values[j] = value;
+        }
+        return;
+    }
+
+    for (uint32_t i = count / 2; i-- > 0;) {
+        sift_down(values, i, count);
+    }
+    for (uint32_t end = count - 1; end > 0; end--) {
+        uint32_t swap = values[0];
+        values[0] = values[end];
+        values[end] = swap;
+        sift_down(values, 0, end);
+    }
+}
+
+// Neighbors from a segment may repeat (two "owns" slots to the same
+// book); sort and drop duplicates so every answer is produced once.
+static uint32_t sort_unique(uint32_t* values, uint32_t count) {
+    if (count < 2) return count;
+    sort_indexes(values, count);
+    uint32_t unique = 1;
+    for (uint32_t i = 1; i < count; i++) {
+        if (values[i] != values[unique - 1]) values[unique++] = values[i];
+    }
+    return unique;
+}
+
+// Number of candidates a check would propose right now (for SELF, an
+// upper bound: the sources before the self-loop filter).
+static uint64_t proposal_size(const Query* query, const QueryCheck* check) {
+    const ConceptStore* store = query->store;
+    const QueryClause* clause = &query->clauses[check->clause];
+    Symbol p = clause->predicate;
+
+    switch (check->mode) {
+    case QUERY_CHECK_TYPE:       return roaring_cardinality(&store->type_index[p]);
+    case QUERY_CHECK_HAS_SOURCE:
+    case QUERY_CHECK_SELF:       return roaring_cardinality(&store->slot_source_index[p]);
+    case QUERY_CHECK_HAS_TARGET: return roaring_cardinality(&store->slot_target_index[p]);
+    case QUERY_CHECK_TO_BOUND:   return store_in_degree(store, term_value(query, &clause->object));
+    case QUERY_CHECK_FROM_BOUND: return store_degree(store, term_value(query, &clause->subject));
+    }
+    return 0;
+}
+
+// Materialize the proposal of `check` into the step's buffer.
+static uint32_t propose(Query* query, QueryStep* step, const QueryCheck* check, uint64_t size) {
+    const ConceptStore* store = query->store;
+    const QueryClause* clause = &query->clauses[check->clause];
+    Symbol p = clause->predicate;
+
+    reserve_candidates(step, (uint32_t)size);
+
+    switch (check->mode) {
+    case QUERY_CHECK_TYPE:
+        return roaring_to_array(&store->type_index[p], step->candidates);
+    case QUERY_CHECK_HAS_SOURCE:
+        return roaring_to_array(&store->slot_source_index[p], step->candidates);
+    case QUERY_CHECK_SELF: {
+        // The index only says "has some p slot"; keep the sources whose
+        // own segment holds a p slot back to themselves.
+        uint32_t sources = roaring_to_array(&store->slot_source_index[p], step->candidates);
+        uint32_t found = 0;
+        for (uint32_t i = 0; i < sources; i++) {
+            uint32_t source = step->candidates[i];
+            if (store_has_slot(store, source, p, source)) step->candidates[found++] = source;
+        }
+        return found;
+    }
+    case QUERY_CHECK_HAS_TARGET:
+        return roaring_to_array(&store->slot_target_index[p], step->candidates);
+    case QUERY_CHECK_TO_BOUND: {
+        uint32_t object = term_value(query, &clause->object);
+        const Symbol* names = store_in_slot_names(store, object);
+        const uint32_t* sources = store_in_slot_sources(store, object);
+        uint32_t found = 0;
+        for (uint32_t i = 0; i < size; i++) {
+            if (names[i] == p && !store_is_reserved(store, sources[i])) step->candidates[found++] = sources[i];
+        }
+        return sort_unique(step->candidates, found);
+    }
+    case QUERY_CHECK_FROM_BOUND: {
+        uint32_t subject = term_value(query, &clause->subject);
+        const Symbol* names = store_slot_names(store, subject);
+        const uint32_t* targets = store_slot_targets(store, subject);
+        uint32_t found = 0;
+        for (uint32_t i = 0; i < size; i++) {
+            if (names[i] == p && !store_is_reserved(store, targets[i])) step->candidates[found++] = targets[i];
+        }
+        return sort_unique(step->candidates, found);
+    }
+    }
+    return 0;
+}
+
+static int verify(const Query* query, const QueryCheck* check, uint32_t candidate) {
+    const ConceptStore* store = query->store;
+    const QueryClause* clause = &query->clauses[check->clause];
+    Symbol p = clause->predicate;
+
+    switch (check->mode) {
+    case QUERY_CHECK_TYPE:       return store->type_symbols[candidate] == p;
+    case QUERY_CHECK_HAS_SOURCE: return roaring_contains(&store->slot_source_index[p], candidate);
+    case QUERY_CHECK_HAS_TARGET: return roaring_contains(&store->slot_target_index[p], candidate);
+    case QUERY_CHECK_SELF:       return store_has_slot(store, candidate, p, candidate);
+    case QUERY_CHECK_TO_BOUND:   return store_has_slot(store, candidate, p, term_value(query, &clause->object));
+    case QUERY_CHECK_FROM_BOUND: return store_has_slot(store, term_value(query, &clause->subject), p, candidate);
+    }
+    return 0;
+}
+
+// Bind steps[depth].variable to every candidate that passes all checks
+// and recurse. Returns 1 if the callback asked to stop.
+static int run_step(Query* query, uint32_t depth, QueryCallback callback, void* user_data, uint64_t* answers) {
+    if (depth == query->variable_count) {
+        (*answers)++;
+        return callback ? callback(query->bindings, user_data) != 0 : 0;
+    }
+
+    QueryStep* step = &query->steps[depth];
+
+    uint32_t best = 0;
+    uint64_t best_size = UINT64_MAX;
+    for (uint32_t i = 0; i < step->check_count; i++) {
+        uint64_t size = proposal_size(query, &step->checks[i]);
+        if (size < best_size) {
+            best = i;
+            best_size = size;
+        }
+    }
+    if (best_size == 0) return 0;
+
+    uint32_t count = propose(query, step, &step->checks[best], best_size);
+    for (uint32_t c = 0; c < count; c++) {
+        uint32_t candidate = step->candidates[c];
+
+        int ok = 1;
+        for (uint32_t i = 0; i < step->check_count && ok; i++) {
+            if (i != best) ok = verify(query, &step->checks[i], candidate);
+        }
+        if (!ok) continue;
+
+        query->bindings[step->variable] = candidate;
+        if (run_step(query, depth + 1, callback, user_data, answers)) return 1;
+    }
+    return 0;
+}
+
+// Clauses with no variables ("john owns book1", "$1 type Person") hold
+// or fail once per run.
+static int ground_clauses_hold(const Query* query) {
+    for (uint32_t c = 0; c < query->clause_count; c++) {
+        const QueryClause* clause = &query->clauses[c];
+        if (clause->subject.kind == QUERY_TERM_VARIABLE) continue;
+
+        uint32_t subject = term_value(query, &clause->subject);
+        if (clause->is_type) {
+            if (query->store->type_symbols[subject] != clause->predicate) return 0;
+        } else if (clause->object.kind != QUERY_TERM_VARIABLE) {
+            uint32_t object = term_value(query, &clause->object);
+            if (!store_has_slot(query->store, subject, clause->predicate, object)) return 0;
+        }
+    }
+    return 1;
+}
+
+// uint64_t run_prepared_query(Query* query, const uint32_t* parameters, uint32_t parameter_count,
+//                             QueryCallback callback, void* user_data);
+//
+// Enumerate answers with $1..$N bound to parameters[0..N-1], calling
+// `callback` (if non-NULL) for each one. Returns the number of answers.
+// Missing parameters, or ones that are not valid concept indexes (e.g. a
+// CONCEPT_NONE from a failed lookup), simply give no answers.
+// `callback` must not modify the store while the query runs.
+
+uint64_t run_prepared_query(Query* query, const uint32_t* parameters, uint32_t parameter_count,
+                            QueryCallback callback, void* user_data) {
+    if (!query || query->unsatisfiable) return 0;
+    if (parameter_count < query->parameter_count) return 0;
+
+    for (uint32_t i = 0; i < query->parameter_count; i++) {
+        if (parameters[i] >= query->store->concept_count) return 0;
+        query->parameters[i] = parameters[i];
+    }
+    if (!ground_clauses_hold(query)) return 0;
+
+    uint64_t answers = 0;
+    run_step(query, 0, callback, user_data, &answers);
+    return answers;
+}
+
+uint64_t run_query(Query* query, QueryCallback callback, void* user_data) {
+    return run_prepared_query(query, NULL, 0, callback, user_data);
+}
+
+void print_query_plan(const Query* query) {
+    if (!query) return;
+
+    printf("Query plan (%u clauses, %u variables, %u parameters%s):\n", query->clause_count,
+           query->variable_count, query->parameter_count, query->unsatisfiable ? ", unsatisfiable" : "");
+    for (uint32_t depth = 0; depth < query->variable_count; depth++) {
+        const QueryStep* step = &query->steps[depth];
+        printf("\t%u. %s (estimate %.1f)\n", depth + 1, query->variable_names[step->variable], step->estimate);
+        for (uint32_t i = 0; i < step->check_count; i++) {
+            printf("\t\tclause %u: %s\n", step->checks[i].clause + 1, check_mode_names[step->checks[i].mode]);
+        }
+    }
+}
+
+// ---
+// Prepared query cache
+// ---
+
+QueryCache* create_query_cache(const ConceptStore* store) {
+    if (!store) return NULL;
+
+    QueryCache* cache = (QueryCache*)calloc(1, sizeof(QueryCache));
+    if (!cache) {
+        fprintf(stderr, "Failed to allocate memory for QueryCache.\n");
+        exit(1);
+    }
+    cache->store = store;
+    init_symbol_table(&cache->patterns);
+    return cache;
+}
+
+void free_query_cache(QueryCache* cache) {
+    if (!cache) return;
+    for (uint32_t i = 0; i < cache->patterns.count; i++) {
+        free_query(cache->queries[i]);
+    }
+    free(cache->queries);
+    free_symbol_table(&cache->patterns);
+    free(cache);
+}
+
+// Bring a cached query up to date with the store.
+//
+// - Unsatisfiable and the store has new names: re-parse in place. The
+//   pattern parsed before, so it parses again; candidate buffers are kept.
+// - Store doubled in concepts or slots since planning: re-plan only.
+static void refresh_query(Query* query, const char* pattern) {
+    const ConceptStore* store = query->store;
+
+    if (query->unsatisfiable &&
+        (store->concept_count != query->planned_concepts || store->symbols.count != query->planned_symbols)) {
+        query->clause_count = 0;
+        query->variable_count = 0;
+        query->parameter_count = 0;
+        query->unsatisfiable = 0;
+        parse_pattern(query, pattern);
+        plan_query(query);
+        return;
+    }
+
+    if (store->concept_count >= 2 * (uint64_t)query->planned_concepts + 64 ||
+        store->slot_count >= 2 * (uint64_t)query->planned_slots + 64) {
+        plan_query(query);
+    }
+}
+
+// Query* prepare_query(QueryCache* cache, const char* pattern);
+//
+// Goal:
+// ======
+// Return the compiled Query for `pattern`, compiling it on first use.
+//
+// The Query stays owned by the cache (do not free_query() it) and is
+// valid until free_query_cache(). Returns NULL for a malformed pattern;
+// malformed patterns are not cached, so they report their error on
+// every call.
+
+Query* prepare_query(QueryCache* cache, const char* pattern) {
+    if (!cache || !pattern) return NULL;
+
+    Symbol symbol = find_symbol(&cache->patterns, pattern);
+    if (symbol != SYMBOL_NONE) {
+        refresh_query(cache->queries[symbol], pattern);
+        return cache->queries[symbol];
+    }
+
+    Query* query = compile_query(cache->store, pattern);
+    if (!query) return NULL;
+
+    symbol = intern_symbol(&cache->patterns, pattern);
+    if (symbol >= cache->query_capacity) {
+        uint32_t new_capacity = cache->query_capacity ? cache->query_capacity * 2 : 16;
+        Query** queries = realloc(cache->queries, new_capacity * sizeof(Query*));
+        if (!queries) {
+            fprintf(stderr, "Failed to allocate memory for query cache.\n");
+            exit(1);
+        }
+        cache->queries = queries;
+        cache->query_capacity = new_capacity;
+    }
+    cache->queries[symbol] = query;
+    return query;
+}
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "rank.h"
+
+// Heap order: the *worst* kept slot sits at the root so it can be
+// replaced. Lower score is worse; on equal scores the later slot is worse,
+// which keeps earlier slots ahead in the final output.
+static int worse(const RankedSlot* a, const RankedSlot* b) {
+    if (a->score != b->score) return a->score < b->score;
+    return a->position > b->position;
+}
+
+static void swap_slots(RankedSlot* a, RankedSlot* b) {
+    RankedSlot swap = *a;
+    *a = *b;
+    *b = swap;
+}
+
+static void sift_up(RankedSlot* heap, uint32_t index) {
+    while (index > 0) {
+        uint32_t parent = (index - 1) / 2;
+        if (!worse(&heap[index], &heap[parent])) return;
+        swap_slots(&heap[index], &heap[parent]);
+        index = parent;
+    }
+}
+
+static void sift_down(RankedSlot* heap, uint32_t index, uint32_t count) {
+    for (;;) {
+        uint32_t child = 2 * index + 1;
+        if (child >= count) return;
+        if (child + 1 < count && worse(&heap[child + 1], &heap[child])) child++;
+        if (!worse(&heap[child], &heap[index])) return;
+        swap_slots(&heap[index], &heap[child]);
+        index = child;
+    }
+}
+
+// uint32_t top_k_slots(const ConceptStore* store, uint32_t concept, const char* slot_name,
+//                      uint32_t k, RankedSlot* out);
+//
+// Goal:
+// ======
+// Write the (up to) k highest-scoring slots of `concept` named
+// `slot_name` (any name if NULL) into out[0..k), best first, and return
+// how many were written.
+//
+// Key Steps:
+// ========================
+//
+// 1. `out` itself is the heap: fill it with the first k matches, then
+//    each further match replaces the root only if it beats it.
+//
+// 2. Pop the heap from the back: repeatedly move the worst element to
+//    the end, which leaves `out` sorted best-first.
+
+uint32_t top_k_slots(const ConceptStore* store, uint32_t concept, const char* slot_name,
+                     uint32_t k, RankedSlot* out) {
+    if (!store || !out || k == 0 || concept >= store->concept_count) return 0;
+
+    Symbol wanted = SYMBOL_NONE;
+    if (slot_name) {
+        wanted = find_symbol(&store->symbols, slot_name);
+        if (wanted == SYMBOL_NONE) return 0;
+    }
+
+    const Symbol* names = store_slot_names(store, concept);
+    const uint32_t* targets = store_slot_targets(store, concept);
+    const SlotMeta* meta = store_slot_meta(store, concept);
+    uint32_t degree = store_degree(store, concept);
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < degree; i++) {
+        if (slot_name && names[i] != wanted) continue;
+
+        RankedSlot candidate;
+        candidate.target = targets[i];
+        candidate.name = names[i];
+        candidate.score = meta ? meta[i].weight * meta[i].confidence : 1.0f;
+        candidate.position = i;
+
+        if (count < k) {
+            out[count] = candidate;
+            sift_up(out, count);
+            count++;
+        } else if (worse(&out[0], &candidate)) {
+            out[0] = candidate;
+            sift_down(out, 0, count);
+        }
+    }
+
+    for (uint32_t end = count; end > 1; end--) {
+        swap_slots(&out[0], &out[end - 1]);
+        sift_down(out, 0, end - 1);
+    }
+    return count;
+}
@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "resolve.h"
+#include "distance.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void* resolve_grow(void* ptr, size_t size, const char* what) {
+    void* grown = realloc(ptr, size ? size : 1);
+    if (!grown) {
+        fprintf(stderr, "Failed to allocate memory for %s.\n", what);
+        exit(1);
+    }
+    return grown;
+}
+
+void init_resolve_workspace(ResolveWorkspace* workspace) {
+    if (!workspace) return;
+    memset(workspace, 0, sizeof(ResolveWorkspace));
+}
+
+void free_resolve_workspace(ResolveWorkspace* workspace) {
+    if (!workspace) return;
+    free(workspace->token_norms);
+    free(workspace->end_offsets);
+    free(workspace->weights);
+    free(workspace->confidences);
+    free(workspace->order);
+    free(workspace->best);
+    memset(workspace, 0, sizeof(ResolveWorkspace));
+}
+
+static void reserve_workspace(ResolveWorkspace* workspace, uint32_t token_count, uint32_t mention_count) {
+    if (token_count + 2 > workspace->token_capacity) {
+        uint32_t capacity = token_count + 2;
+        workspace->token_norms = resolve_grow(workspace->token_norms, capacity * sizeof(float), "token norms");
+        workspace->end_offsets = resolve_grow(workspace->end_offsets, capacity * sizeof(uint32_t), "span order");
+        workspace->token_capacity = capacity;
+    }
+    if (mention_count + 1 > workspace->mention_capacity) {
+        uint32_t capacity = mention_count + 1;
+        workspace->weights = resolve_grow(workspace->weights, capacity * sizeof(float), "span weights");
+        workspace->confidences = resolve_grow(workspace->confidences, capacity * sizeof(float), "span weights");
+        workspace->order = resolve_grow(workspace->order, capacity * sizeof(uint32_t), "span order");
+        workspace->best = resolve_grow(workspace->best, capacity * sizeof(float), "span scores");
+        workspace->mention_capacity = capacity;
+    }
+}
+
+// ---
+// Confidence
+// ---
+
+static float token_norm(ResolveWorkspace* workspace, const float* token, uint32_t t, uint32_t dimensions) {
+    float norm = workspace->token_norms[t];
+    if (norm < 0.0f) {
+        norm = vector_norm(token, dimensions);
+        workspace->token_norms[t] = norm;
+    }
+    return norm;
+}
+
+// Mean cosine between `embedding` and the tokens in [from, to), added to
+// `sum`; returns how many tokens counted (zero vectors are skipped).
+static uint32_t add_similarities(ResolveWorkspace* workspace, const float* embedding, float norm,
+                                 const float* tokens, size_t stride, uint32_t dimensions, uint32_t from,
+                                 uint32_t to, float* sum) {
+    uint32_t counted = 0;
+    for (uint32_t t = from; t < to; t++) {
+        const float* token = tokens + (size_t)t * stride;
+        float token_length = token_norm(workspace, token, t, dimensions);
+        if (token_length == 0.0f) continue;
+        *sum += dot_f32(embedding, token, dimensions) / (norm * token_length);
+        counted++;
+    }
+    return counted;
+}
+
+// c(span) = P(concept) · ContextSimilarity, see "Confidence" in resolve.h.
+static float mention_confidence(const ConceptStore* store, const ConceptVectorStore* vectors, const float* tokens,
+                                size_t stride, uint32_t token_count, uint32_t begin, uint32_t end,
+                                uint32_t concept, uint32_t window, ResolveWorkspace* workspace) {
+    float prior = store_concept_prior(store, concept);
+    const float* embedding = (vectors && tokens) ? vector_of(vectors, concept) : NULL;
+    if (!embedding) return prior * 0.5f;
+
+    uint32_t dimensions = vectors->dimensions;
+    float norm = vector_norm(embedding, dimensions);
+    if (norm == 0.0f) return prior * 0.5f;
+
+    uint32_t left = begin > window ? begin - window : 0;
+    uint32_t right = token_count - end > window ? end + window : token_count;
+    float sum = 0.0f;
+    uint32_t counted = add_similarities(workspace, embedding, norm, tokens, stride, dimensions, left, begin, &sum) +
+                       add_similarities(workspace, embedding, norm, tokens, stride, dimensions, end, right, &sum);
+    if (counted == 0) return prior * 0.5f;
+
+    float similarity = 0.5f * (1.0f + sum / (float)counted);
+    if (similarity < 0.0f) similarity = 0.0f;
+    if (similarity > 1.0f) similarity = 1.0f;
+    return prior * similarity;
+}
+
+// ---
+// Selection
+// ---
+
+// uint32_t resolve_mentions(const ConceptStore* store, const ConceptVectorStore* vectors, const float* tokens,
+//                           size_t stride, uint32_t token_count, const EntityMention* mentions,
+//                           uint32_t mention_count, uint32_t window, ResolveWorkspace* workspace,
+//                           ResolvedMention* out);
+//
+// Goal:
+// ======
+// Pick the best non-overlapping subset of candidate `mentions` (token
+// spans of a turn of `token_count` tokens, e.g. from matcher_scan_tokens())
+// and write it to `out` in text order; returns how many were picked.
+// `out` needs room for min(mention_count, token_count) entries.
+//
+// `tokens` holds one embedding of vectors->dimensions floats per token,
+// `stride` floats apart (NULL: priors only). `window` 0 means
+// RESOLVE_DEFAULT_WINDOW.
+//
+// Key Steps:
+// ========================
+//
+// 1. Score every valid mention (see "Confidence" in resolve.h). Spans
+//    past the turn or naming no concept of `store` weigh 0 and are
+//    never picked.
+// 2. Counting-sort mentions by end; the prefix sums give p(j) for free.
+// 3. best(j) = max(best(j-1), weight(j) + best(p(j))), then walk back
+//    from the end, taking span j whenever it improved on best(j-1).
+
+uint32_t resolve_mentions(const ConceptStore* store, const ConceptVectorStore* vectors, const float* tokens,
+                          size_t stride, uint32_t token_count, const EntityMention* mentions,
+                          uint32_t mention_count, uint32_t window, ResolveWorkspace* workspace,
+                          ResolvedMention* out) {
+    if (!store || !mentions || !workspace || !out || mention_count == 0 || token_count == 0) return 0;
+    if (window == 0) window = RESOLVE_DEFAULT_WINDOW;
+
+    reserve_workspace(workspace, token_count, mention_count);
+    float* weights = workspace->weights;
+    float* confidences = workspace->confidences;
+    uint32_t* offsets = workspace->end_offsets;
+    uint32_t* order = workspace->order;
+    float* best = workspace->best;
+
+    for (uint32_t t = 0; t < token_count; t++) workspace->token_norms[t] = -1.0f;
+
+    for (uint32_t i = 0; i < mention_count; i++) {
+        const EntityMention* mention = &mentions[i];
+        weights[i] = 0.0f;
+        confidences[i] = 0.0f;
+        if (mention->begin >= mention->end || mention->end > token_count || mention->concept >= store->concept_count) {
+            continue;
+        }
+        confidences[i] = mention_confidence(store, vectors, tokens, stride, token_count, mention->begin,
+                                            mention->end, mention->concept, window, workspace);
+        weights[i] = confidences[i] * (float)(mention->end - mention->begin);
+    }
+
+    // offsets[e] = number of mentions ending before token e; clamped ends
+    // of invalid mentions only need some slot, their weight is 0.
+    memset(offsets, 0, (token_count + 2) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < mention_count; i++) {
+        uint32_t end = mentions[i].end <= token_count ? mentions[i].end : token_count;
+        offsets[end + 1]++;
+    }
+    for (uint32_t e = 0; e <= token_count; e++) offsets[e + 1] += offsets[e];
+    for (uint32_t i = 0; i < mention_count; i++) {
+        uint32_t end = mentions[i].end <= token_count ? mentions[i].end : token_count;
+        order[offsets[end]++] = i;
+    }
+    // The scatter advanced offsets[e] to "ending at or before e".
+
+    best[0] = 0.0f;
+    for (uint32_t j = 0; j < mention_count; j++) {
+        uint32_t i = order[j];
+        uint32_t begin = mentions[i].begin < token_count ? mentions[i].begin : token_count;
+        float take = weights[i] + best[offsets[begin]];
+        best[j + 1] = (weights[i] > 0.0f && take > best[j]) ? take : best[j];
+    }
+
+    uint32_t count = 0;
+    for (uint32_t j = mention_count; j > 0;) {
+        if (best[j] == best[j - 1]) {
+            j--;
+            continue;
+        }
+        uint32_t i = order[j - 1];
+        out[count++] = (ResolvedMention){ mentions[i].begin, mentions[i].end, mentions[i].concept, confidences[i] };
+        j = offsets[mentions[i].begin];
+    }
+
+    for (uint32_t a = 0, b = count ? count - 1 : 0; a < b; a++, b--) {
+        ResolvedMention swap = out[a];
+        out[a] = out[b];
+        out[b] = swap;
+    }
+    return count;
+}
@@ -0,0 +1,238 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "scan.h"
+#include "cpu.h"
+#include <string.h>
+
+#if CLARITY_X86
+#include <immintrin.h>
+#endif
+
+typedef struct ScanKernels {
+    const char* name;
+    uint32_t (*indexes)(const Symbol* values, uint32_t count, Symbol needle, uint32_t* out);
+    uint64_t (*match_block)(const Symbol* values, Symbol needle);   // exactly 64 values
+} ScanKernels;
+
+// ---
+// Scalar fallback
+// ---
+
+static uint32_t indexes_scalar(const Symbol* values, uint32_t count, Symbol needle, uint32_t* out) {
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (values[i] == needle) {
+            out[found++] = i;
+        }
+    }
+    return found;
+}
+
+static uint64_t match_block_scalar(const Symbol* values, Symbol needle) {
+    uint64_t word = 0;
+    for (uint32_t i = 0; i < 64; i++) {
+        word |= (uint64_t)(values[i] == needle) << i;
+    }
+    return word;
+}
+
+#if CLARITY_X86
+
+// Emit `base + bit` for every set bit of `mask`.
+static inline uint32_t emit_mask(uint32_t mask, uint32_t base, uint32_t* out) {
+    uint32_t found = 0;
+    while (mask) {
+        out[found++] = base + (uint32_t)__builtin_ctz(mask);
+        mask &= mask - 1;
+    }
+    return found;
+}
+
+// ---
+// SSE2: 4 symbols per compare
+// ---
+
+__attribute__((target("sse2")))
+static uint32_t indexes_sse2(const Symbol* values, uint32_t count, Symbol needle, uint32_t* out) {
+    __m128i key = _mm_set1_epi32((int)needle);
+    uint32_t found = 0;
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(values + i));
+        uint32_t mask = (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(chunk, key)));
+        found += emit_mask(mask, i, out + found);
+    }
+    for (; i < count; i++) {
+        if (values[i] == needle) out[found++] = i;
+    }
+    return found;
+}
+
+__attribute__((target("sse2")))
+static uint64_t match_block_sse2(const Symbol* values, Symbol needle) {
+    __m128i key = _mm_set1_epi32((int)needle);
+    uint64_t word = 0;
+    for (uint32_t i = 0; i < 64; i += 4) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(values + i));
+        uint64_t mask = (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(chunk, key)));
+        word |= mask << i;
+    }
+    return word;
+}
+
+// ---
+// AVX2: 8 symbols per compare
+// ---
+
+__attribute__((target("avx2")))
+static uint32_t indexes_avx2(const Symbol* values, uint32_t count, Symbol needle, uint32_t* out) {
+    __m256i key = _mm256_set1_epi32((int)needle);
+    uint32_t found = 0;
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(values + i));
+        uint32_t mask = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(chunk, key)));
+        found += emit_mask(mask, i, out + found);
+    }
+    for (; i < count; i++) {
+        if (values[i] == needle) out[found++] = i;
+    }
+    return found;
+}
+
+__attribute__((target("avx2")))
+static uint64_t match_block_avx2(const Symbol* values, Symbol needle) {
+    __m256i key = _mm256_set1_epi32((int)needle);
+    uint64_t word = 0;
+    for (uint32_t i = 0; i < 64; i += 8) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(values + i));
+        uint64_t mask = (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(chunk, key)));
+        word |= mask << i;
+    }
+    return word;
+}
+
+// ---
+// AVX-512: 16 symbols per compare, matches compacted with vpcompressd
+// ---
+
+__attribute__((target("avx512f")))
+static uint32_t indexes_avx512(const Symbol* values, uint32_t count, Symbol needle, uint32_t* out) {
+    __m512i key = _mm512_set1_epi32((int)needle);
+    __m512i lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m512i step = _mm512_set1_epi32(16);
+    uint32_t found = 0;
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512i chunk = _mm512_loadu_si512((const void*)(values + i));
+        __mmask16 mask = _mm512_cmpeq_epi32_mask(chunk, key);
+        _mm512_mask_compressstoreu_epi32(out + found, mask, lane);
+        found += (uint32_t)__builtin_popcount(mask);
+        lane = _mm512_add_epi32(lane, step);
+    }
+    for (; i < count; i++) {
+        if (values[i] == needle) out[found++] = i;
+    }
+    return found;
+}
+
+__attribute__((target("avx512f")))
+static uint64_t match_block_avx512(const Symbol* values, Symbol needle) {
+    __m512i key = _mm512_set1_epi32((int)needle);
+    uint64_t word = 0;
+    for (uint32_t i = 0; i < 64; i += 16) {
+        __m512i chunk = _mm512_loadu_si512((const void*)(values + i));
+        word |= (uint64_t)_mm512_cmpeq_epi32_mask(chunk, key) << i;
+    }
+    return word;
+}
+
+#endif
+
+static const ScanKernels scan_kernels_table[] = {
+    { "scalar", indexes_scalar, match_block_scalar },
+#if CLARITY_X86
+    { "sse2",   indexes_sse2,   match_block_sse2 },
+    { "avx2",   indexes_avx2,   match_block_avx2 },
+    { "avx512", indexes_avx512, match_block_avx512 },
+#endif
+};
+
+static const ScanKernels* scan_kernels(void) {
+#if CLARITY_X86
+    return &scan_kernels_table[cpu_level()];
+#else
+    return &scan_kernels_table[0];
+#endif
+}
+
+const char* scan_kernel_name(void) {
+    return scan_kernels()->name;
+}
+
+uint32_t scan_symbol_indexes(const Symbol* values, uint32_t count, Symbol needle, uint32_t* out) {
+    if (!values || !out) return 0;
+    return scan_kernels()->indexes(values, count, needle, out);
+}
+
+// void scan_symbol_bitmap(const Symbol* values, uint32_t count, Symbol needle, uint64_t* bitmap);
+//
+// Whole 64-value blocks go through the SIMD kernel; the last partial
+// word is done in scalar so unused high bits always come out zero.
+
+void scan_symbol_bitmap(const Symbol* values, uint32_t count, Symbol needle, uint64_t* bitmap) {
+    if (!values || !bitmap) return;
+
+    const ScanKernels* kernels = scan_kernels();
+    uint32_t full_words = count / 64;
+    for (uint32_t w = 0; w < full_words; w++) {
+        bitmap[w] = kernels->match_block(values + w * 64, needle);
+    }
+
+    uint32_t tail = count % 64;
+    if (tail) {
+        uint64_t word = 0;
+        const Symbol* block = values + full_words * 64;
+        for (uint32_t i = 0; i < tail; i++) {
+            word |= (uint64_t)(block[i] == needle) << i;
+        }
+        bitmap[full_words] = word;
+    }
+}
+
+// ---
+// Store-level filters
+// ---
+//
+// An unknown type or slot name was never interned, so nothing can match:
+// return an empty result without scanning.
+
+uint32_t scan_concepts_by_type(const ConceptStore* store, const char* type, uint32_t* out) {
+    if (!store || !type) return 0;
+
+    Symbol symbol = find_symbol(&store->symbols, type);
+    if (symbol == SYMBOL_NONE) return 0;
+
+    return scan_symbol_indexes(store->type_symbols, store->concept_count, symbol, out);
+}
+
+void scan_concepts_by_type_bitmap(const ConceptStore* store, const char* type, uint64_t* bitmap) {
+    if (!store || !type || !bitmap) return;
+
+    Symbol symbol = find_symbol(&store->symbols, type);
+    if (symbol == SYMBOL_NONE) {
+        memset(bitmap, 0, ((store->concept_count + 63) / 64) * sizeof(uint64_t));
+        return;
+    }
+
+    scan_symbol_bitmap(store->type_symbols, store->concept_count, symbol, bitmap);
+}
+
+uint32_t scan_slots_by_name(const ConceptStore* store, uint32_t concept, const char* slot_name, uint32_t* out) {
+    if (!store || !slot_name || concept >= store->concept_count) return 0;
+
+    Symbol symbol = find_symbol(&store->symbols, slot_name);
+    if (symbol == SYMBOL_NONE) return 0;
+
+    return scan_symbol_indexes(store_slot_names(store, concept), store_degree(store, concept), symbol, out);
+}
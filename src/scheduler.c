@@ -0,0 +1,569 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "scheduler.h"
+#include "cpu.h"
+#include "numa.h"
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if CLARITY_X86
+#include <immintrin.h>
+#endif
+
+#define SCHEDULER_SPINS_BEFORE_SLEEP 256
+#define SCHEDULER_SPINS_BEFORE_YIELD 64
+#define DEQUE_INITIAL_SIZE 256
+
+struct Task {
+    void (*run)(Task* task);
+    TaskGroup* group;
+
+    TaskFn fn;                  // scheduler_spawn()
+    void* arg;
+
+    RangeFn range;              // parallel_for()
+    ShardFn shard_fn;           // parallel_for_shards()
+    void* context;
+    uint32_t begin;
+    uint32_t end;
+    uint32_t grain;
+};
+
+typedef struct TaskRing {
+    int64_t mask;               // size - 1, size a power of two
+    struct TaskRing* previous;  // replaced rings, freed with the deque
+    Task* items[];
+} TaskRing;
+
+// `top` and `bottom` on separate lines: thieves hammer one, the owner
+// the other.
+struct TaskDeque {
+    int64_t top;
+    char pad[56];
+    int64_t bottom;
+    TaskRing* ring;
+};
+
+static __thread Worker* current_worker;
+
+static void* scheduler_alloc(size_t size, const char* what) {
+    void* ptr = malloc(size);
+    if (!ptr) {
+        fprintf(stderr, "Failed to allocate memory for %s.\n", what);
+        exit(1);
+    }
+    return ptr;
+}
+
+static void cpu_relax(void) {
+#if CLARITY_X86
+    _mm_pause();
+#endif
+}
+
+// ---
+// Chase–Lev deque
+// ---
+
+static TaskRing* new_ring(int64_t size, TaskRing* previous) {
+    TaskRing* ring = scheduler_alloc(sizeof(TaskRing) + (size_t)size * sizeof(Task*), "task deque");
+    ring->mask = size - 1;
+    ring->previous = previous;
+    return ring;
+}
+
+static TaskDeque* new_deque(void) {
+    TaskDeque* deque = scheduler_alloc(sizeof(TaskDeque), "task deque");
+    memset(deque, 0, sizeof(TaskDeque));
+    deque->ring = new_ring(DEQUE_INITIAL_SIZE, NULL);
+    return deque;
+}
+
+static void free_deque(TaskDeque* deque) {
+    TaskRing* ring = deque->ring;
+    while (ring) {
+        TaskRing* previous = ring->previous;
+        free(ring);
+        ring = previous;
+    }
+    free(deque);
+}
+
+// Owner only. The new entry is written before `bottom` moves past it
+// (release fence), so a thief that sees the new bottom sees the task.
+static void deque_push(TaskDeque* deque, Task* task) {
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    TaskRing* ring = __atomic_load_n(&deque->ring, __ATOMIC_RELAXED);
+
+    if (bottom - top > ring->mask) {
+        TaskRing* grown = new_ring((ring->mask + 1) * 2, ring);
+        for (int64_t i = top; i < bottom; i++) {
+            grown->items[i & grown->mask] = ring->items[i & ring->mask];
+        }
+        __atomic_store_n(&deque->ring, grown, __ATOMIC_RELEASE);
+        ring = grown;
+    }
+
+    __atomic_store_n(&ring->items[bottom & ring->mask], task, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+}
+
+// Owner only. Claim the bottom entry first, then look at `top`; only
+// the very last entry can be contended, and a CAS on `top` settles it.
+static Task* deque_take(TaskDeque* deque) {
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    TaskRing* ring = __atomic_load_n(&deque->ring, __ATOMIC_RELAXED);
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+    if (top > bottom) {
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    Task* task = __atomic_load_n(&ring->items[bottom & ring->mask], __ATOMIC_RELAXED);
+    if (top == bottom) {
+        if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, 0,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            task = NULL;
+        }
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+    return task;
+}
+
+// Any thread. NULL if empty or if another thief won the race.
+static Task* deque_steal(TaskDeque* deque) {
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+    if (top >= bottom) return NULL;
+
+    TaskRing* ring = __atomic_load_n(&deque->ring, __ATOMIC_ACQUIRE);
+    Task* task = __atomic_load_n(&ring->items[top & ring->mask], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, 0,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return NULL;
+    }
+    return task;
+}
+
+// ---
+// Mailboxes
+// ---
+
+static void mailbox_push(Worker* worker, Task* task) {
+    pthread_mutex_lock(&worker->mailbox_lock);
+    if (worker->mailbox_count == worker->mailbox_capacity) {
+        uint32_t new_capacity = worker->mailbox_capacity ? worker->mailbox_capacity * 2 : 64;
+        Task** new_mailbox = scheduler_alloc(new_capacity * sizeof(Task*), "worker mailbox");
+        for (uint32_t i = 0; i < worker->mailbox_count; i++) {
+            new_mailbox[i] = worker->mailbox[(worker->mailbox_head + i) % worker->mailbox_capacity];
+        }
+        free(worker->mailbox);
+        worker->mailbox = new_mailbox;
+        worker->mailbox_head = 0;
+        worker->mailbox_capacity = new_capacity;
+    }
+    uint32_t tail = (worker->mailbox_head + worker->mailbox_count) % worker->mailbox_capacity;
+    worker->mailbox[tail] = task;
+    __atomic_store_n(&worker->mailbox_count, worker->mailbox_count + 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&worker->mailbox_lock);
+}
+
+static Task* mailbox_pop(Worker* worker) {
+    if (!__atomic_load_n(&worker->mailbox_count, __ATOMIC_RELAXED)) return NULL;
+
+    Task* task = NULL;
+    pthread_mutex_lock(&worker->mailbox_lock);
+    if (worker->mailbox_count) {
+        task = worker->mailbox[worker->mailbox_head];
+        worker->mailbox_head = (worker->mailbox_head + 1) % worker->mailbox_capacity;
+        __atomic_store_n(&worker->mailbox_count, worker->mailbox_count - 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&worker->mailbox_lock);
+    return task;
+}
+
+// ---
+// Finding and running tasks
+// ---
+
+static uint64_t next_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+// Own deque, own mailbox, then everybody else's from a random start.
+// `self` is NULL for a thread that is not one of this pool's workers.
+static Task* find_task(Scheduler* scheduler, Worker* self) {
+    static __thread uint64_t outsider_rng;
+    Task* task = NULL;
+
+    if (self) {
+        task = deque_take(self->deque);
+        if (!task) task = mailbox_pop(self);
+    }
+
+    if (!task) {
+        uint64_t* rng = self ? &self->rng : &outsider_rng;
+        if (!*rng) *rng = (uint64_t)(uintptr_t)&outsider_rng | 1;
+
+        uint32_t count = scheduler->worker_count;
+        uint32_t start = (uint32_t)(next_random(rng) % count);
+        for (uint32_t i = 0; i < count && !task; i++) {
+            Worker* victim = &scheduler->workers[(start + i) % count];
+            if (victim == self) continue;
+            task = deque_steal(victim->deque);
+            if (!task) task = mailbox_pop(victim);
+        }
+    }
+
+    if (task) __atomic_sub_fetch(&scheduler->queued, 1, __ATOMIC_SEQ_CST);
+    return task;
+}
+
+static void run_task(Task* task) {
+    TaskGroup* group = task->group;
+    task->run(task);
+    free(task);
+    __atomic_sub_fetch(&group->pending, 1, __ATOMIC_RELEASE);
+}
+
+// Counted in `queued` before it is visible, so `queued` never dips
+// below zero; sleepers are woken once it is.
+static void submit(Scheduler* scheduler, Worker* target, Task* task) {
+    __atomic_add_fetch(&task->group->pending, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&scheduler->queued, 1, __ATOMIC_SEQ_CST);
+
+    Worker* self = current_worker;
+    if (!target && self && self->scheduler == scheduler) {
+        deque_push(self->deque, task);
+    } else {
+        if (!target) {
+            uint32_t next = __atomic_fetch_add(&scheduler->next_mailbox, 1, __ATOMIC_RELAXED);
+            target = &scheduler->workers[next % scheduler->worker_count];
+        }
+        mailbox_push(target, task);
+    }
+
+    if (__atomic_load_n(&scheduler->sleeping, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&scheduler->sleep_lock);
+        pthread_cond_signal(&scheduler->wake);
+        pthread_mutex_unlock(&scheduler->sleep_lock);
+    }
+}
+
+static Task* new_task(TaskGroup* group, void (*run)(Task* task)) {
+    Task* task = scheduler_alloc(sizeof(Task), "task");
+    memset(task, 0, sizeof(Task));
+    task->run = run;
+    task->group = group;
+    return task;
+}
+
+// Workers spin a little after running dry, then sleep. A sleeper
+// registers in `sleeping` before checking `queued`, and submit() bumps
+// `queued` before checking `sleeping`, so one of them always sees the
+// other: no lost wakeups.
+static void* worker_main(void* arg) {
+    Worker* self = (Worker*)arg;
+    Scheduler* scheduler = self->scheduler;
+    current_worker = self;
+    numa_pin_thread(self->node);
+
+    uint32_t idle = 0;
+    for (;;) {
+        Task* task = find_task(scheduler, self);
+        if (task) {
+            run_task(task);
+            idle = 0;
+            continue;
+        }
+        if (++idle < SCHEDULER_SPINS_BEFORE_SLEEP) {
+            cpu_relax();
+            continue;
+        }
+
+        pthread_mutex_lock(&scheduler->sleep_lock);
+        __atomic_add_fetch(&scheduler->sleeping, 1, __ATOMIC_SEQ_CST);
+        while (!__atomic_load_n(&scheduler->queued, __ATOMIC_SEQ_CST) && !scheduler->stopping) {
+            pthread_cond_wait(&scheduler->wake, &scheduler->sleep_lock);
+        }
+        __atomic_sub_fetch(&scheduler->sleeping, 1, __ATOMIC_SEQ_CST);
+        int stopping = scheduler->stopping;
+        pthread_mutex_unlock(&scheduler->sleep_lock);
+
+        if (stopping) break;
+        idle = 0;
+    }
+    return NULL;
+}
+
+// ---
+// Pool
+// ---
+
+static uint32_t default_worker_count(void) {
+    const char* env = getenv("CLARITY_WORKERS");
+    if (env && atoi(env) > 0) return (uint32_t)atoi(env);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 1 ? (uint32_t)(cpus - 1) : 1;
+}
+
+// Scheduler* create_scheduler(uint32_t worker_count);
+//
+// Start `worker_count` workers (0: the default, see NOTES), worker i
+// pinned to node i mod node_count.
+
+Scheduler* create_scheduler(uint32_t worker_count) {
+    if (worker_count == 0) worker_count = default_worker_count();
+
+    Scheduler* scheduler = scheduler_alloc(sizeof(Scheduler), "Scheduler");
+    memset(scheduler, 0, sizeof(Scheduler));
+    scheduler->workers = scheduler_alloc(worker_count * sizeof(Worker), "workers");
+    memset(scheduler->workers, 0, worker_count * sizeof(Worker));
+    scheduler->worker_count = worker_count;
+    pthread_mutex_init(&scheduler->sleep_lock, NULL);
+    pthread_cond_init(&scheduler->wake, NULL);
+
+    int node_count = numa_node_count();
+    for (uint32_t i = 0; i < worker_count; i++) {
+        Worker* worker = &scheduler->workers[i];
+        worker->scheduler = scheduler;
+        worker->index = i;
+        worker->node = (int)(i % (uint32_t)node_count);
+        worker->rng = 0x9E3779B97F4A7C15ull * (i + 1);
+        worker->deque = new_deque();
+        pthread_mutex_init(&worker->mailbox_lock, NULL);
+    }
+
+    // All workers exist before any starts stealing from the others.
+    for (uint32_t i = 0; i < worker_count; i++) {
+        if (pthread_create(&scheduler->workers[i].thread, NULL, worker_main, &scheduler->workers[i]) != 0) {
+            fprintf(stderr, "Failed to start scheduler worker.\n");
+            exit(1);
+        }
+    }
+    return scheduler;
+}
+
+// Stop and join the workers. Every group must have been waited for.
+void free_scheduler(Scheduler* scheduler) {
+    if (!scheduler) return;
+
+    pthread_mutex_lock(&scheduler->sleep_lock);
+    scheduler->stopping = 1;
+    pthread_cond_broadcast(&scheduler->wake);
+    pthread_mutex_unlock(&scheduler->sleep_lock);
+
+    for (uint32_t i = 0; i < scheduler->worker_count; i++) {
+        pthread_join(scheduler->workers[i].thread, NULL);
+    }
+    for (uint32_t i = 0; i < scheduler->worker_count; i++) {
+        Worker* worker = &scheduler->workers[i];
+        free_deque(worker->deque);
+        free(worker->mailbox);
+        pthread_mutex_destroy(&worker->mailbox_lock);
+    }
+    pthread_mutex_destroy(&scheduler->sleep_lock);
+    pthread_cond_destroy(&scheduler->wake);
+    free(scheduler->workers);
+    free(scheduler);
+}
+
+static Scheduler* shared;
+static pthread_once_t shared_once = PTHREAD_ONCE_INIT;
+
+static void create_shared(void) {
+    shared = create_scheduler(0);
+}
+
+// The process-wide pool, started on first use and never stopped.
+Scheduler* shared_scheduler(void) {
+    pthread_once(&shared_once, create_shared);
+    return shared;
+}
+
+// Index of the calling worker, or worker_count for any other thread;
+// handy for per-worker scratch arrays of worker_count + 1 entries.
+uint32_t scheduler_worker_index(const Scheduler* scheduler) {
+    Worker* self = current_worker;
+    if (!scheduler || !self || self->scheduler != scheduler) {
+        return scheduler ? scheduler->worker_count : 0;
+    }
+    return self->index;
+}
+
+// ---
+// Fork-join
+// ---
+
+void init_task_group(TaskGroup* group, Scheduler* scheduler) {
+    if (!group) return;
+    group->scheduler = scheduler;
+    group->pending = 0;
+}
+
+static void run_plain(Task* task) {
+    task->fn(task->arg);
+}
+
+void scheduler_spawn(TaskGroup* group, TaskFn fn, void* arg) {
+    if (!group || !group->scheduler || !fn) return;
+
+    Task* task = new_task(group, run_plain);
+    task->fn = fn;
+    task->arg = arg;
+    submit(group->scheduler, NULL, task);
+}
+
+// Like scheduler_spawn(), but queued in `worker`'s mailbox so that
+// worker picks it up first (anyone may still steal it).
+void scheduler_spawn_on(TaskGroup* group, uint32_t worker, TaskFn fn, void* arg) {
+    if (!group || !group->scheduler || !fn) return;
+
+    Scheduler* scheduler = group->scheduler;
+    Task* task = new_task(group, run_plain);
+    task->fn = fn;
+    task->arg = arg;
+    submit(scheduler, &scheduler->workers[worker % scheduler->worker_count], task);
+}
+
+// void scheduler_wait(TaskGroup* group);
+//
+// Run tasks until every task of `group` (including ones its tasks
+// spawned) has finished. The acquire load pairs with run_task()'s
+// release: once pending is 0, all their writes are visible.
+
+void scheduler_wait(TaskGroup* group) {
+    if (!group || !group->scheduler) return;
+
+    Scheduler* scheduler = group->scheduler;
+    Worker* self = current_worker && current_worker->scheduler == scheduler ? current_worker : NULL;
+
+    uint32_t spins = 0;
+    while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE)) {
+        Task* task = find_task(scheduler, self);
+        if (task) {
+            run_task(task);
+            spins = 0;
+        } else if (++spins < SCHEDULER_SPINS_BEFORE_YIELD) {
+            cpu_relax();
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+// Split off right halves until the piece is at most `grain`, then run
+// it. The halves are pushed onto this worker's deque for thieves.
+static void run_range(Task* task) {
+    uint32_t begin = task->begin;
+    uint32_t end = task->end;
+    while (end - begin > task->grain) {
+        uint32_t middle = begin + (end - begin) / 2;
+        Task* half = new_task(task->group, run_range);
+        half->range = task->range;
+        half->context = task->context;
+        half->begin = middle;
+        half->end = end;
+        half->grain = task->grain;
+        submit(task->group->scheduler, NULL, half);
+        end = middle;
+    }
+    task->range(task->context, begin, end);
+}
+
+// void parallel_for(Scheduler* scheduler, uint32_t begin, uint32_t end, uint32_t grain,
+//                   RangeFn fn, void* context);
+//
+// Goal:
+// ======
+// Call fn(context, b, e) on disjoint pieces covering [begin, end), each
+// at most `grain` long, in parallel; return once all are done. With no
+// scheduler, or a range of one grain, it is a plain call.
+
+void parallel_for(Scheduler* scheduler, uint32_t begin, uint32_t end, uint32_t grain,
+                  RangeFn fn, void* context) {
+    if (!fn || begin >= end) return;
+    if (grain == 0) grain = 1;
+    if (!scheduler || end - begin <= grain) {
+        fn(context, begin, end);
+        return;
+    }
+
+    TaskGroup group;
+    init_task_group(&group, scheduler);
+    Task* task = new_task(&group, run_range);
+    task->range = fn;
+    task->context = context;
+    task->begin = begin;
+    task->end = end;
+    task->grain = grain;
+    submit(scheduler, NULL, task);
+    scheduler_wait(&group);
+}
+
+// uint32_t scheduler_worker_for_shard(const Scheduler* scheduler, const ShardedStore* sharded, uint32_t shard);
+//
+// A worker on the shard's node; shards on the same node are dealt out
+// over that node's workers. Unplaced shards (or nodes without workers)
+// fall back to shard mod worker_count.
+
+uint32_t scheduler_worker_for_shard(const Scheduler* scheduler, const ShardedStore* sharded, uint32_t shard) {
+    if (!scheduler || !sharded || shard >= sharded->shard_count) return 0;
+
+    int node = sharded->shards[shard].node;
+    uint32_t on_node = 0;
+    for (uint32_t i = 0; i < scheduler->worker_count; i++) {
+        on_node += (uint32_t)(scheduler->workers[i].node == node);
+    }
+    if (node < 0 || on_node == 0) return shard % scheduler->worker_count;
+
+    uint32_t pick = shard % on_node;
+    for (uint32_t i = 0; i < scheduler->worker_count; i++) {
+        if (scheduler->workers[i].node != node) continue;
+        if (pick-- == 0) return i;
+    }
+    return 0;
+}
+
+static void run_shard(Task* task) {
+    task->shard_fn(task->context, task->begin);
+}
+
+// One task per shard, each queued on a worker next to the shard's
+// memory; returns once all have run.
+void parallel_for_shards(Scheduler* scheduler, ShardedStore* sharded, ShardFn fn, void* context) {
+    if (!sharded || !fn) return;
+    if (!scheduler) {
+        for (uint32_t i = 0; i < sharded->shard_count; i++) {
+            fn(context, i);
+        }
+        return;
+    }
+
+    TaskGroup group;
+    init_task_group(&group, scheduler);
+    for (uint32_t i = 0; i < sharded->shard_count; i++) {
+        Task* task = new_task(&group, run_shard);
+        task->shard_fn = fn;
+        task->context = context;
+        task->begin = i;
+        uint32_t worker = scheduler_worker_for_shard(scheduler, sharded, i);
+        submit(scheduler, &scheduler->workers[worker], task);
+    }
+    scheduler_wait(&group);
+}
@@ -0,0 +1,426 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "shard.h"
+#include "numa.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// ShardedStore* create_sharded_store(uint32_t shard_count);
+//
+// Goal:
+// ======
+// Allocate `shard_count` empty shards (at least one), each with its own
+// arena, store and lock. Shards start unpinned.
+
+ShardedStore* create_sharded_store(uint32_t shard_count) {
+    if (shard_count == 0) shard_count = 1;
+
+    ShardedStore* sharded = (ShardedStore*)calloc(1, sizeof(ShardedStore));
+    StoreShard* shards = (StoreShard*)calloc(shard_count, sizeof(StoreShard));
+    if (!sharded || !shards) {
+        fprintf(stderr, "Failed to allocate memory for ShardedStore.\n");
+        exit(1);
+    }
+
+    for (uint32_t i = 0; i < shard_count; i++) {
+        StoreShard* shard = &shards[i];
+        init_arena(&shard->arena, -1);
+        shard->store = create_store_in_arena(&shard->arena);
+        pthread_rwlock_init(&shard->lock, NULL);
+        shard->node = -1;
+    }
+
+    sharded->shards = shards;
+    sharded->shard_count = shard_count;
+    sharded->node_count = (uint32_t)numa_node_count();
+    pthread_mutex_init(&sharded->replica_lock, NULL);
+    return sharded;
+}
+
+void free_sharded_store(ShardedStore* sharded) {
+    if (!sharded) return;
+
+    for (uint32_t i = 0; i < sharded->shard_count; i++) {
+        StoreShard* shard = &sharded->shards[i];
+        free_store(shard->store);
+        free(shard->replicas);      // their memory goes with node_arenas
+        arena_free(&shard->arena, shard->remote);
+        free_arena(&shard->arena);
+        pthread_rwlock_destroy(&shard->lock);
+    }
+    if (sharded->node_arenas) {
+        for (uint32_t node = 0; node < sharded->node_count; node++) {
+            free_arena(&sharded->node_arenas[node]);
+        }
+        free(sharded->node_arenas);
+    }
+    pthread_mutex_destroy(&sharded->replica_lock);
+    free(sharded->shards);
+    free(sharded);
+}
+
+// uint32_t shard_of_id(const ShardedStore* sharded, const char* id);
+//
+// FNV-1a, then multiply-shift onto [0, shard_count): no division, and
+// every shard count works, not just powers of two.
+
+// FNV-1a changes mostly its low bits on the last byte, so IDs like
+// "p1", "p2" share their top bits. The multiply-shift reads the top
+// bits: run the murmur3 finalizer first so every input bit reaches them.
+static uint32_t mix_hash(uint32_t hash) {
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+uint32_t shard_of_id(const ShardedStore* sharded, const char* id) {
+    if (!sharded || !id) return 0;
+    return (uint32_t)(((uint64_t)mix_hash(hash_string(id)) * sharded->shard_count) >> 32);
+}
+
+// ---
+// NUMA placement
+// ---
+
+// Move a shard to `node`: its arena binds new mappings there and
+// migrates the pages it already has.
+void shard_set_node(ShardedStore* sharded, uint32_t shard, int node) {
+    if (!sharded || shard >= sharded->shard_count) return;
+
+    StoreShard* target = &sharded->shards[shard];
+    pthread_rwlock_wrlock(&target->lock);
+    target->node = node;
+    arena_set_node(&target->arena, node);
+    pthread_rwlock_unlock(&target->lock);
+}
+
+// Shard i → node i mod node_count, so every socket gets its share.
+void sharded_spread_nodes(ShardedStore* sharded) {
+    if (!sharded) return;
+
+    for (uint32_t i = 0; i < sharded->shard_count; i++) {
+        shard_set_node(sharded, i, (int)(i % sharded->node_count));
+    }
+}
+
+// Pin the calling thread to the node of `shard`. Returns -1 if the
+// shard has no node or the node has no usable CPUs.
+int shard_pin_thread(ShardedStore* sharded, uint32_t shard) {
+    if (!sharded || shard >= sharded->shard_count) return -1;
+    return numa_pin_thread(sharded->shards[shard].node);
+}
+
+// void sharded_replicate_symbols(ShardedStore* sharded);
+//
+// Goal:
+// ======
+// (Re)build every shard's per-node copies of its symbol table.
+//
+// Key Steps:
+// ========================
+//
+// 1. Per-node arenas are created on first use, each bound to its node,
+//    so a copy's pages land there when copy_symbol_table() touches them.
+//
+// 2. Per shard, under its write lock: release the old copies and make
+//    fresh ones. Readers use copies only under the read lock, so none
+//    can be looking at the old ones.
+//
+// `replica_lock` serializes callers: the node arenas are shared by all
+// shards and an arena is not thread-safe.
+
+void sharded_replicate_symbols(ShardedStore* sharded) {
+    if (!sharded) return;
+
+    pthread_mutex_lock(&sharded->replica_lock);
+    if (!sharded->node_arenas) {
+        sharded->node_arenas = (Arena*)malloc(sharded->node_count * sizeof(Arena));
+        if (!sharded->node_arenas) {
+            fprintf(stderr, "Failed to allocate memory for node arenas.\n");
+            exit(1);
+        }
+        for (uint32_t node = 0; node < sharded->node_count; node++) {
+            init_arena(&sharded->node_arenas[node], (int)node);
+        }
+    }
+
+    for (uint32_t i = 0; i < sharded->shard_count; i++) {
+        StoreShard* shard = &sharded->shards[i];
+        pthread_rwlock_wrlock(&shard->lock);
+
+        if (!shard->replicas) {
+            shard->replicas = (SymbolTable*)calloc(sharded->node_count, sizeof(SymbolTable));
+            if (!shard->replicas) {
+                fprintf(stderr, "Failed to allocate memory for symbol replicas.\n");
+                exit(1);
+            }
+        }
+
+        const SymbolTable* master = &shard->store->symbols;
+        size_t bytes = symbol_table_bytes(master);
+        for (uint32_t node = 0; node < sharded->node_count; node++) {
+            Arena* arena = &sharded->node_arenas[node];
+            arena_free(arena, shard->replicas[node].buckets);
+            copy_symbol_table(&shard->replicas[node], master, arena_alloc(arena, bytes));
+        }
+
+        pthread_rwlock_unlock(&shard->lock);
+    }
+    pthread_mutex_unlock(&sharded->replica_lock);
+}
+
+// ---
+// Helpers (caller holds the shard's lock)
+// ---
+
+// Make sure `remote` covers `concept` and record its owner handle.
+static void track_concept(StoreShard* shard, uint32_t concept, ConceptHandle owner) {
+    if (concept >= shard->remote_capacity) {
+        uint32_t new_capacity = shard->remote_capacity ? shard->remote_capacity * 2 : 64;
+        while (new_capacity <= concept) {
+            new_capacity *= 2;
+        }
+        shard->remote = arena_realloc(&shard->arena, shard->remote, new_capacity * sizeof(ConceptHandle));
+        shard->remote_capacity = new_capacity;
+    }
+    shard->remote[concept] = owner;
+}
+
+static int is_real(const StoreShard* shard, uint32_t concept) {
+    return concept < shard->store->concept_count && shard->remote[concept] == HANDLE_NONE;
+}
+
+// Local neighbor → handle: proxies resolve to the concept they stand for.
+static ConceptHandle resolve(const StoreShard* shard, uint32_t shard_index, uint32_t concept) {
+    ConceptHandle owner = shard->remote[concept];
+    return owner != HANDLE_NONE ? owner : make_handle(shard_index, concept);
+}
+
+// The local proxy for `owner`, created on first use.
+static uint32_t proxy_for(StoreShard* shard, ConceptHandle owner) {
+    char id[32];
+    snprintf(id, sizeof(id), "@%u:%u", handle_shard(owner), handle_index(owner));
+
+    uint32_t proxy = find_concept_by_id(shard->store, id);
+    if (proxy == CONCEPT_NONE) {
+        proxy = store_create_concept(shard->store, id, SHARD_REMOTE_TYPE);
+        track_concept(shard, proxy, owner);
+        shard->proxy_count++;
+    }
+    return proxy;
+}
+
+// Symbol for `name`, from this node's replica when there is one. A miss
+// there may just be a name interned after the copy: ask the master.
+static Symbol find_local_symbol(const StoreShard* shard, uint32_t node_count, const char* name) {
+    if (shard->replicas) {
+        uint32_t node = (uint32_t)numa_current_node();
+        if (node < node_count) {
+            Symbol symbol = find_symbol(&shard->replicas[node], name);
+            if (symbol != SYMBOL_NONE) return symbol;
+        }
+    }
+    return find_symbol(&shard->store->symbols, name);
+}
+
+// Shard for a handle, or NULL if the shard number is out of range.
+static StoreShard* shard_for(ShardedStore* sharded, ConceptHandle handle) {
+    if (!sharded || handle == HANDLE_NONE || handle_shard(handle) >= sharded->shard_count) return NULL;
+    return &sharded->shards[handle_shard(handle)];
+}
+
+// ---
+// Concepts
+// ---
+
+ConceptHandle sharded_create_concept(ShardedStore* sharded, const char* id, const char* type) {
+    if (!sharded || !id || !type || id[0] == '@') return HANDLE_NONE;
+
+    uint32_t shard_index = shard_of_id(sharded, id);
+    StoreShard* shard = &sharded->shards[shard_index];
+
+    pthread_rwlock_wrlock(&shard->lock);
+    uint32_t before = shard->store->concept_count;
+    uint32_t concept = store_create_concept(shard->store, id, type);
+    if (concept == before) {
+        track_concept(shard, concept, HANDLE_NONE);
+    }
+    pthread_rwlock_unlock(&shard->lock);
+
+    return make_handle(shard_index, concept);
+}
+
+ConceptHandle sharded_find_concept(ShardedStore* sharded, const char* id) {
+    if (!sharded || !id || id[0] == '@') return HANDLE_NONE;
+
+    uint32_t shard_index = shard_of_id(sharded, id);
+    StoreShard* shard = &sharded->shards[shard_index];
+
+    pthread_rwlock_rdlock(&shard->lock);
+    uint32_t concept = find_concept_by_id(shard->store, id);
+    pthread_rwlock_unlock(&shard->lock);
+
+    return concept == CONCEPT_NONE ? HANDLE_NONE : make_handle(shard_index, concept);
+}
+
+const char* sharded_concept_id(ShardedStore* sharded, ConceptHandle concept) {
+    StoreShard* shard = shard_for(sharded, concept);
+    if (!shard) return NULL;
+
+    pthread_rwlock_rdlock(&shard->lock);
+    const char* id = is_real(shard, handle_index(concept)) ? store_concept_id(shard->store, handle_index(concept)) : NULL;
+    pthread_rwlock_unlock(&shard->lock);
+    return id;
+}
+
+// ---
+// Slots
+// ---
+
+static int handle_is_real(ShardedStore* sharded, ConceptHandle handle) {
+    StoreShard* shard = shard_for(sharded, handle);
+    if (!shard) return 0;
+
+    pthread_rwlock_rdlock(&shard->lock);
+    int real = is_real(shard, handle_index(handle));
+    pthread_rwlock_unlock(&shard->lock);
+    return real;
+}
+
+// void sharded_add_slot(ShardedStore* sharded, ConceptHandle source, const char* slot_name, ConceptHandle target);
+//
+// Goal:
+// ======
+// Record (slot_name → target) on `source`.
+//
+// Key Steps:
+// ========================
+//
+// 1. Both handles must name real concepts. Concepts are never removed,
+//    so checking first (under read locks) stays true afterwards.
+//
+// 2. Same shard → one ordinary store_add_slot().
+//
+// 3. Different shards → in the source shard, source → proxy(target);
+//    then in the target shard, proxy(source) → target as a mirror. Each
+//    step holds only its own shard's lock.
+
+void sharded_add_slot(ShardedStore* sharded, ConceptHandle source, const char* slot_name, ConceptHandle target) {
+    if (!slot_name) return;
+    if (!handle_is_real(sharded, source) || !handle_is_real(sharded, target)) return;
+
+    StoreShard* from = shard_for(sharded, source);
+    StoreShard* to = shard_for(sharded, target);
+
+    if (from == to) {
+        pthread_rwlock_wrlock(&from->lock);
+        store_add_slot(from->store, handle_index(source), slot_name, handle_index(target));
+        pthread_rwlock_unlock(&from->lock);
+        return;
+    }
+
+    pthread_rwlock_wrlock(&from->lock);
+    uint32_t target_proxy = proxy_for(from, target);
+    store_add_slot(from->store, handle_index(source), slot_name, target_proxy);
+    pthread_rwlock_unlock(&from->lock);
+
+    pthread_rwlock_wrlock(&to->lock);
+    uint32_t source_proxy = proxy_for(to, source);
+    store_add_slot(to->store, source_proxy, slot_name, handle_index(target));
+    to->mirror_slots++;
+    pthread_rwlock_unlock(&to->lock);
+}
+
+uint32_t sharded_degree(ShardedStore* sharded, ConceptHandle concept) {
+    StoreShard* shard = shard_for(sharded, concept);
+    if (!shard) return 0;
+
+    pthread_rwlock_rdlock(&shard->lock);
+    uint32_t degree = is_real(shard, handle_index(concept)) ? store_degree(shard->store, handle_index(concept)) : 0;
+    pthread_rwlock_unlock(&shard->lock);
+    return degree;
+}
+
+uint32_t sharded_in_degree(ShardedStore* sharded, ConceptHandle concept) {
+    StoreShard* shard = shard_for(sharded, concept);
+    if (!shard) return 0;
+
+    pthread_rwlock_rdlock(&shard->lock);
+    uint32_t degree = is_real(shard, handle_index(concept)) ? store_in_degree(shard->store, handle_index(concept)) : 0;
+    pthread_rwlock_unlock(&shard->lock);
+    return degree;
+}
+
+// Shared body of sharded_slots() / sharded_in_slots(): copy one segment
+// of `concept`, optionally filtered by name, resolving proxies.
+static uint32_t collect_segment(ShardedStore* sharded, ConceptHandle concept, const char* slot_name,
+                                int incoming, ConceptHandle* out) {
+    StoreShard* shard = shard_for(sharded, concept);
+    if (!shard || !out) return 0;
+
+    uint32_t shard_index = handle_shard(concept);
+    uint32_t local = handle_index(concept);
+    uint32_t found = 0;
+
+    pthread_rwlock_rdlock(&shard->lock);
+    const ConceptStore* store = shard->store;
+    if (is_real(shard, local)) {
+        Symbol filter = slot_name ? find_local_symbol(shard, sharded->node_count, slot_name) : SYMBOL_NONE;
+        if (!slot_name || filter != SYMBOL_NONE) {
+            uint32_t degree = incoming ? store_in_degree(store, local) : store_degree(store, local);
+            const Symbol* names = incoming ? store_in_slot_names(store, local) : store_slot_names(store, local);
+            const uint32_t* neighbors = incoming ? store_in_slot_sources(store, local) : store_slot_targets(store, local);
+            for (uint32_t i = 0; i < degree; i++) {
+                if (slot_name && names[i] != filter) continue;
+                out[found++] = resolve(shard, shard_index, neighbors[i]);
+            }
+        }
+    }
+    pthread_rwlock_unlock(&shard->lock);
+    return found;
+}
+
+// uint32_t sharded_slots(ShardedStore* sharded, ConceptHandle concept, const char* slot_name, ConceptHandle* targets);
+//
+// Targets of `concept`'s outgoing slots (all, or only `slot_name`) as
+// handles, in insertion order. `targets` needs sharded_degree() entries.
+
+uint32_t sharded_slots(ShardedStore* sharded, ConceptHandle concept, const char* slot_name, ConceptHandle* targets) {
+    return collect_segment(sharded, concept, slot_name, 0, targets);
+}
+
+// Sources of `concept`'s incoming slots, including ones from other
+// shards (through their mirrors). `sources` needs sharded_in_degree().
+uint32_t sharded_in_slots(ShardedStore* sharded, ConceptHandle concept, const char* slot_name, ConceptHandle* sources) {
+    return collect_segment(sharded, concept, slot_name, 1, sources);
+}
+
+// Totals over all shards, not counting proxies or mirrors.
+uint64_t sharded_concept_count(ShardedStore* sharded) {
+    if (!sharded) return 0;
+
+    uint64_t count = 0;
+    for (uint32_t i = 0; i < sharded->shard_count; i++) {
+        StoreShard* shard = &sharded->shards[i];
+        pthread_rwlock_rdlock(&shard->lock);
+        count += shard->store->concept_count - shard->proxy_count;
+        pthread_rwlock_unlock(&shard->lock);
+    }
+    return count;
+}
+
+uint64_t sharded_slot_count(ShardedStore* sharded) {
+    if (!sharded) return 0;
+
+    uint64_t count = 0;
+    for (uint32_t i = 0; i < sharded->shard_count; i++) {
+        StoreShard* shard = &sharded->shards[i];
+        pthread_rwlock_rdlock(&shard->lock);
+        count += shard->store->slot_count - shard->mirror_slots;
+        pthread_rwlock_unlock(&shard->lock);
+    }
+    return count;
+}
@@ -0,0 +1,229 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "snapshot.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// A committed view of one segment: the first `degree` entries of
+// names / neighbors / versions.
+typedef struct SegmentView {
+    const Symbol* names;
+    const uint32_t* neighbors;
+    const SlotVersion* versions;
+    uint32_t degree;
+} SegmentView;
+
+// Locate the concept's current and history segments in one read
+// section, so a retraction (which moves a slot from one to the other)
+// is seen entirely or not at all.
+static void read_segments(const ConceptStore* store, uint32_t concept, SegmentView* current, SegmentView* closed) {
+    const SlotPool* pools[2] = { &store->slots, &store->history };
+    SegmentView* views[2] = { current, closed };
+    uint32_t sequence;
+    do {
+        sequence = epoch_read_begin(store->epochs);
+        for (int p = 0; p < 2; p++) {
+            const SlotPool* pool = pools[p];
+            uint32_t offset = __atomic_load_n(&pool->offsets[concept], __ATOMIC_RELAXED);
+            views[p]->degree = __atomic_load_n(&pool->degrees[concept], __ATOMIC_RELAXED);
+            views[p]->names = pool->names + offset;
+            views[p]->neighbors = pool->neighbors + offset;
+            views[p]->versions = (const SlotVersion*)pool->columns[SLOT_COLUMN_VERSION] + offset;
+        }
+    } while (epoch_read_retry(store->epochs, sequence));
+}
+
+// int open_snapshot(const ConceptStore* store, StoreSnapshot* snapshot);
+//
+// Goal:
+// ======
+// Pin the current version and record how many concepts it has. Returns
+// 0, or -1 if snapshots are not enabled or every reader slot is taken.
+//
+// Key Questions:
+// ========================
+//
+// 1. How do we know the concept count belongs to the pinned version?
+//    - Writers publish (current, committed_concepts) together as one
+//      move. Read the pair in one read section; if `current` is no
+//      longer the pin, a write committed meanwhile: re-pin and retry.
+
+int open_snapshot(const ConceptStore* store, StoreSnapshot* snapshot) {
+    if (!store || !snapshot || !store->epochs) return -1;
+
+    EpochManager* epochs = store->epochs;
+    for (;;) {
+        uint64_t version;
+        int reader = epoch_pin(epochs, &version);
+        if (reader < 0) return -1;
+
+        uint64_t current;
+        uint32_t concept_count;
+        uint32_t sequence;
+        do {
+            sequence = epoch_read_begin(epochs);
+            current = __atomic_load_n(&epochs->current, __ATOMIC_RELAXED);
+            concept_count = __atomic_load_n(&store->committed_concepts, __ATOMIC_RELAXED);
+        } while (epoch_read_retry(epochs, sequence));
+
+        if (current == version) {
+            snapshot->store = store;
+            snapshot->version = version;
+            snapshot->reader = reader;
+            snapshot->concept_count = concept_count;
+            return 0;
+        }
+        epoch_unpin(epochs, reader);
+    }
+}
+
+void close_snapshot(StoreSnapshot* snapshot) {
+    if (!snapshot || !snapshot->store) return;
+    epoch_unpin(snapshot->store->epochs, snapshot->reader);
+    snapshot->store = NULL;
+    snapshot->reader = -1;
+}
+
+// find_symbol() is safe against a concurrent intern (symbol.h); IDs
+// interned after the pinned version are filtered out by index.
+uint32_t snapshot_find_concept(const StoreSnapshot* snapshot, const char* id) {
+    if (!snapshot || !snapshot->store || !id) return CONCEPT_NONE;
+
+    uint32_t concept = find_symbol(&snapshot->store->ids, id);
+    return concept < snapshot->concept_count ? concept : CONCEPT_NONE;
+}
+
+const char* snapshot_concept_id(const StoreSnapshot* snapshot, uint32_t concept) {
+    if (!snapshot || !snapshot->store || concept >= snapshot->concept_count) return NULL;
+    return symbol_name(&snapshot->store->ids, concept);
+}
+
+const char* snapshot_concept_type(const StoreSnapshot* snapshot, uint32_t concept) {
+    if (!snapshot || !snapshot->store || concept >= snapshot->concept_count) return NULL;
+
+    const ConceptStore* store = snapshot->store;
+    Symbol type;
+    uint32_t sequence;
+    do {
+        sequence = epoch_read_begin(store->epochs);
+        type = store->type_symbols[concept];
+    } while (epoch_read_retry(store->epochs, sequence));
+
+    return symbol_name(&store->symbols, type);
+}
+
+const char* snapshot_symbol_name(const StoreSnapshot* snapshot, Symbol symbol) {
+    if (!snapshot || !snapshot->store) return NULL;
+    return symbol_name(&snapshot->store->symbols, symbol);
+}
+
+// Current slots are visible once born; closed ones until they died.
+static int current_visible(const SlotVersion* version, uint64_t at) {
+    return version->born <= at;
+}
+
+static int history_visible(const SlotVersion* version, uint64_t at) {
+    return version->born <= at && at < version->died;
+}
+
+// One visible slot, keyed for the canonical order.
+typedef struct SnapshotSlot {
+    uint64_t born;
+    Symbol name;
+    uint32_t target;
+} SnapshotSlot;
+
+#define SNAPSHOT_STACK_SLOTS 64
+
+static int compare_snapshot_slots(const void* a, const void* b) {
+    const SnapshotSlot* x = a;
+    const SnapshotSlot* y = b;
+    if (x->born != y->born) return x->born < y->born ? -1 : 1;
+    if (x->name != y->name) return x->name < y->name ? -1 : 1;
+    return (x->target > y->target) - (x->target < y->target);
+}
+
+static uint32_t collect_visible(const SegmentView* view, int closed, Symbol filter, uint64_t version,
+                                SnapshotSlot* out) {
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < view->degree; i++) {
+        if (filter != SYMBOL_NONE && view->names[i] != filter) continue;
+        if (closed ? !history_visible(&view->versions[i], version) : !current_visible(&view->versions[i], version)) {
+            continue;
+        }
+        out[found++] = (SnapshotSlot){ view->versions[i].born, view->names[i], view->neighbors[i] };
+    }
+    return found;
+}
+
+// uint32_t snapshot_slots(const StoreSnapshot* snapshot, uint32_t concept, const char* slot_name,
+//                         uint32_t* targets, Symbol* names);
+//
+// Goal:
+// ======
+// The outgoing slots of `concept` (all, or only `slot_name`) at the
+// snapshot's version. Writes targets (and names, if not NULL) and
+// returns the count; `targets` needs snapshot_degree() entries.
+//
+// Order:
+// ========================
+//
+// A retraction moves a slot from the current segment to history and the
+// writer may relocate either, so segment order is not stable within one
+// snapshot. Slots are returned sorted by (version added, name, target),
+// which is the same on every read of one snapshot; slots from before
+// snapshots were enabled all share version 0 and sort by name, target.
+
+uint32_t snapshot_slots(const StoreSnapshot* snapshot, uint32_t concept, const char* slot_name,
+                        uint32_t* targets, Symbol* names) {
+    if (!snapshot || !snapshot->store || !targets || concept >= snapshot->concept_count) return 0;
+
+    const ConceptStore* store = snapshot->store;
+    Symbol filter = SYMBOL_NONE;
+    if (slot_name) {
+        filter = find_symbol(&store->symbols, slot_name);
+        if (filter == SYMBOL_NONE) return 0;
+    }
+
+    SegmentView current, closed;
+    read_segments(store, concept, &current, &closed);
+
+    SnapshotSlot stack[SNAPSHOT_STACK_SLOTS];
+    SnapshotSlot* slots = stack;
+    uint32_t room = current.degree + closed.degree;
+    if (room > SNAPSHOT_STACK_SLOTS) {
+        slots = malloc(room * sizeof(SnapshotSlot));
+        if (!slots) {
+            fprintf(stderr, "Failed to allocate memory for snapshot slots.\n");
+            exit(1);
+        }
+    }
+
+    uint32_t found = collect_visible(&current, 0, filter, snapshot->version, slots);
+    found += collect_visible(&closed, 1, filter, snapshot->version, slots + found);
+    qsort(slots, found, sizeof(SnapshotSlot), compare_snapshot_slots);
+
+    for (uint32_t i = 0; i < found; i++) {
+        targets[i] = slots[i].target;
+        if (names) names[i] = slots[i].name;
+    }
+    if (slots != stack) free(slots);
+    return found;
+}
+
+uint32_t snapshot_degree(const StoreSnapshot* snapshot, uint32_t concept) {
+    if (!snapshot || !snapshot->store || concept >= snapshot->concept_count) return 0;
+
+    const ConceptStore* store = snapshot->store;
+    SegmentView current, closed;
+    read_segments(store, concept, &current, &closed);
+
+    uint32_t degree = 0;
+    for (uint32_t i = 0; i < current.degree; i++) {
+        degree += (uint32_t)current_visible(&current.versions[i], snapshot->version);
+    }
+    for (uint32_t i = 0; i < closed.degree; i++) {
+        degree += (uint32_t)history_visible(&closed.versions[i], snapshot->version);
+    }
+    return degree;
+}
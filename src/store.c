@@ -0,0 +1,948 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "store.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Slots reserved for a concept the first time it gets one.
+#define STORE_INITIAL_SEGMENT 2
+
+static const SlotMeta default_slot_meta = { 1.0f, 1.0f, 0 };
+static const SlotValidity default_slot_validity = { 0, SLOT_TIME_MAX };
+static const SlotVersion default_slot_version = { 0, UINT64_MAX };
+
+// Element size and default value of each optional slot column.
+static const struct {
+    size_t size;
+    const void* fill;
+} slot_columns[SLOT_COLUMN_COUNT] = {
+    [SLOT_COLUMN_META] = { sizeof(SlotMeta), &default_slot_meta },
+    [SLOT_COLUMN_VALIDITY] = { sizeof(SlotValidity), &default_slot_validity },
+    [SLOT_COLUMN_VERSION] = { sizeof(SlotVersion), &default_slot_version },
+};
+
+static void* store_realloc(void* ptr, size_t size, const char* what) {
+    void* new_ptr = realloc(ptr, size);
+    if (!new_ptr) {
+        fprintf(stderr, "Failed to allocate memory for %s.\n", what);
+        exit(1);
+    }
+    return new_ptr;
+}
+
+// The big arrays (pools, columns, per-concept arrays) come from the
+// store's arena when it has one.
+static void* array_realloc(Arena* arena, void* ptr, size_t size, const char* what) {
+    if (!arena) return store_realloc(ptr, size, what);
+    return arena_realloc(arena, ptr, size);
+}
+
+static void array_free(Arena* arena, void* ptr) {
+    if (arena) {
+        arena_free(arena, ptr);
+    } else {
+        free(ptr);
+    }
+}
+
+static void release_to_arena(void* arena, void* ptr) {
+    arena_free((Arena*)arena, ptr);
+}
+
+// Free an array that was replaced. With snapshots enabled a pinned
+// reader may still hold it, so it is retired instead.
+static void store_discard(Arena* arena, EpochManager* epochs, void* ptr) {
+    if (!epochs) {
+        array_free(arena, ptr);
+    } else if (arena) {
+        epoch_retire_to(epochs, ptr, release_to_arena, arena);
+    } else {
+        epoch_retire(epochs, ptr);
+    }
+}
+
+// realloc(), except that once snapshots are enabled the old array is
+// copied and discarded rather than resized in place.
+static void* store_grow(Arena* arena, EpochManager* epochs, void* ptr, size_t old_size, size_t new_size,
+                        const char* what) {
+    if (!epochs) return array_realloc(arena, ptr, new_size, what);
+
+    void* new_ptr = array_realloc(arena, NULL, new_size, what);
+    if (ptr) {
+        memcpy(new_ptr, ptr, old_size);
+        store_discard(arena, epochs, ptr);
+    }
+    return new_ptr;
+}
+
+// Every public write is one version once snapshots are enabled; see
+// "Snapshots" in store.h. Without them these are no-ops.
+static void begin_write(ConceptStore* store) {
+    if (!store->epochs) return;
+    pthread_mutex_lock(&store->write_lock);
+}
+
+// The version and its concept count are published together, as one
+// (very short) move, so open_snapshot() can read a matching pair.
+static void end_write(ConceptStore* store) {
+    if (!store->epochs) return;
+    epoch_move_begin(store->epochs);
+    epoch_commit(store->epochs);
+    store->committed_concepts = store->concept_count;
+    epoch_move_end(store->epochs);
+    epoch_reclaim(store->epochs);
+    pthread_mutex_unlock(&store->write_lock);
+}
+
+// Bracket anything that changes where published slots live.
+static void begin_move(EpochManager* epochs) {
+    if (epochs) epoch_move_begin(epochs);
+}
+
+static void end_move(EpochManager* epochs) {
+    if (epochs) epoch_move_end(epochs);
+}
+
+// Version stamped on slots by the write in progress.
+static uint64_t write_version(const ConceptStore* store) {
+    return store->epochs->current + 1;
+}
+
+// ConceptStore* create_store(void);
+//
+// Goal:
+// ======
+// Allocate an empty store. Arrays start as NULL and grow on first use;
+// both symbol tables are ready for interning.
+
+ConceptStore* create_store(void) {
+    return create_store_in_arena(NULL);
+}
+
+ConceptStore* create_store_in_arena(Arena* arena) {
+    ConceptStore* store = (ConceptStore*)calloc(1, sizeof(ConceptStore));
+    if (!store) {
+        fprintf(stderr, "Failed to allocate memory for ConceptStore.\n");
+        exit(1);
+    }
+
+    init_symbol_table(&store->ids);
+    init_symbol_table(&store->symbols);
+
+    store->arena = arena;
+    store->slots.arena = arena;
+    store->in_slots.arena = arena;
+    store->history.arena = arena;
+
+    return store;
+}
+
+static void free_slot_pool(SlotPool* pool) {
+    array_free(pool->arena, pool->degrees);
+    array_free(pool->arena, pool->offsets);
+    array_free(pool->arena, pool->capacities);
+    array_free(pool->arena, pool->names);
+    array_free(pool->arena, pool->neighbors);
+    for (int c = 0; c < SLOT_COLUMN_COUNT; c++) {
+        array_free(pool->arena, pool->columns[c]);
+    }
+}
+
+static void fill_column(void* column, SlotColumn which, uint32_t from, uint32_t to) {
+    size_t size = slot_columns[which].size;
+    for (uint32_t i = from; i < to; i++) {
+        memcpy((char*)column + i * size, slot_columns[which].fill, size);
+    }
+}
+
+// Allocate a slot column on first use, covering the whole pool with
+// every slot (live or dead) set to the column default.
+static void* pool_column(SlotPool* pool, SlotColumn which) {
+    if (!pool->columns[which]) {
+        uint32_t capacity = pool->capacity ? pool->capacity : 1;
+        void* column = array_realloc(pool->arena, NULL, capacity * slot_columns[which].size, "slot column");
+        fill_column(column, which, 0, pool->capacity);
+        pool->columns[which] = column;
+    }
+    return pool->columns[which];
+}
+
+// void store_enable_snapshots(ConceptStore* store);
+//
+// Goal:
+// ======
+// Make the store safe for StoreSnapshot readers on other threads (see
+// "Snapshots" in store.h). Call it before sharing the store; it cannot
+// be turned off again.
+//
+// Key Steps:
+// ========================
+//
+// 1. Create the epoch manager and the writers' lock, and hand the
+//    manager to every pool and both symbol tables so growth retires.
+//
+// 2. Allocate the VERSION column: existing current slots read as born
+//    at version 0, existing history as already dead at version 0.
+
+void store_enable_snapshots(ConceptStore* store) {
+    if (!store || store->epochs) return;
+
+    EpochManager* epochs = store_realloc(NULL, sizeof(EpochManager), "epoch manager");
+    init_epochs(epochs);
+    pthread_mutex_init(&store->write_lock, NULL);
+
+    pool_column(&store->slots, SLOT_COLUMN_VERSION);
+    SlotVersion* closed = (SlotVersion*)pool_column(&store->history, SLOT_COLUMN_VERSION);
+    for (uint32_t i = 0; i < store->history.used; i++) {
+        closed[i].died = 0;
+    }
+
+    store->slots.epochs = epochs;
+    store->in_slots.epochs = epochs;
+    store->history.epochs = epochs;
+    store->ids.epochs = epochs;
+    store->symbols.epochs = epochs;
+    store->committed_concepts = store->concept_count;
+    store->epochs = epochs;
+}
+
+void free_store(ConceptStore* store) {
+    if (!store) return;
+
+    free_slot_pool(&store->slots);
+    free_slot_pool(&store->in_slots);
+    free_slot_pool(&store->history);
+    array_free(store->arena, store->type_symbols);
+    array_free(store->arena, store->usage_counts);
+
+    for (uint32_t i = 0; i < store->index_capacity; i++) {
+        free_roaring(&store->type_index[i]);
+        free_roaring(&store->slot_source_index[i]);
+        free_roaring(&store->slot_target_index[i]);
+    }
+    free(store->type_index);
+    free(store->slot_source_index);
+    free(store->slot_target_index);
+    free(store->slot_name_counts);
+    free_roaring(&store->reserved);
+
+    free_symbol_table(&store->ids);
+    free_symbol_table(&store->symbols);
+
+    if (store->epochs) {
+        free_epochs(store->epochs);
+        free(store->epochs);
+        pthread_mutex_destroy(&store->write_lock);
+    }
+
+    free(store);
+}
+
+static void grow_pool_concepts(SlotPool* pool, uint32_t old_capacity, uint32_t new_capacity) {
+    size_t old_bytes = old_capacity * sizeof(uint32_t);
+    size_t bytes = new_capacity * sizeof(uint32_t);
+    pool->degrees = store_grow(pool->arena, pool->epochs, pool->degrees, old_bytes, bytes, "concept degrees");
+    pool->offsets = store_grow(pool->arena, pool->epochs, pool->offsets, old_bytes, bytes, "slot offsets");
+    pool->capacities = store_grow(pool->arena, pool->epochs, pool->capacities, old_bytes, bytes, "slot capacities");
+}
+
+static void grow_concept_arrays(ConceptStore* store) {
+    uint32_t new_capacity = store->concept_capacity ? store->concept_capacity * 2 : 64;
+
+    begin_move(store->epochs);
+    grow_pool_concepts(&store->slots, store->concept_capacity, new_capacity);
+    grow_pool_concepts(&store->in_slots, store->concept_capacity, new_capacity);
+    grow_pool_concepts(&store->history, store->concept_capacity, new_capacity);
+    store->type_symbols = store_grow(store->arena, store->epochs, store->type_symbols,
+                                     store->concept_capacity * sizeof(Symbol), new_capacity * sizeof(Symbol),
+                                     "type symbols");
+    store->usage_counts = store_grow(store->arena, store->epochs, store->usage_counts,
+                                     store->concept_capacity * sizeof(uint32_t), new_capacity * sizeof(uint32_t),
+                                     "usage counts");
+    end_move(store->epochs);
+
+    store->concept_capacity = new_capacity;
+}
+
+// Intern `name` and make sure the per-symbol bitmaps cover it.
+// New entries are zeroed, which is a valid empty RoaringBitmap.
+static Symbol intern_indexed_symbol(ConceptStore* store, const char* name) {
+    Symbol symbol = intern_symbol(&store->symbols, name);
+    if (symbol < store->index_capacity) return symbol;
+
+    uint32_t new_capacity = store->index_capacity ? store->index_capacity * 2 : 16;
+    while (new_capacity <= symbol) {
+        new_capacity *= 2;
+    }
+    size_t bytes = new_capacity * sizeof(RoaringBitmap);
+    size_t old_bytes = store->index_capacity * sizeof(RoaringBitmap);
+
+    store->type_index = store_realloc(store->type_index, bytes, "type index");
+    store->slot_source_index = store_realloc(store->slot_source_index, bytes, "slot source index");
+    store->slot_target_index = store_realloc(store->slot_target_index, bytes, "slot target index");
+    memset((char*)store->type_index + old_bytes, 0, bytes - old_bytes);
+    memset((char*)store->slot_source_index + old_bytes, 0, bytes - old_bytes);
+    memset((char*)store->slot_target_index + old_bytes, 0, bytes - old_bytes);
+
+    store->slot_name_counts = store_realloc(store->slot_name_counts, new_capacity * sizeof(uint32_t), "slot name counts");
+    memset(store->slot_name_counts + store->index_capacity, 0,
+           (new_capacity - store->index_capacity) * sizeof(uint32_t));
+
+    store->index_capacity = new_capacity;
+    return symbol;
+}
+
+// uint32_t store_create_concept(ConceptStore* store, const char* id, const char* type);
+//
+// Goal:
+// ======
+// Register a concept and return its index.
+//
+// Key Steps:
+// ========================
+//
+// 1. IDs are unique: if `id` already exists, return the existing index
+//    untouched (its type is not changed).
+//
+// 2. Intern the ID into `ids`. Because IDs are only ever added here, the
+//    symbol it gets is exactly the next concept index.
+//
+// 3. Intern the type into `symbols`, start with an empty segment, and
+//    add the concept to its type's bitmap, or to `reserved` if the type
+//    is internal.
+
+uint32_t store_create_concept(ConceptStore* store, const char* id, const char* type) {
+    if (!store || !id || !type) return CONCEPT_NONE;
+
+    begin_write(store);
+
+    uint32_t existing = find_concept_by_id(store, id);
+    if (existing != CONCEPT_NONE) {
+        end_write(store);
+        return existing;
+    }
+
+    if (store->concept_count >= store->concept_capacity) {
+        grow_concept_arrays(store);
+    }
+
+    uint32_t concept = intern_symbol(&store->ids, id);
+
+    store->slots.degrees[concept] = 0;
+    store->slots.offsets[concept] = store->slots.used;
+    store->slots.capacities[concept] = 0;
+    store->in_slots.degrees[concept] = 0;
+    store->in_slots.offsets[concept] = store->in_slots.used;
+    store->in_slots.capacities[concept] = 0;
+    store->history.degrees[concept] = 0;
+    store->history.offsets[concept] = store->history.used;
+    store->history.capacities[concept] = 0;
+    store->type_symbols[concept] = intern_indexed_symbol(store, type);
+    store->usage_counts[concept] = 0;
+    store->concept_count++;
+
+    if (type[0] == STORE_RESERVED_PREFIX) {
+        roaring_add(&store->reserved, concept);
+    } else {
+        roaring_add(&store->type_index[store->type_symbols[concept]], concept);
+    }
+
+    end_write(store);
+    return concept;
+}
+
+// void store_compact_slots(ConceptStore* store);
+//
+// Goal:
+// ======
+// Squeeze the dead space out of both edge pools.
+//
+// Every live segment is copied, in concept order, into fresh arrays; each
+// concept keeps its reserved capacity so the next add_slot on it does
+// not immediately relocate again. After this, dead == 0 and traversing
+// concepts 0..N-1 walks the pool front to back.
+
+static void compact_pool(SlotPool* pool, uint32_t concept_count) {
+    uint32_t live = pool->used - pool->dead;
+    uint32_t new_capacity = live ? live * 2 : 0;
+
+    Symbol* new_names = NULL;
+    uint32_t* new_neighbors = NULL;
+    if (new_capacity) {
+        new_names = array_realloc(pool->arena, NULL, new_capacity * sizeof(Symbol), "slot names");
+        new_neighbors = array_realloc(pool->arena, NULL, new_capacity * sizeof(uint32_t), "slot neighbors");
+    }
+
+    void* new_columns[SLOT_COLUMN_COUNT] = {0};
+    for (int c = 0; c < SLOT_COLUMN_COUNT; c++) {
+        if (pool->columns[c]) {
+            new_columns[c] = array_realloc(pool->arena, NULL, (new_capacity ? new_capacity : 1) * slot_columns[c].size,
+                                           "slot column");
+        }
+    }
+
+    begin_move(pool->epochs);
+    uint32_t cursor = 0;
+    for (uint32_t i = 0; i < concept_count; i++) {
+        uint32_t offset = pool->offsets[i];
+        uint32_t degree = pool->degrees[i];
+        if (degree) {
+            memcpy(new_names + cursor, pool->names + offset, degree * sizeof(Symbol));
+            memcpy(new_neighbors + cursor, pool->neighbors + offset, degree * sizeof(uint32_t));
+            for (int c = 0; c < SLOT_COLUMN_COUNT; c++) {
+                if (!new_columns[c]) continue;
+                size_t size = slot_columns[c].size;
+                memcpy((char*)new_columns[c] + cursor * size, (char*)pool->columns[c] + offset * size, degree * size);
+            }
+        }
+        pool->offsets[i] = cursor;
+        cursor += pool->capacities[i];
+    }
+
+    store_discard(pool->arena, pool->epochs, pool->names);
+    store_discard(pool->arena, pool->epochs, pool->neighbors);
+    pool->names = new_names;
+    pool->neighbors = new_neighbors;
+    for (int c = 0; c < SLOT_COLUMN_COUNT; c++) {
+        store_discard(pool->arena, pool->epochs, pool->columns[c]);
+        pool->columns[c] = new_columns[c];
+    }
+    pool->used = cursor;
+    pool->capacity = new_capacity;
+    pool->dead = 0;
+    end_move(pool->epochs);
+}
+
+void store_compact_slots(ConceptStore* store) {
+    if (!store) return;
+    begin_write(store);
+    compact_pool(&store->slots, store->concept_count);
+    compact_pool(&store->in_slots, store->concept_count);
+    end_write(store);
+}
+
+// Make sure `needed` more slots fit at the end of the pool.
+// Prefer compaction over growth when at least half the pool is dead.
+static void reserve_pool(SlotPool* pool, uint32_t concept_count, uint32_t needed) {
+    if (pool->used + needed <= pool->capacity) return;
+
+    if (pool->dead && pool->dead * 2 >= pool->used) {
+        compact_pool(pool, concept_count);
+        if (pool->used + needed <= pool->capacity) return;
+    }
+
+    uint32_t new_capacity = pool->capacity ? pool->capacity * 2 : 256;
+    while (new_capacity < pool->used + needed) {
+        new_capacity *= 2;
+    }
+    begin_move(pool->epochs);
+    pool->names = store_grow(pool->arena, pool->epochs, pool->names, pool->used * sizeof(Symbol),
+                             new_capacity * sizeof(Symbol), "slot names");
+    pool->neighbors = store_grow(pool->arena, pool->epochs, pool->neighbors, pool->used * sizeof(uint32_t),
+                                 new_capacity * sizeof(uint32_t), "slot neighbors");
+    for (int c = 0; c < SLOT_COLUMN_COUNT; c++) {
+        if (pool->columns[c]) {
+            size_t size = slot_columns[c].size;
+            pool->columns[c] = store_grow(pool->arena, pool->epochs, pool->columns[c], pool->used * size,
+                                          new_capacity * size, "slot column");
+        }
+    }
+    pool->capacity = new_capacity;
+    end_move(pool->epochs);
+}
+
+// Copy `count` slots (names, neighbors, side columns) within the pool.
+// Ranges may overlap.
+static void move_slots(SlotPool* pool, uint32_t from, uint32_t to, uint32_t count) {
+    if (!count) return;
+    memmove(pool->names + to, pool->names + from, count * sizeof(Symbol));
+    memmove(pool->neighbors + to, pool->neighbors + from, count * sizeof(uint32_t));
+    for (int c = 0; c < SLOT_COLUMN_COUNT; c++) {
+        if (!pool->columns[c]) continue;
+        size_t size = slot_columns[c].size;
+        memmove((char*)pool->columns[c] + to * size, (char*)pool->columns[c] + from * size, count * size);
+    }
+}
+
+// Append (name, neighbor) to `concept`'s segment in `pool`.
+//
+// Key Questions:
+// ========================
+//
+// 1. Is there room in the segment?
+//    - degree < capacity → write in place.
+//
+// 2. If not, can the segment grow where it is?
+//    - Only if it is the last segment in the pool; bulk-loading one
+//      concept at a time hits this path and never leaves dead space.
+//
+// 3. Otherwise move it:
+//    - Reserve 2x the capacity at the end of the pool, copy, and count
+//      the old segment as dead.
+//
+// 4. Side columns move with the segment; the new slot gets each
+//    column's default. Returns the slot's position in the pool.
+
+static uint32_t pool_append(SlotPool* pool, uint32_t concept_count, uint32_t concept, Symbol name, uint32_t neighbor) {
+    uint32_t degree = pool->degrees[concept];
+    uint32_t capacity = pool->capacities[concept];
+
+    if (degree >= capacity) {
+        uint32_t new_capacity = capacity ? capacity * 2 : STORE_INITIAL_SEGMENT;
+        uint32_t grow_by = new_capacity - capacity;
+
+        if (pool->offsets[concept] + capacity == pool->used &&
+            pool->used + grow_by <= pool->capacity) {
+            pool->used += grow_by;
+        } else {
+            begin_move(pool->epochs);
+            reserve_pool(pool, concept_count, new_capacity);   // may compact: reload offset below
+
+            uint32_t new_offset = pool->used;
+            move_slots(pool, pool->offsets[concept], new_offset, degree);
+            pool->dead += pool->capacities[concept];
+            pool->offsets[concept] = new_offset;
+            pool->used += new_capacity;
+            end_move(pool->epochs);
+        }
+        pool->capacities[concept] = new_capacity;
+    }
+
+    uint32_t position = pool->offsets[concept] + degree;
+    pool->names[position] = name;
+    pool->neighbors[position] = neighbor;
+    for (int c = 0; c < SLOT_COLUMN_COUNT; c++) {
+        if (pool->columns[c]) fill_column(pool->columns[c], (SlotColumn)c, position, position + 1);
+    }
+    if (pool->epochs && pool->columns[SLOT_COLUMN_VERSION]) {
+        ((SlotVersion*)pool->columns[SLOT_COLUMN_VERSION])[position].born = pool->epochs->current + 1;
+    }
+
+    // Publish last: a snapshot reader that sees the new degree sees the slot
+    __atomic_store_n(&pool->degrees[concept], degree + 1, __ATOMIC_RELEASE);
+    return position;
+}
+
+// void store_add_slot(ConceptStore* store, uint32_t concept, const char* slot_name, uint32_t target);
+//
+// Goal:
+// ======
+// Record (slot_name → target) on `concept`.
+//
+// Key Steps:
+// ========================
+//
+// 1. Append to the concept's outgoing segment and mirror it into the
+//    target's incoming segment.
+//
+// 2. Record both endpoints (unless reserved) in the slot-name bitmaps
+//    and bump the per-name slot count used by the query planner.
+//
+// append_slot() is the shared body; it returns the slot's position in
+// the outgoing pool so variants can fill side columns.
+
+static uint32_t append_slot(ConceptStore* store, uint32_t concept, const char* slot_name, uint32_t target) {
+    Symbol name = intern_indexed_symbol(store, slot_name);
+
+    uint32_t position = pool_append(&store->slots, store->concept_count, concept, name, target);
+    pool_append(&store->in_slots, store->concept_count, target, name, concept);
+    store->slot_count++;
+
+    if (!store_is_reserved(store, concept)) roaring_add(&store->slot_source_index[name], concept);
+    if (!store_is_reserved(store, target)) roaring_add(&store->slot_target_index[name], target);
+    store->slot_name_counts[name]++;
+
+    return position;
+}
+
+void store_add_slot(ConceptStore* store, uint32_t concept, const char* slot_name, uint32_t target) {
+    if (!store || !slot_name) return;
+    if (concept >= store->concept_count || target >= store->concept_count) return;
+
+    begin_write(store);
+    append_slot(store, concept, slot_name, target);
+    end_write(store);
+}
+
+// void store_add_weighted_slot(ConceptStore* store, uint32_t concept, const char* slot_name, uint32_t target,
+//                              float weight, float confidence, uint64_t timestamp);
+//
+// Same as store_add_slot(), plus the slot's SlotMeta. The first call
+// allocates the META column for the whole out-slot pool; slots added
+// before (or later without weights) read as the defaults.
+
+void store_add_weighted_slot(ConceptStore* store, uint32_t concept, const char* slot_name, uint32_t target,
+                             float weight, float confidence, uint64_t timestamp) {
+    if (!store || !slot_name) return;
+    if (concept >= store->concept_count || target >= store->concept_count) return;
+
+    begin_write(store);
+    uint32_t position = append_slot(store, concept, slot_name, target);
+
+    SlotMeta* meta = (SlotMeta*)pool_column(&store->slots, SLOT_COLUMN_META);
+    meta[position].weight = weight;
+    meta[position].confidence = confidence;
+    meta[position].timestamp = timestamp;
+    end_write(store);
+}
+
+// void store_add_slot_at(ConceptStore* store, uint32_t concept, const char* slot_name, uint32_t target,
+//                        uint64_t valid_from);
+//
+// Same as store_add_slot(), for a fact that holds from `valid_from` on.
+// The slot is open ([valid_from, SLOT_TIME_MAX)) until retracted.
+
+void store_add_slot_at(ConceptStore* store, uint32_t concept, const char* slot_name, uint32_t target,
+                       uint64_t valid_from) {
+    if (!store || !slot_name) return;
+    if (concept >= store->concept_count || target >= store->concept_count) return;
+
+    begin_write(store);
+    uint32_t position = append_slot(store, concept, slot_name, target);
+
+    SlotValidity* validity = (SlotValidity*)pool_column(&store->slots, SLOT_COLUMN_VALIDITY);
+    validity[position].valid_from = valid_from;
+    validity[position].valid_to = SLOT_TIME_MAX;
+    end_write(store);
+}
+
+// Remove slot `index` of `concept`'s segment, keeping the order of the
+// rest (and of their side columns). The segment keeps its capacity.
+//
+// With snapshots enabled a reader may be scanning the segment, so the
+// shortened copy is written at the end of the pool instead and the old
+// segment is left intact as dead space.
+static void pool_remove(SlotPool* pool, uint32_t concept_count, uint32_t concept, uint32_t index) {
+    uint32_t degree = pool->degrees[concept];
+    uint32_t after = degree - index - 1;
+
+    if (pool->epochs) {
+        uint32_t capacity = pool->capacities[concept];
+        begin_move(pool->epochs);
+        reserve_pool(pool, concept_count, capacity);   // may compact: reload offset below
+
+        uint32_t old_offset = pool->offsets[concept];
+        uint32_t new_offset = pool->used;
+        move_slots(pool, old_offset, new_offset, index);
+        move_slots(pool, old_offset + index + 1, new_offset + index, after);
+        pool->dead += capacity;
+        pool->offsets[concept] = new_offset;
+        pool->used += capacity;
+        pool->degrees[concept] = degree - 1;
+        end_move(pool->epochs);
+        return;
+    }
+
+    uint32_t position = pool->offsets[concept] + index;
+    move_slots(pool, position + 1, position, after);
+    pool->degrees[concept] = degree - 1;
+}
+
+static int segment_has_name(const SlotPool* pool, uint32_t concept, Symbol name) {
+    const Symbol* names = pool->names + pool->offsets[concept];
+    for (uint32_t i = 0; i < pool->degrees[concept]; i++) {
+        if (names[i] == name) return 1;
+    }
+    return 0;
+}
+
+// uint32_t store_retract_slot(ConceptStore* store, uint32_t concept, const char* slot_name, uint32_t target,
+//                             uint64_t valid_to);
+//
+// Goal:
+// ======
+// Close every current (slot_name → target) slot of `concept` at
+// `valid_to` and return how many were closed.
+//
+// Key Steps:
+// ========================
+//
+// 1. Each match is appended to the concept's history segment with
+//    interval [valid_from, valid_to) and its SlotMeta, then removed from
+//    the outgoing segment and from the target's incoming segment.
+//
+// 2. Slot counts drop accordingly, and the concept / target leave the
+//    slot-name bitmaps once they have no current slot of that name left.
+
+uint32_t store_retract_slot(ConceptStore* store, uint32_t concept, const char* slot_name, uint32_t target,
+                            uint64_t valid_to) {
+    if (!store || !slot_name) return 0;
+    if (concept >= store->concept_count || target >= store->concept_count) return 0;
+
+    Symbol name = find_symbol(&store->symbols, slot_name);
+    if (name == SYMBOL_NONE) return 0;
+
+    begin_write(store);
+    begin_move(store->epochs);   // history and current segments change together
+
+    SlotPool* out = &store->slots;
+    SlotPool* in = &store->in_slots;
+    SlotPool* history = &store->history;
+    uint32_t retracted = 0;
+
+    uint32_t i = 0;
+    while (i < out->degrees[concept]) {
+        uint32_t position = out->offsets[concept] + i;
+        if (out->names[position] != name || out->neighbors[position] != target) {
+            i++;
+            continue;
+        }
+
+        const SlotValidity* validity = (const SlotValidity*)out->columns[SLOT_COLUMN_VALIDITY];
+        uint64_t valid_from = validity ? validity[position].valid_from : 0;
+        const SlotMeta* meta = (const SlotMeta*)out->columns[SLOT_COLUMN_META];
+        SlotMeta slot_meta = meta ? meta[position] : default_slot_meta;
+
+        uint32_t closed = pool_append(history, store->concept_count, concept, name, target);
+        SlotValidity* closed_validity = (SlotValidity*)pool_column(history, SLOT_COLUMN_VALIDITY);
+        closed_validity[closed].valid_from = valid_from;
+        closed_validity[closed].valid_to = valid_to;
+        if (meta) {
+            ((SlotMeta*)pool_column(history, SLOT_COLUMN_META))[closed] = slot_meta;
+        }
+        if (store->epochs) {
+            const SlotVersion* live = (const SlotVersion*)out->columns[SLOT_COLUMN_VERSION];
+            SlotVersion* closed_version = (SlotVersion*)history->columns[SLOT_COLUMN_VERSION];
+            closed_version[closed].born = live[position].born;
+            closed_version[closed].died = write_version(store);
+        }
+
+        pool_remove(out, store->concept_count, concept, i);
+
+        const Symbol* in_names = in->names + in->offsets[target];
+        const uint32_t* in_sources = in->neighbors + in->offsets[target];
+        for (uint32_t j = 0; j < in->degrees[target]; j++) {
+            if (in_names[j] == name && in_sources[j] == concept) {
+                pool_remove(in, store->concept_count, target, j);
+                break;
+            }
+        }
+
+        store->slot_count--;
+        store->slot_name_counts[name]--;
+        store->history_count++;
+        retracted++;
+    }
+
+    if (retracted) {
+        if (!segment_has_name(out, concept, name)) roaring_remove(&store->slot_source_index[name], concept);
+        if (!segment_has_name(in, target, name)) roaring_remove(&store->slot_target_index[name], target);
+    }
+
+    end_move(store->epochs);
+    end_write(store);
+    return retracted;
+}
+
+// uint32_t store_slots_as_of(const ConceptStore* store, uint32_t concept, const char* slot_name, uint64_t as_of,
+//                            uint32_t* targets, Symbol* names);
+//
+// Goal:
+// ======
+// The slots of `concept` (all of them, or only `slot_name`) that held at
+// time `as_of`: current slots with valid_from <= as_of, then closed ones
+// with valid_from <= as_of < valid_to. Writes targets (and names, if not
+// NULL) and returns the count.
+//
+// Only the concept's own two segments are read, so the cost is the
+// current-state scan plus that concept's history, never the whole store.
+
+uint32_t store_slots_as_of(const ConceptStore* store, uint32_t concept, const char* slot_name, uint64_t as_of,
+                           uint32_t* targets, Symbol* names) {
+    if (!store || !targets || concept >= store->concept_count) return 0;
+
+    Symbol filter = SYMBOL_NONE;
+    if (slot_name) {
+        filter = find_symbol(&store->symbols, slot_name);
+        if (filter == SYMBOL_NONE) return 0;
+    }
+
+    const SlotPool* pools[2] = { &store->slots, &store->history };
+    uint32_t found = 0;
+
+    for (int p = 0; p < 2; p++) {
+        const SlotPool* pool = pools[p];
+        uint32_t offset = pool->offsets[concept];
+        uint32_t degree = pool->degrees[concept];
+        const SlotValidity* validity = (const SlotValidity*)pool->columns[SLOT_COLUMN_VALIDITY];
+
+        for (uint32_t i = 0; i < degree; i++) {
+            Symbol name = pool->names[offset + i];
+            if (filter != SYMBOL_NONE && name != filter) continue;
+            if (validity) {
+                const SlotValidity* interval = &validity[offset + i];
+                if (interval->valid_from > as_of || as_of >= interval->valid_to) continue;
+            }
+            targets[found] = pool->neighbors[offset + i];
+            if (names) names[found] = name;
+            found++;
+        }
+    }
+    return found;
+}
+
+// uint32_t store_compact_history(ConceptStore* store, uint64_t now, uint64_t retention);
+//
+// Goal:
+// ======
+// Drop closed slots that ended more than `retention` before `now`; they
+// can no longer answer an as-of query inside the window. Returns the
+// number dropped.
+//
+// Each history segment is filtered and shrunk to its new degree, then
+// the history pool is compacted to reclaim the space. With snapshots
+// enabled, a slot also stays while an open snapshot can still see it.
+
+uint32_t store_compact_history(ConceptStore* store, uint64_t now, uint64_t retention) {
+    if (!store) return 0;
+
+    SlotPool* history = &store->history;
+    if (!history->columns[SLOT_COLUMN_VALIDITY]) return 0;
+
+    begin_write(store);
+    begin_move(store->epochs);
+
+    uint64_t cutoff = now > retention ? now - retention : 0;
+    uint64_t oldest = store->epochs ? epoch_oldest(store->epochs) : 0;
+    uint32_t dropped = 0;
+
+    for (uint32_t concept = 0; concept < store->concept_count; concept++) {
+        uint32_t i = 0;
+        while (i < history->degrees[concept]) {
+            // Reload: a copy-on-write removal may have moved the columns
+            uint32_t position = history->offsets[concept] + i;
+            const SlotValidity* validity = (const SlotValidity*)history->columns[SLOT_COLUMN_VALIDITY];
+            const SlotVersion* version = (const SlotVersion*)history->columns[SLOT_COLUMN_VERSION];
+
+            if (validity[position].valid_to < cutoff && (!version || version[position].died <= oldest)) {
+                pool_remove(history, store->concept_count, concept, i);
+                dropped++;
+            } else {
+                i++;
+            }
+        }
+    }
+    if (!dropped) {
+        end_move(store->epochs);
+        end_write(store);
+        return 0;
+    }
+
+    for (uint32_t concept = 0; concept < store->concept_count; concept++) {
+        history->dead += history->capacities[concept] - history->degrees[concept];
+        history->capacities[concept] = history->degrees[concept];
+    }
+    store->history_count -= dropped;
+    compact_pool(history, store->concept_count);
+
+    end_move(store->epochs);
+    end_write(store);
+    return dropped;
+}
+
+// int store_has_slot(const ConceptStore* store, uint32_t concept, Symbol slot_name, uint32_t target);
+//
+// Scan whichever side is shorter: the concept's outgoing segment or
+// the target's incoming one. Hubs are usually on only one side.
+
+int store_has_slot(const ConceptStore* store, uint32_t concept, Symbol slot_name, uint32_t target) {
+    if (!store || concept >= store->concept_count || target >= store->concept_count) return 0;
+
+    uint32_t out_degree = store_degree(store, concept);
+    uint32_t in_degree = store_in_degree(store, target);
+
+    if (out_degree <= in_degree) {
+        const Symbol* names = store_slot_names(store, concept);
+        const uint32_t* targets = store_slot_targets(store, concept);
+        for (uint32_t i = 0; i < out_degree; i++) {
+            if (targets[i] == target && names[i] == slot_name) return 1;
+        }
+    } else {
+        const Symbol* names = store_in_slot_names(store, target);
+        const uint32_t* sources = store_in_slot_sources(store, target);
+        for (uint32_t i = 0; i < in_degree; i++) {
+            if (sources[i] == concept && names[i] == slot_name) return 1;
+        }
+    }
+    return 0;
+}
+
+uint32_t find_concept_by_id(const ConceptStore* store, const char* id) {
+    if (!store || !id) return CONCEPT_NONE;
+    return find_symbol(&store->ids, id);
+}
+
+// Index lookups return NULL for a name that was never interned, which
+// callers treat the same as an empty set.
+static const RoaringBitmap* lookup_index(const ConceptStore* store, const RoaringBitmap* index, const char* name) {
+    if (!store || !name) return NULL;
+    Symbol symbol = find_symbol(&store->symbols, name);
+    if (symbol == SYMBOL_NONE || symbol >= store->index_capacity) return NULL;
+    return &index[symbol];
+}
+
+const RoaringBitmap* store_type_index(const ConceptStore* store, const char* type) {
+    return store ? lookup_index(store, store->type_index, type) : NULL;
+}
+
+const RoaringBitmap* store_slot_source_index(const ConceptStore* store, const char* slot_name) {
+    return store ? lookup_index(store, store->slot_source_index, slot_name) : NULL;
+}
+
+const RoaringBitmap* store_slot_target_index(const ConceptStore* store, const char* slot_name) {
+    return store ? lookup_index(store, store->slot_target_index, slot_name) : NULL;
+}
+
+const char* store_concept_id(const ConceptStore* store, uint32_t concept) {
+    if (!store || concept >= store->concept_count) return NULL;
+    return symbol_name(&store->ids, concept);
+}
+
+const char* store_concept_type(const ConceptStore* store, uint32_t concept) {
+    if (!store || concept >= store->concept_count) return NULL;
+    return symbol_name(&store->symbols, store->type_symbols[concept]);
+}
+
+// void store_record_usage(ConceptStore* store, uint32_t concept, uint32_t count);
+//
+// Count `count` more uses of `concept` toward its prior. Not a graph
+// change, so no version is committed; with snapshots enabled it still
+// takes the write lock, as the usage array may be moved by a grow.
+
+void store_record_usage(ConceptStore* store, uint32_t concept, uint32_t count) {
+    if (!store || concept >= store->concept_count) return;
+
+    if (store->epochs) pthread_mutex_lock(&store->write_lock);
+    store->usage_counts[concept] += count;
+    store->usage_total += count;
+    if (store->epochs) pthread_mutex_unlock(&store->write_lock);
+}
+
+float store_concept_prior(const ConceptStore* store, uint32_t concept) {
+    if (!store || concept >= store->concept_count) return 0.0f;
+    return (float)(store->usage_counts[concept] + 1) / (float)(store->usage_total + store->concept_count);
+}
+
+// void print_store_concept(const ConceptStore* store, uint32_t concept);
+//
+// Same output as print_concept(), read from the store's arrays instead of
+// a Concept struct. This is the one place that touches all three tiers.
+
+void print_store_concept(const ConceptStore* store, uint32_t concept) {
+    if (!store || concept >= store->concept_count) return;
+
+    const Symbol* names = store_slot_names(store, concept);
+    const uint32_t* targets = store_slot_targets(store, concept);
+    uint32_t degree = store_degree(store, concept);
+
+    printf("ID: %s\n", store_concept_id(store, concept));
+    printf("Types: %s\n", store_concept_type(store, concept));
+    printf("Slots (# of slots = %u):\n", degree);
+
+    for (uint32_t i = 0; i < degree; i++) {
+        printf("\t#%u\n", i + 1);
+        printf("\t\tName: %s\n", symbol_name(&store->symbols, names[i]));
+        printf("\t\tTarget: %s\n", store_concept_id(store, targets[i]));
+    }
+}
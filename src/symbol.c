@@ -0,0 +1,226 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "symbol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// uint32_t hash_string(const char* str);
+//
+// 32-bit FNV-1a. Short identifiers ("john", "owns") dominate, so a
+// byte-at-a-time hash with no setup cost beats anything fancier here.
+
+uint32_t hash_string(const char* str) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)str; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static SymbolBuckets* alloc_buckets(uint32_t count) {
+    SymbolBuckets* buckets = calloc(1, sizeof(SymbolBuckets) + (size_t)count * sizeof(uint32_t));
+    if (!buckets) {
+        fprintf(stderr, "Failed to allocate memory for symbol buckets.\n");
+        exit(1);
+    }
+    buckets->count = count;
+    return buckets;
+}
+
+// void init_symbol_table(SymbolTable* table);
+//
+// Start empty: no pool, no offsets, and a small bucket array so the
+// probe loop never has to special-case an empty table.
+
+void init_symbol_table(SymbolTable* table) {
+    if (!table) return;
+
+    table->pool = NULL;
+    table->pool_size = 0;
+    table->pool_capacity = 0;
+
+    table->offsets = NULL;
+    table->count = 0;
+    table->capacity = 0;
+
+    table->epochs = NULL;
+
+    table->buckets = alloc_buckets(16);
+}
+
+void free_symbol_table(SymbolTable* table) {
+    if (!table) return;
+
+    free(table->pool);
+    free(table->offsets);
+    free(table->buckets);
+
+    table->pool = NULL;
+    table->offsets = NULL;
+    table->buckets = NULL;
+    table->count = 0;
+    table->pool_size = 0;
+}
+
+// realloc(), except that with readers around the old array is copied
+// and retired rather than freed.
+static void* grow_array(SymbolTable* table, void* ptr, size_t old_size, size_t new_size, const char* what) {
+    void* new_ptr;
+    if (table->epochs) {
+        new_ptr = malloc(new_size);
+        if (new_ptr && old_size) memcpy(new_ptr, ptr, old_size);
+        if (new_ptr) epoch_retire(table->epochs, ptr);
+    } else {
+        new_ptr = realloc(ptr, new_size);
+    }
+    if (!new_ptr) {
+        fprintf(stderr, "Failed to allocate memory for %s.\n", what);
+        exit(1);
+    }
+    return new_ptr;
+}
+
+// Rehash every symbol into a bucket array twice as large.
+// Buckets hold symbol + 1 so that a zeroed array means "all empty".
+static void grow_buckets(SymbolTable* table) {
+    uint32_t new_count = table->buckets->count * 2;
+    SymbolBuckets* new_buckets = alloc_buckets(new_count);
+
+    uint32_t mask = new_count - 1;
+    for (uint32_t symbol = 0; symbol < table->count; symbol++) {
+        uint32_t slot = hash_string(table->pool + table->offsets[symbol]) & mask;
+        while (new_buckets->slots[slot]) {
+            slot = (slot + 1) & mask;
+        }
+        new_buckets->slots[slot] = symbol + 1;
+    }
+
+    // Slots and count are published together, by one pointer store.
+    if (table->epochs) {
+        epoch_retire(table->epochs, table->buckets);
+    } else {
+        free(table->buckets);
+    }
+    __atomic_store_n(&table->buckets, new_buckets, __ATOMIC_RELEASE);
+}
+
+// Symbol find_symbol(const SymbolTable* table, const char* name);
+//
+// Probe from hash(name) until we hit the matching string or an empty
+// bucket. Returns SYMBOL_NONE if the string was never interned.
+
+Symbol find_symbol(const SymbolTable* table, const char* name) {
+    if (!table || !name) return SYMBOL_NONE;
+
+    const SymbolBuckets* buckets = __atomic_load_n(&table->buckets, __ATOMIC_ACQUIRE);
+    uint32_t mask = buckets->count - 1;
+    uint32_t slot = hash_string(name) & mask;
+    uint32_t entry;
+    while ((entry = __atomic_load_n(&buckets->slots[slot], __ATOMIC_ACQUIRE)) != 0) {
+        Symbol symbol = entry - 1;
+        if (strcmp(table->pool + table->offsets[symbol], name) == 0) {
+            return symbol;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return SYMBOL_NONE;
+}
+
+// Symbol intern_symbol(SymbolTable* table, const char* name);
+//
+// Key Steps:
+// ========================
+//
+// 1. If the string is already interned, return its symbol.
+//
+// 2. Otherwise append "name\0" to the pool (doubling it if needed) and
+//    record its offset; the new symbol is the previous count.
+//
+// 3. Keep the load factor at or below 1/2 so probe chains stay short.
+
+Symbol intern_symbol(SymbolTable* table, const char* name) {
+    if (!table || !name) return SYMBOL_NONE;
+
+    Symbol existing = find_symbol(table, name);
+    if (existing != SYMBOL_NONE) {
+        return existing;
+    }
+
+    uint32_t length = (uint32_t)strlen(name) + 1;
+    if (table->pool_size + length > table->pool_capacity) {
+        uint32_t new_capacity = table->pool_capacity ? table->pool_capacity * 2 : 256;
+        while (new_capacity < table->pool_size + length) {
+            new_capacity *= 2;
+        }
+        table->pool = grow_array(table, table->pool, table->pool_size, new_capacity, "symbol pool");
+        table->pool_capacity = new_capacity;
+    }
+
+    if (table->count >= table->capacity) {
+        uint32_t new_capacity = table->capacity ? table->capacity * 2 : 16;
+        table->offsets = grow_array(table, table->offsets, table->count * sizeof(uint32_t),
+                                    new_capacity * sizeof(uint32_t), "symbol offsets");
+        table->capacity = new_capacity;
+    }
+
+    Symbol symbol = table->count;
+    memcpy(table->pool + table->pool_size, name, length);
+    table->offsets[symbol] = table->pool_size;
+    table->pool_size += length;
+    table->count++;
+
+    if (table->count * 2 > table->buckets->count) {
+        grow_buckets(table);     // re-inserts the new symbol too
+    } else {
+        uint32_t mask = table->buckets->count - 1;
+        uint32_t slot = hash_string(name) & mask;
+        while (table->buckets->slots[slot]) {
+            slot = (slot + 1) & mask;
+        }
+        __atomic_store_n(&table->buckets->slots[slot], symbol + 1, __ATOMIC_RELEASE);
+    }
+
+    return symbol;
+}
+
+const char* symbol_name(const SymbolTable* table, Symbol symbol) {
+    if (!table || symbol >= table->count) return NULL;
+    return table->pool + table->offsets[symbol];
+}
+
+size_t symbol_table_bytes(const SymbolTable* table) {
+    if (!table) return 0;
+    return sizeof(SymbolBuckets) + ((size_t)table->buckets->count + table->count) * sizeof(uint32_t) +
+           table->pool_size;
+}
+
+// void copy_symbol_table(SymbolTable* copy, const SymbolTable* table, void* memory);
+//
+// Same symbols, same buckets: the arrays are copied as they are, so no
+// rehash. `memory` must hold symbol_table_bytes(table).
+
+void copy_symbol_table(SymbolTable* copy, const SymbolTable* table, void* memory) {
+    if (!copy || !table || !memory) return;
+
+    size_t bucket_bytes = sizeof(SymbolBuckets) + (size_t)table->buckets->count * sizeof(uint32_t);
+    SymbolBuckets* buckets = (SymbolBuckets*)memory;
+    uint32_t* offsets = (uint32_t*)((char*)memory + bucket_bytes);
+    char* pool = (char*)(offsets + table->count);
+
+    memcpy(buckets, table->buckets, bucket_bytes);
+    if (table->count) {
+        memcpy(offsets, table->offsets, table->count * sizeof(uint32_t));
+        memcpy(pool, table->pool, table->pool_size);
+    }
+
+    copy->pool = pool;
+    copy->pool_size = table->pool_size;
+    copy->pool_capacity = table->pool_size;
+    copy->offsets = offsets;
+    copy->count = table->count;
+    copy->capacity = table->count;
+    copy->buckets = buckets;
+    copy->epochs = NULL;
+}
@@ -0,0 +1,330 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "trie.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EDGE_EMPTY UINT64_MAX
+
+static void* trie_grow(void* ptr, size_t size, const char* what) {
+    void* grown = realloc(ptr, size ? size : 1);
+    if (!grown) {
+        fprintf(stderr, "Failed to allocate memory for %s.\n", what);
+        exit(1);
+    }
+    return grown;
+}
+
+static inline uint64_t edge_key(uint32_t state, uint32_t token) {
+    return ((uint64_t)state << 32) | token;
+}
+
+static inline uint32_t edge_slot(uint64_t key, uint32_t mask) {
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+void init_token_trie(TokenTrie* trie, uint32_t vocab_size) {
+    if (!trie) return;
+
+    memset(trie, 0, sizeof(TokenTrie));
+    trie->vocab_size = vocab_size;
+    trie->root_next = calloc(vocab_size ? vocab_size : 1, sizeof(uint32_t));
+    if (!trie->root_next) {
+        fprintf(stderr, "Failed to allocate memory for token trie root.\n");
+        exit(1);
+    }
+
+    trie->state_capacity = 64;
+    trie->fail = trie_grow(NULL, trie->state_capacity * sizeof(uint32_t), "token trie states");
+    trie->dict = trie_grow(NULL, trie->state_capacity * sizeof(uint32_t), "token trie states");
+    trie->output = trie_grow(NULL, trie->state_capacity * sizeof(uint32_t), "token trie states");
+    trie->label = trie_grow(NULL, trie->state_capacity * sizeof(uint32_t), "token trie states");
+    trie->first_child = trie_grow(NULL, trie->state_capacity * sizeof(uint32_t), "token trie states");
+    trie->next_sibling = trie_grow(NULL, trie->state_capacity * sizeof(uint32_t), "token trie states");
+
+    // State 0 is the root.
+    trie->fail[0] = 0;
+    trie->dict[0] = TOKEN_NONE;
+    trie->output[0] = TOKEN_NONE;
+    trie->label[0] = TOKEN_NONE;
+    trie->first_child[0] = TOKEN_NONE;
+    trie->next_sibling[0] = TOKEN_NONE;
+    trie->state_count = 1;
+    trie->compiled = 1;
+}
+
+void free_token_trie(TokenTrie* trie) {
+    if (!trie) return;
+    free(trie->root_next);
+    free(trie->edge_keys);
+    free(trie->edge_targets);
+    free(trie->fail);
+    free(trie->dict);
+    free(trie->output);
+    free(trie->label);
+    free(trie->first_child);
+    free(trie->next_sibling);
+    free(trie->patterns);
+    free(trie->pattern_next);
+    memset(trie, 0, sizeof(TokenTrie));
+}
+
+// ---
+// Edges
+// ---
+
+static uint32_t trie_goto(const TokenTrie* trie, uint32_t state, uint32_t token) {
+    if (state == 0) return trie->root_next[token] ? trie->root_next[token] : TOKEN_NONE;
+    if (trie->edge_capacity == 0) return TOKEN_NONE;
+
+    uint32_t mask = trie->edge_capacity - 1;
+    uint64_t key = edge_key(state, token);
+    for (uint32_t slot = edge_slot(key, mask);; slot = (slot + 1) & mask) {
+        if (trie->edge_keys[slot] == key) return trie->edge_targets[slot];
+        if (trie->edge_keys[slot] == EDGE_EMPTY) return TOKEN_NONE;
+    }
+}
+
+static void insert_edge(TokenTrie* trie, uint64_t key, uint32_t target) {
+    uint32_t mask = trie->edge_capacity - 1;
+    uint32_t slot = edge_slot(key, mask);
+    while (trie->edge_keys[slot] != EDGE_EMPTY) slot = (slot + 1) & mask;
+    trie->edge_keys[slot] = key;
+    trie->edge_targets[slot] = target;
+}
+
+// Keep the load factor at or below 1/2 so probe chains stay short.
+static void add_edge(TokenTrie* trie, uint32_t state, uint32_t token, uint32_t target) {
+    if (state == 0) {
+        trie->root_next[token] = target;
+        return;
+    }
+
+    if ((trie->edge_count + 1) * 2 > trie->edge_capacity) {
+        uint32_t old_capacity = trie->edge_capacity;
+        uint64_t* old_keys = trie->edge_keys;
+        uint32_t* old_targets = trie->edge_targets;
+
+        trie->edge_capacity = old_capacity ? old_capacity * 2 : 256;
+        trie->edge_keys = trie_grow(NULL, trie->edge_capacity * sizeof(uint64_t), "token trie edges");
+        trie->edge_targets = trie_grow(NULL, trie->edge_capacity * sizeof(uint32_t), "token trie edges");
+        memset(trie->edge_keys, 0xff, trie->edge_capacity * sizeof(uint64_t));
+        for (uint32_t slot = 0; slot < old_capacity; slot++) {
+            if (old_keys[slot] != EDGE_EMPTY) insert_edge(trie, old_keys[slot], old_targets[slot]);
+        }
+        free(old_keys);
+        free(old_targets);
+    }
+
+    insert_edge(trie, edge_key(state, token), target);
+    trie->edge_count++;
+}
+
+static uint32_t add_state(TokenTrie* trie, uint32_t parent, uint32_t token) {
+    if (trie->state_count == trie->state_capacity) {
+        uint32_t capacity = trie->state_capacity * 2;
+        trie->fail = trie_grow(trie->fail, capacity * sizeof(uint32_t), "token trie states");
+        trie->dict = trie_grow(trie->dict, capacity * sizeof(uint32_t), "token trie states");
+        trie->output = trie_grow(trie->output, capacity * sizeof(uint32_t), "token trie states");
+        trie->label = trie_grow(trie->label, capacity * sizeof(uint32_t), "token trie states");
+        trie->first_child = trie_grow(trie->first_child, capacity * sizeof(uint32_t), "token trie states");
+        trie->next_sibling = trie_grow(trie->next_sibling, capacity * sizeof(uint32_t), "token trie states");
+        trie->state_capacity = capacity;
+    }
+
+    // Until the next compile a new state falls back to the root and
+    // reports only its own patterns.
+    uint32_t state = trie->state_count++;
+    trie->fail[state] = 0;
+    trie->dict[state] = TOKEN_NONE;
+    trie->output[state] = TOKEN_NONE;
+    trie->label[state] = token;
+    trie->first_child[state] = TOKEN_NONE;
+    trie->next_sibling[state] = trie->first_child[parent];
+    trie->first_child[parent] = state;
+    add_edge(trie, parent, token, state);
+    return state;
+}
+
+// ---
+// Patterns
+// ---
+
+// uint32_t token_trie_add(TokenTrie* trie, const int* tokens, uint32_t length, uint32_t concept);
+//
+// Insert the token sequence as a pattern of `concept` and return its
+// pattern id, or TOKEN_NONE if it is empty or holds a token outside the
+// vocabulary. Detected by streams after the next token_trie_compile().
+
+uint32_t token_trie_add(TokenTrie* trie, const int* tokens, uint32_t length, uint32_t concept) {
+    if (!trie || !tokens || length == 0) return TOKEN_NONE;
+    for (uint32_t i = 0; i < length; i++) {
+        if (tokens[i] < 0 || (uint32_t)tokens[i] >= trie->vocab_size) return TOKEN_NONE;
+    }
+
+    uint32_t state = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        uint32_t next = trie_goto(trie, state, (uint32_t)tokens[i]);
+        state = next != TOKEN_NONE ? next : add_state(trie, state, (uint32_t)tokens[i]);
+    }
+
+    if (trie->pattern_count == trie->pattern_capacity) {
+        uint32_t capacity = trie->pattern_capacity ? trie->pattern_capacity * 2 : 64;
+        trie->patterns = trie_grow(trie->patterns, capacity * sizeof(TokenPattern), "token trie patterns");
+        trie->pattern_next = trie_grow(trie->pattern_next, capacity * sizeof(uint32_t), "token trie patterns");
+        trie->pattern_capacity = capacity;
+    }
+    uint32_t pattern = trie->pattern_count++;
+    trie->patterns[pattern] = (TokenPattern){ length, concept };
+    trie->pattern_next[pattern] = trie->output[state];
+    trie->output[state] = pattern;
+    trie->compiled = 0;
+    return pattern;
+}
+
+// uint32_t token_trie_add_text(TokenTrie* trie, const char* text, uint32_t concept, TokenEncodeFn encode,
+//                              void* context);
+//
+// token_trie_add() for a string, tokenized with `encode`. Encodings
+// longer than TOKEN_TRIE_MAX_PATTERN tokens are not added.
+
+uint32_t token_trie_add_text(TokenTrie* trie, const char* text, uint32_t concept, TokenEncodeFn encode,
+                             void* context) {
+    if (!trie || !text || !encode) return TOKEN_NONE;
+
+    int tokens[TOKEN_TRIE_MAX_PATTERN + 1];
+    uint32_t length = encode(context, text, tokens, TOKEN_TRIE_MAX_PATTERN + 1);
+    if (length > TOKEN_TRIE_MAX_PATTERN) return TOKEN_NONE;
+    return token_trie_add(trie, tokens, length, concept);
+}
+
+// uint32_t token_trie_sync_matcher(TokenTrie* trie, const EntityMatcher* matcher, TokenEncodeFn encode,
+//                                  void* context);
+//
+// Tokenize and add every pattern of `matcher` (concept IDs and aliases)
+// added since the last sync, so both indexes share one list of surface
+// forms. Patterns are tokenized as they were added, also from a
+// folding matcher: token IDs are case-sensitive, so "John" and "john"
+// are different entries here. Returns how many were added.
+
+uint32_t token_trie_sync_matcher(TokenTrie* trie, const EntityMatcher* matcher, TokenEncodeFn encode,
+                                 void* context) {
+    if (!trie || !matcher || !encode) return 0;
+
+    uint32_t added = 0;
+    for (uint32_t p = trie->matcher_synced; p < matcher->pattern_count; p++) {
+        const MatchPattern* pattern = &matcher->patterns[p];
+        if (token_trie_add_text(trie, matcher->pool + pattern->offset, pattern->concept, encode, context) !=
+            TOKEN_NONE) {
+            added++;
+        }
+    }
+    trie->matcher_synced = matcher->pattern_count;
+    return added;
+}
+
+static inline uint32_t trie_step(const TokenTrie* trie, uint32_t state, uint32_t token) {
+    while (state != 0) {
+        uint32_t next = trie_goto(trie, state, token);
+        if (next != TOKEN_NONE) return next;
+        state = trie->fail[state];
+    }
+    return trie->root_next[token];
+}
+
+// void token_trie_compile(TokenTrie* trie);
+//
+// Recompute fail and dict links after additions. States are visited
+// breadth-first, so the fail target of a state's parent, being
+// shallower, is always final before the state itself is reached.
+
+void token_trie_compile(TokenTrie* trie) {
+    if (!trie || trie->compiled) return;
+
+    uint32_t* queue = trie_grow(NULL, trie->state_count * sizeof(uint32_t), "token trie queue");
+    uint32_t head = 0, tail = 0;
+    for (uint32_t child = trie->first_child[0]; child != TOKEN_NONE; child = trie->next_sibling[child]) {
+        trie->fail[child] = 0;
+        trie->dict[child] = TOKEN_NONE;
+        queue[tail++] = child;
+    }
+
+    while (head < tail) {
+        uint32_t state = queue[head++];
+        for (uint32_t child = trie->first_child[state]; child != TOKEN_NONE; child = trie->next_sibling[child]) {
+            uint32_t fail = trie_step(trie, trie->fail[state], trie->label[child]);
+            trie->fail[child] = fail;
+            trie->dict[child] = trie->output[fail] != TOKEN_NONE ? fail : trie->dict[fail];
+            queue[tail++] = child;
+        }
+    }
+
+    free(queue);
+    trie->compiled = 1;
+}
+
+// ---
+// Streaming
+// ---
+
+void init_token_stream(TokenStream* stream) {
+    if (!stream) return;
+    stream->state = 0;
+    stream->position = 0;
+}
+
+// uint32_t token_stream_push(const TokenTrie* trie, TokenStream* stream, int token, EntityMention* out,
+//                            uint32_t capacity);
+//
+// Feed the next generated token. Writes up to `capacity` mentions ending
+// at it to `out` (begin / end are stream positions, longest first) and
+// returns how many there are. A token outside the vocabulary breaks any
+// mention in progress.
+
+uint32_t token_stream_push(const TokenTrie* trie, TokenStream* stream, int token, EntityMention* out,
+                           uint32_t capacity) {
+    if (!trie || !stream) return 0;
+
+    uint32_t end = ++stream->position;
+    if (token < 0 || (uint32_t)token >= trie->vocab_size) {
+        stream->state = 0;
+        return 0;
+    }
+    uint32_t state = trie_step(trie, stream->state, (uint32_t)token);
+    stream->state = state;
+
+    // The dict chain runs from the longest suffix to the shortest.
+    uint32_t found = 0;
+    uint32_t hit = trie->output[state] != TOKEN_NONE ? state : trie->dict[state];
+    while (hit != TOKEN_NONE) {
+        for (uint32_t p = trie->output[hit]; p != TOKEN_NONE; p = trie->pattern_next[p]) {
+            if (out && found < capacity) {
+                out[found] = (EntityMention){ end - trie->patterns[p].length, end, trie->patterns[p].concept, p };
+            }
+            found++;
+        }
+        hit = trie->dict[hit];
+    }
+    return found;
+}
+
+// uint32_t token_trie_scan(const TokenTrie* trie, const int* tokens, uint32_t token_count, EntityMention* out,
+//                          uint32_t capacity);
+//
+// Stream a whole token sequence (e.g. a prompt) and collect its mentions
+// in end order. Writes up to `capacity`, returns the total.
+
+uint32_t token_trie_scan(const TokenTrie* trie, const int* tokens, uint32_t token_count, EntityMention* out,
+                         uint32_t capacity) {
+    if (!trie || !tokens) return 0;
+
+    TokenStream stream;
+    init_token_stream(&stream);
+    uint32_t found = 0;
+    for (uint32_t t = 0; t < token_count; t++) {
+        uint32_t room = (out && found < capacity) ? capacity - found : 0;
+        found += token_stream_push(trie, &stream, tokens[t], room ? out + found : NULL, room);
+    }
+    return found;
+}
@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#define _GNU_SOURCE
+#include "vectors.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+static size_t matrix_bytes(uint32_t rows, uint32_t stride) {
+    return (size_t)rows * stride * sizeof(float);
+}
+
+static size_t present_bytes(uint32_t rows) {
+    return ((size_t)rows + 63) / 64 * sizeof(uint64_t);
+}
+
+static void* map_reserved(size_t size, const char* what) {
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED) {
+        fprintf(stderr, "Failed to map %zu bytes for %s.\n", size, what);
+        exit(1);
+    }
+    return memory;
+}
+
+static void* remap(void* memory, size_t old_size, size_t new_size, const char* what) {
+    void* moved = mremap(memory, old_size, new_size, MREMAP_MAYMOVE);
+    if (moved == MAP_FAILED) {
+        fprintf(stderr, "Failed to remap %zu bytes for %s.\n", new_size, what);
+        exit(1);
+    }
+    return moved;
+}
+
+// void init_vector_store(ConceptVectorStore* store, uint32_t dimensions, uint32_t max_concepts);
+//
+// Reserve room for `max_concepts` rows (0: VECTOR_DEFAULT_MAX_CONCEPTS)
+// of `dimensions` floats. Nothing is committed until rows are written.
+
+void init_vector_store(ConceptVectorStore* store, uint32_t dimensions, uint32_t max_concepts) {
+    if (!store) return;
+    if (max_concepts == 0) max_concepts = VECTOR_DEFAULT_MAX_CONCEPTS;
+
+    store->dimensions = dimensions;
+    store->stride = (dimensions + VECTOR_ALIGN_FLOATS - 1) / VECTOR_ALIGN_FLOATS * VECTOR_ALIGN_FLOATS;
+    store->capacity = max_concepts;
+    store->n_concepts = 0;
+    store->mapped = matrix_bytes(max_concepts, store->stride);
+    store->vectors = map_reserved(store->mapped, "concept vectors");
+    store->present = map_reserved(present_bytes(max_concepts), "vector presence bits");
+}
+
+void free_vector_store(ConceptVectorStore* store) {
+    if (!store || !store->vectors) return;
+
+    munmap(store->vectors, store->mapped);
+    munmap(store->present, present_bytes(store->capacity));
+    memset(store, 0, sizeof(ConceptVectorStore));
+}
+
+// Cover row `concept`, doubling the reservation. Fresh anonymous pages
+// read as zero, so new rows and bits need no clearing.
+static void reserve_rows(ConceptVectorStore* store, uint32_t concept) {
+    uint64_t new_capacity = store->capacity;
+    while (new_capacity <= concept) {
+        new_capacity *= 2;
+    }
+    if (new_capacity > UINT32_MAX) new_capacity = UINT32_MAX;
+
+    size_t new_mapped = matrix_bytes((uint32_t)new_capacity, store->stride);
+    store->vectors = remap(store->vectors, store->mapped, new_mapped, "concept vectors");
+    store->present = remap(store->present, present_bytes(store->capacity),
+                           present_bytes((uint32_t)new_capacity), "vector presence bits");
+    store->mapped = new_mapped;
+    store->capacity = (uint32_t)new_capacity;
+}
+
+// float* vector_attach(ConceptVectorStore* store, uint32_t concept, const float* embedding);
+//
+// Copy `embedding` (dimensions floats) into the row of `concept`,
+// replacing any previous one, and return the row. With a NULL
+// embedding the row is just claimed (zeroed) for the caller to fill.
+
+float* vector_attach(ConceptVectorStore* store, uint32_t concept, const float* embedding) {
+    if (!store || !store->vectors || concept == UINT32_MAX) return NULL;
+    if (concept >= store->capacity) reserve_rows(store, concept);
+
+    float* row = store->vectors + (size_t)concept * store->stride;
+    if (embedding) {
+        memcpy(row, embedding, store->dimensions * sizeof(float));
+    } else {
+        memset(row, 0, store->dimensions * sizeof(float));
+    }
+
+    if (!vector_present(store, concept)) {
+        store->present[concept >> 6] |= (uint64_t)1 << (concept & 63);
+        store->n_concepts++;
+    }
+    return row;
+}
+
+void vector_detach(ConceptVectorStore* store, uint32_t concept) {
+    if (!store || !vector_present(store, concept)) return;
+
+    memset(store->vectors + (size_t)concept * store->stride, 0, store->dimensions * sizeof(float));
+    store->present[concept >> 6] &= ~((uint64_t)1 << (concept & 63));
+    store->n_concepts--;
+}
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "cpu.h"
+
+int test_failures = 0;
+
+typedef struct TestSuite {
+    const char* name;
+    void (*run)(void);
+} TestSuite;
+
+static const TestSuite suites[] = {
+    { "concept", test_concept },
+    { "store", test_store },
+    { "scan", test_scan },
+    { "roaring", test_roaring },
+    { "query", test_query },
+    { "rank", test_rank },
+    { "temporal", test_temporal },
+    { "snapshot", test_snapshot },
+    { "shard", test_shard },
+    { "scheduler", test_scheduler },
+    { "graph", test_graph },
+    { "ppr", test_ppr },
+    { "path", test_path },
+    { "vectors", test_vectors },
+    { "hnsw", test_hnsw },
+    { "distance", test_distance },
+    { "quantize", test_quantize },
+    { "lsh", test_lsh },
+    { "knn", test_knn },
+    { "matcher", test_matcher },
+    { "trie", test_trie },
+    { "resolve", test_resolve },
+    { "alias", test_alias },
+};
+
+int main(void) {
+    // CLARITY_CPU_LEVEL caps the kernels every suite below runs on.
+    printf("cpu level    %s\n", cpu_level_name(cpu_level()));
+    int failed_suites = 0;
+    for (size_t i = 0; i < sizeof(suites) / sizeof(suites[0]); i++) {
+        int before = test_failures;
+        suites[i].run();
+        int failed = test_failures - before;
+        printf("%-12s %s\n", suites[i].name, failed ? "FAILED" : "ok");
+        if (failed) failed_suites++;
+    }
+    printf("%d of %zu suites failed\n", failed_suites, sizeof(suites) / sizeof(suites[0]));
+    return failed_suites ? 1 : 0;
+}
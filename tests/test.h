@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "store.h"
+
+// -------------------------------------- NOTES ---------------------------------------
+
+// `make test` builds every tests/*.c with the library sources into one
+// binary and runs each suite listed in tests/main.c. A suite checks the
+// real implementation against a naive reference (brute force, linear
+// scans, exhaustive search, hand-worked small graphs); CHECK() records a
+// failure and keeps going, so one run reports every mismatch.
+
+// ----------------------------------------------------------------------------------------
+
+extern int test_failures;
+
+#define CHECK(condition, ...)                                             \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            test_failures++;                                              \
+            fprintf(stderr, "  %s:%d: ", __FILE__, __LINE__);             \
+            fprintf(stderr, __VA_ARGS__);                                 \
+            fputc('\n', stderr);                                          \
+        }                                                                 \
+    } while (0)
+
+// Deterministic xorshift64*, so every run sees the same inputs.
+static inline uint32_t test_random(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return (uint32_t)((*state * 2685821657736338717ull) >> 32);
+}
+
+void test_concept(void);
+void test_store(void);
+void test_scan(void);
+void test_roaring(void);
+void test_query(void);
+void test_rank(void);
+void test_temporal(void);
+void test_snapshot(void);
+void test_shard(void);
+void test_scheduler(void);
+void test_graph(void);
+void test_ppr(void);
+void test_path(void);
+void test_vectors(void);
+void test_hnsw(void);
+void test_distance(void);
+void test_quantize(void);
+void test_lsh(void);
+void test_knn(void);
+void test_matcher(void);
+void test_trie(void);
+void test_resolve(void);
+void test_alias(void);
+
+// Shared graph builders (test_graph.c): concepts "n0", "n1", ... of
+// type Node joined by "to" slots.
+ConceptStore* test_graph_store(uint32_t concepts, const uint32_t (*edges)[2], uint32_t edge_count);
+ConceptStore* test_random_graph(uint32_t concepts, uint64_t seed);
+
+#endif
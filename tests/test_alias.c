@@ -0,0 +1,235 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "alias.h"
+#include "shard.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Exact and fuzzy alias lookup against a naive scan over every name, and
+// edit_distance() against the textbook DP. A five-letter alphabet keeps
+// near names common; a few names run past 64 bytes, off the
+// bit-parallel path.
+
+#define NAMES 300
+#define QUERIES 60
+#define LIMIT 4096
+
+static uint32_t naive_distance(const char* a, const char* b) {
+    uint32_t n = (uint32_t)strlen(a), m = (uint32_t)strlen(b);
+    uint32_t row[128];
+    for (uint32_t j = 0; j <= m; j++) row[j] = j;
+    for (uint32_t i = 1; i <= n; i++) {
+        uint32_t diagonal = row[0];
+        row[0] = i;
+        for (uint32_t j = 1; j <= m; j++) {
+            uint32_t above = row[j];
+            uint32_t best = diagonal + (a[i - 1] != b[j - 1]);
+            if (above + 1 < best) best = above + 1;
+            if (row[j - 1] + 1 < best) best = row[j - 1] + 1;
+            row[j] = best;
+            diagonal = above;
+        }
+    }
+    return row[m];
+}
+
+static void random_name(uint64_t* state, char* name, uint32_t min_length, uint32_t max_length) {
+    uint32_t length = min_length + test_random(state) % (max_length - min_length + 1);
+    for (uint32_t i = 0; i < length; i++) name[i] = "abcde"[test_random(state) % 5];
+    name[length] = '\0';
+}
+
+// Name i names concept i, and every third one concept i + NAMES too.
+static uint32_t naive_fuzzy_count(char names[][100], const char* query, uint32_t k) {
+    uint32_t expected = 0;
+    for (uint32_t i = 0; i < NAMES; i++) {
+        if (naive_distance(query, names[i]) <= k) expected += i % 3 == 0 ? 2 : 1;
+    }
+    return expected;
+}
+
+static void check_fuzzy(const AliasIndex* index, AliasWorkspace* workspace, char names[][100], const char* query,
+                        AliasMatch* matches) {
+    for (uint32_t k = 0; k <= 3; k++) {
+        uint32_t found = alias_fuzzy_lookup(index, workspace, query, k, LIMIT, matches);
+        uint32_t expected = naive_fuzzy_count(names, query, k);
+        CHECK(found == expected, "fuzzy(%s, %u): %u matches, naive %u", query, k, found, expected);
+
+        for (uint32_t m = 0; m < found; m++) {
+            const AliasMatch* match = &matches[m];
+            uint32_t name = match->concept % NAMES;
+            uint32_t truth = naive_distance(query, names[name]);
+            CHECK(match->distance == truth, "fuzzy(%s, %u): %s reported at %u, naive %u", query, k, names[name],
+                  match->distance, truth);
+            if (m > 0) {
+                CHECK(matches[m - 1].distance <= match->distance, "fuzzy(%s, %u): not nearest first", query, k);
+            }
+        }
+
+        // A short limit keeps the nearest.
+        AliasMatch few[3];
+        uint32_t kept = alias_fuzzy_lookup(index, workspace, query, k, 3, few);
+        CHECK(kept == (found < 3 ? found : 3), "fuzzy(%s, %u): limit 3 kept %u of %u", query, k, kept, found);
+        for (uint32_t m = 0; m < kept; m++) {
+            CHECK(few[m].distance == matches[m].distance, "fuzzy(%s, %u): limit 3 dropped a nearer match", query, k);
+        }
+    }
+}
+
+static void test_lookup(void) {
+    static char names[NAMES][100];
+    uint64_t state = 37;
+    AliasIndex index;
+    init_alias_index(&index);
+    for (uint32_t i = 0; i < NAMES; i++) {
+        random_name(&state, names[i], 1, i % 10 == 0 ? 90 : 8);     // a few past 64 bytes
+        alias_add(&index, names[i], i);
+        if (i % 3 == 0) alias_add(&index, names[i], i + NAMES);      // shared names
+    }
+    Symbol again = alias_add(&index, names[0], 0);
+    CHECK(again != SYMBOL_NONE && index.entry_count == NAMES + (NAMES + 2) / 3, "adding a pair twice added it again");
+    char too_long[ALIAS_MAX_LENGTH + 2];
+    memset(too_long, 'a', sizeof(too_long) - 1);
+    too_long[sizeof(too_long) - 1] = '\0';
+    CHECK(alias_add(&index, "", 1) == SYMBOL_NONE && alias_add(&index, too_long, 1) == SYMBOL_NONE,
+          "an empty or overlong name was added");
+
+    // Exact lookup: every concept given the name, upper case folded.
+    char upper[100];
+    for (uint32_t i = 0; i < NAMES; i += 7) {
+        for (uint32_t c = 0; c <= strlen(names[i]); c++) upper[c] = (char)(names[i][c] & ~0x20);
+        uint32_t concepts[64];
+        uint32_t found = alias_lookup(&index, upper, concepts, 64);
+        uint32_t expected = 0;
+        for (uint32_t j = 0; j < NAMES; j++) {
+            if (strcmp(names[j], names[i]) == 0) expected += j % 3 == 0 ? 2 : 1;
+        }
+        CHECK(found == expected, "alias_lookup(%s): %u concepts, expected %u", upper, found, expected);
+        CHECK(alias_lookup(&index, upper, concepts, 0) == expected, "alias_lookup(%s) without room miscounted",
+              upper);
+    }
+    CHECK(alias_lookup(&index, "zzz", NULL, 0) == 0, "alias_lookup found an unknown name");
+
+    AliasWorkspace workspace;
+    init_alias_workspace(&workspace);
+    AliasMatch* matches = malloc(LIMIT * sizeof(AliasMatch));
+    char query[100];
+    for (uint32_t q = 0; q < QUERIES; q++) {
+        if (q % 2) {
+            random_name(&state, query, 1, q % 10 == 1 ? 90 : 8);
+        } else {
+            strcpy(query, names[test_random(&state) % NAMES]);
+            query[test_random(&state) % strlen(query)] = 'e';
+        }
+        check_fuzzy(&index, &workspace, names, query, matches);
+
+        // Every bound from 0 up to past the true distance.
+        for (uint32_t i = 0; i < NAMES; i += 13) {
+            uint32_t truth = naive_distance(query, names[i]);
+            for (uint32_t bound = 0; bound <= truth + 1; bound += truth > 8 ? 7 : 1) {
+                uint32_t fast = edit_distance(query, (uint32_t)strlen(query), names[i], (uint32_t)strlen(names[i]),
+                                              bound);
+                CHECK(fast == (truth <= bound ? truth : bound + 1), "edit_distance(%s, %s, %u) = %u, naive %u",
+                      query, names[i], bound, fast, truth);
+            }
+            // Bounds far past any distance, where bound + 1 used to wrap.
+            static const uint32_t large[] = { 1000, UINT32_MAX - 1, UINT32_MAX };
+            for (uint32_t b = 0; b < 3; b++) {
+                uint32_t fast = edit_distance(query, (uint32_t)strlen(query), names[i], (uint32_t)strlen(names[i]),
+                                              large[b]);
+                CHECK(fast == truth, "edit_distance(%s, %s, %u) = %u, naive %u", query, names[i], large[b], fast,
+                      truth);
+            }
+        }
+    }
+    free(matches);
+    free_alias_workspace(&workspace);
+    free_alias_index(&index);
+
+    // Strings longer than any name: five substitutions apart.
+    char long_a[400], long_b[400];
+    memset(long_a, 'a', sizeof(long_a));
+    memcpy(long_b, long_a, sizeof(long_b));
+    for (uint32_t i = 0; i < 5; i++) long_b[7 + 61 * i] = 'b';
+    CHECK(edit_distance(long_a, 400, long_b, 400, UINT32_MAX) == 5, "400-byte strings: distance is not 5");
+    CHECK(edit_distance(long_a, 400, long_b, 400, 2) == 3, "400-byte strings: bound 2 not exceeded");
+    CHECK(edit_distance(long_a, 400, long_b, 390, UINT32_MAX) == 15, "400 and 390 bytes: distance is not 15");
+    CHECK(edit_distance(long_a, 0, long_b, 0, UINT32_MAX) == 0, "two empty strings are not equal");
+}
+
+// Concept IDs become names; later syncs add only new concepts.
+static void test_sync(void) {
+    ConceptStore* store = create_store();
+    uint32_t john = store_create_concept(store, "John", "Person");
+    store_create_concept(store, "Mary", "Person");
+    AliasIndex index;
+    AliasWorkspace workspace;
+    AliasMatch matches[8];
+    uint32_t concepts[4];
+    init_alias_index(&index);
+    init_alias_workspace(&workspace);
+
+    CHECK(alias_sync_store(&index, store) == 2 && alias_sync_store(&index, store) == 0, "sync added the wrong IDs");
+    alias_add(&index, "Johnny", john);
+    CHECK(alias_lookup(&index, "johnny", concepts, 4) == 1 && concepts[0] == john, "alias Johnny is not John");
+    uint32_t found = alias_fuzzy_lookup(&index, &workspace, "Jon", 1, 8, matches);
+    CHECK(found == 1 && matches[0].concept == john && matches[0].distance == 1, "fuzzy Jon found %u", found);
+
+    uint32_t jon = store_create_concept(store, "Jon", "Person");
+    CHECK(alias_sync_store(&index, store) == 1, "sync missed the new concept");
+    found = alias_fuzzy_lookup(&index, &workspace, "Jon", 1, 8, matches);
+    CHECK(found == 2 && matches[0].concept == jon && matches[0].distance == 0 && matches[1].concept == john,
+          "fuzzy Jon after sync found %u", found);
+
+    free_alias_workspace(&workspace);
+    free_alias_index(&index);
+    free_store(store);
+}
+
+// Each shard's store also holds "@s:i" proxies for the targets of
+// cross-shard slots; syncing a shard must name only its real concepts.
+static void test_sync_shards(void) {
+    ShardedStore* sharded = create_sharded_store(2);
+    ConceptHandle people[12];
+    char id[16];
+    for (uint32_t i = 0; i < 12; i++) {
+        snprintf(id, sizeof(id), "p%u", i);
+        people[i] = sharded_create_concept(sharded, id, "Person");
+    }
+    for (uint32_t i = 0; i + 1 < 12; i++) sharded_add_slot(sharded, people[i], "knows", people[i + 1]);
+
+    AliasWorkspace workspace;
+    AliasMatch matches[16];
+    uint32_t concepts[4];
+    init_alias_workspace(&workspace);
+    uint32_t proxies = 0;
+    for (uint32_t s = 0; s < sharded->shard_count; s++) {
+        const ConceptStore* store = sharded->shards[s].store;
+        uint32_t owned = 0;
+        for (uint32_t i = 0; i < 12; i++) owned += handle_shard(people[i]) == s;
+
+        AliasIndex index;
+        init_alias_index(&index);
+        uint32_t added = alias_sync_store(&index, store);
+        CHECK(added == owned, "shard %u: sync added %u names for %u concepts", s, added, owned);
+        for (uint32_t concept = 0; concept < store->concept_count; concept++) {
+            if (!store_is_reserved(store, concept)) continue;
+            const char* proxy = store_concept_id(store, concept);
+            proxies++;
+            CHECK(alias_lookup(&index, proxy, concepts, 4) == 0, "shard %u: proxy %s has a name", s, proxy);
+            CHECK(alias_fuzzy_lookup(&index, &workspace, proxy, 1, 16, matches) == 0,
+                  "shard %u: proxy %s matched fuzzily", s, proxy);
+        }
+        free_alias_index(&index);
+    }
+    CHECK(proxies > 0, "no proxies: every slot stayed within one shard");
+    free_alias_workspace(&workspace);
+    free_sharded_store(sharded);
+}
+
+void test_alias(void) {
+    test_lookup();
+    test_sync();
+    test_sync_shards();
+}
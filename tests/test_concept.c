@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "concept.h"
+#include <string.h>
+
+// Inline slots: the first CONCEPT_INLINE_SLOTS live in the Concept,
+// later ones spill to a heap array. Order and targets must survive the
+// spill and every later growth. Every Concept starts on a cache line.
+
+#define SLOTS 11
+
+void test_concept(void) {
+    static const char* names[] = { "owns", "likes", "hates", "knows" };
+    Concept* john = create_concept("john", "Person");
+    Concept* targets[SLOTS];
+    char id[16];
+    for (int i = 0; i < SLOTS; i++) {
+        snprintf(id, sizeof(id), "t%d", i);
+        targets[i] = create_concept(id, "Object");
+        CHECK((uintptr_t)targets[i] % CONCEPT_ALIGNMENT == 0, "%s is not %d-byte aligned", id, CONCEPT_ALIGNMENT);
+    }
+    CHECK((uintptr_t)john % CONCEPT_ALIGNMENT == 0, "john is not %d-byte aligned", CONCEPT_ALIGNMENT);
+
+    CHECK(john->slots == john->inline_slots && john->slot_count == 0 &&
+              john->slot_capacity == CONCEPT_INLINE_SLOTS,
+          "a fresh concept does not start on its inline slots");
+
+    for (int i = 0; i < SLOTS; i++) {
+        add_slot(john, names[i % 4], targets[i]);
+        int inline_storage = john->slots == john->inline_slots;
+        CHECK(inline_storage == (i + 1 <= CONCEPT_INLINE_SLOTS), "after %d slots: inline storage is %d", i + 1,
+              inline_storage);
+        CHECK(john->slot_count == i + 1 && john->slot_capacity >= john->slot_count,
+              "after %d slots: count %d, capacity %d", i + 1, john->slot_count, john->slot_capacity);
+
+        // Every slot so far, in insertion order.
+        for (int j = 0; j <= i; j++) {
+            CHECK(strcmp(john->slots[j].name, names[j % 4]) == 0 && john->slots[j].target == targets[j],
+                  "after %d slots: slot %d is %s → %s", i + 1, j, john->slots[j].name, john->slots[j].target->id);
+        }
+    }
+
+    // The slot name is copied, not borrowed.
+    char name[8] = "temp";
+    add_slot(targets[0], name, john);
+    name[0] = 'X';
+    CHECK(strcmp(targets[0]->slots[0].name, "temp") == 0, "slot name aliases the caller's buffer");
+
+    // Incomplete calls are ignored.
+    add_slot(john, NULL, targets[0]);
+    add_slot(john, "owns", NULL);
+    CHECK(john->slot_count == SLOTS, "add_slot() with a NULL argument added a slot");
+
+    free_concept(john);
+    for (int i = 0; i < SLOTS; i++) free_concept(targets[i]);
+}
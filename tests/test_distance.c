@@ -0,0 +1,400 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "cpu.h"
+#include "distance.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Distance kernels against plain double-precision loops, for every
+// format and metric, over lengths that hit every vector tail and from
+// unaligned starts. `make test` runs the suite capped at each
+// CLARITY_CPU_LEVEL, so the scalar, AVX2 and AVX-512 kernels are each
+// held to the same reference. fp16 conversion is checked on all 65536
+// halves and against round-to-nearest-even on floats of every class.
+
+#define MAX_DIMENSIONS 300
+#define ROWS 9
+
+static const uint32_t lengths[] = { 0, 1, 2, 3, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 128, 257, 300 };
+static const DistanceMetric metrics[] = { DISTANCE_L2, DISTANCE_INNER_PRODUCT, DISTANCE_COSINE };
+
+static double absolute(double value) {
+    return value < 0.0 ? -value : value;
+}
+
+// Newton's method, so the suite does not need libm.
+static double square_root(double value) {
+    if (value <= 0.0) return 0.0;
+    double root = value > 1.0 ? value : 1.0;
+    for (int i = 0; i < 100; i++) root = 0.5 * (root + value / root);
+    return root;
+}
+
+static float random_float(uint64_t* state) {
+    return (float)(test_random(state) % 200001) / 100000.0f - 1.0f;
+}
+
+static int is_nan(float value) {
+    return value != value;
+}
+
+// Metric of two vectors given as doubles; `scale` bounds the rounding
+// error a float kernel may accumulate (sum of |terms|).
+static double reference(DistanceMetric metric, const double* a, const double* b, uint32_t n, double* scale) {
+    double dot = 0.0, aa = 0.0, bb = 0.0, l2 = 0.0, magnitude = 0.0;
+    for (uint32_t i = 0; i < n; i++) {
+        dot += a[i] * b[i];
+        aa += a[i] * a[i];
+        bb += b[i] * b[i];
+        l2 += (a[i] - b[i]) * (a[i] - b[i]);
+        magnitude += absolute(a[i] * b[i]);
+    }
+    switch (metric) {
+    case DISTANCE_INNER_PRODUCT:
+        *scale = magnitude + 1.0;
+        return 1.0 - dot;
+    case DISTANCE_COSINE:
+        *scale = 1.0;
+        return aa <= 0.0 || bb <= 0.0 ? 1.0 : 1.0 - dot / (square_root(aa) * square_root(bb));
+    default:
+        *scale = l2 + 1e-30;
+        return l2;
+    }
+}
+
+static int close_enough(double actual, double expected, double scale) {
+    return absolute(actual - expected) <= 1e-5 * scale + 1e-6;
+}
+
+// ---
+// fp16 conversion
+// ---
+
+// Value of a half computed by arithmetic, not bit tricks.
+static double half_value(uint16_t half) {
+    uint32_t exponent = (half >> 10) & 0x1f, mantissa = half & 0x3ff;
+    double value = exponent ? 1.0 + mantissa / 1024.0 : mantissa / 1024.0;
+    int power = exponent ? (int)exponent - 15 : -14;
+    for (; power > 0; power--) value *= 2.0;
+    for (; power < 0; power++) value *= 0.5;
+    return half & 0x8000 ? -value : value;
+}
+
+// Round-to-nearest-even by binary search over the positive halves,
+// which are ordered like their values. Inf sits at 65536 for rounding:
+// the midpoint 65520 then ties to the even code 0x7c00, as IEEE says.
+static uint16_t reference_half(float value) {
+    if (is_nan(value)) return 0x7e00;
+    uint16_t sign = value < 0.0f || (value == 0.0f && 1.0f / value < 0.0f) ? 0x8000 : 0;
+    double magnitude = absolute(value);
+    if (magnitude >= 65536.0) return sign | 0x7c00;
+    uint32_t low = 0, high = 0x7c00;            // value(low) <= magnitude < value(high)
+    while (high - low > 1) {
+        uint32_t middle = (low + high) / 2;
+        if (half_value((uint16_t)middle) <= magnitude) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    double below = half_value((uint16_t)low), above = high == 0x7c00 ? 65536.0 : half_value((uint16_t)high);
+    double down = magnitude - below, up = above - magnitude;
+    uint32_t chosen = down < up ? low : up < down ? high : (low & 1 ? high : low);
+    return sign | (uint16_t)chosen;
+}
+
+static void test_halves(void) {
+    // Every half decodes to its value; every non-NaN one survives a
+    // round trip, and NaNs stay NaN.
+    uint32_t decode_errors = 0, trip_errors = 0;
+    for (uint32_t h = 0; h < 0x10000; h++) {
+        uint16_t half = (uint16_t)h;
+        float value = half_to_float(half);
+        int nan = (half & 0x7c00) == 0x7c00 && (half & 0x3ff);
+        int inf = (half & 0x7fff) == 0x7c00;
+        if (nan) {
+            decode_errors += !is_nan(value);
+            trip_errors += (float_to_half(value) & 0x7c00) != 0x7c00 || !(float_to_half(value) & 0x3ff);
+            continue;
+        }
+        if (inf) {
+            decode_errors += value != (half & 0x8000 ? -1.0f : 1.0f) * (float)(1e300 * 1e300);
+        } else {
+            decode_errors += (double)value != half_value(half);
+        }
+        trip_errors += float_to_half(value) != half;
+    }
+    CHECK(decode_errors == 0, "%u halves decode to the wrong float", decode_errors);
+    CHECK(trip_errors == 0, "%u halves do not survive float_to_half(half_to_float())", trip_errors);
+
+    // Floats of every class: around each half (exact, halfway, just
+    // off), subnormal halves, underflow, overflow, inf and NaN.
+    float* floats = malloc(0x10000 * 4 * sizeof(float));
+    uint32_t count = 0;
+    for (uint32_t h = 0; h < 0x7c00; h += 7) {
+        double here = half_value((uint16_t)h), next = h + 1 == 0x7c00 ? 65536.0 : half_value((uint16_t)(h + 1));
+        double middle = 0.5 * (here + next);
+        floats[count++] = (float)middle;
+        floats[count++] = -(float)middle;
+        floats[count++] = (float)(middle + (next - here) / 64.0);
+        floats[count++] = (float)(middle - (next - here) / 64.0);
+    }
+    static const float specials[] = { 0.0f, -0.0f, 1e-8f, -1e-8f, 2.9802322e-8f, 2.98023259e-8f, 5.96046448e-8f,
+                                      6.1e-5f, 65504.0f, 65519.99f, 65520.0f, 70000.0f, -1e10f, 1e38f };
+    memcpy(floats + count, specials, sizeof(specials));
+    count += sizeof(specials) / sizeof(specials[0]);
+    floats[count++] = (float)(1e300 * 1e300);
+    floats[count++] = -(float)(1e300 * 1e300);
+    floats[count++] = (float)(1e300 * 1e300) * 0.0f;
+
+    uint16_t* halves = malloc(count * sizeof(uint16_t));
+    float* back = malloc(count * sizeof(float));
+    floats_to_halves(floats, count, halves);
+    halves_to_floats(halves, count, back);
+    uint32_t wrong = 0, batch_wrong = 0, back_wrong = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint16_t expected = reference_half(floats[i]);
+        uint16_t single = float_to_half(floats[i]);
+        if (is_nan(floats[i])) {
+            wrong += (single & 0x7c00) != 0x7c00 || !(single & 0x3ff);
+            batch_wrong += (halves[i] & 0x7c00) != 0x7c00 || !(halves[i] & 0x3ff);
+            back_wrong += !is_nan(back[i]);
+            continue;
+        }
+        wrong += single != expected;
+        batch_wrong += halves[i] != expected;
+        back_wrong += back[i] != half_to_float(expected);
+    }
+    CHECK(wrong == 0, "float_to_half: %u of %u floats rounded wrongly", wrong, count);
+    CHECK(batch_wrong == 0, "floats_to_halves (%s): %u of %u floats rounded wrongly", distance_kernel_name(),
+          batch_wrong, count);
+    CHECK(back_wrong == 0, "halves_to_floats (%s): %u of %u halves decoded wrongly", distance_kernel_name(),
+          back_wrong, count);
+
+    // Batched conversion of every length, so each tail path runs.
+    for (uint32_t n = 0; n <= 40; n++) {
+        uint16_t part[40];
+        float decoded[40];
+        floats_to_halves(floats + 3, n, part);
+        halves_to_floats(part, n, decoded);
+        uint32_t errors = 0;
+        for (uint32_t i = 0; i < n; i++) errors += part[i] != halves[3 + i] || decoded[i] != back[3 + i];
+        CHECK(errors == 0, "batched conversion of %u values: %u differ", n, errors);
+    }
+    free(floats);
+    free(halves);
+    free(back);
+}
+
+// ---
+// Kernels
+// ---
+
+static void test_kernel_level(void) {
+    static const char* expected[] = { "scalar", "scalar", "avx2", "avx512" };
+    CpuLevel level = cpu_level();
+    CHECK(strcmp(distance_kernel_name(), expected[level]) == 0, "level %s runs the %s kernels", cpu_level_name(level),
+          distance_kernel_name());
+}
+
+static void test_f32(uint64_t* state) {
+    float* a = malloc((MAX_DIMENSIONS + 1) * sizeof(float));
+    float* b = malloc((MAX_DIMENSIONS + 1) * sizeof(float));
+    double da[MAX_DIMENSIONS], db[MAX_DIMENSIONS], scale;
+    uint32_t errors = 0;
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        uint32_t n = lengths[l];
+        for (uint32_t i = 0; i <= n; i++) {
+            a[i] = random_float(state);
+            b[i] = random_float(state);
+        }
+        for (uint32_t offset = 0; offset < 2 && offset <= n; offset++) {
+            uint32_t length = n - offset;
+            for (uint32_t i = 0; i < length; i++) {
+                da[i] = a[offset + i];
+                db[i] = b[offset + i];
+            }
+            double dot = 1.0 - reference(DISTANCE_INNER_PRODUCT, da, db, length, &scale);
+            errors += !close_enough(dot_f32(a + offset, b + offset, length), dot, scale);
+            for (size_t m = 0; m < 3; m++) {
+                double truth = reference(metrics[m], da, db, length, &scale);
+                errors += !close_enough(distance_f32(metrics[m], a + offset, b + offset, length), truth, scale);
+                errors += !close_enough(distance_f32_kernel(metrics[m])(a + offset, b + offset, length), truth, scale);
+            }
+            double l2 = reference(DISTANCE_L2, da, db, length, &scale);
+            errors += !close_enough(l2sq_f32(a + offset, b + offset, length), l2, scale);
+            double norm = square_root(1.0 - reference(DISTANCE_INNER_PRODUCT, da, da, length, &scale));
+            errors += !close_enough(vector_norm(a + offset, length), norm, norm + 1.0);
+        }
+    }
+    CHECK(errors == 0, "fp32 (%s): %u results off the reference", distance_kernel_name(), errors);
+
+    // Zero vectors are at cosine distance 1.
+    memset(a, 0, MAX_DIMENSIONS * sizeof(float));
+    CHECK(distance_f32(DISTANCE_COSINE, a, b, 33) == 1.0f, "cosine with a zero vector is not 1");
+    free(a);
+    free(b);
+}
+
+static void test_f16(uint64_t* state) {
+    uint16_t a[MAX_DIMENSIONS + 1], b[MAX_DIMENSIONS + 1];
+    double da[MAX_DIMENSIONS], db[MAX_DIMENSIONS], scale;
+    uint32_t errors = 0;
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        uint32_t n = lengths[l];
+        for (uint32_t i = 0; i <= n; i++) {
+            a[i] = float_to_half(random_float(state));
+            b[i] = float_to_half(random_float(state));
+        }
+        for (uint32_t offset = 0; offset < 2 && offset <= n; offset++) {
+            uint32_t length = n - offset;
+            for (uint32_t i = 0; i < length; i++) {
+                da[i] = half_value(a[offset + i]);
+                db[i] = half_value(b[offset + i]);
+            }
+            double dot = 1.0 - reference(DISTANCE_INNER_PRODUCT, da, db, length, &scale);
+            errors += !close_enough(dot_f16(a + offset, b + offset, length), dot, scale);
+            double l2 = reference(DISTANCE_L2, da, db, length, &scale);
+            errors += !close_enough(l2sq_f16(a + offset, b + offset, length), l2, scale);
+            for (size_t m = 0; m < 3; m++) {
+                double truth = reference(metrics[m], da, db, length, &scale);
+                errors += !close_enough(distance_f16(metrics[m], a + offset, b + offset, length), truth, scale);
+            }
+        }
+    }
+    CHECK(errors == 0, "fp16 (%s): %u results off the reference", distance_kernel_name(), errors);
+}
+
+static void test_i16(uint64_t* state) {
+    int16_t a[MAX_DIMENSIONS + 1], b[MAX_DIMENSIONS + 1];
+    double da[MAX_DIMENSIONS], db[MAX_DIMENSIONS], scale;
+    uint32_t errors = 0;
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        uint32_t n = lengths[l];
+        for (int extremes = 0; extremes < 2; extremes++) {
+            for (uint32_t i = 0; i <= n; i++) {
+                a[i] = extremes ? -32768 : (int16_t)(test_random(state) & 0xffff);
+                b[i] = extremes ? (int16_t)(i % 2 ? 32767 : -32768) : (int16_t)(test_random(state) & 0xffff);
+            }
+            for (uint32_t offset = 0; offset < 2 && offset <= n; offset++) {
+                uint32_t length = n - offset;
+                for (uint32_t i = 0; i < length; i++) {
+                    da[i] = a[offset + i];
+                    db[i] = b[offset + i];
+                }
+                // Sums are fp32, so held to the float tolerance, not exact.
+                double dot = 1.0 - reference(DISTANCE_INNER_PRODUCT, da, db, length, &scale);
+                errors += !close_enough(dot_i16(a + offset, b + offset, length), dot, scale);
+                double l2 = reference(DISTANCE_L2, da, db, length, &scale);
+                errors += !close_enough(l2sq_i16(a + offset, b + offset, length), l2, scale);
+            }
+        }
+    }
+    CHECK(errors == 0, "int16 (%s): %u results off the reference", distance_kernel_name(), errors);
+}
+
+static void test_i8(uint64_t* state) {
+    int8_t a[MAX_DIMENSIONS + 1], b[MAX_DIMENSIONS + 1];
+    double da[MAX_DIMENSIONS], db[MAX_DIMENSIONS], scale;
+    uint32_t errors = 0;
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        uint32_t n = lengths[l];
+        for (int extremes = 0; extremes < 2; extremes++) {
+            // Extremes: -128 against 127 and -128 squared, the largest terms.
+            for (uint32_t i = 0; i <= n; i++) {
+                a[i] = extremes ? -128 : (int8_t)(test_random(state) & 0xff);
+                b[i] = extremes ? (int8_t)(i % 2 ? 127 : -128) : (int8_t)(test_random(state) & 0xff);
+            }
+            for (uint32_t offset = 0; offset < 2 && offset <= n; offset++) {
+                uint32_t length = n - offset;
+                int64_t dot = 0, l2 = 0;
+                for (uint32_t i = 0; i < length; i++) {
+                    da[i] = a[offset + i];
+                    db[i] = b[offset + i];
+                    dot += (int64_t)a[offset + i] * b[offset + i];
+                    l2 += (int64_t)(a[offset + i] - b[offset + i]) * (a[offset + i] - b[offset + i]);
+                }
+                errors += dot_i8(a + offset, b + offset, length) != dot;
+                errors += l2sq_i8(a + offset, b + offset, length) != l2;
+                for (size_t m = 0; m < 3; m++) {
+                    double truth = reference(metrics[m], da, db, length, &scale);
+                    errors += !close_enough(distance_i8(metrics[m], a + offset, b + offset, length), truth, scale);
+                }
+            }
+        }
+    }
+    CHECK(errors == 0, "int8 (%s): %u results off the reference", distance_kernel_name(), errors);
+}
+
+// Batched forms against the single-pair kernels, rows strided apart.
+static void test_batched(uint64_t* state) {
+    const uint32_t n = 37, stride = 48, queries = 3;
+    float* rows = malloc(ROWS * stride * sizeof(float));
+    float* query = malloc(queries * stride * sizeof(float));
+    uint16_t* rows16 = malloc(ROWS * stride * sizeof(uint16_t));
+    uint16_t* query16 = malloc(queries * stride * sizeof(uint16_t));
+    int8_t* rows8 = malloc(ROWS * stride);
+    int8_t* query8 = malloc(queries * stride);
+    for (uint32_t i = 0; i < ROWS * stride; i++) {
+        rows[i] = random_float(state);
+        rows16[i] = float_to_half(rows[i]);
+        rows8[i] = (int8_t)(test_random(state) & 0xff);
+    }
+    for (uint32_t i = 0; i < queries * stride; i++) {
+        query[i] = random_float(state);
+        query16[i] = float_to_half(query[i]);
+        query8[i] = (int8_t)(test_random(state) & 0xff);
+    }
+
+    uint32_t errors = 0;
+    float out[queries * ROWS], matrix[queries * ROWS];
+    for (size_t m = 0; m < 3; m++) {
+        DistanceMetric metric = metrics[m];
+        distance_f32_matrix(metric, query, stride, queries, rows, stride, ROWS, n, matrix);
+        for (uint32_t q = 0; q < queries; q++) {
+            distance_f32_many(metric, query + q * stride, rows, stride, ROWS, n, out);
+            for (uint32_t r = 0; r < ROWS; r++) {
+                float single = distance_f32(metric, query + q * stride, rows + r * stride, n);
+                errors += !close_enough(out[r], single, 1.0 + absolute(single));
+                errors += !close_enough(matrix[q * ROWS + r], single, 1.0 + absolute(single));
+            }
+        }
+        distance_f16_matrix(metric, query16, stride, queries, rows16, stride, ROWS, n, matrix);
+        for (uint32_t q = 0; q < queries; q++) {
+            distance_f16_many(metric, query16 + q * stride, rows16, stride, ROWS, n, out);
+            for (uint32_t r = 0; r < ROWS; r++) {
+                float single = distance_f16(metric, query16 + q * stride, rows16 + r * stride, n);
+                errors += !close_enough(out[r], single, 1.0 + absolute(single));
+                errors += !close_enough(matrix[q * ROWS + r], single, 1.0 + absolute(single));
+            }
+        }
+        distance_i8_matrix(metric, query8, stride, queries, rows8, stride, ROWS, n, matrix);
+        for (uint32_t q = 0; q < queries; q++) {
+            distance_i8_many(metric, query8 + q * stride, rows8, stride, ROWS, n, out);
+            for (uint32_t r = 0; r < ROWS; r++) {
+                float single = distance_i8(metric, query8 + q * stride, rows8 + r * stride, n);
+                errors += !close_enough(out[r], single, 1.0 + absolute(single));
+                errors += !close_enough(matrix[q * ROWS + r], single, 1.0 + absolute(single));
+            }
+        }
+    }
+    CHECK(errors == 0, "batched kernels (%s): %u results differ from single pairs", distance_kernel_name(), errors);
+    free(rows);
+    free(query);
+    free(rows16);
+    free(query16);
+    free(rows8);
+    free(query8);
+}
+
+void test_distance(void) {
+    uint64_t state = 43;
+    test_kernel_level();
+    test_halves();
+    test_f32(&state);
+    test_f16(&state);
+    test_i16(&state);
+    test_i8(&state);
+    test_batched(&state);
+}
@@ -0,0 +1,284 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "graph.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Graph algorithms on hand-checked small graphs, then on random graphs
+// against naive references (dense power iteration, BFS labelling, a
+// degree loop). The large random graph spans several parallel_for()
+// pieces, so partial results really are merged.
+
+#define SMALL_CONCEPTS 60
+#define LARGE_CONCEPTS 5000
+
+static double absolute(double value) {
+    return value < 0.0 ? -value : value;
+}
+
+// ---
+// Shared graph builders
+// ---
+
+ConceptStore* test_graph_store(uint32_t concepts, const uint32_t (*edges)[2], uint32_t edge_count) {
+    ConceptStore* store = create_store();
+    char id[16];
+    for (uint32_t i = 0; i < concepts; i++) {
+        snprintf(id, sizeof(id), "n%u", i);
+        store_create_concept(store, id, "Node");
+    }
+    for (uint32_t e = 0; e < edge_count; e++) store_add_slot(store, edges[e][0], "to", edges[e][1]);
+    return store;
+}
+
+// About two out-slots per concept; every seventh concept has none.
+ConceptStore* test_random_graph(uint32_t concepts, uint64_t seed) {
+    uint64_t state = seed;
+    uint32_t (*edges)[2] = malloc(concepts * 2 * sizeof(*edges));
+    uint32_t edge_count = 0;
+    for (uint32_t k = 0; k < concepts * 2; k++) {
+        uint32_t source = test_random(&state) % concepts;
+        if (source % 7 == 6) continue;
+        edges[edge_count][0] = source;
+        edges[edge_count][1] = test_random(&state) % concepts;
+        edge_count++;
+    }
+    ConceptStore* store = test_graph_store(concepts, (const uint32_t (*)[2])edges, edge_count);
+    free(edges);
+    return store;
+}
+
+// ---
+// PageRank
+// ---
+
+// Dense power iteration, following the definition in graph.c.
+static void reference_pagerank(const ConceptStore* store, const uint32_t* seeds, uint32_t seed_count,
+                               float damping, double* scores) {
+    uint32_t n = store->concept_count;
+    double* teleport = calloc(n, sizeof(double));
+    double* next = malloc(n * sizeof(double));
+    for (uint32_t i = 0; i < n; i++) teleport[i] = seed_count ? 0.0 : 1.0 / n;
+    for (uint32_t s = 0; s < seed_count; s++) teleport[seeds[s]] += 1.0 / seed_count;
+    memcpy(scores, teleport, n * sizeof(double));
+
+    for (int iteration = 0; iteration < 500; iteration++) {
+        double dangling = 0.0;
+        for (uint32_t i = 0; i < n; i++) {
+            next[i] = 0.0;
+            if (store_degree(store, i) == 0) dangling += scores[i];
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t degree = store_degree(store, i);
+            const uint32_t* targets = store_slot_targets(store, i);
+            for (uint32_t e = 0; e < degree; e++) next[targets[e]] += scores[i] / degree;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            scores[i] = (1.0 - damping) * teleport[i] + damping * (next[i] + dangling * teleport[i]);
+        }
+    }
+    free(teleport);
+    free(next);
+}
+
+static void check_pagerank(const ConceptStore* store, Scheduler* scheduler, const uint32_t* seeds,
+                           uint32_t seed_count, const char* label) {
+    uint32_t n = store->concept_count;
+    float* scores = malloc(n * sizeof(float));
+    double* expected = malloc(n * sizeof(double));
+    store_pagerank(store, scheduler, seeds, seed_count, PAGERANK_DAMPING, 1e-7f, 200, scores);
+    reference_pagerank(store, seeds, seed_count, PAGERANK_DAMPING, expected);
+
+    double sum = 0.0, error = 0.0;
+    for (uint32_t i = 0; i < n; i++) {
+        sum += scores[i];
+        if (absolute(scores[i] - expected[i]) > error) error = absolute(scores[i] - expected[i]);
+    }
+    CHECK(absolute(sum - 1.0) < 1e-4, "%s: PageRank sums to %f", label, sum);
+    CHECK(error < 1e-4, "%s: PageRank off the reference by %g", label, error);
+    free(scores);
+    free(expected);
+}
+
+static void test_pagerank(Scheduler* scheduler) {
+    // a → b, a → c, b → c, c → a. Solving
+    //     a = .05 + .85 c,  b = .05 + .85 a/2,  c = .05 + .85 (a/2 + b)
+    // gives a = .38779, b = .21481, c = .39740.
+    static const uint32_t classic[][2] = { { 0, 1 }, { 0, 2 }, { 1, 2 }, { 2, 0 } };
+    ConceptStore* store = test_graph_store(3, classic, 4);
+    float scores[3];
+    store_pagerank(store, scheduler, NULL, 0, PAGERANK_DAMPING, 1e-7f, 200, scores);
+    CHECK(absolute(scores[0] - 0.38779f) < 1e-4f && absolute(scores[1] - 0.21481f) < 1e-4f &&
+              absolute(scores[2] - 0.39740f) < 1e-4f,
+          "3-node PageRank: %f %f %f", scores[0], scores[1], scores[2]);
+
+    // A directed cycle is uniform.
+    static const uint32_t cycle[][2] = { { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 } };
+    ConceptStore* ring = test_graph_store(4, cycle, 4);
+    float ring_scores[4];
+    store_pagerank(ring, scheduler, NULL, 0, PAGERANK_DAMPING, 1e-7f, 200, ring_scores);
+    for (int i = 0; i < 4; i++) {
+        CHECK(absolute(ring_scores[i] - 0.25f) < 1e-5f, "cycle PageRank[%d] = %f", i, ring_scores[i]);
+    }
+    free_store(ring);
+    free_store(store);
+
+    uint32_t seeds[2] = { 3, 11 };
+    ConceptStore* small = test_random_graph(SMALL_CONCEPTS, 7);
+    check_pagerank(small, scheduler, NULL, 0, "random graph");
+    check_pagerank(small, scheduler, seeds, 2, "personalized");
+    free_store(small);
+
+    ConceptStore* large = test_random_graph(LARGE_CONCEPTS, 8);
+    check_pagerank(large, scheduler, NULL, 0, "large random graph");
+    check_pagerank(large, scheduler, seeds, 2, "large personalized");
+    free_store(large);
+}
+
+// ---
+// Components
+// ---
+
+static void reference_components(const ConceptStore* store, uint32_t* component) {
+    uint32_t n = store->concept_count;
+    uint32_t* queue = malloc(n * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i++) component[i] = UINT32_MAX;
+    for (uint32_t root = 0; root < n; root++) {
+        if (component[root] != UINT32_MAX) continue;
+        uint32_t head = 0, tail = 0;
+        queue[tail++] = root;
+        component[root] = root;
+        while (head < tail) {
+            uint32_t concept = queue[head++];
+            for (int incoming = 0; incoming < 2; incoming++) {
+                uint32_t degree = incoming ? store_in_degree(store, concept) : store_degree(store, concept);
+                const uint32_t* neighbors = incoming ? store_in_slot_sources(store, concept)
+                                                     : store_slot_targets(store, concept);
+                for (uint32_t e = 0; e < degree; e++) {
+                    if (component[neighbors[e]] != UINT32_MAX) continue;
+                    component[neighbors[e]] = root;
+                    queue[tail++] = neighbors[e];
+                }
+            }
+        }
+    }
+    free(queue);
+}
+
+static void check_components(const ConceptStore* store, Scheduler* scheduler, const char* label) {
+    uint32_t n = store->concept_count;
+    uint32_t* actual = malloc(n * sizeof(uint32_t));
+    uint32_t* reference = malloc(n * sizeof(uint32_t));
+    uint32_t found = store_components(store, scheduler, actual);
+    reference_components(store, reference);
+    uint32_t roots = 0, wrong = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        roots += reference[i] == i;
+        wrong += actual[i] != reference[i];
+    }
+    CHECK(wrong == 0, "%s: %u concepts labelled unlike BFS", label, wrong);
+    CHECK(found == roots, "%s: %u components, BFS says %u", label, found, roots);
+    free(actual);
+    free(reference);
+}
+
+static void test_components(Scheduler* scheduler) {
+    // {0, 1, 2} (edges in both directions), {3, 4}, {5} alone.
+    static const uint32_t edges[][2] = { { 2, 1 }, { 0, 1 }, { 4, 3 } };
+    ConceptStore* store = test_graph_store(6, edges, 3);
+    uint32_t component[6];
+    uint32_t count = store_components(store, scheduler, component);
+    static const uint32_t expected[6] = { 0, 0, 0, 3, 3, 5 };
+    CHECK(count == 3, "hand graph: %u components, expected 3", count);
+    for (int i = 0; i < 6; i++) CHECK(component[i] == expected[i], "component[%d] = %u", i, component[i]);
+    free_store(store);
+
+    ConceptStore* small = test_random_graph(SMALL_CONCEPTS, 11);
+    check_components(small, scheduler, "random graph");
+    free_store(small);
+
+    // Many components across the pieces, plus isolated concepts.
+    ConceptStore* large = test_random_graph(LARGE_CONCEPTS, 12);
+    char id[16];
+    for (uint32_t i = 0; i < 50; i++) {
+        snprintf(id, sizeof(id), "alone%u", i);
+        store_create_concept(large, id, "Node");
+    }
+    check_components(large, scheduler, "large random graph");
+    free_store(large);
+}
+
+// ---
+// Degree statistics
+// ---
+
+static void check_degrees(const ConceptStore* store, Scheduler* scheduler, int incoming, const char* label) {
+    DegreeStats stats;
+    store_degree_stats(store, scheduler, incoming, &stats);
+
+    uint32_t histogram[DEGREE_BUCKETS] = { 0 };
+    uint64_t sum = 0;
+    uint32_t min = UINT32_MAX, max = 0;
+    for (uint32_t c = 0; c < store->concept_count; c++) {
+        uint32_t degree = incoming ? store_in_degree(store, c) : store_degree(store, c);
+        uint32_t bucket = 0;
+        while (bucket < 32 && degree >= (1u << bucket)) bucket++;
+        histogram[bucket]++;
+        sum += degree;
+        if (degree < min) min = degree;
+        if (degree > max) max = degree;
+    }
+    uint32_t max_degree = stats.max_concept < store->concept_count
+                              ? (incoming ? store_in_degree(store, stats.max_concept)
+                                          : store_degree(store, stats.max_concept))
+                              : UINT32_MAX;
+    CHECK(stats.concept_count == store->concept_count && stats.slot_count == sum, "%s: %u concepts, %llu slots",
+          label, stats.concept_count, (unsigned long long)stats.slot_count);
+    CHECK(stats.min == min && stats.max == max && max_degree == max,
+          "%s: min %u max %u (at a degree %u), expected %u %u", label, stats.min, stats.max, max_degree, min, max);
+    CHECK(absolute(stats.mean - (double)sum / store->concept_count) < 1e-9, "%s: mean %f", label, stats.mean);
+    CHECK(memcmp(stats.histogram, histogram, sizeof(histogram)) == 0, "%s: histogram differs", label);
+}
+
+static void test_degrees(Scheduler* scheduler) {
+    // Hub 0 → 1..9, so out-degrees 9 and 0 and in-degrees 0 and 1.
+    uint32_t edges[9][2];
+    for (uint32_t i = 0; i < 9; i++) {
+        edges[i][0] = 0;
+        edges[i][1] = i + 1;
+    }
+    ConceptStore* star = test_graph_store(10, (const uint32_t (*)[2])edges, 9);
+    DegreeStats stats;
+    store_degree_stats(star, scheduler, 0, &stats);
+    CHECK(stats.max == 9 && stats.max_concept == 0 && stats.min == 0 && stats.histogram[0] == 9 &&
+              stats.histogram[degree_bucket(9)] == 1,
+          "star: out-degree stats wrong");
+    check_degrees(star, scheduler, 1, "star in-degrees");
+    free_store(star);
+
+    CHECK(degree_bucket(0) == 0 && degree_bucket(1) == 1 && degree_bucket(2) == 2 && degree_bucket(3) == 2 &&
+              degree_bucket(4) == 3 && degree_bucket(UINT32_MAX) == 32,
+          "degree_bucket boundaries wrong");
+
+    ConceptStore* large = test_random_graph(LARGE_CONCEPTS, 13);
+    check_degrees(large, scheduler, 0, "large out-degrees");
+    check_degrees(large, scheduler, 1, "large in-degrees");
+    free_store(large);
+
+    ConceptStore* empty = create_store();
+    store_degree_stats(empty, scheduler, 0, &stats);
+    CHECK(stats.concept_count == 0 && stats.slot_count == 0, "empty store has degree stats");
+    free_store(empty);
+}
+
+void test_graph(void) {
+    Scheduler* scheduler = create_scheduler(2);
+    Scheduler* schedulers[2] = { NULL, scheduler };
+    for (int s = 0; s < 2; s++) {
+        test_pagerank(schedulers[s]);
+        test_components(schedulers[s]);
+        test_degrees(schedulers[s]);
+    }
+    free_scheduler(scheduler);
+}
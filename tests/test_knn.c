@@ -0,0 +1,230 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "knn.h"
+#include <stdlib.h>
+#include <string.h>
+
+// knn_exact() against a double-precision scan for every metric, on both
+// the few-query (row tiles) and many-query (query blocks) paths, with an
+// odd dimension count so rows carry padding; the shared top-k heap
+// against a sort; knn_recall() on hand-made results, and hnsw_recall()
+// against recall counted here.
+
+#define VECTORS 1200
+#define DIMENSIONS 37
+#define QUERIES 40
+#define K 10
+#define EF 64
+
+static const DistanceMetric metrics[] = { DISTANCE_L2, DISTANCE_INNER_PRODUCT, DISTANCE_COSINE };
+
+static float random_unit(uint64_t* state) {
+    return (float)(test_random(state) % 20001) / 10000.0f - 1.0f;
+}
+
+static double absolute(double value) {
+    return value < 0.0 ? -value : value;
+}
+
+// Newton's method, so the suite does not need libm.
+static double square_root(double value) {
+    if (value <= 0.0) return 0.0;
+    double root = value > 1.0 ? value : 1.0;
+    for (int step = 0; step < 60; step++) root = 0.5 * (root + value / root);
+    return root;
+}
+
+// The metric in doubles; `scale` bounds the float error of computing it
+// from dot products and norms.
+static double naive_distance(DistanceMetric metric, const float* a, const float* b, double* scale) {
+    double l2 = 0.0, dot = 0.0, aa = 0.0, bb = 0.0;
+    for (uint32_t i = 0; i < DIMENSIONS; i++) {
+        l2 += ((double)a[i] - b[i]) * ((double)a[i] - b[i]);
+        dot += (double)a[i] * b[i];
+        aa += (double)a[i] * a[i];
+        bb += (double)b[i] * b[i];
+    }
+    switch (metric) {
+    case DISTANCE_INNER_PRODUCT:
+        *scale = 1.0 + aa + bb;
+        return 1.0 - dot;
+    case DISTANCE_COSINE:
+        *scale = 1.0;
+        return aa <= 0.0 || bb <= 0.0 ? 1.0 : 1.0 - dot / (square_root(aa) * square_root(bb));
+    default:
+        *scale = aa + bb;
+        return l2;
+    }
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// ---
+// knn_exact
+// ---
+
+static void check_exact(const ConceptVectorStore* vectors, DistanceMetric metric, const float* queries,
+                        uint32_t query_count, uint32_t k, Scheduler* scheduler, const char* label) {
+    Neighbor* exact = malloc((size_t)query_count * k * sizeof(Neighbor));
+    uint32_t* counts = malloc(query_count * sizeof(uint32_t));
+    double* sorted = malloc(VECTORS * sizeof(double));
+    uint8_t* seen = malloc(VECTORS);
+    uint32_t present = vectors->n_concepts, expected = k < present ? k : present, wrong = 0, scale_wrong = 0;
+
+    uint32_t returned = knn_exact(vectors, metric, queries, DIMENSIONS, query_count, k, scheduler, exact, counts);
+    CHECK(returned == expected, "%s: knn_exact returned %u, expected %u", label, returned, expected);
+    for (uint32_t q = 0; q < query_count; q++) {
+        const float* query = queries + (size_t)q * DIMENSIONS;
+        double scale, tolerance = 0.0;
+        uint32_t found = 0;
+        for (uint32_t concept = 0; concept < VECTORS; concept++) {
+            const float* row = vector_of(vectors, concept);
+            if (!row) continue;
+            sorted[found++] = naive_distance(metric, query, row, &scale);
+            if (scale > tolerance) tolerance = scale;
+        }
+        tolerance = 1e-5 * tolerance + 1e-6;
+        qsort(sorted, found, sizeof(double), compare_doubles);
+
+        // The right count, each concept once, within the k nearest, with
+        // its distance, nearest first.
+        wrong += counts[q] != expected;
+        memset(seen, 0, VECTORS);
+        for (uint32_t i = 0; i < counts[q] && i < k; i++) {
+            const Neighbor* hit = &exact[(size_t)q * k + i];
+            const float* row = hit->concept < VECTORS ? vector_of(vectors, hit->concept) : NULL;
+            if (!row || seen[hit->concept]++) {
+                wrong++;
+                continue;
+            }
+            double truth = naive_distance(metric, query, row, &scale);
+            wrong += truth > sorted[expected - 1] + tolerance;
+            scale_wrong += absolute(truth - hit->distance) > tolerance;
+            if (i > 0) wrong += hit[-1].distance > hit->distance;
+        }
+    }
+    CHECK(wrong == 0, "%s (%s): %u results wrong, missing or out of order", label, knn_kernel_name(), wrong);
+    CHECK(scale_wrong == 0, "%s (%s): %u distances off the naive ones", label, knn_kernel_name(), scale_wrong);
+    free(seen);
+    free(sorted);
+    free(counts);
+    free(exact);
+}
+
+// The bounded heap keeps the `limit` smallest and sorts them nearest
+// first, ties by concept.
+static void test_heap(uint64_t* state) {
+    Neighbor heap[16], all[500];
+    uint32_t wrong = 0;
+    for (uint32_t round = 0; round < 50; round++) {
+        uint32_t limit = 1 + round % 16, count = 0, pushed = 20 + round * 9;
+        for (uint32_t i = 0; i < pushed; i++) {
+            all[i].concept = i;
+            all[i].distance = (float)(test_random(state) % 40);     // plenty of ties
+            neighbors_keep(heap, &count, limit, i, all[i].distance);
+        }
+        neighbors_sort(all, pushed);
+        neighbors_sort(heap, count);
+        wrong += count != limit;
+        for (uint32_t i = 0; i < count; i++) {
+            wrong += heap[i].distance != all[i].distance;
+            if (i > 0) {
+                wrong += heap[i - 1].distance == heap[i].distance && heap[i - 1].concept > heap[i].concept;
+            }
+        }
+    }
+    CHECK(wrong == 0, "neighbors_keep/sort: %u entries wrong", wrong);
+}
+
+// ---
+// Recall
+// ---
+
+static void test_knn_recall(void) {
+    // Query 0: 2 of 3 found; query 1: 1 of 2 (exact holds fewer than k);
+    // query 2: nothing to find.
+    const Neighbor exact[9] = { { 1, 0 }, { 2, 0 }, { 3, 0 }, { 7, 0 }, { 8, 0 } };
+    const Neighbor found[9] = { { 3, 0 }, { 9, 0 }, { 1, 0 }, { 8, 0 }, { 4, 0 }, { 5, 0 }, { 6, 0 } };
+    const uint32_t exact_counts[3] = { 3, 2, 0 }, found_counts[3] = { 3, 3, 1 };
+    float recall = knn_recall(exact, exact_counts, found, found_counts, 3, 3);
+    CHECK(absolute(recall - 3.0 / 5.0) < 1e-6, "knn_recall = %f, expected 0.6", recall);
+    CHECK(knn_recall(exact, exact_counts, exact, exact_counts, 3, 3) == 1.0f, "knn_recall of itself is not 1");
+    CHECK(knn_recall(exact, exact_counts + 2, found, found_counts, 1, 3) == 1.0f, "nothing to find is not recall 1");
+}
+
+static void check_hnsw_recall(const ConceptVectorStore* vectors, HnswMetric metric, const float* queries,
+                              Scheduler* scheduler, const char* label) {
+    HnswIndex index;
+    init_hnsw(&index, vectors, metric, 12, 100);
+    hnsw_insert_all(&index, scheduler);
+
+    Neighbor* exact = malloc(QUERIES * K * sizeof(Neighbor));
+    uint32_t counts[QUERIES], hits = 0, total = 0;
+    knn_exact(vectors, (DistanceMetric)metric, queries, DIMENSIONS, QUERIES, K, scheduler, exact, counts);
+    for (uint32_t q = 0; q < QUERIES; q++) {
+        HnswResult results[K];
+        uint32_t found = hnsw_search(&index, queries + (size_t)q * DIMENSIONS, K, EF, results);
+        for (uint32_t e = 0; e < counts[q]; e++) {
+            for (uint32_t i = 0; i < found; i++) hits += results[i].concept == exact[q * K + e].concept;
+        }
+        total += counts[q];
+    }
+    float counted = (float)hits / (float)total;
+    float reported = hnsw_recall(&index, queries, DIMENSIONS, QUERIES, K, EF, scheduler);
+    CHECK(counted >= 0.9f, "%s: HNSW recall@%d = %.3f at ef %d", label, K, counted, EF);
+    CHECK(absolute(reported - counted) < 1e-4, "%s: hnsw_recall() = %.3f, counted %.3f", label, reported, counted);
+    free(exact);
+    free_hnsw(&index);
+}
+
+void test_knn(void) {
+    uint64_t state = 46;
+    ConceptVectorStore vectors;
+    init_vector_store(&vectors, DIMENSIONS, VECTORS);
+    float row[DIMENSIONS];
+    for (uint32_t concept = 0; concept < VECTORS; concept++) {
+        for (uint32_t i = 0; i < DIMENSIONS; i++) row[i] = random_unit(&state);
+        if (concept % 11 != 4) vector_attach(&vectors, concept, row);     // leave gaps
+    }
+    float* queries = malloc(QUERIES * DIMENSIONS * sizeof(float));
+    for (uint32_t i = 0; i < QUERIES * DIMENSIONS; i++) queries[i] = random_unit(&state);
+
+    Scheduler* scheduler = create_scheduler(3);
+    test_heap(&state);
+    test_knn_recall();
+    check_hnsw_recall(&vectors, HNSW_METRIC_L2, queries, scheduler, "L2");
+    check_hnsw_recall(&vectors, HNSW_METRIC_COSINE, queries, scheduler, "cosine");
+
+    // A zero vector, at cosine distance 1 from everything. It joins after
+    // the HNSW checks: as the nearest node to almost every other, it would
+    // crowd their pruned link lists.
+    memset(row, 0, sizeof(row));
+    vector_attach(&vectors, 15, row);
+    for (size_t m = 0; m < 3; m++) {
+        char label[64];
+        snprintf(label, sizeof(label), "metric %d", (int)metrics[m]);
+        check_exact(&vectors, metrics[m], queries, QUERIES, K, NULL, label);
+        check_exact(&vectors, metrics[m], queries, QUERIES, K, scheduler, label);
+        check_exact(&vectors, metrics[m], queries, 1, K, scheduler, label);
+        check_exact(&vectors, metrics[m], queries, 5, 1, NULL, label);
+        check_exact(&vectors, metrics[m], queries, 7, KNN_ROW_TILE + 3, scheduler, label);
+        check_exact(&vectors, metrics[m], queries, 3, VECTORS, scheduler, label);     // k above the count
+    }
+
+    // Nothing to search.
+    ConceptVectorStore none;
+    Neighbor out[K];
+    uint32_t counts[1] = { 99 };
+    init_vector_store(&none, DIMENSIONS, 16);
+    CHECK(knn_exact(&none, DISTANCE_L2, queries, DIMENSIONS, 1, K, NULL, out, counts) == 0 && counts[0] == 0,
+          "knn_exact on an empty store found %u", counts[0]);
+    free_vector_store(&none);
+
+    free_scheduler(scheduler);
+    free(queries);
+    free_vector_store(&vectors);
+}
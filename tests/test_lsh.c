@@ -0,0 +1,384 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "lsh.h"
+#include <stdlib.h>
+#include <string.h>
+
+// SimHash LSH: the bucket layout and signatures against hashes recomputed
+// here from the index's planes, queries against a brute-force pass over
+// the same buckets, determinism per seed, the collision rate of one
+// signature bit against 1 - θ/π, and recall on clustered vectors.
+
+#define DIMENSIONS 32
+#define CLUSTERS 24
+#define VECTORS 2000
+#define QUERIES 40
+#define K 10
+#define LIMIT 4096
+
+static double absolute(double value) {
+    return value < 0.0 ? -value : value;
+}
+
+static double square_root(double value) {
+    if (value <= 0.0) return 0.0;
+    double root = value > 1.0 ? value : 1.0;
+    for (int i = 0; i < 60; i++) root = 0.5 * (root + value / root);
+    return root;
+}
+
+// Taylor series; fine on [0, π].
+static double sine_of(double x) {
+    double term = x, sum = x;
+    for (int n = 1; n < 20; n++) {
+        term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+        sum += term;
+    }
+    return sum;
+}
+
+static double cosine_of(double x) {
+    double term = 1.0, sum = 1.0;
+    for (int n = 1; n < 20; n++) {
+        term *= -x * x / ((2.0 * n - 1.0) * (2.0 * n));
+        sum += term;
+    }
+    return sum;
+}
+
+static float random_float(uint64_t* state) {
+    return (float)(test_random(state) % 200001) / 100000.0f - 1.0f;
+}
+
+// Cluster members within ±0.3 of centers in [-1, 1]; every ninth concept
+// has no vector.
+static void clustered(ConceptVectorStore* vectors, float* queries, uint64_t* state) {
+    float centers[CLUSTERS][DIMENSIONS], row[DIMENSIONS];
+    for (uint32_t c = 0; c < CLUSTERS; c++) {
+        for (uint32_t d = 0; d < DIMENSIONS; d++) centers[c][d] = random_float(state);
+    }
+    init_vector_store(vectors, DIMENSIONS, VECTORS);
+    for (uint32_t v = 0; v < VECTORS; v++) {
+        const float* center = centers[test_random(state) % CLUSTERS];
+        for (uint32_t d = 0; d < DIMENSIONS; d++) row[d] = center[d] + 0.3f * random_float(state);
+        if (v % 9 != 2) vector_attach(vectors, v, row);
+    }
+    for (uint32_t q = 0; q < QUERIES; q++) {
+        const float* center = centers[test_random(state) % CLUSTERS];
+        for (uint32_t d = 0; d < DIMENSIONS; d++) queries[q * DIMENSIONS + d] = center[d] + 0.3f * random_float(state);
+    }
+}
+
+// ---
+// Hashes recomputed from the planes
+// ---
+
+static float projection(const LshIndex* index, uint32_t plane, const float* vector) {
+    return dot_f32(index->planes + (size_t)plane * DIMENSIONS, vector, DIMENSIONS);
+}
+
+static uint32_t key_of(const LshIndex* index, uint32_t table, const float* vector) {
+    uint32_t key = 0;
+    for (uint32_t b = 0; b < index->bits; b++) {
+        key |= (uint32_t)(projection(index, table * index->bits + b, vector) > 0.0f) << b;
+    }
+    return key;
+}
+
+static void signature_of(const LshIndex* index, const float* vector, uint64_t* signature) {
+    memset(signature, 0, LSH_SIGNATURE_WORDS * sizeof(uint64_t));
+    for (uint32_t b = 0; b < LSH_SIGNATURE_BITS; b++) {
+        if (projection(index, index->tables * index->bits + b, vector) > 0.0f) signature[b / 64] |= 1ull << (b % 64);
+    }
+}
+
+static uint32_t hamming(const uint64_t* a, const uint64_t* b) {
+    uint32_t bits = 0;
+    for (uint32_t w = 0; w < LSH_SIGNATURE_WORDS; w++) bits += (uint32_t)__builtin_popcountll(a[w] ^ b[w]);
+    return bits;
+}
+
+static const uint32_t* bucket(const LshIndex* index, uint32_t table, uint32_t key, uint32_t* count) {
+    const uint32_t* offsets = index->offsets + (size_t)table * ((1u << index->bits) + 1);
+    *count = offsets[key + 1] - offsets[key];
+    return index->ids + (size_t)table * index->count + offsets[key];
+}
+
+// Every concept with a vector sits once per table, in the bucket of its
+// key, with its signature alongside; buckets keep concept order.
+static void check_layout(const LshIndex* index, const ConceptVectorStore* vectors) {
+    uint32_t buckets = 1u << index->bits, wrong = 0;
+    uint64_t signature[LSH_SIGNATURE_WORDS];
+    uint8_t* seen = malloc(VECTORS);
+    CHECK(index->count == vectors->n_concepts, "LSH indexed %u of %u vectors", index->count, vectors->n_concepts);
+    for (uint32_t t = 0; t < index->tables; t++) {
+        const uint32_t* offsets = index->offsets + (size_t)t * (buckets + 1);
+        wrong += offsets[0] != 0 || offsets[buckets] != index->count;
+        memset(seen, 0, VECTORS);
+        for (uint32_t key = 0; key < buckets; key++) {
+            uint32_t count;
+            const uint32_t* ids = bucket(index, t, key, &count);
+            for (uint32_t i = 0; i < count; i++) {
+                uint32_t concept = ids[i];
+                const float* row = vector_of(vectors, concept);
+                if (!row || seen[concept]++ || (i > 0 && ids[i - 1] >= concept) || key_of(index, t, row) != key) {
+                    wrong++;
+                    continue;
+                }
+                signature_of(index, row, signature);
+                size_t at = (size_t)t * index->count + (size_t)(ids + i - index->ids - (size_t)t * index->count);
+                wrong += memcmp(index->signatures + at * LSH_SIGNATURE_WORDS, signature, sizeof(signature)) != 0;
+            }
+        }
+    }
+    free(seen);
+    CHECK(wrong == 0, "LSH (%s): %u bucket entries misplaced or mis-signed", lsh_kernel_name(), wrong);
+}
+
+// ---
+// Queries
+// ---
+
+// Brute force: concepts in the query's buckets (and their one-bit
+// neighbours when probing) within `max_hamming`, as bit counts.
+static void expected_candidates(const LshIndex* index, const ConceptVectorStore* vectors, const float* query,
+                                uint32_t max_hamming, int probe, int32_t* bits) {
+    uint64_t signature[LSH_SIGNATURE_WORDS], other[LSH_SIGNATURE_WORDS];
+    signature_of(index, query, signature);
+    for (uint32_t v = 0; v < VECTORS; v++) bits[v] = -1;
+    for (uint32_t t = 0; t < index->tables; t++) {
+        uint32_t key = key_of(index, t, query);
+        for (int32_t flip = -1; flip < (probe ? (int32_t)index->bits : 0); flip++) {
+            uint32_t count;
+            const uint32_t* ids = bucket(index, t, flip < 0 ? key : key ^ (1u << flip), &count);
+            for (uint32_t i = 0; i < count; i++) {
+                signature_of(index, vector_of(vectors, ids[i]), other);
+                uint32_t distance = hamming(signature, other);
+                if (distance <= max_hamming) bits[ids[i]] = (int32_t)distance;
+            }
+        }
+    }
+}
+
+static void check_queries(const LshIndex* index, const ConceptVectorStore* vectors, const float* queries) {
+    static const uint32_t max_hammings[] = { 128, 40, 10 };
+    static const uint32_t limits[] = { LIMIT, 7 };
+    int32_t* bits = malloc(VECTORS * sizeof(int32_t));
+    Neighbor* out = malloc(LIMIT * sizeof(Neighbor));
+    LshWorkspace workspace;
+    init_lsh_workspace(&workspace);
+    uint32_t wrong = 0;
+
+    for (uint32_t q = 0; q < 10; q++) {
+        const float* query = queries + q * DIMENSIONS;
+        for (size_t h = 0; h < 3; h++) {
+            for (int probe = 0; probe < 2; probe++) {
+                expected_candidates(index, vectors, query, max_hammings[h], probe, bits);
+                uint32_t expected = 0, worst_kept = 0;
+                for (uint32_t v = 0; v < VECTORS; v++) expected += bits[v] >= 0;
+                for (size_t l = 0; l < 2; l++) {
+                    uint32_t count = lsh_query(index, &workspace, query, max_hammings[h], probe, limits[l], out);
+                    wrong += count != (expected < limits[l] ? expected : limits[l]);
+                    for (uint32_t i = 0; i < count; i++) {
+                        // Each candidate once, with its bit count, fewest first.
+                        int32_t truth = bits[out[i].concept];
+                        wrong += truth < 0 || out[i].distance != (float)truth;
+                        if (i > 0) wrong += out[i - 1].distance > out[i].distance;
+                        if (truth >= 0) bits[out[i].concept] = -2 - truth;
+                        if (truth >= 0 && (uint32_t)truth > worst_kept) worst_kept = (uint32_t)truth;
+                    }
+                    // A truncated result keeps the closest ones.
+                    for (uint32_t v = 0; v < VECTORS; v++) {
+                        if (bits[v] >= 0 && (uint32_t)bits[v] < worst_kept) wrong++;
+                        if (bits[v] <= -2) bits[v] = -2 - bits[v];
+                    }
+                    worst_kept = 0;
+                }
+            }
+        }
+    }
+
+    // A concept's own vector finds it at distance 0.
+    for (uint32_t v = 0; v < VECTORS; v += 97) {
+        if (!vector_of(vectors, v)) continue;
+        uint32_t count = lsh_query(index, &workspace, vector_of(vectors, v), 0, 0, LIMIT, out), found = 0;
+        for (uint32_t i = 0; i < count; i++) found += out[i].concept == v && out[i].distance == 0.0f;
+        wrong += found != 1;
+    }
+
+    // The batch is the single queries back to back.
+    Neighbor* batch = malloc((size_t)QUERIES * 16 * sizeof(Neighbor));
+    uint32_t counts[QUERIES];
+    lsh_query_batch(index, &workspace, queries, DIMENSIONS, QUERIES, 30, 1, 16, batch, counts);
+    for (uint32_t q = 0; q < QUERIES; q++) {
+        uint32_t count = lsh_query(index, &workspace, queries + q * DIMENSIONS, 30, 1, 16, out);
+        wrong += counts[q] != count;
+        for (uint32_t i = 0; i < count && i < counts[q]; i++) {
+            wrong += batch[q * 16 + i].concept != out[i].concept || batch[q * 16 + i].distance != out[i].distance;
+        }
+    }
+    wrong += lsh_query(index, &workspace, queries, 128, 1, 0, out) != 0;
+    CHECK(wrong == 0, "LSH (%s): %u query results differ from the brute-force buckets", lsh_kernel_name(), wrong);
+
+    free(batch);
+    free_lsh_workspace(&workspace);
+    free(out);
+    free(bits);
+}
+
+// ---
+// Determinism
+// ---
+
+static int same_index(const LshIndex* a, const LshIndex* b) {
+    size_t planes = (size_t)(a->tables * a->bits + LSH_SIGNATURE_BITS) * DIMENSIONS;
+    size_t offsets = (size_t)a->tables * ((1u << a->bits) + 1);
+    size_t entries = (size_t)a->tables * a->count;
+    return a->count == b->count && memcmp(a->planes, b->planes, planes * sizeof(float)) == 0 &&
+           memcmp(a->offsets, b->offsets, offsets * sizeof(uint32_t)) == 0 &&
+           memcmp(a->ids, b->ids, entries * sizeof(uint32_t)) == 0 &&
+           memcmp(a->signatures, b->signatures, entries * LSH_SIGNATURE_WORDS * sizeof(uint64_t)) == 0;
+}
+
+static void check_determinism(const LshIndex* index, const ConceptVectorStore* vectors) {
+    Scheduler* scheduler = create_scheduler(3);
+    LshIndex again, other;
+    init_lsh(&again, DIMENSIONS, 0, 0, 45);
+    lsh_build(&again, vectors, scheduler);
+    CHECK(same_index(index, &again), "LSH: same seed, parallel build differs");
+    lsh_build(&again, vectors, NULL);
+    CHECK(same_index(index, &again), "LSH: rebuilding changed the index");
+
+    init_lsh(&other, DIMENSIONS, 0, 0, 46);
+    lsh_build(&other, vectors, NULL);
+    CHECK(!same_index(index, &other), "LSH: different seeds drew the same planes");
+    free_lsh(&other);
+    free_lsh(&again);
+    free_scheduler(scheduler);
+}
+
+// ---
+// Collision rate and recall
+// ---
+
+// One signature bit splits a pair at angle θ with probability θ/π; the
+// mean over pairs and the 128 signature planes should be close.
+static void check_collisions(const LshIndex* index, uint64_t* state) {
+    static const double angles[] = { 0.05, 0.3, 0.8, 1.5, 2.5 };
+    float u[DIMENSIONS], v[DIMENSIONS], w[DIMENSIONS];
+    uint64_t su[LSH_SIGNATURE_WORDS], sw[LSH_SIGNATURE_WORDS];
+    for (size_t a = 0; a < sizeof(angles) / sizeof(angles[0]); a++) {
+        uint64_t differing = 0;
+        const uint32_t pairs = 300;
+        for (uint32_t p = 0; p < pairs; p++) {
+            // u and v orthonormal, w at angle θ from u in their plane.
+            double uu = 0.0, uv = 0.0, vv = 0.0;
+            for (uint32_t d = 0; d < DIMENSIONS; d++) {
+                u[d] = random_float(state);
+                v[d] = random_float(state);
+                uu += (double)u[d] * u[d];
+            }
+            for (uint32_t d = 0; d < DIMENSIONS; d++) u[d] = (float)(u[d] / square_root(uu));
+            for (uint32_t d = 0; d < DIMENSIONS; d++) uv += (double)u[d] * v[d];
+            for (uint32_t d = 0; d < DIMENSIONS; d++) {
+                v[d] = (float)(v[d] - uv * u[d]);
+                vv += (double)v[d] * v[d];
+            }
+            for (uint32_t d = 0; d < DIMENSIONS; d++) {
+                w[d] = (float)(cosine_of(angles[a]) * u[d] + sine_of(angles[a]) * v[d] / square_root(vv));
+            }
+            signature_of(index, u, su);
+            signature_of(index, w, sw);
+            differing += hamming(su, sw);
+        }
+        double rate = (double)differing / ((double)pairs * LSH_SIGNATURE_BITS);
+        double expected = angles[a] / 3.14159265358979;
+        CHECK(absolute(rate - expected) < 0.015, "LSH: pairs at angle %.2f differ in %.3f of bits, expected %.3f",
+              angles[a], rate, expected);
+    }
+}
+
+// The K nearest by cosine, by a full scan.
+static void naive_knn(const ConceptVectorStore* vectors, const float* query, uint32_t* nearest) {
+    float distances[K];
+    uint32_t found = 0;
+    for (uint32_t v = 0; v < VECTORS; v++) {
+        const float* row = vector_of(vectors, v);
+        if (!row) continue;
+        float distance = distance_f32(DISTANCE_COSINE, query, row, DIMENSIONS);
+        if (found == K && distance >= distances[K - 1]) continue;
+        uint32_t at = found < K ? found++ : K - 1;
+        while (at > 0 && distances[at - 1] > distance) {
+            distances[at] = distances[at - 1];
+            nearest[at] = nearest[at - 1];
+            at--;
+        }
+        distances[at] = distance;
+        nearest[at] = v;
+    }
+}
+
+// Candidates cover the true cosine neighbours while staying a small
+// slice of the store; the closest few by bit count are mostly right.
+static void check_recall(const LshIndex* index, const ConceptVectorStore* vectors, const float* queries) {
+    Neighbor* out = malloc(LIMIT * sizeof(Neighbor));
+    LshWorkspace workspace;
+    init_lsh_workspace(&workspace);
+    uint32_t covered = 0, top = 0;
+    uint64_t candidates = 0;
+    for (uint32_t q = 0; q < QUERIES; q++) {
+        uint32_t truth[K];
+        naive_knn(vectors, queries + q * DIMENSIONS, truth);
+        uint32_t count = lsh_query(index, &workspace, queries + q * DIMENSIONS, 40, 1, LIMIT, out);
+        candidates += count;
+        for (uint32_t i = 0; i < count; i++) {
+            for (uint32_t t = 0; t < K; t++) {
+                covered += out[i].concept == truth[t];
+                top += i < 5 * K && out[i].concept == truth[t];
+            }
+        }
+    }
+    float recall = (float)covered / (float)(QUERIES * K);
+    float top_recall = (float)top / (float)(QUERIES * K);
+    float share = (float)candidates / (float)(QUERIES * vectors->n_concepts);
+    CHECK(recall >= 0.95f, "LSH: candidate recall@%d %.3f", K, recall);
+    CHECK(top_recall >= 0.85f, "LSH: recall@%d among the %d closest signatures %.3f", K, 5 * K, top_recall);
+    CHECK(share <= 0.1f, "LSH: candidates are %.3f of the store", share);
+    free_lsh_workspace(&workspace);
+    free(out);
+}
+
+void test_lsh(void) {
+    uint64_t state = 45;
+    ConceptVectorStore vectors;
+    float* queries = malloc(QUERIES * DIMENSIONS * sizeof(float));
+    clustered(&vectors, queries, &state);
+
+    LshIndex index;
+    init_lsh(&index, DIMENSIONS, 0, 0, 45);
+    lsh_build(&index, &vectors, NULL);
+    check_layout(&index, &vectors);
+    check_queries(&index, &vectors, queries);
+    check_determinism(&index, &vectors);
+    check_collisions(&index, &state);
+    check_recall(&index, &vectors, queries);
+
+    // An empty index answers nothing.
+    LshIndex empty;
+    LshWorkspace workspace;
+    ConceptVectorStore none;
+    Neighbor out[4];
+    init_vector_store(&none, DIMENSIONS, 16);
+    init_lsh(&empty, DIMENSIONS, 2, 4, 1);
+    lsh_build(&empty, &none, NULL);
+    init_lsh_workspace(&workspace);
+    CHECK(lsh_query(&empty, &workspace, queries, 128, 1, 4, out) == 0, "LSH: empty index returned candidates");
+    free_lsh_workspace(&workspace);
+    free_lsh(&empty);
+    free_vector_store(&none);
+
+    free_lsh(&index);
+    free(queries);
+    free_vector_store(&vectors);
+}
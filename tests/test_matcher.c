@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "matcher.h"
+#include <stdlib.h>
+#include <string.h>
+
+// The Aho–Corasick matcher against a naive scan over every pattern, in
+// bytes and over tokens. Small alphabets make overlapping, nested and
+// duplicate patterns common; compiling after uneven batches exercises
+// the delta automaton and full rebuilds.
+
+#define TEXT_LENGTH 3000
+#define MATCH_PATTERNS 400
+#define MAX_MENTIONS 200000
+
+static int compare_mentions(const void* a, const void* b) {
+    const EntityMention* x = a;
+    const EntityMention* y = b;
+    if (x->begin != y->begin) return x->begin < y->begin ? -1 : 1;
+    if (x->end != y->end) return x->end > y->end ? -1 : 1;
+    return (x->pattern > y->pattern) - (x->pattern < y->pattern);
+}
+
+// Scans report by start, longer spans first; the order among mentions
+// of one span is free, so both sides are sorted before comparing.
+static void check_same_mentions(EntityMention* actual, uint32_t actual_count, EntityMention* expected,
+                                uint32_t expected_count, const char* label) {
+    CHECK(actual_count == expected_count, "%s: %u mentions, naive scan %u", label, actual_count, expected_count);
+    if (actual_count != expected_count) return;
+    for (uint32_t i = 1; i < actual_count; i++) {
+        const EntityMention* x = &actual[i - 1];
+        const EntityMention* y = &actual[i];
+        if (x->begin > y->begin || (x->begin == y->begin && x->end < y->end)) {
+            CHECK(0, "%s: mention %u out of order", label, i);
+            return;
+        }
+    }
+    qsort(actual, actual_count, sizeof(EntityMention), compare_mentions);
+    qsort(expected, expected_count, sizeof(EntityMention), compare_mentions);
+    for (uint32_t i = 0; i < actual_count; i++) {
+        const EntityMention* x = &actual[i];
+        const EntityMention* y = &expected[i];
+        if (x->begin != y->begin || x->end != y->end || x->pattern != y->pattern || x->concept != y->concept) {
+            CHECK(0, "%s: mention %u is [%u, %u) pattern %u, naive [%u, %u) pattern %u", label, i, x->begin, x->end,
+                  x->pattern, y->begin, y->end, y->pattern);
+            return;
+        }
+    }
+}
+
+static int is_word(char byte) {
+    return (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z') || (byte >= '0' && byte <= '9') ||
+           byte == '_' || (unsigned char)byte >= 0x80;
+}
+
+// ---
+// Byte matcher
+// ---
+
+static uint32_t naive_scan(char patterns[][8], uint32_t pattern_count, const char* text, uint32_t length,
+                           uint32_t flags, EntityMention* out) {
+    uint32_t found = 0;
+    for (uint32_t p = 0; p < pattern_count; p++) {
+        uint32_t pattern_length = (uint32_t)strlen(patterns[p]);
+        for (uint32_t begin = 0; begin + pattern_length <= length; begin++) {
+            uint32_t i = 0;
+            while (i < pattern_length) {
+                char byte = flags & MATCHER_FOLD_CASE && text[begin + i] >= 'A' && text[begin + i] <= 'Z'
+                          ? (char)(text[begin + i] | 0x20) : text[begin + i];
+                if (byte != patterns[p][i]) break;
+                i++;
+            }
+            if (i < pattern_length) continue;
+            uint32_t end = begin + pattern_length;
+            if (flags & MATCHER_WHOLE_WORDS &&
+                ((begin > 0 && is_word(text[begin - 1])) || (end < length && is_word(text[end])))) {
+                continue;
+            }
+            out[found++] = (EntityMention){ begin, end, p + 1000, p };
+        }
+    }
+    return found;
+}
+
+static void test_bytes(EntityMention* actual, EntityMention* expected) {
+    static const uint32_t flag_sets[] = { MATCHER_FOLD_CASE, MATCHER_FOLD_CASE | MATCHER_WHOLE_WORDS, 0 };
+    static const char* labels[] = { "matcher", "matcher (whole words)", "matcher (case-sensitive)" };
+    static char patterns[MATCH_PATTERNS][8];
+    char* text = malloc(TEXT_LENGTH + 1);
+    uint64_t state = 17;
+    for (uint32_t i = 0; i < TEXT_LENGTH; i++) text[i] = "ABCab  \xc3"[test_random(&state) % 8];
+    text[TEXT_LENGTH] = '\0';
+
+    for (size_t f = 0; f < 3; f++) {
+        EntityMatcher matcher;
+        init_entity_matcher(&matcher, flag_sets[f]);
+        // Compile after uneven batches: small deltas, then full rebuilds
+        // once a delta outgrows its share of the main automaton.
+        for (uint32_t p = 0; p < MATCH_PATTERNS; p++) {
+            uint32_t length = 1 + test_random(&state) % 5;
+            for (uint32_t i = 0; i < length; i++) patterns[p][i] = "abcA"[test_random(&state) % (f == 2 ? 4 : 3)];
+            patterns[p][length] = '\0';
+            CHECK(matcher_add(&matcher, patterns[p], p + 1000) == p, "%s: pattern %u got another id", labels[f], p);
+            if (p % 37 == 0 || p % 5 == 1) matcher_compile(&matcher);
+        }
+        matcher_compile(&matcher);
+
+        // Patterns added since the last compile are not matched yet.
+        matcher_add(&matcher, "\xc3\xc3\xc3", 1);
+        uint32_t found = matcher_scan(&matcher, text, TEXT_LENGTH, actual, MAX_MENTIONS);
+        uint32_t reference = naive_scan(patterns, MATCH_PATTERNS, text, TEXT_LENGTH, flag_sets[f], expected);
+        check_same_mentions(actual, found, expected, reference, labels[f]);
+
+        // A short buffer still gets the total, and real mentions.
+        EntityMention few[5];
+        uint32_t total = matcher_scan(&matcher, text, TEXT_LENGTH, few, 5), unknown = 0;
+        for (uint32_t i = 0; i < 5; i++) {
+            unknown += bsearch(&few[i], actual, found, sizeof(EntityMention), compare_mentions) == NULL;
+        }
+        CHECK(total == found && unknown == 0, "%s: short buffer total %u of %u, %u unknown mentions", labels[f],
+              total, found, unknown);
+        free_entity_matcher(&matcher);
+    }
+    free(text);
+
+    EntityMatcher empty;
+    init_entity_matcher(&empty, 0);
+    CHECK(matcher_add(&empty, "", 3) == MATCHER_NONE, "an empty pattern was added");
+    matcher_compile(&empty);
+    CHECK(matcher_scan(&empty, "abc", 3, actual, MAX_MENTIONS) == 0, "an empty matcher found mentions");
+    free_entity_matcher(&empty);
+}
+
+// ---
+// Token-aligned matcher
+// ---
+
+static void test_tokens(EntityMention* actual, EntityMention* expected) {
+    static const char* vocabulary[] = { "a", "ab", "b", "ba", "abc" };
+    enum { TOKENS = 600, PATTERNS = 120 };
+    const char* tokens[TOKENS];
+    char patterns[PATTERNS][24];
+    uint64_t state = 29;
+    for (uint32_t t = 0; t < TOKENS; t++) tokens[t] = vocabulary[test_random(&state) % 5];
+
+    EntityMatcher matcher;
+    init_entity_matcher(&matcher, 0);
+    for (uint32_t p = 0; p < PATTERNS; p++) {
+        // Whole words joined by spaces, or a bare fragment that only
+        // matches inside a token or across a space.
+        patterns[p][0] = '\0';
+        uint32_t words = 1 + test_random(&state) % 3;
+        for (uint32_t w = 0; w < words; w++) {
+            if (w) strcat(patterns[p], " ");
+            strcat(patterns[p], vocabulary[test_random(&state) % 5]);
+        }
+        if (p % 6 == 5) strcpy(patterns[p], p % 12 == 5 ? "b a" : "bc");
+        matcher_add(&matcher, patterns[p], p);
+        if (p % 17 == 3) matcher_compile(&matcher);
+    }
+    matcher_compile(&matcher);
+
+    uint32_t reference = 0;
+    char joined[128];
+    for (uint32_t begin = 0; begin < TOKENS; begin++) {
+        joined[0] = '\0';
+        for (uint32_t end = begin + 1; end <= TOKENS && end - begin <= 3; end++) {
+            if (end > begin + 1) strcat(joined, " ");
+            strcat(joined, tokens[end - 1]);
+            for (uint32_t p = 0; p < PATTERNS; p++) {
+                if (strcmp(joined, patterns[p]) == 0) expected[reference++] = (EntityMention){ begin, end, p, p };
+            }
+        }
+    }
+    uint32_t found = matcher_scan_tokens(&matcher, tokens, TOKENS, actual, MAX_MENTIONS);
+    check_same_mentions(actual, found, expected, reference, "matcher tokens");
+    free_entity_matcher(&matcher);
+}
+
+// ---
+// Store sync
+// ---
+
+static void test_sync(EntityMention* actual) {
+    ConceptStore* store = create_store();
+    uint32_t john = store_create_concept(store, "John", "Person");
+    uint32_t smith = store_create_concept(store, "John Smith", "Person");
+    uint32_t acme = store_create_concept(store, "Acme", "Company");
+    // Reserved concepts such as shard proxies are not entities.
+    store_create_concept(store, "@1:7", "@remote");
+
+    EntityMatcher matcher;
+    init_entity_matcher(&matcher, MATCHER_FOLD_CASE | MATCHER_WHOLE_WORDS);
+    CHECK(matcher_sync_store(&matcher, store) == 3, "sync did not add the three IDs");
+    CHECK(matcher_sync_store(&matcher, store) == 0, "a second sync added IDs again");
+    matcher_compile(&matcher);
+
+    const char* text = "john smith left ACME for Acmeville; Mary stayed @1:7";
+    uint32_t length = (uint32_t)strlen(text);
+    uint32_t found = matcher_scan(&matcher, text, length, actual, MAX_MENTIONS);
+    CHECK(found == 3 && actual[0].concept == smith && actual[0].end == 10 && actual[1].concept == john &&
+              actual[1].end == 4 && actual[2].concept == acme && actual[2].begin == 16,
+          "store sync: %u mentions of John Smith, John and Acme", found);
+
+    // Only concepts created since the last sync are added.
+    uint32_t mary = store_create_concept(store, "Mary", "Person");
+    CHECK(matcher_sync_store(&matcher, store) == 1, "sync added more than the new concept");
+    matcher_compile(&matcher);
+    found = matcher_scan(&matcher, text, length, actual, MAX_MENTIONS);
+    CHECK(found == 4 && actual[3].concept == mary, "store sync: the new concept is not matched");
+
+    free_entity_matcher(&matcher);
+    free_store(store);
+}
+
+void test_matcher(void) {
+    EntityMention* actual = malloc(MAX_MENTIONS * sizeof(EntityMention));
+    EntityMention* expected = malloc(MAX_MENTIONS * sizeof(EntityMention));
+    test_bytes(actual, expected);
+    test_tokens(actual, expected);
+    test_sync(actual);
+    free(expected);
+    free(actual);
+}
@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "path.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Shortest paths and landmark bounds on a hand-checked graph, then on
+// random graphs against BFS distances from every concept, before and
+// after incremental landmark_add_slot() updates.
+
+#define RANDOM_CONCEPTS 60
+
+// Hop distances from `from` by plain BFS (255: unreachable).
+static void reference_distances(const ConceptStore* store, uint32_t from, int directed, uint8_t* distance) {
+    uint32_t n = store->concept_count;
+    uint32_t* queue = malloc(n * sizeof(uint32_t));
+    memset(distance, PATH_UNREACHABLE, n);
+    uint32_t head = 0, tail = 0;
+    queue[tail++] = from;
+    distance[from] = 0;
+    while (head < tail) {
+        uint32_t concept = queue[head++];
+        for (int incoming = 0; incoming < (directed ? 1 : 2); incoming++) {
+            uint32_t degree = incoming ? store_in_degree(store, concept) : store_degree(store, concept);
+            const uint32_t* neighbors = incoming ? store_in_slot_sources(store, concept)
+                                                 : store_slot_targets(store, concept);
+            for (uint32_t e = 0; e < degree; e++) {
+                if (distance[neighbors[e]] != PATH_UNREACHABLE) continue;
+                distance[neighbors[e]] = (uint8_t)(distance[concept] + 1);
+                queue[tail++] = neighbors[e];
+            }
+        }
+    }
+    free(queue);
+}
+
+static int path_is_valid(const ConceptStore* store, const PathStep* path, uint32_t length, uint32_t from,
+                         uint32_t to, int directed) {
+    if (length == 0 || path[0].concept != from || path[length - 1].concept != to) return 0;
+    for (uint32_t i = 1; i < length; i++) {
+        uint32_t previous = path[i - 1].concept, concept = path[i].concept;
+        if (directed && path[i].reversed) return 0;
+        int holds = path[i].reversed ? store_has_slot(store, concept, path[i].name, previous)
+                                     : store_has_slot(store, previous, path[i].name, concept);
+        if (!holds) return 0;
+    }
+    return 1;
+}
+
+static void check_paths(const ConceptStore* store, PathWorkspace* workspace, const char* label) {
+    uint32_t n = store->concept_count;
+    uint8_t* distance = malloc(n);
+    PathStep path[17];
+    for (int directed = 0; directed < 2; directed++) {
+        for (uint32_t from = 0; from < n; from++) {
+            reference_distances(store, from, directed, distance);
+            for (uint32_t to = 0; to < n; to++) {
+                uint32_t length = store_shortest_path(store, workspace, from, to, 16, directed, path);
+                uint32_t expected = distance[to] == PATH_UNREACHABLE || distance[to] > 16 ? 0 : distance[to] + 1u;
+                CHECK(length == expected, "%s: %s path %u → %u has %u concepts, BFS says %u", label,
+                      directed ? "directed" : "undirected", from, to, length, expected);
+                if (length && length == expected) {
+                    CHECK(path_is_valid(store, path, length, from, to, directed), "%s: path %u → %u is not a walk",
+                          label, from, to);
+                }
+            }
+        }
+    }
+    free(distance);
+}
+
+static void check_landmarks(const ConceptStore* store, const LandmarkIndex* index, PathWorkspace* workspace,
+                            const char* label) {
+    uint32_t n = store->concept_count;
+    uint8_t* distance = malloc(n);
+    for (uint32_t from = 0; from < n; from++) {
+        reference_distances(store, from, 0, distance);
+        for (uint32_t to = 0; to < n; to++) {
+            uint32_t lower, upper;
+            landmark_distance_bounds(index, from, to, &lower, &upper);
+            uint32_t truth = distance[to];
+            CHECK(lower <= truth && (truth == PATH_UNREACHABLE || truth <= upper),
+                  "%s: d(%u, %u) = %u outside landmark bounds [%u, %u]", label, from, to, truth, lower, upper);
+            for (uint32_t hops = 1; hops <= 4; hops++) {
+                int within = store_within_hops(store, index, workspace, from, to, hops);
+                CHECK(within == (truth <= hops), "%s: within_hops(%u, %u, %u) = %d, distance %u", label, from, to,
+                      hops, within, truth);
+            }
+        }
+    }
+    free(distance);
+}
+
+static void test_paths(Scheduler* scheduler) {
+    // 0 → 1 → 2 → 3, 4 → 3, 5 isolated: directed 0 ⇝ 3 takes 3 hops,
+    // undirected 0 ⇝ 4 takes 4 (through 3 backwards), 5 is unreachable.
+    static const uint32_t edges[][2] = { { 0, 1 }, { 1, 2 }, { 2, 3 }, { 4, 3 } };
+    ConceptStore* store = test_graph_store(6, edges, 4);
+    PathWorkspace workspace;
+    init_path_workspace(&workspace);
+    PathStep path[8];
+    CHECK(store_shortest_path(store, &workspace, 0, 3, 7, 1, path) == 4, "0 → 3 directed is not 3 hops");
+    CHECK(store_shortest_path(store, &workspace, 3, 0, 7, 1, path) == 0, "3 → 0 directed should not exist");
+    CHECK(store_shortest_path(store, &workspace, 0, 4, 7, 0, path) == 5 && path[4].reversed,
+          "0 - 4 undirected is not 4 hops ending against a slot");
+    CHECK(store_shortest_path(store, &workspace, 0, 4, 3, 0, path) == 0, "0 - 4 found within 3 hops");
+    CHECK(store_shortest_path(store, &workspace, 0, 5, 7, 0, path) == 0, "isolated concept reached");
+    check_paths(store, &workspace, "hand graph");
+    free_store(store);
+
+    ConceptStore* random = test_random_graph(RANDOM_CONCEPTS, 23);
+    check_paths(random, &workspace, "random graph");
+
+    LandmarkIndex index = { 0 };
+    build_landmark_index(&index, random, scheduler, 4);
+    check_landmarks(random, &index, &workspace, "landmarks");
+
+    // Incremental updates must keep the bounds valid.
+    uint64_t state = 99;
+    for (int k = 0; k < 10; k++) {
+        uint32_t source = test_random(&state) % RANDOM_CONCEPTS;
+        uint32_t target = test_random(&state) % RANDOM_CONCEPTS;
+        store_add_slot(random, source, "to", target);
+        landmark_add_slot(&index, random, source, target);
+    }
+    check_landmarks(random, &index, &workspace, "landmarks after add_slot");
+
+    free_landmark_index(&index);
+    free_path_workspace(&workspace);
+    free_store(random);
+}
+
+void test_path(void) {
+    Scheduler* scheduler = create_scheduler(2);
+    test_paths(NULL);
+    test_paths(scheduler);
+    free_scheduler(scheduler);
+}
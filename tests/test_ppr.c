@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "ppr.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Forward push against personalized PageRank solved to convergence by
+// synchronous pushes over every concept (power iteration on the same
+// undirected walk). Push leaves residual mass r behind, and the true
+// score of any concept exceeds its estimate by at most the total
+// residual, never less: that is the tolerance checked here.
+
+#define CONCEPTS 300
+
+static double absolute(double value) {
+    return value < 0.0 ? -value : value;
+}
+
+static uint32_t walk_degree(const ConceptStore* store, uint32_t concept) {
+    return store_degree(store, concept) + store_in_degree(store, concept);
+}
+
+static void reference_ppr(const ConceptStore* store, const uint32_t* seeds, uint32_t seed_count, double alpha,
+                          double* scores) {
+    uint32_t n = store->concept_count;
+    double* residual = calloc(n, sizeof(double));
+    double* next = malloc(n * sizeof(double));
+    memset(scores, 0, n * sizeof(double));
+    for (uint32_t s = 0; s < seed_count; s++) residual[seeds[s]] += 1.0 / seed_count;
+
+    for (int iteration = 0; iteration < 1000; iteration++) {
+        memset(next, 0, n * sizeof(double));
+        for (uint32_t c = 0; c < n; c++) {
+            uint32_t degree = walk_degree(store, c);
+            if (degree == 0) {
+                scores[c] += residual[c];
+                continue;
+            }
+            scores[c] += alpha * residual[c];
+            double share = (1.0 - alpha) * residual[c] / degree;
+            const uint32_t* targets = store_slot_targets(store, c);
+            const uint32_t* sources = store_in_slot_sources(store, c);
+            for (uint32_t i = 0; i < store_degree(store, c); i++) next[targets[i]] += share;
+            for (uint32_t i = 0; i < store_in_degree(store, c); i++) next[sources[i]] += share;
+        }
+        memcpy(residual, next, n * sizeof(double));
+    }
+    free(residual);
+    free(next);
+}
+
+static void check_push(const ConceptStore* store, PushWorkspace* workspace, const uint32_t* seeds,
+                       uint32_t seed_count, float epsilon, const char* label) {
+    uint32_t n = store->concept_count;
+    double* expected = malloc(n * sizeof(double));
+    RankedConcept* ranked = malloc(n * sizeof(RankedConcept));
+    reference_ppr(store, seeds, seed_count, PPR_ALPHA, expected);
+    uint32_t count = personalized_push(store, workspace, seeds, seed_count, PPR_ALPHA, epsilon, 0, n, ranked);
+    CHECK(!workspace->truncated, "%s: truncated without a budget", label);
+
+    // Every residual is below its push threshold, and mass is conserved.
+    double residual = 0.0, mass = 0.0;
+    uint32_t above = 0, positive = 0;
+    for (uint32_t c = 0; c < n; c++) {
+        residual += workspace->residual[c];
+        mass += workspace->estimate[c] + workspace->residual[c];
+        positive += workspace->estimate[c] > 0.0f;
+        if (workspace->residual[c] >= epsilon * (float)walk_degree(store, c) && workspace->residual[c] > 0.0f) above++;
+    }
+    CHECK(above == 0, "%s: %u concepts left above the push threshold", label, above);
+    CHECK(absolute(mass - 1.0) < 1e-4, "%s: estimates plus residuals sum to %f", label, mass);
+
+    // Estimates are lower bounds within the residual left behind.
+    uint32_t outside = 0;
+    double worst = 0.0;
+    for (uint32_t c = 0; c < n; c++) {
+        double gap = expected[c] - workspace->estimate[c];
+        if (gap < -1e-5 || gap > residual + 1e-5) outside++;
+        if (absolute(gap) > worst) worst = absolute(gap);
+    }
+    CHECK(outside == 0, "%s: %u estimates outside [ppr - %g, ppr], worst gap %g", label, outside, residual, worst);
+
+    // The ranking is every positive estimate, best first.
+    CHECK(count == positive, "%s: %u ranked, %u concepts have an estimate", label, count, positive);
+    uint32_t misordered = 0, mismatched = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        mismatched += ranked[i].score != workspace->estimate[ranked[i].concept];
+        if (i > 0 && (ranked[i - 1].score < ranked[i].score ||
+                      (ranked[i - 1].score == ranked[i].score && ranked[i - 1].concept > ranked[i].concept))) {
+            misordered++;
+        }
+    }
+    CHECK(misordered == 0 && mismatched == 0, "%s: ranking has %u misordered, %u wrong scores", label, misordered,
+          mismatched);
+    free(expected);
+    free(ranked);
+}
+
+// Slots scored p[s]/deg(s) + p[t]/deg(t), against scoring every slot.
+static void check_slots(const ConceptStore* store, const PushWorkspace* workspace, uint32_t k) {
+    uint32_t total = store->slot_count;
+    float* expected = malloc(total * sizeof(float));
+    RelevantSlot* found = malloc(k * sizeof(RelevantSlot));
+    uint32_t scored = 0;
+    for (uint32_t c = 0; c < store->concept_count; c++) {
+        const uint32_t* targets = store_slot_targets(store, c);
+        for (uint32_t i = 0; i < store_degree(store, c); i++) {
+            float score = workspace->estimate[c] / (float)walk_degree(store, c) +
+                          workspace->estimate[targets[i]] / (float)walk_degree(store, targets[i]);
+            if (score > 0.0f) expected[scored++] = score;
+        }
+    }
+    // Descending insertion sort; the graph is small.
+    for (uint32_t i = 1; i < scored; i++) {
+        float value = expected[i];
+        uint32_t j = i;
+        for (; j > 0 && expected[j - 1] < value; j--) expected[j] = expected[j - 1];
+        expected[j] = value;
+    }
+
+    uint32_t count = top_k_relevant_slots(store, workspace, k, found);
+    uint32_t want = scored < k ? scored : k;
+    CHECK(count == want, "top_k_relevant_slots returned %u, expected %u", count, want);
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < count && i < want; i++) {
+        float score = workspace->estimate[found[i].source] / (float)walk_degree(store, found[i].source) +
+                      workspace->estimate[found[i].target] / (float)walk_degree(store, found[i].target);
+        Symbol to = find_symbol(&store->symbols, "to");
+        if (!store_has_slot(store, found[i].source, to, found[i].target) || found[i].name != to) wrong++;
+        if (absolute(score - found[i].score) > 1e-6 * score || absolute(found[i].score - expected[i]) > 1e-6 * score) {
+            wrong++;
+        }
+    }
+    CHECK(wrong == 0, "top_k_relevant_slots: %u of %u slots wrong or out of order", wrong, count);
+    free(expected);
+    free(found);
+}
+
+void test_ppr(void) {
+    ConceptStore* store = test_random_graph(CONCEPTS, 21);
+    uint32_t isolated = store_create_concept(store, "alone", "Node");
+    PushWorkspace workspace;
+    init_push_workspace(&workspace);
+
+    uint32_t one[1] = { 3 };
+    uint32_t several[4] = { 5, 40, 41, 299 };
+    uint32_t repeated[3] = { 7, 7, 100 };
+    static const float epsilons[] = { 1e-3f, PPR_EPSILON, 1e-7f };
+    for (size_t e = 0; e < sizeof(epsilons) / sizeof(epsilons[0]); e++) {
+        check_push(store, &workspace, one, 1, epsilons[e], "one seed");
+        check_push(store, &workspace, several, 4, epsilons[e], "four seeds");
+        check_push(store, &workspace, repeated, 3, epsilons[e], "repeated seed");
+    }
+    check_slots(store, &workspace, 25);
+
+    // A fresh workspace gives the same answer as a reused one.
+    PushWorkspace fresh;
+    init_push_workspace(&fresh);
+    RankedConcept reused_top[10], fresh_top[10];
+    uint32_t a = personalized_push(store, &workspace, several, 4, PPR_ALPHA, PPR_EPSILON, 0, 10, reused_top);
+    uint32_t b = personalized_push(store, &fresh, several, 4, PPR_ALPHA, PPR_EPSILON, 0, 10, fresh_top);
+    CHECK(a == b && memcmp(reused_top, fresh_top, a * sizeof(RankedConcept)) == 0, "reused workspace differs");
+    free_push_workspace(&fresh);
+
+    // A concept without slots keeps all of its mass.
+    RankedConcept top[4];
+    uint32_t count = personalized_push(store, &workspace, &isolated, 1, PPR_ALPHA, PPR_EPSILON, 0, 4, top);
+    CHECK(count == 1 && top[0].concept == isolated && top[0].score == 1.0f, "isolated seed scored %f",
+          count ? top[0].score : 0.0f);
+
+    // A spent budget still leaves lower bounds.
+    double* expected = malloc(store->concept_count * sizeof(double));
+    reference_ppr(store, several, 4, PPR_ALPHA, expected);
+    personalized_push(store, &workspace, several, 4, PPR_ALPHA, 1e-9f, 1, 0, NULL);
+    uint32_t over = 0;
+    for (uint32_t c = 0; c < store->concept_count; c++) over += workspace.estimate[c] > expected[c] + 1e-5;
+    CHECK(over == 0, "%u estimates above PPR after a spent budget", over);
+    free(expected);
+
+    uint32_t invalid = store->concept_count + 5;
+    CHECK(personalized_push(store, &workspace, &invalid, 1, PPR_ALPHA, PPR_EPSILON, 0, 4, top) == 0,
+          "an out-of-range seed ranked concepts");
+
+    free_push_workspace(&workspace);
+    free_store(store);
+}
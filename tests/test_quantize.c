@@ -0,0 +1,306 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "quantize.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Quantized storage on clustered vectors: the decode error of each
+// format stays within its bound, code distances match the fp32 metric
+// on the decoded vectors, and search recall@10 against a plain fp32
+// scan holds up, with and without fp32 re-ranking.
+
+#define DIMENSIONS 32
+#define CLUSTERS 24
+#define VECTORS 2000
+#define QUERIES 30
+#define K 10
+#define RERANK 50
+
+static const DistanceMetric metrics[] = { DISTANCE_L2, DISTANCE_INNER_PRODUCT, DISTANCE_COSINE };
+static const char* format_names[] = { "12.4", "int8", "PQ" };
+
+static double absolute(double value) {
+    return value < 0.0 ? -value : value;
+}
+
+static float random_float(uint64_t* state) {
+    return (float)(test_random(state) % 200001) / 25000.0f - 4.0f;
+}
+
+// Cluster centers in [-4, 4], members within ±0.4 of theirs, so the
+// 12.4 step is small next to the spread; every thirteenth concept has
+// no vector.
+static void clustered(ConceptVectorStore* vectors, float* queries, uint64_t* state) {
+    float centers[CLUSTERS][DIMENSIONS];
+    for (uint32_t c = 0; c < CLUSTERS; c++) {
+        for (uint32_t d = 0; d < DIMENSIONS; d++) centers[c][d] = random_float(state);
+    }
+    init_vector_store(vectors, DIMENSIONS, VECTORS);
+    float row[DIMENSIONS];
+    for (uint32_t v = 0; v < VECTORS; v++) {
+        const float* center = centers[test_random(state) % CLUSTERS];
+        for (uint32_t d = 0; d < DIMENSIONS; d++) row[d] = center[d] + 0.1f * random_float(state);
+        if (v % 13 != 5) vector_attach(vectors, v, row);
+    }
+    for (uint32_t q = 0; q < QUERIES; q++) {
+        const float* center = centers[test_random(state) % CLUSTERS];
+        for (uint32_t d = 0; d < DIMENSIONS; d++) queries[q * DIMENSIONS + d] = center[d] + 0.1f * random_float(state);
+    }
+}
+
+static void build(QuantizedVectors* quantized, QuantFormat format, const ConceptVectorStore* vectors) {
+    init_quantized(quantized, format, DIMENSIONS, 0);
+    if (format == QUANT_PQ) {
+        CHECK(quantized_attach(quantized, 0, vector_of(vectors, 0)) == -1, "PQ encoded before training");
+        CHECK(pq_train(quantized, vectors, NULL, 0, 0) == 0, "pq_train failed");
+    }
+    uint32_t encoded = quantize_store(quantized, vectors);
+    CHECK(encoded == vectors->n_concepts && quantized->n_concepts == encoded, "%s: %u of %u rows encoded",
+          format_names[format], encoded, vectors->n_concepts);
+}
+
+// ---
+// Round trip
+// ---
+
+static void check_round_trip(const QuantizedVectors* quantized, const ConceptVectorStore* vectors) {
+    QuantFormat format = quantized->format;
+    float decoded[DIMENSIONS];
+    uint32_t outside = 0, not_nearest = 0;
+    double error = 0.0, energy = 0.0;
+    for (uint32_t v = 0; v < VECTORS; v++) {
+        const float* row = vector_of(vectors, v);
+        if (!row) continue;
+        quantized_decode(quantized, v, decoded);
+
+        // 12.4 is within half a step; int8 within half its row's step.
+        float largest = 0.0f;
+        for (uint32_t d = 0; d < DIMENSIONS; d++) largest = absolute(row[d]) > largest ? absolute(row[d]) : largest;
+        double bound = format == QUANT_FIXED_12_4 ? 0.5 / QUANT_FIXED_ONE : 0.5 * largest / 127.0;
+        for (uint32_t d = 0; d < DIMENSIONS; d++) {
+            double gap = absolute((double)decoded[d] - row[d]);
+            if (format != QUANT_PQ && gap > bound * (1.0 + 1e-5) + 1e-7) outside++;
+            error += gap * gap;
+            energy += (double)row[d] * row[d];
+        }
+
+        // PQ picks the nearest centroid of every subspace.
+        if (format == QUANT_PQ) {
+            uint32_t width = quantized->sub_dimensions;
+            for (uint32_t s = 0; s < quantized->subspaces; s++) {
+                const float* sub = row + s * width;
+                float chosen = l2sq_f32(sub, decoded + s * width, width);
+                for (uint32_t c = 0; c < PQ_CENTROIDS; c++) {
+                    const float* centroid = quantized->centroids + ((size_t)s * PQ_CENTROIDS + c) * width;
+                    if (l2sq_f32(sub, centroid, width) < chosen - 1e-6f) {
+                        not_nearest++;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    CHECK(outside == 0, "%s: %u decoded values outside the rounding bound", format_names[format], outside);
+    CHECK(not_nearest == 0, "PQ: %u sub-vectors not encoded by their nearest centroid", not_nearest);
+    double bound = format == QUANT_PQ ? 0.01 : 1e-3;
+    CHECK(error / energy < bound, "%s: relative squared error %g", format_names[format], error / energy);
+
+    CHECK(!quantized_present(quantized, 5) && !quantized_present(quantized, UINT32_MAX),
+          "%s: rows present without a vector", format_names[format]);
+}
+
+static void test_edges(void) {
+    QuantizedVectors fixed, bytes;
+    init_quantized(&fixed, QUANT_FIXED_12_4, DIMENSIONS, 0);
+    init_quantized(&bytes, QUANT_INT8, DIMENSIONS, 0);
+    float row[DIMENSIONS] = { 0 }, decoded[DIMENSIONS];
+
+    // The zero vector stays zero; 12.4 saturates at its range.
+    quantized_attach(&bytes, 3, row);
+    quantized_decode(&bytes, 3, decoded);
+    uint32_t nonzero = 0;
+    for (uint32_t d = 0; d < DIMENSIONS; d++) nonzero += decoded[d] != 0.0f;
+    CHECK(nonzero == 0 && bytes.scales[3] == 0.0f, "int8: zero vector decodes to %u nonzero values", nonzero);
+    row[0] = 5000.0f;
+    row[1] = -5000.0f;
+    row[2] = 1.0f / 32.0f;          // halfway rounds away from zero
+    row[3] = -1.0f / 32.0f;
+    quantized_attach(&fixed, 3, row);
+    quantized_decode(&fixed, 3, decoded);
+    CHECK(decoded[0] == 32767.0f / 16.0f && decoded[1] == -2048.0f && decoded[2] == 1.0f / 16.0f &&
+              decoded[3] == -1.0f / 16.0f,
+          "12.4: saturation or rounding wrong (%f %f %f %f)", decoded[0], decoded[1], decoded[2], decoded[3]);
+
+    // Re-attaching replaces the row without counting it twice.
+    quantized_attach(&fixed, 3, row);
+    CHECK(fixed.n_concepts == 1, "12.4: re-attaching counted %u rows", fixed.n_concepts);
+    free_quantized(&fixed);
+    free_quantized(&bytes);
+}
+
+// ---
+// Distances
+// ---
+
+// The query as the codes see it: encoded like a row for 12.4 and int8,
+// raw for PQ (asymmetric).
+static void decoded_query(const QuantizedVectors* quantized, const QuantizedQuery* prepared, const float* query,
+                          float* out) {
+    for (uint32_t d = 0; d < DIMENSIONS; d++) {
+        switch (quantized->format) {
+        case QUANT_FIXED_12_4: out[d] = prepared->fixed[d] / QUANT_FIXED_ONE; break;
+        case QUANT_INT8:       out[d] = prepared->bytes[d] * prepared->scale; break;
+        default:               out[d] = query[d]; break;
+        }
+    }
+}
+
+static void check_distances(const QuantizedVectors* quantized, const float* queries) {
+    float query[DIMENSIONS], decoded[DIMENSIONS];
+    uint32_t wrong = 0;
+    for (size_t m = 0; m < 3; m++) {
+        for (uint32_t q = 0; q < QUERIES; q++) {
+            QuantizedQuery prepared;
+            prepare_quantized_query(quantized, metrics[m], queries + q * DIMENSIONS, &prepared);
+            decoded_query(quantized, &prepared, queries + q * DIMENSIONS, query);
+            for (uint32_t v = 0; v < VECTORS; v += 7) {
+                float actual = quantized_distance(quantized, &prepared, v);
+                if (!quantized_present(quantized, v)) {
+                    wrong += actual != __builtin_inff();
+                    continue;
+                }
+                quantized_decode(quantized, v, decoded);
+                float expected = distance_f32(metrics[m], query, decoded, DIMENSIONS);
+                if (metrics[m] == DISTANCE_L2 && expected < 0.0f) expected = 0.0f;
+                if (absolute(actual - expected) > 1e-3 * (1.0 + absolute(expected))) wrong++;
+            }
+            free_quantized_query(&prepared);
+        }
+    }
+    CHECK(wrong == 0, "%s: %u code distances differ from fp32 on the decoded vectors",
+          format_names[quantized->format], wrong);
+}
+
+// ---
+// Search
+// ---
+
+// The K nearest concepts by a full fp32 scan.
+static void naive_knn(const ConceptVectorStore* vectors, DistanceMetric metric, const float* query,
+                      Neighbor* nearest) {
+    uint32_t found = 0;
+    for (uint32_t v = 0; v < VECTORS; v++) {
+        const float* row = vector_of(vectors, v);
+        if (!row) continue;
+        float distance = distance_f32(metric, query, row, DIMENSIONS);
+        if (found == K && distance >= nearest[K - 1].distance) continue;
+        uint32_t at = found < K ? found++ : K - 1;
+        while (at > 0 && nearest[at - 1].distance > distance) {
+            nearest[at] = nearest[at - 1];
+            at--;
+        }
+        nearest[at].concept = v;
+        nearest[at].distance = distance;
+    }
+}
+
+static float search_recall(const QuantizedVectors* quantized, const ConceptVectorStore* vectors,
+                           DistanceMetric metric, const float* queries, int rerank) {
+    uint32_t hits = 0, wrong = 0;
+    for (uint32_t q = 0; q < QUERIES; q++) {
+        const float* query = queries + q * DIMENSIONS;
+        Neighbor truth[K], found[K];
+        naive_knn(vectors, metric, query, truth);
+        uint32_t count = quantized_search(quantized, metric, query, K, rerank ? RERANK : 0, rerank ? vectors : NULL,
+                                          found);
+        wrong += count != K;
+
+        // Re-ranked results carry exact distances, the others code ones.
+        QuantizedQuery prepared;
+        prepare_quantized_query(quantized, metric, query, &prepared);
+        for (uint32_t i = 0; i < count; i++) {
+            float expected = rerank ? distance_f32(metric, query, vector_of(vectors, found[i].concept), DIMENSIONS)
+                                    : quantized_distance(quantized, &prepared, found[i].concept);
+            wrong += found[i].distance != expected;
+            if (i > 0) wrong += found[i - 1].distance > found[i].distance;
+            for (uint32_t t = 0; t < K; t++) hits += found[i].concept == truth[t].concept;
+        }
+        free_quantized_query(&prepared);
+    }
+    CHECK(wrong == 0, "%s%s: %u results with wrong distances or order", format_names[quantized->format],
+          rerank ? " re-ranked" : "", wrong);
+    return (float)hits / (float)(QUERIES * K);
+}
+
+static void check_search(const QuantizedVectors* quantized, const ConceptVectorStore* vectors,
+                         const float* queries) {
+    // Re-ranking from a deep enough candidate list recovers the exact
+    // answer almost always, whatever the format.
+    static const float plain_floor[] = { 0.85f, 0.85f, 0.65f };
+    for (size_t m = 0; m < 3; m++) {
+        float plain = search_recall(quantized, vectors, metrics[m], queries, 0);
+        float reranked = search_recall(quantized, vectors, metrics[m], queries, 1);
+        CHECK(plain >= plain_floor[quantized->format], "%s metric %d: recall@%d %.3f", format_names[quantized->format],
+              (int)metrics[m], K, plain);
+        CHECK(reranked >= 0.97f && reranked >= plain, "%s metric %d: re-ranked recall@%d %.3f (plain %.3f)",
+              format_names[quantized->format], (int)metrics[m], K, reranked, plain);
+    }
+}
+
+// Re-ranking against a store that lacks some rows drops those
+// candidates instead of mixing their code distances into exact ones.
+static void check_rerank_missing(const QuantizedVectors* quantized, ConceptVectorStore* vectors,
+                                 const float* queries) {
+    uint32_t wrong = 0;
+    for (uint32_t q = 0; q < 5; q++) {
+        const float* query = queries + q * DIMENSIONS;
+        Neighbor found[K];
+        uint32_t count = quantized_search(quantized, DISTANCE_L2, query, K, RERANK, vectors, found);
+        if (count == 0) {
+            wrong++;
+            continue;
+        }
+        uint32_t nearest = found[0].concept;
+        float row[DIMENSIONS];
+        memcpy(row, vector_of(vectors, nearest), sizeof(row));
+        vector_detach(vectors, nearest);
+
+        count = quantized_search(quantized, DISTANCE_L2, query, K, RERANK, vectors, found);
+        wrong += count != K;
+        for (uint32_t i = 0; i < count; i++) {
+            const float* exact = vector_of(vectors, found[i].concept);
+            wrong += !exact || found[i].distance != distance_f32(DISTANCE_L2, query, exact, DIMENSIONS);
+        }
+        vector_attach(vectors, nearest, row);
+    }
+    CHECK(wrong == 0, "%s: %u re-ranked results without an exact row or distance", format_names[quantized->format],
+          wrong);
+
+    ConceptVectorStore empty;
+    init_vector_store(&empty, DIMENSIONS, VECTORS);
+    Neighbor found[K];
+    CHECK(quantized_search(quantized, DISTANCE_L2, queries, K, RERANK, &empty, found) == 0,
+          "%s: re-ranking against an empty store returned candidates", format_names[quantized->format]);
+    free_vector_store(&empty);
+}
+
+void test_quantize(void) {
+    uint64_t state = 44;
+    ConceptVectorStore vectors;
+    float* queries = malloc(QUERIES * DIMENSIONS * sizeof(float));
+    clustered(&vectors, queries, &state);
+
+    test_edges();
+    for (QuantFormat format = QUANT_FIXED_12_4; format <= QUANT_PQ; format++) {
+        QuantizedVectors quantized;
+        build(&quantized, format, &vectors);
+        check_round_trip(&quantized, &vectors);
+        check_distances(&quantized, queries);
+        check_search(&quantized, &vectors, queries);
+        check_rerank_missing(&quantized, &vectors, queries);
+        free_quantized(&quantized);
+    }
+    free(queries);
+    free_vector_store(&vectors);
+}
@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "query.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Query answers vs brute force: every assignment of concepts to the
+// query's variables, kept if every parsed clause holds.
+
+#define CONCEPTS 24
+#define MAX_ANSWERS (CONCEPTS * CONCEPTS * CONCEPTS)
+
+typedef struct AnswerSet {
+    uint64_t* keys;
+    uint32_t count;
+    uint32_t variables;
+} AnswerSet;
+
+static uint64_t encode(const uint32_t* values, uint32_t variables) {
+    uint64_t key = 0;
+    for (uint32_t v = 0; v < variables; v++) key = key * CONCEPTS + values[v];
+    return key;
+}
+
+static int collect(const uint32_t* bindings, void* user_data) {
+    AnswerSet* set = user_data;
+    if (set->count < MAX_ANSWERS) set->keys[set->count] = encode(bindings, set->variables);
+    set->count++;
+    return 0;
+}
+
+static int compare_keys(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t term_of(const QueryTerm* term, const uint32_t* values, const uint32_t* parameters) {
+    switch (term->kind) {
+    case QUERY_TERM_VARIABLE:  return values[term->value];
+    case QUERY_TERM_PARAMETER: return parameters[term->value];
+    case QUERY_TERM_CONSTANT:  return term->value;
+    }
+    return CONCEPT_NONE;
+}
+
+static int clause_holds(const ConceptStore* store, const QueryClause* clause, const uint32_t* values,
+                        const uint32_t* parameters) {
+    uint32_t subject = term_of(&clause->subject, values, parameters);
+    if (subject >= store->concept_count) return 0;
+    if (clause->is_type) return store->type_symbols[subject] == clause->predicate;
+
+    uint32_t object = term_of(&clause->object, values, parameters);
+    if (object >= store->concept_count) return 0;
+    const Symbol* names = store_slot_names(store, subject);
+    const uint32_t* targets = store_slot_targets(store, subject);
+    for (uint32_t i = 0; i < store_degree(store, subject); i++) {
+        if (names[i] == clause->predicate && targets[i] == object) return 1;
+    }
+    return 0;
+}
+
+static void brute_force(const ConceptStore* store, const Query* query, const uint32_t* parameters,
+                        AnswerSet* expected) {
+    uint32_t variables = query->variable_count;
+    uint32_t values[QUERY_MAX_VARIABLES] = { 0 };
+    uint64_t total = 1;
+    for (uint32_t v = 0; v < variables; v++) total *= store->concept_count;
+
+    expected->count = 0;
+    if (query->unsatisfiable) return;
+    for (uint64_t n = 0; n < total; n++) {
+        uint64_t rest = n;
+        for (uint32_t v = variables; v > 0; v--) {
+            values[v - 1] = (uint32_t)(rest % store->concept_count);
+            rest /= store->concept_count;
+        }
+        int holds = 1;
+        for (uint32_t c = 0; c < query->clause_count && holds; c++) {
+            holds = clause_holds(store, &query->clauses[c], values, parameters);
+        }
+        if (holds) expected->keys[expected->count++] = encode(values, variables);
+    }
+}
+
+static void check_answers(const ConceptStore* store, Query* query, const char* pattern, const uint32_t* parameters,
+                          uint32_t parameter_count, AnswerSet* actual, AnswerSet* expected) {
+    actual->count = 0;
+    actual->variables = query->variable_count;
+    uint64_t reported = parameter_count ? run_prepared_query(query, parameters, parameter_count, collect, actual)
+                                        : run_query(query, collect, actual);
+    brute_force(store, query, parameters, expected);
+
+    CHECK(reported == actual->count, "%s: returned %llu, called back %u", pattern, (unsigned long long)reported,
+          actual->count);
+    CHECK(actual->count == expected->count, "%s ($1=%u): %u answers, brute force %u", pattern,
+          parameter_count ? parameters[0] : 0, actual->count, expected->count);
+    if (actual->count != expected->count) return;
+
+    qsort(actual->keys, actual->count, sizeof(uint64_t), compare_keys);
+    for (uint32_t i = 0; i < actual->count; i++) {
+        if (actual->keys[i] != expected->keys[i]) {
+            CHECK(0, "%s: answer %u differs from brute force", pattern, i);
+            return;
+        }
+    }
+}
+
+void test_query(void) {
+    static const char* patterns[] = {
+        "?x type Person",
+        "?x owns ?y",
+        "?x owns ?x",
+        "?x likes ?x; ?x owns ?y",
+        "?x likes ?y; ?y likes ?x",
+        "?x owns ?y; ?x likes ?y",
+        "?x type Person; ?x owns ?y; ?y type Object",
+        "?x knows ?y; ?y knows ?z; ?z knows ?x",
+        "?x knows ?y; ?y knows ?x; ?x knows ?x",
+        "c3 owns ?y; ?y likes ?z",
+        "?x owns c5",
+        "?x owns nobody",
+        "?x type Ghost",
+    };
+    static const char* prepared[] = {
+        "$1 owns ?y",
+        "?x likes $1",
+        "$1 knows ?y; ?y knows $2",
+        "$1 knows ?y; ?y knows ?y",
+        "$1 likes $1",
+    };
+    static const char* types[] = { "Person", "Object", "Place" };
+    static const char* predicates[] = { "owns", "likes", "knows" };
+
+    ConceptStore* store = create_store();
+    char id[16];
+    for (uint32_t i = 0; i < CONCEPTS; i++) {
+        snprintf(id, sizeof(id), "c%u", i);
+        store_create_concept(store, id, types[i % 3]);
+    }
+    uint64_t state = 42;
+    for (uint32_t k = 0; k < 140; k++) {
+        uint32_t source = test_random(&state) % CONCEPTS;
+        uint32_t target = test_random(&state) % CONCEPTS;
+        store_add_slot(store, source, predicates[test_random(&state) % 3], target);
+    }
+    // Self-loops, and a duplicate slot (answers must stay distinct).
+    store_add_slot(store, 4, "owns", 4);
+    store_add_slot(store, 7, "likes", 7);
+    store_add_slot(store, 9, "knows", 9);
+    store_add_slot(store, 3, "owns", 5);
+    store_add_slot(store, 3, "owns", 5);
+
+    AnswerSet actual = { malloc(MAX_ANSWERS * sizeof(uint64_t)), 0, 0 };
+    AnswerSet expected = { malloc(MAX_ANSWERS * sizeof(uint64_t)), 0, 0 };
+
+    for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+        Query* query = compile_query(store, patterns[i]);
+        CHECK(query != NULL, "%s: did not compile", patterns[i]);
+        if (!query) continue;
+        check_answers(store, query, patterns[i], NULL, 0, &actual, &expected);
+        free_query(query);
+    }
+
+    // Prepared queries run from a cache, once per parameter value: the
+    // plan is reused, so stale candidate buffers would show up here.
+    QueryCache* cache = create_query_cache(store);
+    for (size_t i = 0; i < sizeof(prepared) / sizeof(prepared[0]); i++) {
+        for (uint32_t first = 0; first < CONCEPTS; first++) {
+            Query* query = prepare_query(cache, prepared[i]);
+            CHECK(query != NULL, "%s: did not prepare", prepared[i]);
+            if (!query) break;
+            uint32_t parameters[2] = { first, (first * 7 + 3) % CONCEPTS };
+            check_answers(store, query, prepared[i], parameters, query->parameter_count, &actual, &expected);
+        }
+    }
+    free_query_cache(cache);
+
+    free(actual.keys);
+    free(expected.keys);
+    free_store(store);
+}
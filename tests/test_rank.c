@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "rank.h"
+#include <stdlib.h>
+#include <string.h>
+
+// top_k_slots() against a full sort of the concept's matching slots by
+// (score descending, position ascending), for every k; and the META
+// column against the weights given, through relocation and compaction.
+
+#define CONCEPTS 40
+#define SLOTS 1500
+
+typedef struct ReferenceSlot {
+    uint32_t target;
+    uint32_t name;
+    float weight;
+    float confidence;
+    uint64_t timestamp;
+} ReferenceSlot;
+
+static const char* slot_names[] = { "owns", "likes", "knows" };
+
+static int better(const RankedSlot* a, const RankedSlot* b) {
+    if (a->score != b->score) return a->score > b->score;
+    return a->position < b->position;
+}
+
+static void check_top_k(const ConceptStore* store, uint32_t concept, const char* slot_name, RankedSlot* all,
+                        RankedSlot* out) {
+    // Reference: every match, insertion-sorted best first.
+    uint32_t degree = store_degree(store, concept), matches = 0;
+    const SlotMeta* meta = store_slot_meta(store, concept);
+    for (uint32_t i = 0; i < degree; i++) {
+        Symbol name = store_slot_names(store, concept)[i];
+        if (slot_name && strcmp(symbol_name(&store->symbols, name), slot_name) != 0) continue;
+        RankedSlot slot = { store_slot_targets(store, concept)[i], name, meta ? meta[i].weight * meta[i].confidence
+                                                                             : 1.0f, i };
+        uint32_t j = matches++;
+        while (j > 0 && better(&slot, &all[j - 1])) {
+            all[j] = all[j - 1];
+            j--;
+        }
+        all[j] = slot;
+    }
+
+    for (uint32_t k = 1; k <= matches + 2; k++) {
+        uint32_t found = top_k_slots(store, concept, slot_name, k, out);
+        uint32_t expected = k < matches ? k : matches;
+        CHECK(found == expected, "concept %u, %s, k %u: %u slots, expected %u", concept, slot_name ? slot_name : "*",
+              k, found, expected);
+        for (uint32_t i = 0; i < found && i < expected; i++) {
+            if (out[i].position != all[i].position || out[i].target != all[i].target || out[i].score != all[i].score) {
+                CHECK(0, "concept %u, %s, k %u: rank %u is slot %u, expected %u", concept,
+                      slot_name ? slot_name : "*", k, i, out[i].position, all[i].position);
+                break;
+            }
+        }
+    }
+}
+
+void test_rank(void) {
+    ConceptStore* store = create_store();
+    char id[16];
+    for (uint32_t i = 0; i < CONCEPTS; i++) {
+        snprintf(id, sizeof(id), "c%u", i);
+        store_create_concept(store, id, "Thing");
+    }
+    store_add_slot(store, 0, "owns", 1);
+    CHECK(store_slot_meta(store, 0) == NULL, "the META column exists before any weighted slot");
+
+    // Unweighted and weighted slots mixed, skewed sources, repeated
+    // scores so ties are common.
+    ReferenceSlot (*reference)[SLOTS] = calloc(CONCEPTS, sizeof(*reference));
+    uint32_t counts[CONCEPTS] = { 0 };
+    reference[0][counts[0]++] = (ReferenceSlot){ 1, 0, 1.0f, 1.0f, 0 };
+    uint64_t state = 77;
+    for (uint32_t k = 0; k < SLOTS; k++) {
+        uint32_t source = test_random(&state) % CONCEPTS;
+        if (k % 3) source %= 4;
+        ReferenceSlot slot = { test_random(&state) % CONCEPTS, test_random(&state) % 3, 1.0f, 1.0f, 0 };
+        if (k % 4) {
+            slot.weight = (float)(test_random(&state) % 8) / 4.0f;
+            slot.confidence = (float)(1 + test_random(&state) % 4) / 4.0f;
+            slot.timestamp = k;
+            store_add_weighted_slot(store, source, slot_names[slot.name], slot.target, slot.weight, slot.confidence,
+                                    slot.timestamp);
+        } else {
+            store_add_slot(store, source, slot_names[slot.name], slot.target);
+        }
+        reference[source][counts[source]++] = slot;
+        if (k == SLOTS / 2) store_compact_slots(store);
+    }
+
+    for (uint32_t c = 0; c < CONCEPTS; c++) {
+        const SlotMeta* meta = store_slot_meta(store, c);
+        uint32_t errors = 0;
+        CHECK(store_degree(store, c) == counts[c], "concept %u: degree %u, expected %u", c, store_degree(store, c),
+              counts[c]);
+        for (uint32_t i = 0; i < counts[c] && i < store_degree(store, c); i++) {
+            const ReferenceSlot* slot = &reference[c][i];
+            if (store_slot_targets(store, c)[i] != slot->target || meta[i].weight != slot->weight ||
+                meta[i].confidence != slot->confidence || meta[i].timestamp != slot->timestamp) {
+                errors++;
+            }
+        }
+        CHECK(errors == 0, "concept %u: %u slots carry the wrong target or meta", c, errors);
+    }
+
+    RankedSlot* all = malloc(SLOTS * sizeof(RankedSlot));
+    RankedSlot* out = malloc((SLOTS + 2) * sizeof(RankedSlot));
+    for (uint32_t c = 0; c < CONCEPTS; c++) {
+        check_top_k(store, c, NULL, all, out);
+        check_top_k(store, c, "likes", all, out);
+    }
+    CHECK(top_k_slots(store, 0, "Ghost", 5, out) == 0, "an unknown slot name ranked slots");
+    CHECK(top_k_slots(store, CONCEPTS, NULL, 5, out) == 0, "an unknown concept ranked slots");
+    CHECK(top_k_slots(store, 0, NULL, 0, out) == 0, "k = 0 ranked slots");
+
+    free(out);
+    free(all);
+    free(reference);
+    free_store(store);
+}
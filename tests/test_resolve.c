@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "resolve.h"
+#include <stdlib.h>
+
+// Weighted interval selection against exhaustive search over every
+// subset of a dozen candidate spans, with confidences recomputed here
+// in doubles: priors from the usage counts, and context similarity from
+// token and concept embeddings (some concepts without one, a zero token
+// among the context).
+
+#define CONCEPTS 8
+#define TOKENS 14
+#define MENTIONS 12
+#define ROUNDS 300
+#define DIMENSIONS 12
+
+static double absolute(double value) {
+    return value < 0.0 ? -value : value;
+}
+
+// Newton's method, so the suite does not need libm.
+static double square_root(double value) {
+    if (value <= 0.0) return 0.0;
+    double root = value > 1.0 ? value : 1.0;
+    for (int step = 0; step < 60; step++) root = 0.5 * (root + value / root);
+    return root;
+}
+
+static float random_unit(uint64_t* state) {
+    return (float)(test_random(state) % 20001) / 10000.0f - 1.0f;
+}
+
+static double dot(const float* a, const float* b) {
+    double sum = 0.0;
+    for (uint32_t i = 0; i < DIMENSIONS; i++) sum += (double)a[i] * b[i];
+    return sum;
+}
+
+// Concept i was used i² times.
+static double reference_prior(uint32_t concept) {
+    double total = 0.0;
+    for (uint32_t i = 0; i < CONCEPTS; i++) total += (double)i * i;
+    return ((double)concept * concept + 1.0) / (total + CONCEPTS);
+}
+
+// P(concept) · ContextSimilarity over `window` tokens on each side; 0
+// for mentions that can never be picked.
+static double reference_confidence(const ConceptVectorStore* vectors, const float* tokens, uint32_t window,
+                                   const EntityMention* mention) {
+    if (mention->begin >= mention->end || mention->end > TOKENS || mention->concept >= CONCEPTS) return 0.0;
+    double prior = reference_prior(mention->concept);
+    const float* embedding = vectors && tokens ? vector_of(vectors, mention->concept) : NULL;
+    if (!embedding || dot(embedding, embedding) == 0.0) return prior * 0.5;
+
+    double sum = 0.0;
+    uint32_t counted = 0;
+    uint32_t left = mention->begin > window ? mention->begin - window : 0;
+    uint32_t right = mention->end + window < TOKENS ? mention->end + window : TOKENS;
+    for (uint32_t t = left; t < right; t++) {
+        const float* token = tokens + t * DIMENSIONS;
+        if ((t >= mention->begin && t < mention->end) || dot(token, token) == 0.0) continue;
+        sum += dot(embedding, token) / square_root(dot(embedding, embedding) * dot(token, token));
+        counted++;
+    }
+    return counted ? prior * 0.5 * (1.0 + sum / counted) : prior * 0.5;
+}
+
+// Best total weight of pairwise non-overlapping mentions.
+static double exhaustive_best(const EntityMention* mentions, const double* weights, uint32_t count) {
+    double best = 0.0;
+    for (uint32_t subset = 1; subset < (1u << count); subset++) {
+        double total = 0.0;
+        int valid = 1;
+        for (uint32_t i = 0; i < count && valid; i++) {
+            if (!(subset & (1u << i))) continue;
+            if (weights[i] <= 0.0) valid = 0;
+            for (uint32_t j = 0; j < i && valid; j++) {
+                if (!(subset & (1u << j))) continue;
+                if (mentions[i].begin < mentions[j].end && mentions[j].begin < mentions[i].end) valid = 0;
+            }
+            total += weights[i];
+        }
+        if (valid && total > best) best = total;
+    }
+    return best;
+}
+
+static void check_rounds(const ConceptStore* store, const ConceptVectorStore* vectors, const float* tokens,
+                         ResolveWorkspace* workspace, uint64_t* state, const char* label) {
+    EntityMention mentions[MENTIONS];
+    ResolvedMention out[MENTIONS];
+    double weights[MENTIONS];
+    uint32_t wrong = 0, confidence_wrong = 0, total_wrong = 0;
+
+    for (uint32_t round = 0; round < ROUNDS; round++) {
+        uint32_t count = 1 + test_random(state) % MENTIONS;
+        uint32_t window = test_random(state) % 4;       // 0: the default
+        uint32_t effective = window ? window : RESOLVE_DEFAULT_WINDOW;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t begin = test_random(state) % TOKENS;
+            uint32_t length = 1 + test_random(state) % 4;
+            uint32_t concept = test_random(state) % (CONCEPTS + 1);      // CONCEPTS: not in the store
+            mentions[i] = (EntityMention){ begin, begin + length, concept, i };    // may run past the turn
+            weights[i] = reference_confidence(vectors, tokens, effective, &mentions[i]) * length;
+        }
+
+        uint32_t picked = resolve_mentions(store, vectors, tokens, DIMENSIONS, TOKENS, mentions, count, window,
+                                           workspace, out);
+        double total = 0.0;
+        for (uint32_t i = 0; i < picked; i++) {
+            if (out[i].end > TOKENS || out[i].concept >= CONCEPTS || (i > 0 && out[i - 1].end > out[i].begin)) {
+                wrong++;
+                continue;
+            }
+            EntityMention as_mention = { out[i].begin, out[i].end, out[i].concept, 0 };
+            double confidence = reference_confidence(vectors, tokens, effective, &as_mention);
+            confidence_wrong += absolute(out[i].confidence - confidence) > 1e-5;
+            total += confidence * (out[i].end - out[i].begin);
+        }
+        total_wrong += absolute(total - exhaustive_best(mentions, weights, count)) > 1e-5;
+    }
+    CHECK(wrong == 0, "%s: %u picks invalid, overlapping or out of order", label, wrong);
+    CHECK(confidence_wrong == 0, "%s: %u confidences off the reference", label, confidence_wrong);
+    CHECK(total_wrong == 0, "%s: %u rounds short of the exhaustive best weight", label, total_wrong);
+}
+
+void test_resolve(void) {
+    ConceptStore* store = create_store();
+    char id[16];
+    for (uint32_t i = 0; i < CONCEPTS; i++) {
+        snprintf(id, sizeof(id), "e%u", i);
+        store_create_concept(store, id, "Entity");
+        store_record_usage(store, i, i * i);        // uneven priors
+    }
+    store_record_usage(store, CONCEPTS, 5);         // not a concept: ignored
+    uint32_t prior_wrong = 0;
+    for (uint32_t i = 0; i < CONCEPTS; i++) {
+        prior_wrong += absolute(store_concept_prior(store, i) - reference_prior(i)) > 1e-7;
+    }
+    CHECK(prior_wrong == 0 && store_concept_prior(store, CONCEPTS) == 0.0f, "%u priors off the reference",
+          prior_wrong);
+
+    // Embeddings for some concepts (one of them zero); token 5 is zero.
+    uint64_t state = 3;
+    ConceptVectorStore vectors;
+    float row[DIMENSIONS], tokens[TOKENS * DIMENSIONS];
+    init_vector_store(&vectors, DIMENSIONS, CONCEPTS);
+    for (uint32_t i = 0; i < CONCEPTS; i++) {
+        for (uint32_t d = 0; d < DIMENSIONS; d++) row[d] = i == 6 ? 0.0f : random_unit(&state);
+        if (i % 3 != 1) vector_attach(&vectors, i, row);
+    }
+    for (uint32_t i = 0; i < TOKENS * DIMENSIONS; i++) tokens[i] = i / DIMENSIONS == 5 ? 0.0f : random_unit(&state);
+
+    // One workspace throughout, so stale buffers would show.
+    ResolveWorkspace workspace;
+    init_resolve_workspace(&workspace);
+    check_rounds(store, NULL, NULL, &workspace, &state, "priors only");
+    check_rounds(store, &vectors, tokens, &workspace, &state, "with context");
+
+    ResolvedMention out[1];
+    EntityMention lone = { 0, 1, 2, 0 };
+    CHECK(resolve_mentions(store, NULL, NULL, 0, 0, &lone, 1, 0, &workspace, out) == 0,
+          "resolved a mention in an empty turn");
+
+    free_resolve_workspace(&workspace);
+    free_vector_store(&vectors);
+    free_store(store);
+}
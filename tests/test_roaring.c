@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "bitmap.h"
+#include "store.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Roaring set algebra against byte-per-value sets. Chunk sizes sit on
+// both sides of ROARING_ARRAY_MAX, so results cross between array and
+// bitset containers in both directions.
+
+#define CHUNK 65536u
+#define DOMAIN (3 * CHUNK)
+
+typedef struct TestSet {
+    RoaringBitmap bitmap;
+    uint8_t* members;
+} TestSet;
+
+// `count` values of chunk `chunk`, starting at position `skip` of a fixed
+// permutation: two calls with overlapping ranges share exactly the overlap.
+static void add_run(TestSet* set, const uint16_t* permutation, uint32_t chunk, uint32_t skip, uint32_t count) {
+    for (uint32_t i = skip; i < skip + count; i++) {
+        uint32_t value = chunk * CHUNK + permutation[i];
+        roaring_add(&set->bitmap, value);
+        set->members[value] = 1;
+    }
+}
+
+static void check_set(const RoaringBitmap* bitmap, const uint8_t* members, uint32_t* array, const char* label) {
+    uint32_t expected = 0, errors = 0;
+    for (uint32_t value = 0; value < DOMAIN; value++) {
+        expected += members[value];
+        if (roaring_contains(bitmap, value) != members[value]) errors++;
+    }
+    CHECK(errors == 0, "%s: %u membership errors", label, errors);
+    CHECK(roaring_cardinality(bitmap) == expected, "%s: cardinality %llu, expected %u", label,
+          (unsigned long long)roaring_cardinality(bitmap), expected);
+
+    uint32_t written = roaring_to_array(bitmap, array);
+    errors = 0;
+    for (uint32_t i = 0, value = 0; value < DOMAIN; value++) {
+        if (members[value] && (i >= written || array[i++] != value)) errors++;
+    }
+    CHECK(written == expected && errors == 0, "%s: to_array wrote %u values (%u wrong)", label, written, errors);
+
+    // Containers: sorted keys, arrays never past the limit, cardinalities exact.
+    for (uint32_t c = 0; c < bitmap->count; c++) {
+        const RoaringContainer* container = &bitmap->containers[c];
+        if (c > 0) CHECK(bitmap->containers[c - 1].key < container->key, "%s: container keys out of order", label);
+        CHECK(container->cardinality > 0, "%s: empty container %u kept", label, container->key);
+        if (container->type == ROARING_ARRAY) {
+            CHECK(container->cardinality <= ROARING_ARRAY_MAX, "%s: array container of %u values", label,
+                  container->cardinality);
+        }
+    }
+}
+
+static void init_set(TestSet* set) {
+    init_roaring(&set->bitmap);
+    set->members = calloc(DOMAIN, 1);
+}
+
+static void free_set(TestSet* set) {
+    free_roaring(&set->bitmap);
+    free(set->members);
+}
+
+static void check_algebra(const TestSet* a, const TestSet* b, uint32_t* array, const char* label) {
+    static const char* names[] = { "and", "or", "andnot" };
+    uint8_t* members = malloc(DOMAIN);
+    char name[96];
+    for (int op = 0; op < 3; op++) {
+        RoaringBitmap out;
+        init_roaring(&out);
+        roaring_add(&out, 5);                   // previous contents must be replaced
+        if (op == 0) roaring_and(&a->bitmap, &b->bitmap, &out);
+        if (op == 1) roaring_or(&a->bitmap, &b->bitmap, &out);
+        if (op == 2) roaring_andnot(&a->bitmap, &b->bitmap, &out);
+        for (uint32_t value = 0; value < DOMAIN; value++) {
+            uint8_t x = a->members[value], y = b->members[value];
+            members[value] = op == 0 ? (x & y) : op == 1 ? (x | y) : (x & !y);
+        }
+        snprintf(name, sizeof(name), "%s: %s", label, names[op]);
+        check_set(&out, members, array, name);
+        free_roaring(&out);
+    }
+    free(members);
+}
+
+void test_roaring(void) {
+    uint16_t* permutation = malloc(CHUNK * sizeof(uint16_t));
+    for (uint32_t i = 0; i < CHUNK; i++) permutation[i] = (uint16_t)i;
+    uint64_t state = 19;
+    for (uint32_t i = CHUNK - 1; i > 0; i--) {
+        uint32_t j = test_random(&state) % (i + 1);
+        uint16_t swap = permutation[i];
+        permutation[i] = permutation[j];
+        permutation[j] = swap;
+    }
+    uint32_t* array = malloc(DOMAIN * sizeof(uint32_t));
+    char label[96];
+
+    // Chunk 0 sizes around the limit; chunk 1 dense in both; chunk 2 in
+    // `a` only. Overlaps put AND results just under, at and over 4096,
+    // and OR results of two arrays over it.
+    static const uint32_t sizes[] = { 2048, 4095, 4096, 4097, 8192 };
+    static const uint32_t overlaps[] = { 0, 1, 4095, 4096, 4097 };
+    for (int x = 0; x < 5; x++) {
+        for (int y = 0; y < 5; y++) {
+            for (int o = 0; o < 5; o++) {
+                uint32_t overlap = overlaps[o];
+                if (overlap > sizes[x] || overlap > sizes[y]) continue;
+                TestSet a, b;
+                init_set(&a);
+                init_set(&b);
+                add_run(&a, permutation, 0, 0, sizes[x]);
+                add_run(&b, permutation, 0, sizes[x] - overlap, sizes[y]);
+                if (o % 2) {
+                    add_run(&a, permutation, 1, 0, 30000);
+                    add_run(&b, permutation, 1, 20000, 30000);
+                    add_run(&a, permutation, 2, 100, 50);
+                }
+                snprintf(label, sizeof(label), "|a| %u, |b| %u, overlap %u", sizes[x], sizes[y], overlap);
+                check_set(&a.bitmap, a.members, array, label);
+                check_algebra(&a, &b, array, label);
+                check_algebra(&b, &a, array, label);
+                free_set(&a);
+                free_set(&b);
+            }
+        }
+    }
+
+    // The store's indexes against its own slots.
+    static const char* types[] = { "Person", "Object" };
+    static const char* names[] = { "owns", "likes" };
+    ConceptStore* store = create_store();
+    char id[16];
+    for (uint32_t i = 0; i < 5000; i++) {
+        snprintf(id, sizeof(id), "c%u", i);
+        store_create_concept(store, id, types[i % 7 == 0]);
+    }
+    uint8_t* sources[2] = { calloc(DOMAIN, 1), calloc(DOMAIN, 1) };
+    uint8_t* targets[2] = { calloc(DOMAIN, 1), calloc(DOMAIN, 1) };
+    for (uint32_t k = 0; k < 9000; k++) {
+        uint32_t source = test_random(&state) % 5000, target = test_random(&state) % 5000, n = k % 2;
+        store_add_slot(store, source, names[n], target);
+        sources[n][source] = targets[n][target] = 1;
+    }
+    uint8_t* typed = calloc(DOMAIN, 1);
+    for (int t = 0; t < 2; t++) {
+        for (uint32_t i = 0; i < 5000; i++) typed[i] = (i % 7 == 0) == t;
+        snprintf(label, sizeof(label), "type_index[%s]", types[t]);
+        check_set(store_type_index(store, types[t]), typed, array, label);
+        snprintf(label, sizeof(label), "slot_source_index[%s]", names[t]);
+        check_set(store_slot_source_index(store, names[t]), sources[t], array, label);
+        snprintf(label, sizeof(label), "slot_target_index[%s]", names[t]);
+        check_set(store_slot_target_index(store, names[t]), targets[t], array, label);
+    }
+    CHECK(store_type_index(store, "Ghost") == NULL, "an unknown type has an index");
+
+    free(typed);
+    for (int n = 0; n < 2; n++) {
+        free(sources[n]);
+        free(targets[n]);
+    }
+    free_store(store);
+    free(array);
+    free(permutation);
+}
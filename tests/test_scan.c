@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "scan.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Every scan against a plain loop over the same column. The kernel is
+// whatever cpu_level() picked; `make test` reruns the suite capped at
+// each level, so each kernel meets the same inputs.
+
+#define VALUES 1000
+#define CONCEPTS 500
+
+static void check_scan(const Symbol* values, uint32_t count, Symbol needle, uint32_t* out, uint64_t* bitmap,
+                       const char* label) {
+    uint32_t expected = 0, errors = 0;
+    uint32_t found = scan_symbol_indexes(values, count, needle, out);
+    for (uint32_t i = 0; i < count; i++) {
+        if (values[i] != needle) continue;
+        if (expected >= found || out[expected] != i) errors++;
+        expected++;
+    }
+    CHECK(found == expected && errors == 0, "%s: %u indexes (%u wrong), loop says %u", label, found, errors,
+          expected);
+
+    uint32_t words = (count + 63) / 64;
+    memset(bitmap, 0xAB, (words + 1) * sizeof(uint64_t));
+    scan_symbol_bitmap(values, count, needle, bitmap);
+    errors = 0;
+    for (uint32_t i = 0; i < words * 64; i++) {
+        int bit = (int)((bitmap[i / 64] >> (i % 64)) & 1);
+        if (bit != (i < count && values[i] == needle)) errors++;
+    }
+    CHECK(errors == 0, "%s: %u bitmap bits wrong", label, errors);
+    CHECK(bitmap[words] == 0xABABABABABABABABull, "%s: bitmap written past word %u", label, words);
+}
+
+void test_scan(void) {
+    Symbol* values = malloc((VALUES + 1) * sizeof(Symbol));
+    uint32_t* out = malloc(VALUES * sizeof(uint32_t));
+    uint64_t* bitmap = malloc((VALUES / 64 + 2) * sizeof(uint64_t));
+    uint64_t state = 3;
+    char label[64];
+
+    // Dense and sparse needles, every length around the vector widths,
+    // and a start that is not 64-byte aligned.
+    for (uint32_t count = 0; count <= VALUES; count += count < 70 ? 1 : 97) {
+        for (uint32_t i = 0; i <= count; i++) values[i] = test_random(&state) % (count % 2 ? 3 : 40);
+        for (Symbol needle = 0; needle < 3; needle++) {
+            snprintf(label, sizeof(label), "%u values, needle %u", count, needle);
+            check_scan(values, count, needle, out, bitmap, label);
+            if (count) check_scan(values + 1, count, needle, out, bitmap, label);
+        }
+        snprintf(label, sizeof(label), "%u values, absent needle", count);
+        check_scan(values, count, 1000, out, bitmap, label);
+    }
+
+    // Store-level filters.
+    static const char* types[] = { "Person", "Object", "Place" };
+    static const char* names[] = { "owns", "likes" };
+    ConceptStore* store = create_store();
+    char id[16];
+    for (uint32_t i = 0; i < CONCEPTS; i++) {
+        snprintf(id, sizeof(id), "c%u", i);
+        store_create_concept(store, id, types[test_random(&state) % 3]);
+    }
+    for (uint32_t k = 0; k < 300; k++) store_add_slot(store, 7, names[test_random(&state) % 2], k % CONCEPTS);
+
+    uint32_t* concepts = malloc(CONCEPTS * sizeof(uint32_t));
+    for (int t = 0; t < 3; t++) {
+        uint32_t found = scan_concepts_by_type(store, types[t], concepts);
+        uint32_t expected = 0, errors = 0;
+        scan_concepts_by_type_bitmap(store, types[t], bitmap);
+        for (uint32_t i = 0; i < CONCEPTS; i++) {
+            int match = strcmp(store_concept_type(store, i), types[t]) == 0;
+            if (match && (expected >= found || concepts[expected++] != i)) errors++;
+            if ((int)((bitmap[i / 64] >> (i % 64)) & 1) != match) errors++;
+        }
+        CHECK(found == expected && errors == 0, "type %s: %u concepts (%u errors), loop says %u", types[t], found,
+              errors, expected);
+    }
+    CHECK(scan_concepts_by_type(store, "Ghost", concepts) == 0, "an unknown type matched");
+
+    for (int n = 0; n < 2; n++) {
+        uint32_t found = scan_slots_by_name(store, 7, names[n], out);
+        uint32_t expected = 0, errors = 0;
+        const Symbol* slot_names = store_slot_names(store, 7);
+        for (uint32_t i = 0; i < 300; i++) {
+            if (strcmp(symbol_name(&store->symbols, slot_names[i]), names[n]) != 0) continue;
+            if (expected >= found || out[expected] != i) errors++;
+            expected++;
+        }
+        CHECK(found == expected && errors == 0, "slots named %s: %u (%u wrong), loop says %u", names[n], found,
+              errors, expected);
+    }
+    CHECK(scan_slots_by_name(store, 7, "Ghost", out) == 0, "an unknown slot name matched");
+
+    free(concepts);
+    free_store(store);
+    free(bitmap);
+    free(out);
+    free(values);
+}
@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "scheduler.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Every index of a parallel_for() and every spawned task must run
+// exactly once, including tasks spawned from inside other tasks. The
+// suites run with more workers than this machine may have cores, so
+// stealing and sleeping both get exercised.
+
+#define RANGE 20000
+#define TREE_DEPTH 8
+#define TREE_FANOUT 3
+
+typedef struct RangeCheck {
+    uint32_t* hits;
+    uint32_t begin;
+    uint32_t end;
+    uint32_t grain;
+    uint32_t bad_ranges;
+} RangeCheck;
+
+static void mark_range(void* context, uint32_t begin, uint32_t end) {
+    RangeCheck* check = context;
+    if (begin >= end || begin < check->begin || end > check->end || end - begin > check->grain) {
+        __atomic_fetch_add(&check->bad_ranges, 1, __ATOMIC_RELAXED);
+    }
+    for (uint32_t i = begin; i < end; i++) __atomic_fetch_add(&check->hits[i], 1, __ATOMIC_RELAXED);
+}
+
+static void check_parallel_for(Scheduler* scheduler, uint32_t begin, uint32_t end, uint32_t grain) {
+    RangeCheck check = { calloc(RANGE, sizeof(uint32_t)), begin, end, grain ? grain : 1, 0 };
+    parallel_for(scheduler, begin, end, grain, mark_range, &check);
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < RANGE; i++) wrong += check.hits[i] != (i >= begin && i < end);
+    CHECK(wrong == 0, "parallel_for [%u, %u) grain %u: %u indexes not run exactly once", begin, end, grain, wrong);
+    CHECK(check.bad_ranges == 0, "parallel_for [%u, %u) grain %u: %u pieces out of bounds or over the grain",
+          begin, end, grain, check.bad_ranges);
+    free(check.hits);
+}
+
+// A task tree: each node bumps its own counter, then spawns its
+// children into a group of its own and waits for them.
+typedef struct TreeNode {
+    Scheduler* scheduler;
+    uint32_t* hits;
+    uint32_t index;             // heap numbering, root 0
+    uint32_t depth;
+} TreeNode;
+
+static void run_tree(void* arg) {
+    TreeNode* node = arg;
+    __atomic_fetch_add(&node->hits[node->index], 1, __ATOMIC_RELAXED);
+    if (node->depth == TREE_DEPTH) return;
+
+    TreeNode children[TREE_FANOUT];
+    TaskGroup group;
+    init_task_group(&group, node->scheduler);
+    for (uint32_t c = 0; c < TREE_FANOUT; c++) {
+        children[c] = *node;
+        children[c].index = node->index * TREE_FANOUT + 1 + c;
+        children[c].depth = node->depth + 1;
+        scheduler_spawn(&group, run_tree, &children[c]);
+    }
+    scheduler_wait(&group);
+}
+
+static uint32_t tree_size(void) {
+    uint32_t size = 0, level = 1;
+    for (uint32_t d = 0; d <= TREE_DEPTH; d++, level *= TREE_FANOUT) size += level;
+    return size;
+}
+
+typedef struct NestedRange {
+    Scheduler* scheduler;
+    uint32_t* hits;             // row r owns [r * 64, r * 64 + 64)
+    uint32_t bad_ranges;
+} NestedRange;
+
+static void outer_range(void* context, uint32_t begin, uint32_t end) {
+    NestedRange* nested = context;
+    for (uint32_t row = begin; row < end; row++) {
+        RangeCheck check = { nested->hits, row * 64, row * 64 + 64, 8, 0 };
+        parallel_for(nested->scheduler, row * 64, row * 64 + 64, 8, mark_range, &check);
+        __atomic_fetch_add(&nested->bad_ranges, check.bad_ranges, __ATOMIC_RELAXED);
+    }
+}
+
+typedef struct ShardCheck {
+    uint32_t hits[64];
+} ShardCheck;
+
+static void mark_shard(void* context, uint32_t shard) {
+    ShardCheck* check = context;
+    if (shard < 64) __atomic_fetch_add(&check->hits[shard], 1, __ATOMIC_RELAXED);
+}
+
+static void count_task(void* arg) {
+    __atomic_fetch_add((uint32_t*)arg, 1, __ATOMIC_RELAXED);
+}
+
+static void test_workers(uint32_t worker_count) {
+    Scheduler* scheduler = create_scheduler(worker_count);
+    CHECK(scheduler && scheduler->worker_count == worker_count, "asked for %u workers", worker_count);
+
+    // Ranges: empty, single, smaller than the grain, uneven splits.
+    static const uint32_t grains[] = { 0, 1, 7, 64, 1000, RANGE };
+    check_parallel_for(scheduler, 5, 5, 16);
+    check_parallel_for(scheduler, 9, 10, 16);
+    for (size_t g = 0; g < sizeof(grains) / sizeof(grains[0]); g++) {
+        check_parallel_for(scheduler, 0, RANGE, grains[g]);
+        check_parallel_for(scheduler, 3, RANGE - 11, grains[g]);
+    }
+
+    // Flat spawns, from outside and onto a chosen worker.
+    uint32_t* counts = calloc(RANGE, sizeof(uint32_t));
+    TaskGroup group;
+    init_task_group(&group, scheduler);
+    for (uint32_t i = 0; i < RANGE; i++) {
+        if (i % 5 == 0) {
+            scheduler_spawn_on(&group, i % worker_count, count_task, &counts[i]);
+        } else {
+            scheduler_spawn(&group, count_task, &counts[i]);
+        }
+    }
+    scheduler_wait(&group);
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < RANGE; i++) wrong += counts[i] != 1;
+    CHECK(wrong == 0 && group.pending == 0, "%u workers: %u spawned tasks not run exactly once", worker_count, wrong);
+    free(counts);
+
+    // Nested spawns: a task tree where every node waits on its children.
+    uint32_t size = tree_size();
+    TreeNode root = { scheduler, calloc(size, sizeof(uint32_t)), 0, 0 };
+    run_tree(&root);
+    wrong = 0;
+    for (uint32_t i = 0; i < size; i++) wrong += root.hits[i] != 1;
+    CHECK(wrong == 0, "%u workers: %u of %u nested tasks not run exactly once", worker_count, wrong, size);
+    free(root.hits);
+
+    // Nested parallel_for: every row of the outer loop runs an inner one.
+    NestedRange nested = { scheduler, calloc(RANGE, sizeof(uint32_t)), 0 };
+    parallel_for(scheduler, 0, RANGE / 64, 2, outer_range, &nested);
+    wrong = 0;
+    for (uint32_t i = 0; i < RANGE / 64 * 64; i++) wrong += nested.hits[i] != 1;
+    CHECK(wrong == 0 && nested.bad_ranges == 0, "%u workers: nested parallel_for missed %u indexes", worker_count,
+          wrong);
+    free(nested.hits);
+
+    // One task per shard.
+    ShardedStore* sharded = create_sharded_store(7);
+    ShardCheck shards;
+    memset(&shards, 0, sizeof(shards));
+    parallel_for_shards(scheduler, sharded, mark_shard, &shards);
+    wrong = 0;
+    for (uint32_t s = 0; s < 64; s++) wrong += shards.hits[s] != (s < 7);
+    CHECK(wrong == 0, "%u workers: parallel_for_shards ran %u shards wrongly", worker_count, wrong);
+    for (uint32_t s = 0; s < 7; s++) {
+        CHECK(scheduler_worker_for_shard(scheduler, sharded, s) < worker_count, "shard %u has no worker", s);
+    }
+    free_sharded_store(sharded);
+
+    free_scheduler(scheduler);
+}
+
+void test_scheduler(void) {
+    test_workers(1);
+    test_workers(4);
+    test_workers(9);
+}
@@ -0,0 +1,245 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "numa.h"
+#include "query.h"
+#include "shard.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Cross-shard slots go through "@shard:index" proxies. The sharded API
+// must resolve every slot, in both directions, back to the real
+// concept, and the counts must not include proxies or mirrors.
+// Per-shard indexes and queries must never expose them.
+
+#define SHARDS 4
+#define PEOPLE 40
+#define SLOTS 160
+
+// Random IDs so placement does not depend on how well the shard hash
+// spreads near-identical strings.
+static void person_id(char* id, size_t size, uint32_t person) {
+    uint64_t state = person + 1;
+    snprintf(id, size, "%08llx", (unsigned long long)test_random(&state));
+}
+
+static uint32_t person_of(ConceptHandle handle, const ConceptHandle* people) {
+    for (uint32_t i = 0; i < PEOPLE; i++) {
+        if (people[i] == handle) return i;
+    }
+    return PEOPLE;
+}
+
+typedef struct ShardAnswers {
+    const ConceptStore* store;
+    uint32_t variables;
+    uint32_t answers;
+    uint32_t proxies;
+} ShardAnswers;
+
+static int count_proxies(const uint32_t* bindings, void* user_data) {
+    ShardAnswers* answers = user_data;
+    answers->answers++;
+    for (uint32_t v = 0; v < answers->variables; v++) {
+        const char* id = store_concept_id(answers->store, bindings[v]);
+        if (!id || id[0] == '@') answers->proxies++;
+    }
+    return 0;
+}
+
+static int index_has_reserved(const ConceptStore* store, const RoaringBitmap* index) {
+    if (!index) return 0;
+    uint64_t size = roaring_cardinality(index);
+    uint32_t* members = malloc((size ? size : 1) * sizeof(uint32_t));
+    roaring_to_array(index, members);
+    int found = 0;
+    for (uint64_t i = 0; i < size; i++) found |= store_concept_id(store, members[i])[0] == '@';
+    free(members);
+    return found;
+}
+
+// Proxies stay out of the type and slot indexes and out of every
+// per-shard query answer; "?x owns ?y" sees exactly the slots with both
+// ends in the shard.
+static void check_shard_queries(const ShardedStore* sharded, const ConceptHandle* people, uint8_t owns[][PEOPLE]) {
+    static const char* patterns[] = {
+        "?x owns ?y",
+        "?y owns ?x",
+        "?x type Person; ?x owns ?y",
+        "?x owns ?y; ?y owns ?z",
+        "?x type @remote",
+    };
+    for (uint32_t s = 0; s < SHARDS; s++) {
+        const ConceptStore* store = sharded->shards[s].store;
+        const RoaringBitmap* remote = store_type_index(store, SHARD_REMOTE_TYPE);
+        CHECK(!remote || roaring_cardinality(remote) == 0, "shard %u: proxies in the type index", s);
+        CHECK(!index_has_reserved(store, store_slot_source_index(store, "owns")) &&
+                  !index_has_reserved(store, store_slot_target_index(store, "owns")),
+              "shard %u: proxies in the slot indexes", s);
+
+        for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); p++) {
+            Query* query = compile_query(store, patterns[p]);
+            if (!query) continue;
+            ShardAnswers answers = { store, query->variable_count, 0, 0 };
+            run_query(query, count_proxies, &answers);
+            CHECK(answers.proxies == 0, "shard %u, %s: %u proxy bindings in %u answers", s, patterns[p],
+                  answers.proxies, answers.answers);
+            if (p == 0) {
+                uint32_t local = 0;
+                for (uint32_t a = 0; a < PEOPLE; a++) {
+                    for (uint32_t b = 0; b < PEOPLE; b++) {
+                        local += owns[a][b] && handle_shard(people[a]) == s && handle_shard(people[b]) == s;
+                    }
+                }
+                CHECK(answers.answers == local, "shard %u: %u local owns answers, expected %u", s, answers.answers,
+                      local);
+            }
+            free_query(query);
+        }
+    }
+}
+
+static void test_resolution(void) {
+    ShardedStore* sharded = create_sharded_store(SHARDS);
+    ConceptHandle people[PEOPLE];
+    char id[32];
+    for (uint32_t i = 0; i < PEOPLE; i++) {
+        person_id(id, sizeof(id), i);
+        people[i] = sharded_create_concept(sharded, id, "Person");
+        CHECK(handle_shard(people[i]) == shard_of_id(sharded, id), "%s created outside its shard", id);
+    }
+    for (uint32_t i = 0; i < PEOPLE; i++) {
+        person_id(id, sizeof(id), i);
+        const char* name = sharded_concept_id(sharded, people[i]);
+        CHECK(sharded_find_concept(sharded, id) == people[i], "%s not found by ID", id);
+        CHECK(name && strcmp(name, id) == 0, "%s reads back as %s", id, name ? name : "(null)");
+    }
+    CHECK(sharded_find_concept(sharded, "missing") == HANDLE_NONE, "a missing ID was found");
+
+    uint8_t owns[PEOPLE][PEOPLE];
+    memset(owns, 0, sizeof(owns));
+    uint64_t state = 13;
+    uint32_t cross = 0, slots = 0;
+    for (uint32_t k = 0; k < SLOTS; k++) {
+        uint32_t source = test_random(&state) % PEOPLE;
+        uint32_t target = test_random(&state) % PEOPLE;
+        if (owns[source][target]) continue;
+        owns[source][target] = 1;
+        cross += handle_shard(people[source]) != handle_shard(people[target]);
+        slots++;
+        sharded_add_slot(sharded, people[source], "owns", people[target]);
+    }
+    CHECK(cross > 0, "no cross-shard slots: the proxy path is untested");
+    CHECK(sharded_concept_count(sharded) == PEOPLE, "%llu concepts counted, %u created",
+          (unsigned long long)sharded_concept_count(sharded), PEOPLE);
+    CHECK(sharded_slot_count(sharded) == slots, "%llu slots counted, %u added",
+          (unsigned long long)sharded_slot_count(sharded), slots);
+
+    // Both directions resolve proxies back to the real handles.
+    ConceptHandle found[PEOPLE];
+    for (uint32_t p = 0; p < PEOPLE; p++) {
+        uint32_t out = 0, in = 0;
+        for (uint32_t q = 0; q < PEOPLE; q++) {
+            out += owns[p][q];
+            in += owns[q][p];
+        }
+        uint32_t count = sharded_slots(sharded, people[p], "owns", found);
+        CHECK(count == out && sharded_degree(sharded, people[p]) == out, "person %u: %u slots, expected %u", p,
+              count, out);
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t q = person_of(found[i], people);
+            CHECK(q < PEOPLE && owns[p][q], "person %u: slot to an unknown or wrong handle", p);
+        }
+        count = sharded_in_slots(sharded, people[p], "owns", found);
+        CHECK(count == in && sharded_in_degree(sharded, people[p]) == in, "person %u: %u in-slots, expected %u", p,
+              count, in);
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t q = person_of(found[i], people);
+            CHECK(q < PEOPLE && owns[q][p], "person %u: in-slot from an unknown or wrong handle", p);
+        }
+        CHECK(sharded_slots(sharded, people[p], "likes", found) == 0, "person %u: slots under an unused name", p);
+    }
+    check_shard_queries(sharded, people, owns);
+    free_sharded_store(sharded);
+}
+
+// Spreading shards over nodes and replicating their symbol tables must
+// not change any answer, including filters on names interned after the
+// replicas were taken.
+static void test_placement(void) {
+    int nodes = numa_node_count();
+    CHECK(nodes >= 1 && nodes <= NUMA_MAX_NODES, "%d NUMA nodes", nodes);
+    int current = numa_current_node();
+    CHECK(current >= 0 && current < nodes, "current node %d of %d", current, nodes);
+
+    ShardedStore* sharded = create_sharded_store(SHARDS);
+    ConceptHandle people[PEOPLE];
+    char id[32];
+    for (uint32_t i = 0; i < PEOPLE; i++) {
+        person_id(id, sizeof(id), i);
+        people[i] = sharded_create_concept(sharded, id, "Person");
+    }
+    for (uint32_t i = 0; i + 1 < PEOPLE; i++) sharded_add_slot(sharded, people[i], "owns", people[i + 1]);
+
+    sharded_spread_nodes(sharded);
+    sharded_replicate_symbols(sharded);
+    for (uint32_t s = 0; s < SHARDS; s++) {
+        int node = sharded->shards[s].node;
+        CHECK(node == (int)(s % (uint32_t)nodes), "shard %u on node %d", s, node);
+        if (numa_node_cpu_count(node) > 0) CHECK(shard_pin_thread(sharded, s) == 0, "pinning to shard %u failed", s);
+    }
+
+    // "likes" is interned after the replicas: the master must answer.
+    for (uint32_t i = 0; i + 2 < PEOPLE; i++) sharded_add_slot(sharded, people[i], "likes", people[i + 2]);
+
+    ConceptHandle found[PEOPLE];
+    for (uint32_t i = 0; i < PEOPLE; i++) {
+        person_id(id, sizeof(id), i);
+        CHECK(sharded_find_concept(sharded, id) == people[i], "%s not found after moving shards", id);
+        uint32_t owns = sharded_slots(sharded, people[i], "owns", found);
+        CHECK(owns == (i + 1 < PEOPLE) && (!owns || found[0] == people[i + 1]), "person %u: owns wrong", i);
+        uint32_t likes = sharded_slots(sharded, people[i], "likes", found);
+        CHECK(likes == (i + 2 < PEOPLE) && (!likes || found[0] == people[i + 2]), "person %u: likes wrong", i);
+        CHECK(sharded_slots(sharded, people[i], NULL, found) == owns + likes, "person %u: unfiltered count", i);
+        CHECK(sharded_in_slots(sharded, people[i], "likes", found) == (i >= 2), "person %u: likes in-slots", i);
+    }
+
+    // Replicating again after more names appear keeps answers too.
+    sharded_replicate_symbols(sharded);
+    CHECK(sharded_slots(sharded, people[0], "likes", found) == 1 && found[0] == people[2],
+          "likes wrong after replicating again");
+    free_sharded_store(sharded);
+}
+
+// Near-identical IDs must still spread: "p0" .. "p999" within 20% of an
+// even split, and "p0" .. "p9" over more than one shard.
+static void test_spread(void) {
+    static const uint32_t counts[] = { 2, 3, 4, 8 };
+    char id[16];
+    for (uint32_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        ShardedStore* sharded = create_sharded_store(counts[c]);
+        uint32_t per_shard[8] = { 0 };
+        uint32_t short_shards = 0;
+        for (uint32_t i = 0; i < 1000; i++) {
+            snprintf(id, sizeof(id), "p%u", i);
+            uint32_t shard = shard_of_id(sharded, id);
+            CHECK(shard < counts[c], "%s mapped to shard %u of %u", id, shard, counts[c]);
+            if (shard >= counts[c]) continue;
+            if (i < 10 && per_shard[shard] == 0) short_shards++;
+            per_shard[shard]++;
+        }
+        for (uint32_t s = 0; s < counts[c]; s++) {
+            uint32_t even = 1000 / counts[c];
+            CHECK(per_shard[s] * 5 >= even * 4 && per_shard[s] * 5 <= even * 6,
+                  "%u shards: shard %u holds %u of 1000 IDs", counts[c], s, per_shard[s]);
+        }
+        CHECK(short_shards > 1, "%u shards: p0 .. p9 all in one shard", counts[c]);
+        free_sharded_store(sharded);
+    }
+}
+
+void test_shard(void) {
+    test_spread();
+    test_resolution();
+    test_placement();
+}
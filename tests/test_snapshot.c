@@ -0,0 +1,331 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "snapshot.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Pinned snapshots against a list of facts. A random run of concept
+// creation, adds and retracts opens a snapshot every few steps and
+// remembers the step it was opened at; each one must keep reading
+// exactly the facts alive at that step while the store grows, retracts,
+// compacts its slots and compacts its history underneath it. Then
+// readers on other threads, while a writer grows the symbol tables.
+
+#define INITIAL_CONCEPTS 8
+#define STEPS 3000
+#define SNAPSHOTS 16
+#define MAX_FACTS STEPS
+
+typedef struct Fact {
+    uint32_t concept;
+    uint32_t name;
+    uint32_t target;
+    uint32_t born;              // step it was added in
+    uint32_t died;              // step it was retracted in, UINT32_MAX while open
+} Fact;
+
+typedef struct Pinned {
+    StoreSnapshot snapshot;
+    uint32_t step;              // facts with born <= step < died are visible
+    uint32_t concept_count;
+} Pinned;
+
+static const char* slot_names[] = { "owns", "likes", "knows" };
+
+static int compare_keys(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t name_index(const char* name) {
+    for (uint32_t n = 0; n < 3; n++) {
+        if (strcmp(name, slot_names[n]) == 0) return n;
+    }
+    return 3;
+}
+
+// Returns the number of concepts whose view differs from the facts.
+static uint32_t check_pinned(const Pinned* pinned, const Fact* facts, uint32_t fact_count, uint64_t* actual,
+                             uint64_t* expected, uint32_t* targets, Symbol* names) {
+    const StoreSnapshot* snapshot = &pinned->snapshot;
+    uint32_t errors = snapshot->concept_count != pinned->concept_count;
+    char id[16];
+    for (uint32_t concept = 0; concept < pinned->concept_count; concept++) {
+        snprintf(id, sizeof(id), "c%u", concept);
+        const char* read = snapshot_concept_id(snapshot, concept);
+        if (snapshot_find_concept(snapshot, id) != concept || !read || strcmp(read, id) != 0) errors++;
+
+        uint32_t found = snapshot_slots(snapshot, concept, NULL, targets, names);
+        for (uint32_t i = 0; i < found; i++) {
+            actual[i] = ((uint64_t)name_index(snapshot_symbol_name(snapshot, names[i])) << 32) | targets[i];
+        }
+        uint32_t held = 0;
+        for (uint32_t f = 0; f < fact_count; f++) {
+            const Fact* fact = &facts[f];
+            if (fact->concept == concept && fact->born <= pinned->step && pinned->step < fact->died) {
+                expected[held++] = ((uint64_t)fact->name << 32) | fact->target;
+            }
+        }
+        qsort(actual, found, sizeof(uint64_t), compare_keys);
+        qsort(expected, held, sizeof(uint64_t), compare_keys);
+        if (found != held || snapshot_degree(snapshot, concept) != held ||
+            memcmp(actual, expected, held * sizeof(uint64_t)) != 0) {
+            errors++;
+        }
+    }
+    // Concepts created after the snapshot are not found.
+    snprintf(id, sizeof(id), "c%u", pinned->concept_count);
+    if (snapshot_find_concept(snapshot, id) != CONCEPT_NONE) errors++;
+    return errors;
+}
+
+static void check_all(const Pinned* pinned, uint32_t pinned_count, const Fact* facts, uint32_t fact_count,
+                      const char* label) {
+    uint64_t* actual = malloc(MAX_FACTS * sizeof(uint64_t));
+    uint64_t* expected = malloc(MAX_FACTS * sizeof(uint64_t));
+    uint32_t* targets = malloc(MAX_FACTS * sizeof(uint32_t));
+    Symbol* names = malloc(MAX_FACTS * sizeof(Symbol));
+    for (uint32_t p = 0; p < pinned_count; p++) {
+        uint32_t errors = check_pinned(&pinned[p], facts, fact_count, actual, expected, targets, names);
+        CHECK(errors == 0, "%s: snapshot opened at step %u has %u concepts differing from the facts", label,
+              pinned[p].step, errors);
+    }
+    free(actual);
+    free(expected);
+    free(targets);
+    free(names);
+}
+
+static void test_pinned_views(void) {
+    ConceptStore* store = create_store();
+    store_enable_snapshots(store);
+    char id[16];
+    uint32_t concept_count = 0;
+    for (; concept_count < INITIAL_CONCEPTS; concept_count++) {
+        snprintf(id, sizeof(id), "c%u", concept_count);
+        store_create_concept(store, id, "Thing");
+    }
+
+    Fact* facts = malloc(MAX_FACTS * sizeof(Fact));
+    uint32_t fact_count = 0;
+    Pinned pinned[SNAPSHOTS];
+    uint32_t pinned_count = 0;
+    uint64_t state = 11;
+
+    for (uint32_t step = 1; step <= STEPS; step++) {
+        uint32_t choice = test_random(&state) % 8;
+        if (choice == 0) {
+            snprintf(id, sizeof(id), "c%u", concept_count);
+            store_create_concept(store, id, "Thing");
+            concept_count++;
+        } else if (choice < 6) {
+            uint32_t concept = test_random(&state) % concept_count;
+            uint32_t name = test_random(&state) % 3;
+            uint32_t target = test_random(&state) % concept_count;
+            store_add_slot_at(store, concept, slot_names[name], target, step);
+            facts[fact_count++] = (Fact){ concept, name, target, step, UINT32_MAX };
+        } else if (fact_count > 0) {
+            Fact* victim = &facts[test_random(&state) % fact_count];
+            if (victim->died == UINT32_MAX) {
+                // Retraction closes every open duplicate too.
+                store_retract_slot(store, victim->concept, slot_names[victim->name], victim->target, step);
+                Fact closed = *victim;
+                for (uint32_t f = 0; f < fact_count; f++) {
+                    Fact* fact = &facts[f];
+                    if (fact->concept == closed.concept && fact->name == closed.name &&
+                        fact->target == closed.target && fact->died == UINT32_MAX) {
+                        fact->died = step;
+                    }
+                }
+            }
+        }
+
+        if (step % (STEPS / SNAPSHOTS) == 0 && pinned_count < SNAPSHOTS) {
+            Pinned* next = &pinned[pinned_count];
+            CHECK(open_snapshot(store, &next->snapshot) == 0, "open_snapshot failed at step %u", step);
+            next->step = step;
+            next->concept_count = concept_count;
+            pinned_count++;
+        }
+        if (step == STEPS / 2) store_compact_slots(store);
+    }
+    check_all(pinned, pinned_count, facts, fact_count, "after the run");
+
+    // Compacting the whole history keeps every slot a pinned snapshot
+    // still reads back.
+    store_compact_slots(store);
+    store_compact_history(store, STEPS + 1, 0);
+    check_all(pinned, pinned_count, facts, fact_count, "after compaction");
+
+    // Closing the older half lets compaction drop what only they saw.
+    uint32_t history_before = store->history_count;
+    uint32_t kept = 0;
+    for (uint32_t p = 0; p < pinned_count; p++) {
+        if (p < pinned_count / 2) {
+            close_snapshot(&pinned[p].snapshot);
+        } else {
+            pinned[kept++] = pinned[p];
+        }
+    }
+    uint32_t visible_history = 0;
+    for (uint32_t f = 0; f < fact_count; f++) {
+        visible_history += facts[f].died != UINT32_MAX && facts[f].died > pinned[0].step;
+    }
+    store_compact_history(store, STEPS + 1, 0);
+    CHECK(store->history_count == visible_history && visible_history < history_before,
+          "history holds %u slots after closing old snapshots, expected %u (was %u)", store->history_count,
+          visible_history, history_before);
+    check_all(pinned, kept, facts, fact_count, "after closing the older snapshots");
+
+    for (uint32_t p = 0; p < kept; p++) close_snapshot(&pinned[p].snapshot);
+    store_compact_history(store, STEPS + 1, 0);
+    CHECK(store->history_count == 0, "%u history slots left with no snapshot open", store->history_count);
+
+    free(facts);
+    free_store(store);
+}
+
+// A retraction after the snapshot moves the slot from the current
+// segment to history; reads within the snapshot keep one order. The
+// second concept is past the slots collected on the stack.
+static void test_stable_order(void) {
+    static const uint32_t degrees[] = { 5, 100 };
+    ConceptStore* store = create_store();
+    store_enable_snapshots(store);
+    store_create_concept(store, "hub", "Thing");
+    store_create_concept(store, "big", "Thing");
+    for (uint32_t t = 0; t < 100; t++) {
+        char id[16];
+        snprintf(id, sizeof(id), "t%u", t);
+        store_create_concept(store, id, "Thing");
+    }
+    for (uint32_t c = 0; c < 2; c++) {
+        for (uint32_t i = 0; i < degrees[c]; i++) store_add_slot(store, c, slot_names[i % 3], 2 + i);
+    }
+
+    uint32_t before[100], after[100];
+    Symbol before_names[100], after_names[100];
+    for (uint32_t c = 0; c < 2; c++) {
+        StoreSnapshot snapshot;
+        CHECK(open_snapshot(store, &snapshot) == 0, "open_snapshot failed");
+        uint32_t found = snapshot_slots(&snapshot, c, NULL, before, before_names);
+        store_retract_slot(store, c, slot_names[0], 2, 1);
+        uint32_t again = snapshot_slots(&snapshot, c, NULL, after, after_names);
+        CHECK(found == degrees[c] && again == found, "concept %u: %u then %u slots, expected %u", c, found, again,
+              degrees[c]);
+        CHECK(memcmp(before, after, found * sizeof(uint32_t)) == 0 &&
+              memcmp(before_names, after_names, found * sizeof(Symbol)) == 0,
+              "concept %u: slot order changed after a retraction within one snapshot", c);
+        close_snapshot(&snapshot);
+    }
+    free_store(store);
+}
+
+// ---
+// Concurrent readers
+// ---
+
+// The writer creates concept_i with one slot i → i-1, and later retracts
+// some of those slots. So in any snapshot where concept c+1 exists:
+//     - "concept_c" is found as c, and c's ID reads back as "concept_c"
+//     - c has either exactly the slot (next → c-1), or none if retracted
+//     - two reads of c's slots in one snapshot agree
+
+#define WRITER_CONCEPTS 20000
+#define READERS 2
+
+typedef struct ReaderStats {
+    ConceptStore* store;
+    volatile int* writer_done;
+    long checks;
+    long lookup_errors;
+    long slot_errors;
+    long unstable;
+} ReaderStats;
+
+static void check_concept(const StoreSnapshot* snapshot, uint32_t concept, ReaderStats* stats) {
+    char id[32];
+    snprintf(id, sizeof(id), "concept_%u", concept);
+    stats->checks++;
+
+    const char* name = snapshot_concept_id(snapshot, concept);
+    if (snapshot_find_concept(snapshot, id) != concept || !name || strcmp(name, id) != 0) stats->lookup_errors++;
+    if (concept == 0) return;
+
+    uint32_t first[4], second[4];
+    uint32_t degree = snapshot_degree(snapshot, concept);
+    if (degree > 1) {
+        stats->slot_errors++;
+        return;
+    }
+    uint32_t found = snapshot_slots(snapshot, concept, "next", first, NULL);
+    if (found != degree || (found == 1 && first[0] != concept - 1)) stats->slot_errors++;
+    uint32_t again = snapshot_slots(snapshot, concept, NULL, second, NULL);
+    if (again != found || (again == 1 && second[0] != first[0])) stats->unstable++;
+}
+
+static void* reader_main(void* argument) {
+    ReaderStats* stats = argument;
+    uint64_t state = (uint64_t)(uintptr_t)argument | 1;
+
+    // At least one pass, however fast the writer is.
+    do {
+        StoreSnapshot snapshot;
+        if (open_snapshot(stats->store, &snapshot) != 0) continue;
+        if (snapshot.concept_count > 1) {
+            for (int k = 0; k < 32; k++) {
+                check_concept(&snapshot, test_random(&state) % (snapshot.concept_count - 1), stats);
+            }
+        }
+        close_snapshot(&snapshot);
+    } while (!__atomic_load_n(stats->writer_done, __ATOMIC_ACQUIRE));
+    return NULL;
+}
+
+static void test_concurrent_readers(void) {
+    ConceptStore* store = create_store();
+    store_enable_snapshots(store);
+    volatile int writer_done = 0;
+
+    pthread_t readers[READERS];
+    ReaderStats stats[READERS];
+    memset(stats, 0, sizeof(stats));
+    for (int r = 0; r < READERS; r++) {
+        stats[r].store = store;
+        stats[r].writer_done = &writer_done;
+        pthread_create(&readers[r], NULL, reader_main, &stats[r]);
+    }
+
+    char id[32];
+    for (uint32_t i = 0; i < WRITER_CONCEPTS; i++) {
+        snprintf(id, sizeof(id), "concept_%u", i);
+        store_create_concept(store, id, i % 2 ? "Odd" : "Even");
+        if (i > 0) store_add_slot(store, i, "next", i - 1);
+        if (i >= 9 && i % 4 == 0) store_retract_slot(store, i - 8, "next", i - 9, i);
+    }
+    __atomic_store_n(&writer_done, 1, __ATOMIC_RELEASE);
+    for (int r = 0; r < READERS; r++) pthread_join(readers[r], NULL);
+
+    for (int r = 0; r < READERS; r++) {
+        CHECK(stats[r].lookup_errors == 0, "reader %d: %ld of %ld ID lookups wrong", r, stats[r].lookup_errors,
+              stats[r].checks);
+        CHECK(stats[r].slot_errors == 0, "reader %d: %ld of %ld slot reads wrong", r, stats[r].slot_errors,
+              stats[r].checks);
+        CHECK(stats[r].unstable == 0, "reader %d: %ld repeated slot reads differ", r, stats[r].unstable);
+    }
+
+    // After the writer is done, the live tables agree with the snapshots.
+    for (uint32_t i = 0; i < WRITER_CONCEPTS; i += 97) {
+        snprintf(id, sizeof(id), "concept_%u", i);
+        CHECK(find_concept_by_id(store, id) == i, "%s not found after the writer finished", id);
+    }
+    free_store(store);
+}
+
+void test_snapshot(void) {
+    test_pinned_views();
+    test_stable_order();
+    test_concurrent_readers();
+}
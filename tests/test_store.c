@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "store.h"
+#include <stdlib.h>
+#include <string.h>
+
+// The structure-of-arrays store against a plain adjacency list: every
+// concept's out- and in-segments must list its slots in insertion order,
+// through segment relocation and compaction.
+
+#define CONCEPTS 300
+#define SLOTS 3000
+#define SYMBOLS 5000
+
+typedef struct ReferenceSlot {
+    uint32_t source;
+    uint32_t name;
+    uint32_t target;
+} ReferenceSlot;
+
+static const char* slot_names[] = { "owns", "likes", "knows", "hates", "next" };
+
+static void test_symbols(void) {
+    SymbolTable table;
+    init_symbol_table(&table);
+    char name[32];
+    // Enough names to rehash the buckets several times.
+    for (uint32_t i = 0; i < SYMBOLS; i++) {
+        snprintf(name, sizeof(name), "symbol_%u", i * 7919);
+        CHECK(intern_symbol(&table, name) == i, "%s: not numbered in insertion order", name);
+    }
+    for (uint32_t i = 0; i < SYMBOLS; i++) {
+        snprintf(name, sizeof(name), "symbol_%u", i * 7919);
+        CHECK(intern_symbol(&table, name) == i, "%s: interned twice", name);
+        CHECK(find_symbol(&table, name) == i, "%s: not found", name);
+        CHECK(strcmp(symbol_name(&table, i), name) == 0, "symbol %u reads back as %s", i, symbol_name(&table, i));
+    }
+    CHECK(find_symbol(&table, "symbol_1") == SYMBOL_NONE, "found a name never interned");
+    CHECK(find_symbol(&table, "") == SYMBOL_NONE, "found the empty name");
+    free_symbol_table(&table);
+}
+
+// A concept gets STORE_INITIAL_SEGMENT slots in place; the next one
+// moves its segment. Order must survive the move, on both sides.
+static void test_third_slot(void) {
+    ConceptStore* store = create_store();
+    uint32_t john = store_create_concept(store, "john", "Person");
+    uint32_t book = store_create_concept(store, "book", "Object");
+    uint32_t mary = store_create_concept(store, "mary", "Person");
+    store_add_slot(store, john, "owns", book);
+    store_add_slot(store, mary, "owns", book);       // john's segment is no longer at the pool tail
+    store_add_slot(store, john, "likes", mary);
+    store_add_slot(store, john, "knows", mary);
+
+    static const char* names[] = { "owns", "likes", "knows" };
+    uint32_t targets[] = { book, mary, mary };
+    CHECK(store_degree(store, john) == 3, "john has %u slots, expected 3", store_degree(store, john));
+    for (uint32_t i = 0; i < 3 && i < store_degree(store, john); i++) {
+        const char* name = symbol_name(&store->symbols, store_slot_names(store, john)[i]);
+        CHECK(strcmp(name, names[i]) == 0 && store_slot_targets(store, john)[i] == targets[i],
+              "john's slot %u is %s → %u", i, name, store_slot_targets(store, john)[i]);
+    }
+    CHECK(store_degree(store, mary) == 1 && store_slot_targets(store, mary)[0] == book,
+          "mary's slot moved with john's");
+
+    // In-slots mirror them from the target's side, also in insertion order.
+    CHECK(store_in_degree(store, book) == 2 && store_in_slot_sources(store, book)[0] == john &&
+              store_in_slot_sources(store, book)[1] == mary,
+          "book's in-slots are not john, mary");
+    CHECK(store_in_degree(store, mary) == 2 && store_in_slot_sources(store, mary)[0] == john &&
+              store_in_slot_sources(store, mary)[1] == john &&
+              strcmp(symbol_name(&store->symbols, store_in_slot_names(store, mary)[1]), "knows") == 0,
+          "mary's in-slots are not likes, knows from john");
+    free_store(store);
+}
+
+static void check_against(const ConceptStore* store, const ReferenceSlot* reference, uint32_t count,
+                          const char* label) {
+    uint32_t* seen = calloc(CONCEPTS, sizeof(uint32_t));
+    uint32_t* seen_in = calloc(CONCEPTS, sizeof(uint32_t));
+    uint32_t errors = 0;
+    for (uint32_t k = 0; k < count; k++) {
+        const ReferenceSlot* slot = &reference[k];
+        uint32_t j = seen_in[slot->target]++;
+        if (j >= store_in_degree(store, slot->target) ||
+            store_in_slot_sources(store, slot->target)[j] != slot->source ||
+            strcmp(symbol_name(&store->symbols, store_in_slot_names(store, slot->target)[j]), slot_names[slot->name])) {
+            errors++;
+        }
+        uint32_t i = seen[slot->source]++;
+        if (i >= store_degree(store, slot->source)) {
+            errors++;
+            continue;
+        }
+        const char* name = symbol_name(&store->symbols, store_slot_names(store, slot->source)[i]);
+        if (strcmp(name, slot_names[slot->name]) != 0 || store_slot_targets(store, slot->source)[i] != slot->target) {
+            errors++;
+        }
+    }
+    for (uint32_t c = 0; c < CONCEPTS; c++) {
+        if (seen[c] != store_degree(store, c) || seen_in[c] != store_in_degree(store, c)) errors++;
+    }
+    CHECK(errors == 0, "%s: %u segment entries differ from the adjacency list", label, errors);
+    CHECK(store->slot_count == count, "%s: slot_count %u, expected %u", label, store->slot_count, count);
+    free(seen_in);
+    free(seen);
+}
+
+void test_store(void) {
+    test_symbols();
+    test_third_slot();
+
+    ConceptStore* store = create_store();
+    char id[16];
+    for (uint32_t i = 0; i < CONCEPTS; i++) {
+        snprintf(id, sizeof(id), "c%u", i);
+        CHECK(store_create_concept(store, id, i % 3 ? "Person" : "Object") == i, "%s: not concept %u", id, i);
+    }
+    CHECK(store_create_concept(store, "c17", "Place") == 17, "a repeated ID created a new concept");
+    CHECK(store->concept_count == CONCEPTS, "%u concepts, expected %u", store->concept_count, CONCEPTS);
+
+    // Skewed sources, so some segments relocate many times.
+    ReferenceSlot* reference = malloc(SLOTS * sizeof(ReferenceSlot));
+    uint64_t state = 21;
+    for (uint32_t k = 0; k < SLOTS; k++) {
+        uint32_t source = test_random(&state) % CONCEPTS;
+        if (k % 2) source %= 8;
+        reference[k] = (ReferenceSlot){ source, test_random(&state) % 5, test_random(&state) % CONCEPTS };
+        store_add_slot(store, source, slot_names[reference[k].name], reference[k].target);
+    }
+    check_against(store, reference, SLOTS, "after adds");
+    store_compact_slots(store);
+    CHECK(store->slots.dead == 0 && store->in_slots.dead == 0, "compaction left %u + %u dead slots", store->slots.dead,
+          store->in_slots.dead);
+    check_against(store, reference, SLOTS, "after compaction");
+
+    for (uint32_t i = 0; i < CONCEPTS; i++) {
+        snprintf(id, sizeof(id), "c%u", i);
+        CHECK(find_concept_by_id(store, id) == i, "find_concept_by_id(%s) = %u", id, find_concept_by_id(store, id));
+        CHECK(strcmp(store_concept_id(store, i), id) == 0, "concept %u reads back as %s", i,
+              store_concept_id(store, i));
+        CHECK(strcmp(store_concept_type(store, i), i % 3 ? "Person" : "Object") == 0, "%s has type %s", id,
+              store_concept_type(store, i));
+    }
+    CHECK(find_concept_by_id(store, "nobody") == CONCEPT_NONE, "found an ID never created");
+    free(reference);
+    free_store(store);
+}
@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "store.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Temporal slots against a list of facts with [from, to) intervals. A
+// random history of adds, retracts and overwrites (retract the old
+// target, add a new one at the same time) is replayed, then every
+// concept is read as of every time, before and after compaction.
+
+#define CONCEPTS 12
+#define TARGETS 6
+#define STEPS 600
+#define MAX_FACTS (STEPS * 2)
+
+typedef struct Fact {
+    uint32_t concept;
+    uint32_t name;
+    uint32_t target;
+    uint64_t from;
+    uint64_t to;                // SLOT_TIME_MAX while open
+} Fact;
+
+static const char* slot_names[] = { "owns", "likes" };
+
+static uint64_t encode(uint32_t name, uint32_t target) {
+    return (uint64_t)name * CONCEPTS + target;
+}
+
+static int compare_keys(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t retract(ConceptStore* store, Fact* facts, uint32_t fact_count, uint32_t concept, uint32_t name,
+                        uint32_t target, uint64_t now) {
+    uint32_t closed = 0;
+    for (uint32_t f = 0; f < fact_count; f++) {
+        Fact* fact = &facts[f];
+        if (fact->concept == concept && fact->name == name && fact->target == target && fact->to == SLOT_TIME_MAX) {
+            fact->to = now;
+            closed++;
+        }
+    }
+    uint32_t retracted = store_retract_slot(store, concept, slot_names[name], target, now);
+    CHECK(retracted == closed, "retract %u %s %u at %llu: closed %u, expected %u", concept, slot_names[name], target,
+          (unsigned long long)now, retracted, closed);
+    return closed;
+}
+
+// Every concept as of every time in [first, last], as a sorted multiset.
+static void check_as_of(const ConceptStore* store, const Fact* facts, uint32_t fact_count, uint64_t first,
+                        uint64_t last, const char* label) {
+    uint32_t targets[MAX_FACTS];
+    Symbol names[MAX_FACTS];
+    uint64_t actual[MAX_FACTS], expected[MAX_FACTS];
+    uint32_t errors = 0;
+    for (uint32_t concept = 0; concept < CONCEPTS; concept++) {
+        for (uint64_t as_of = first; as_of <= last; as_of++) {
+            uint32_t found = store_slots_as_of(store, concept, NULL, as_of, targets, names);
+            for (uint32_t i = 0; i < found; i++) {
+                uint32_t name = strcmp(symbol_name(&store->symbols, names[i]), slot_names[0]) == 0 ? 0 : 1;
+                actual[i] = encode(name, targets[i]);
+            }
+            uint32_t held = 0;
+            for (uint32_t f = 0; f < fact_count; f++) {
+                const Fact* fact = &facts[f];
+                if (fact->concept == concept && fact->from <= as_of && as_of < fact->to) {
+                    expected[held++] = encode(fact->name, fact->target);
+                }
+            }
+            qsort(actual, found, sizeof(uint64_t), compare_keys);
+            qsort(expected, held, sizeof(uint64_t), compare_keys);
+            if (found != held || memcmp(actual, expected, held * sizeof(uint64_t)) != 0) errors++;
+
+            // The name filter keeps exactly the matching ones.
+            uint32_t owns = store_slots_as_of(store, concept, "owns", as_of, targets, NULL);
+            uint32_t expected_owns = 0;
+            for (uint32_t i = 0; i < held; i++) expected_owns += expected[i] < CONCEPTS;
+            if (owns != expected_owns) errors++;
+        }
+    }
+    CHECK(errors == 0, "%s: %u as-of reads differ from the fact list", label, errors);
+}
+
+// Current state: live segments and indexes hold exactly the open facts.
+static void check_current(const ConceptStore* store, const Fact* facts, uint32_t fact_count, const char* label) {
+    uint32_t open[CONCEPTS] = { 0 }, open_in[CONCEPTS] = { 0 };
+    uint8_t has_source[2][CONCEPTS] = { { 0 } }, has_target[2][CONCEPTS] = { { 0 } };
+    uint32_t total = 0;
+    for (uint32_t f = 0; f < fact_count; f++) {
+        if (facts[f].to != SLOT_TIME_MAX) continue;
+        open[facts[f].concept]++;
+        open_in[facts[f].target]++;
+        has_source[facts[f].name][facts[f].concept] = 1;
+        has_target[facts[f].name][facts[f].target] = 1;
+        total++;
+    }
+    uint32_t errors = 0;
+    for (uint32_t c = 0; c < CONCEPTS; c++) {
+        if (store_degree(store, c) != open[c] || store_in_degree(store, c) != open_in[c]) errors++;
+        for (int n = 0; n < 2; n++) {
+            const RoaringBitmap* sources = store_slot_source_index(store, slot_names[n]);
+            const RoaringBitmap* targets = store_slot_target_index(store, slot_names[n]);
+            if (roaring_contains(sources, c) != has_source[n][c]) errors++;
+            if (roaring_contains(targets, c) != has_target[n][c]) errors++;
+        }
+    }
+    CHECK(errors == 0, "%s: %u current degrees or index entries differ from the open facts", label, errors);
+    CHECK(store->slot_count == total, "%s: slot_count %u, %u facts open", label, store->slot_count, total);
+}
+
+static void test_history(void) {
+    ConceptStore* store = create_store();
+    char id[16];
+    for (uint32_t i = 0; i < CONCEPTS; i++) {
+        snprintf(id, sizeof(id), "c%u", i);
+        store_create_concept(store, id, "Thing");
+    }
+
+    Fact* facts = malloc(MAX_FACTS * sizeof(Fact));
+    uint32_t fact_count = 0;
+    uint64_t state = 5;
+    for (uint64_t now = 1; now <= STEPS; now++) {
+        uint32_t concept = test_random(&state) % CONCEPTS;
+        uint32_t name = test_random(&state) % 2;
+        uint32_t target = test_random(&state) % TARGETS;
+        switch (test_random(&state) % 4) {
+        case 0:
+        case 1:
+            store_add_slot_at(store, concept, slot_names[name], target, now);
+            facts[fact_count++] = (Fact){ concept, name, target, now, SLOT_TIME_MAX };
+            break;
+        case 2:
+            retract(store, facts, fact_count, concept, name, target, now);
+            break;
+        case 3: {
+            // Overwrite: move one open fact of this concept to a new target.
+            for (uint32_t f = fact_count; f > 0; f--) {
+                Fact old = facts[f - 1];
+                if (old.concept != concept || old.to != SLOT_TIME_MAX) continue;
+                retract(store, facts, fact_count, concept, old.name, old.target, now);
+                store_add_slot_at(store, concept, slot_names[old.name], target, now);
+                facts[fact_count++] = (Fact){ concept, old.name, target, now, SLOT_TIME_MAX };
+                break;
+            }
+            break;
+        }
+        }
+    }
+    check_current(store, facts, fact_count, "after the history");
+    check_as_of(store, facts, fact_count, 0, STEPS + 1, "before compaction");
+
+    // Compaction drops exactly the facts closed before the window, and
+    // every read inside the window stays the same.
+    uint64_t retention = STEPS / 3, cutoff = STEPS - retention;
+    uint32_t expected_drop = 0, kept = 0;
+    for (uint32_t f = 0; f < fact_count; f++) {
+        if (facts[f].to < cutoff) {
+            expected_drop++;
+        } else {
+            facts[kept++] = facts[f];
+        }
+    }
+    uint32_t dropped = store_compact_history(store, STEPS, retention);
+    CHECK(dropped == expected_drop, "compaction dropped %u closed slots, expected %u", dropped, expected_drop);
+    CHECK(store->history_count == kept - store->slot_count, "history holds %u slots, expected %u",
+          store->history_count, kept - store->slot_count);
+    check_current(store, facts, kept, "after compaction");
+    check_as_of(store, facts, kept, cutoff, STEPS + 1, "after compaction");
+
+    free(facts);
+    free_store(store);
+}
+
+void test_temporal(void) {
+    test_history();
+}
@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "trie.h"
+#include <stdlib.h>
+#include <string.h>
+
+// The token-ID trie against a naive scan over every pattern, in one
+// pass and streamed token by token; then the text entry points through
+// a toy word-level encoder standing in for llama2.c's encode().
+
+#define MAX_MENTIONS 200000
+
+static int compare_mentions(const void* a, const void* b) {
+    const EntityMention* x = a;
+    const EntityMention* y = b;
+    if (x->begin != y->begin) return x->begin < y->begin ? -1 : 1;
+    if (x->end != y->end) return x->end > y->end ? -1 : 1;
+    return (x->pattern > y->pattern) - (x->pattern < y->pattern);
+}
+
+static void check_same_mentions(EntityMention* actual, uint32_t actual_count, EntityMention* expected,
+                                uint32_t expected_count, const char* label) {
+    CHECK(actual_count == expected_count, "%s: %u mentions, naive scan %u", label, actual_count, expected_count);
+    if (actual_count != expected_count) return;
+    qsort(actual, actual_count, sizeof(EntityMention), compare_mentions);
+    qsort(expected, expected_count, sizeof(EntityMention), compare_mentions);
+    for (uint32_t i = 0; i < actual_count; i++) {
+        const EntityMention* x = &actual[i];
+        const EntityMention* y = &expected[i];
+        if (x->begin != y->begin || x->end != y->end || x->pattern != y->pattern || x->concept != y->concept) {
+            CHECK(0, "%s: mention %u is [%u, %u) pattern %u, naive [%u, %u) pattern %u", label, i, x->begin, x->end,
+                  x->pattern, y->begin, y->end, y->pattern);
+            return;
+        }
+    }
+}
+
+// ---
+// Token-ID trie
+// ---
+
+static void test_random_patterns(EntityMention* actual, EntityMention* expected) {
+    enum { TOKENS = 4000, PATTERNS = 300, MAX_LENGTH = 4 };
+    int* sequence = malloc(TOKENS * sizeof(int));
+    int patterns[PATTERNS][MAX_LENGTH];
+    uint32_t lengths[PATTERNS];
+    uint64_t state = 31;
+    for (uint32_t t = 0; t < TOKENS; t++) sequence[t] = (int)(test_random(&state) % 5) * 1000;
+
+    TokenTrie trie;
+    init_token_trie(&trie, 32000);
+    for (uint32_t p = 0; p < PATTERNS; p++) {
+        lengths[p] = 1 + test_random(&state) % MAX_LENGTH;
+        for (uint32_t i = 0; i < lengths[p]; i++) patterns[p][i] = (int)(test_random(&state) % 5) * 1000;
+        token_trie_add(&trie, patterns[p], lengths[p], p + 7);
+        if (p == PATTERNS / 2) token_trie_compile(&trie);  // recompile after more adds
+    }
+    token_trie_compile(&trie);
+
+    uint32_t reference = 0;
+    for (uint32_t p = 0; p < PATTERNS; p++) {
+        for (uint32_t begin = 0; begin + lengths[p] <= TOKENS; begin++) {
+            if (memcmp(sequence + begin, patterns[p], lengths[p] * sizeof(int)) == 0) {
+                expected[reference++] = (EntityMention){ begin, begin + lengths[p], p + 7, p };
+            }
+        }
+    }
+    uint32_t found = token_trie_scan(&trie, sequence, TOKENS, actual, MAX_MENTIONS);
+    check_same_mentions(actual, found, expected, reference, "token trie");
+
+    // Streaming one token at a time must report exactly the same.
+    TokenStream stream;
+    init_token_stream(&stream);
+    uint32_t streamed = 0;
+    for (uint32_t t = 0; t < TOKENS; t++) {
+        streamed += token_stream_push(&trie, &stream, sequence[t], actual + streamed, MAX_MENTIONS - streamed);
+    }
+    // `expected` still holds the same set, sorted by the check above.
+    check_same_mentions(actual, streamed, expected, reference, "token stream");
+
+    // Empty patterns and tokens outside the vocabulary are refused.
+    int outside[2] = { 5, 32000 };
+    CHECK(token_trie_add(&trie, outside, 0, 1) == TOKEN_NONE && token_trie_add(&trie, outside, 2, 1) == TOKEN_NONE,
+          "token trie took an empty or out-of-vocabulary pattern");
+
+    free_token_trie(&trie);
+    free(sequence);
+}
+
+// ---
+// Text through an encoder
+// ---
+
+// One token per space-separated word, case-sensitive, IDs handed out on
+// first sight: enough to tell which strings the trie was given.
+typedef struct WordVocabulary {
+    char words[64][24];
+    uint32_t count;
+    uint32_t calls;
+} WordVocabulary;
+
+static uint32_t encode_words(void* context, const char* text, int* tokens, uint32_t capacity) {
+    WordVocabulary* vocabulary = context;
+    uint32_t count = 0;
+    vocabulary->calls++;
+    while (*text) {
+        while (*text == ' ') text++;
+        uint32_t length = (uint32_t)strcspn(text, " ");
+        if (length == 0) break;
+        uint32_t id = 0;
+        while (id < vocabulary->count &&
+               (strlen(vocabulary->words[id]) != length || strncmp(vocabulary->words[id], text, length) != 0)) {
+            id++;
+        }
+        if (id == vocabulary->count && id < 64 && length < 24) {
+            memcpy(vocabulary->words[id], text, length);
+            vocabulary->words[id][length] = '\0';
+            vocabulary->count++;
+        }
+        if (count < capacity) tokens[count] = (int)(id * 10 + 1);
+        count++;
+        text += length;
+    }
+    return count < capacity ? count : capacity;
+}
+
+static uint32_t scan_text(const TokenTrie* trie, WordVocabulary* vocabulary, const char* text, EntityMention* out) {
+    int tokens[32];
+    uint32_t count = encode_words(vocabulary, text, tokens, 32);
+    return token_trie_scan(trie, tokens, count, out, 16);
+}
+
+static void test_text(EntityMention* actual) {
+    WordVocabulary vocabulary = { .count = 0 };
+    TokenTrie trie;
+    init_token_trie(&trie, 1000);
+    CHECK(token_trie_add_text(&trie, "new york", 1, encode_words, &vocabulary) == 0 &&
+              token_trie_add_text(&trie, "new york city", 2, encode_words, &vocabulary) == 1 &&
+              token_trie_add_text(&trie, "york", 3, encode_words, &vocabulary) == 2,
+          "token_trie_add_text did not return pattern ids");
+    CHECK(token_trie_add_text(&trie, "", 4, encode_words, &vocabulary) == TOKEN_NONE, "an empty text was added");
+
+    // Too many tokens to be a pattern.
+    char long_text[2 * (TOKEN_TRIE_MAX_PATTERN + 1) + 1];
+    for (uint32_t i = 0; i <= TOKEN_TRIE_MAX_PATTERN; i++) memcpy(long_text + 2 * i, "a ", 2);
+    long_text[2 * (TOKEN_TRIE_MAX_PATTERN + 1)] = '\0';
+    CHECK(token_trie_add_text(&trie, long_text, 5, encode_words, &vocabulary) == TOKEN_NONE,
+          "a text past TOKEN_TRIE_MAX_PATTERN tokens was added");
+    token_trie_compile(&trie);
+
+    uint32_t found = scan_text(&trie, &vocabulary, "we love new york city", actual);
+    qsort(actual, found < 16 ? found : 16, sizeof(EntityMention), compare_mentions);
+    CHECK(found == 3 && actual[0].concept == 2 && actual[0].begin == 2 && actual[0].end == 5 &&
+              actual[1].concept == 1 && actual[1].end == 4 && actual[2].concept == 3 && actual[2].begin == 3,
+          "new york city: %u mentions", found);
+    free_token_trie(&trie);
+}
+
+// Every matcher pattern is tokenized once, and only new ones on a later
+// sync; a case-sensitive matcher hands over its strings unchanged.
+// A folding matcher still hands over its patterns as they were added:
+// the trie sees "John Smith", not "john smith".
+static void test_sync(EntityMention* actual) {
+    static const uint32_t flags[] = { 0, MATCHER_FOLD_CASE | MATCHER_WHOLE_WORDS };
+    for (uint32_t f = 0; f < 2; f++) {
+        WordVocabulary vocabulary = { .count = 0 };
+        EntityMatcher matcher;
+        TokenTrie trie;
+        init_entity_matcher(&matcher, flags[f]);
+        init_token_trie(&trie, 1000);
+        matcher_add(&matcher, "John Smith", 10);
+        matcher_add(&matcher, "Acme", 11);
+        CHECK(token_trie_sync_matcher(&trie, &matcher, encode_words, &vocabulary) == 2 && vocabulary.calls == 2,
+              "flags %u: sync did not tokenize the two patterns", flags[f]);
+        CHECK(token_trie_sync_matcher(&trie, &matcher, encode_words, &vocabulary) == 0 && vocabulary.calls == 2,
+              "flags %u: a second sync tokenized patterns again", flags[f]);
+        matcher_add(&matcher, "Jon", 10);
+        CHECK(token_trie_sync_matcher(&trie, &matcher, encode_words, &vocabulary) == 1,
+              "flags %u: sync missed a new pattern", flags[f]);
+        token_trie_compile(&trie);
+
+        uint32_t found = scan_text(&trie, &vocabulary, "John Smith and Jon of Acme met john", actual);
+        qsort(actual, found < 16 ? found : 16, sizeof(EntityMention), compare_mentions);
+        CHECK(found == 3 && actual[0].concept == 10 && actual[0].end == 2 && actual[1].concept == 10 &&
+                  actual[1].begin == 3 && actual[2].concept == 11 && actual[2].begin == 5,
+              "flags %u: synced trie: %u mentions", flags[f], found);
+        free_token_trie(&trie);
+        free_entity_matcher(&matcher);
+    }
+}
+
+void test_trie(void) {
+    EntityMention* actual = malloc(MAX_MENTIONS * sizeof(EntityMention));
+    EntityMention* expected = malloc(MAX_MENTIONS * sizeof(EntityMention));
+    test_random_patterns(actual, expected);
+    test_text(actual);
+    test_sync(actual);
+    free(expected);
+    free(actual);
+}
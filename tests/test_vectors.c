@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: CAL-1.0
+
+#include "test.h"
+#include "vectors.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Attach, overwrite and detach embeddings against a plain copy of each
+// row, across growth past max_concepts. Rows must stay 64-byte aligned
+// and their padding zero, since kernels read the whole stride.
+
+#define DIMENSIONS 37               // not a multiple of 16: rows are padded
+#define MAX_CONCEPTS 100
+#define CONCEPTS 700
+
+static void fill(float* embedding, uint32_t concept, uint32_t version) {
+    for (uint32_t d = 0; d < DIMENSIONS; d++) embedding[d] = (float)concept + (float)d / 64.0f + (float)version;
+}
+
+static uint32_t check_rows(const ConceptVectorStore* store, const float* copies, const uint8_t* present) {
+    uint32_t errors = 0, count = 0;
+    for (uint32_t c = 0; c < CONCEPTS; c++) {
+        const float* row = vector_of(store, c);
+        count += present[c];
+        if (!!row != present[c] || vector_present(store, c) != present[c]) {
+            errors++;
+            continue;
+        }
+        if (!row) continue;
+        if ((uintptr_t)row % 64 != 0 || memcmp(row, copies + c * DIMENSIONS, DIMENSIONS * sizeof(float)) != 0) {
+            errors++;
+        }
+        for (uint32_t d = DIMENSIONS; d < store->stride; d++) errors += row[d] != 0.0f;
+    }
+    return errors + (store->n_concepts != count);
+}
+
+void test_vectors(void) {
+    ConceptVectorStore store;
+    init_vector_store(&store, DIMENSIONS, MAX_CONCEPTS);
+    CHECK(store.stride % VECTOR_ALIGN_FLOATS == 0 && store.stride >= DIMENSIONS, "stride %u for %u dimensions",
+          store.stride, DIMENSIONS);
+    CHECK(vector_of(&store, 0) == NULL && vector_of(&store, UINT32_MAX) == NULL, "rows present before attach");
+
+    float* copies = calloc(CONCEPTS * DIMENSIONS, sizeof(float));
+    uint8_t* present = calloc(CONCEPTS, 1);
+    float embedding[DIMENSIONS];
+    uint64_t state = 31;
+
+    // Random attaches (some past max_concepts, so the matrix grows),
+    // overwrites and detaches.
+    for (uint32_t step = 0; step < 4 * CONCEPTS; step++) {
+        uint32_t concept = test_random(&state) % (step < CONCEPTS ? MAX_CONCEPTS : CONCEPTS);
+        if (test_random(&state) % 4 == 0) {
+            vector_detach(&store, concept);
+            present[concept] = 0;
+        } else {
+            fill(embedding, concept, step);
+            float* row = vector_attach(&store, concept, embedding);
+            CHECK(row && row == vector_of(&store, concept), "attach of %u returned a different row", concept);
+            memcpy(copies + concept * DIMENSIONS, embedding, sizeof(embedding));
+            present[concept] = 1;
+        }
+        if (step % 500 == 0) CHECK(check_rows(&store, copies, present) == 0, "rows differ at step %u", step);
+    }
+    CHECK(check_rows(&store, copies, present) == 0, "rows differ after the run");
+    CHECK(store.capacity >= CONCEPTS, "capacity %u after attaching row %u", store.capacity, CONCEPTS - 1);
+
+    // Detaching zeroes the row; detaching twice is harmless.
+    vector_detach(&store, 1);
+    vector_detach(&store, 1);
+    present[1] = 0;
+    CHECK(check_rows(&store, copies, present) == 0, "rows differ after detaching twice");
+    const float* row = store.vectors + store.stride;
+    uint32_t nonzero = 0;
+    for (uint32_t d = 0; d < store.stride; d++) nonzero += row[d] != 0.0f;
+    CHECK(nonzero == 0, "detached row keeps %u values", nonzero);
+
+    free(copies);
+    free(present);
+    free_vector_store(&store);
+}